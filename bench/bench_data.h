@@ -0,0 +1,125 @@
+#pragma once
+
+#include "benchmark.h"
+
+#include "../lib/cjson/cjson.h"
+#include "../src/config.h"
+#include "../src/database.h"
+#include "../src/table.h"
+#include "../src/properties.h"
+#include "../src/asyncpool.h"
+#include "../src/tablepartitioned.h"
+#include "../src/internoderouter.h"
+
+/*
+    Synthetic data shared by the benchmark units.
+
+    The engine objects are created the same way the unit tests create them
+    (see test/test_db.h), with the async pool suspended so nothing runs in the
+    background while we time things.
+*/
+
+static const char* BENCH_TABLE = "__bench__";
+static const int BENCH_CUSTOMERS = 256;
+static const int BENCH_EVENTS_PER_CUSTOMER = 40;
+
+inline void benchEnvironment()
+{
+    static auto initialized = false;
+
+    if (initialized)
+        return;
+
+    initialized = true;
+
+    openset::config::CommandlineArgs args;
+    openset::globals::running = new openset::config::Config(args);
+
+    // stop load/save objects from doing anything
+    openset::globals::running->testMode = true;
+
+    const auto async = new openset::async::AsyncPool(1, 1); // 1 worker
+
+    const auto mapper = new openset::mapping::Mapper();
+    mapper->startRouter();
+
+    async->suspendAsync();
+
+    new openset::db::Database();
+}
+
+// returns a JSON array of `count` events for `customerId`. Values are drawn
+// from fixed cardinalities so attribute index sizes stay realistic.
+inline std::string benchMakeEvents(const std::string& customerId, const int count)
+{
+    static const std::vector<std::string> events = { "page_view", "add_to_cart", "purchase", "search", "login" };
+
+    cjson doc(cjson::Types_e::ARRAY);
+
+    auto stamp = 1545220000000LL;
+
+    for (auto i = 0; i < count; ++i)
+    {
+        // sessions: mostly short gaps with an occasional long one
+        stamp += benchRandomInt(0, 9) ? benchRandomInt(1'000, 120'000) : benchRandomInt(3'600'000, 86'400'000);
+
+        auto row = doc.pushObject();
+        row->set("id", customerId);
+        row->set("stamp", static_cast<int64_t>(stamp));
+        row->set("event", events[benchRandomInt(0, events.size() - 1)]);
+        row->set("page", "page_" + to_string(benchRandomInt(0, 49)));
+        row->set("referrer", "site_" + to_string(benchRandomInt(0, 999)));
+        row->set("price", static_cast<double>(benchRandomInt(100, 99'999)) / 100.0);
+        row->set("qty", benchRandomInt(1, 10));
+
+        auto tags = row->setArray("tags");
+        for (auto t = benchRandomInt(0, 3); t > 0; --t)
+            tags->push("tag_" + to_string(benchRandomInt(0, 19)));
+    }
+
+    return cjson::stringify(&doc);
+}
+
+// creates the bench table and fills partition zero with BENCH_CUSTOMERS customers
+inline openset::db::Database::TablePtr benchMakeTable()
+{
+    benchEnvironment();
+
+    if (auto table = openset::globals::database->getTable(BENCH_TABLE); table)
+        return table;
+
+    auto table = openset::globals::database->newTable(BENCH_TABLE, false);
+    auto columns = table->getProperties();
+
+    auto col = 1000;
+    columns->setProperty(++col, "page", openset::db::PropertyTypes_e::textProp, false);
+    columns->setProperty(++col, "referrer", openset::db::PropertyTypes_e::textProp, false);
+    columns->setProperty(++col, "price", openset::db::PropertyTypes_e::doubleProp, false);
+    columns->setProperty(++col, "qty", openset::db::PropertyTypes_e::intProp, false);
+    columns->setProperty(++col, "tags", openset::db::PropertyTypes_e::textProp, true);
+
+    auto parts = table->getPartitionObjects(0, true);
+
+    openset::db::Customer person;
+    person.mapTable(table.get(), 0);
+
+    for (auto i = 0; i < BENCH_CUSTOMERS; ++i)
+    {
+        const auto customerId = "customer_" + to_string(i);
+        const auto personRaw = parts->people.createCustomer(customerId);
+
+        person.mount(personRaw);
+        person.prepare();
+
+        cjson insertJSON(benchMakeEvents(customerId, BENCH_EVENTS_PER_CUSTOMER), cjson::Mode_e::string);
+
+        for (auto e : insertJSON.getNodes())
+            person.insert(e);
+
+        person.commit();
+    }
+
+    parts->attributes.clearDirty();
+
+    return table;
+}
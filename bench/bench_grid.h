@@ -0,0 +1,78 @@
+#pragma once
+
+#include "benchmark.h"
+#include "bench_data.h"
+
+#include "../src/customer.h"
+
+inline Benchmarks bench_grid()
+{
+    // pre-parsed insert batches, one per customer, so JSON parsing is not timed here
+    auto batches = std::make_shared<std::vector<std::shared_ptr<cjson>>>();
+
+    const auto setup = [=]()
+    {
+        benchMakeTable();
+
+        if (batches->size())
+            return;
+
+        for (auto i = 0; i < BENCH_CUSTOMERS; ++i)
+            batches->emplace_back(
+                std::make_shared<cjson>(
+                    benchMakeEvents("customer_" + to_string(i), 10),
+                    cjson::Mode_e::string));
+    };
+
+    return {
+        {
+            "grid: mount/prepare (decode) customer",
+            BENCH_CUSTOMERS,
+            setup,
+            [=](int64_t ops)
+            {
+                const auto table = openset::globals::database->getTable(BENCH_TABLE);
+                const auto parts = table->getPartitionObjects(0, false);
+
+                openset::db::Customer person;
+                person.mapTable(table.get(), 0);
+
+                for (auto i = 0; i < ops; ++i)
+                {
+                    person.mount(parts->people.getCustomerByLIN(i % BENCH_CUSTOMERS));
+                    person.prepare();
+                }
+            }
+        },
+        {
+            "grid: insertEvent x10 + commit",
+            BENCH_CUSTOMERS,
+            setup,
+            [=](int64_t ops)
+            {
+                const auto table = openset::globals::database->getTable(BENCH_TABLE);
+                const auto parts = table->getPartitionObjects(0, false);
+
+                openset::db::Customer person;
+                person.mapTable(table.get(), 0);
+
+                // re-inserting the same batch replaces matching rows, so customer
+                // size stays constant from one sample to the next
+                for (auto i = 0; i < ops; ++i)
+                {
+                    const auto linId = i % BENCH_CUSTOMERS;
+
+                    person.mount(parts->people.getCustomerByLIN(linId));
+                    person.prepare();
+
+                    for (auto e : (*batches)[linId]->getNodes())
+                        person.insert(e);
+
+                    person.commit();
+                }
+
+                parts->attributes.clearDirty();
+            }
+        },
+    };
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "benchmark.h"
+#include "../src/indexbits.h"
+#include "../lib/sba/sba.h"
+
+inline Benchmarks bench_indexbits()
+{
+    using namespace openset::db;
+
+    // ~1M customers per partition is a large but realistic partition
+    const int64_t bitCount = 1'000'000;
+
+    // shared between the items below, allocated once
+    auto left = std::make_shared<IndexBits>();
+    auto right = std::make_shared<IndexBits>();
+    auto work = std::make_shared<IndexBits>();
+
+    const auto fillSparse = [=]()
+    {
+        left->makeBits(bitCount, 0);
+        right->makeBits(bitCount, 0);
+
+        // ~5% population, the shape of a typical attribute index
+        for (auto i = 0; i < bitCount / 20; ++i)
+        {
+            left->bitSet(benchRandomInt(0, bitCount - 1));
+            right->bitSet(benchRandomInt(0, bitCount - 1));
+        }
+    };
+
+    return {
+        {
+            "indexbits: opAnd 1M bits",
+            100,
+            fillSparse,
+            [=](int64_t ops)
+            {
+                for (auto i = 0; i < ops; ++i)
+                {
+                    work->opCopy(*left);
+                    work->opAnd(*right);
+                }
+                benchKeep(work->bits[0]);
+            }
+        },
+        {
+            "indexbits: opOr 1M bits",
+            100,
+            fillSparse,
+            [=](int64_t ops)
+            {
+                for (auto i = 0; i < ops; ++i)
+                {
+                    work->opCopy(*left);
+                    work->opOr(*right);
+                }
+                benchKeep(work->bits[0]);
+            }
+        },
+        {
+            "indexbits: population 1M bits",
+            100,
+            fillSparse,
+            [=](int64_t ops)
+            {
+                int64_t total = 0;
+                for (auto i = 0; i < ops; ++i)
+                    total += left->population(bitCount);
+                benchKeep(total);
+            }
+        },
+        {
+            "indexbits: linearIter 1M bits (5% set)",
+            10,
+            fillSparse,
+            [=](int64_t ops)
+            {
+                int64_t total = 0;
+                for (auto i = 0; i < ops; ++i)
+                {
+                    int64_t linId = -1;
+                    while (left->linearIter(linId, bitCount))
+                        total += linId;
+                }
+                benchKeep(total);
+            }
+        },
+        {
+            "indexbits: bitSet/bitClear random",
+            1'000'000,
+            fillSparse,
+            [=](int64_t ops)
+            {
+                for (auto i = 0; i < ops; ++i)
+                {
+                    const auto idx = (i * 7919) % bitCount;
+                    if (i & 1)
+                        work->bitClear(idx);
+                    else
+                        work->bitSet(idx);
+                }
+                benchKeep(work->bits[0]);
+            }
+        },
+        {
+            "indexbits: store/mount (LZ4) 1M bits",
+            20,
+            fillSparse,
+            [=](int64_t ops)
+            {
+                for (auto i = 0; i < ops; ++i)
+                {
+                    int64_t compBytes = 0;
+                    int64_t linId = 0;
+                    int32_t offset = 0;
+                    int32_t length = 0;
+
+                    const auto compData = left->store(compBytes, linId, offset, length);
+
+                    IndexBits restored;
+                    restored.mount(compData, left->ints, offset, length, static_cast<int32_t>(linId));
+                    benchKeep(restored.ints);
+
+                    if (compData)
+                        PoolMem::getPool().freePtr(compData);
+                }
+            }
+        },
+    };
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "benchmark.h"
+#include "bench_data.h"
+
+#include "../src/customer.h"
+#include "../src/queryparserosl.h"
+#include "../src/queryinterpreter.h"
+#include "../src/result.h"
+
+// holds a compiled script and the result set it writes to
+struct BenchScript_s
+{
+    openset::query::Macro_s macros;
+    openset::query::Interpreter* interpreter {nullptr};
+    openset::result::ResultSet* resultSet {nullptr};
+
+    ~BenchScript_s()
+    {
+        delete interpreter;
+        delete resultSet;
+    }
+
+    void compile(const std::string& script)
+    {
+        const auto table = benchMakeTable();
+
+        openset::query::QueryParser p;
+        p.compileQuery(script, table->getProperties(), macros, nullptr);
+
+        if (p.error.inError())
+        {
+            std::cerr << "bench script failed to compile: " << p.error.getErrorJSON() << std::endl;
+            exit(1);
+        }
+
+        resultSet = new openset::result::ResultSet(macros.vars.columnVars.size());
+        interpreter = new openset::query::Interpreter(macros);
+        interpreter->setResultObject(resultSet);
+    }
+};
+
+inline Benchmarks bench_interpreter()
+{
+    const auto countScript = R"osl(
+    select
+      count id
+      sum price
+      sum qty
+    end
+
+    each_row where event.is(== "page_view")
+      << event, page
+    end
+    )osl"s;
+
+    const auto filterScript = R"osl(
+    select
+      count id
+    end
+
+    each_row where event.is(== "purchase")
+      if price > 250
+        << "big spender", referrer
+      end
+    end
+    )osl"s;
+
+    auto counting = std::make_shared<BenchScript_s>();
+    auto filtering = std::make_shared<BenchScript_s>();
+
+    // runs a script over every customer in the partition, like OpenLoopQuery does
+    const auto runScript = [](BenchScript_s* script, int64_t ops)
+    {
+        const auto table = openset::globals::database->getTable(BENCH_TABLE);
+        const auto parts = table->getPartitionObjects(0, false);
+
+        auto mappedColumns = script->interpreter->getReferencedColumns();
+
+        openset::db::Customer person;
+        person.mapTable(table.get(), 0, mappedColumns);
+
+        for (auto i = 0; i < ops; ++i)
+        {
+            person.mount(parts->people.getCustomerByLIN(i % BENCH_CUSTOMERS));
+            person.prepare();
+            script->interpreter->mount(&person);
+            script->interpreter->exec();
+        }
+    };
+
+    return {
+        {
+            "interpreter: exec tally/aggregate per customer",
+            BENCH_CUSTOMERS,
+            [=]()
+            {
+                if (!counting->interpreter)
+                    counting->compile(countScript);
+            },
+            [=](int64_t ops)
+            {
+                runScript(counting.get(), ops);
+            }
+        },
+        {
+            "interpreter: exec filtered tally per customer",
+            BENCH_CUSTOMERS,
+            [=]()
+            {
+                if (!filtering->interpreter)
+                    filtering->compile(filterScript);
+            },
+            [=](int64_t ops)
+            {
+                runScript(filtering.get(), ops);
+            }
+        },
+    };
+}
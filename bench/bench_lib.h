@@ -0,0 +1,75 @@
+#pragma once
+
+#include "benchmark.h"
+#include "bench_data.h"
+
+#include "../lib/sba/sba.h"
+#include "../lib/cjson/cjson.h"
+
+inline Benchmarks bench_lib()
+{
+    // one customer's worth of events, as it would arrive on the insert endpoint
+    struct InsertBatch_s
+    {
+        std::string text;
+        std::unique_ptr<cjson> doc;
+    };
+
+    auto batch = std::make_shared<InsertBatch_s>();
+
+    const auto setup = [=]()
+    {
+        batch->text = benchMakeEvents("customer_json", BENCH_EVENTS_PER_CUSTOMER);
+        batch->doc = std::make_unique<cjson>(batch->text, cjson::Mode_e::string);
+    };
+
+    return {
+        {
+            "poolmem: getPtr/freePtr mixed sizes",
+            100'000,
+            nullptr,
+            [](int64_t ops)
+            {
+                // mimic the mix of small attribute and larger customer records
+                static const int64_t sizes[] = { 12, 40, 90, 250, 700, 1500, 4000, 12000 };
+                void* held[8];
+
+                for (auto i = 0; i < ops; i += 8)
+                {
+                    for (auto s = 0; s < 8; ++s)
+                        held[s] = PoolMem::getPool().getPtr(sizes[(i + s) & 7]);
+                    for (auto s = 0; s < 8; ++s)
+                        PoolMem::getPool().freePtr(held[s]);
+                }
+            }
+        },
+        {
+            "cjson: parse insert batch",
+            1'000,
+            setup,
+            [=](int64_t ops)
+            {
+                for (auto i = 0; i < ops; ++i)
+                {
+                    cjson doc(batch->text, cjson::Mode_e::string);
+                    benchKeep(doc.memberCount);
+                }
+            }
+        },
+        {
+            "cjson: stringify insert batch",
+            1'000,
+            setup,
+            [=](int64_t ops)
+            {
+                for (auto i = 0; i < ops; ++i)
+                {
+                    int64_t length;
+                    const auto text = cjson::stringifyCstr(batch->doc.get(), length);
+                    benchKeep(length);
+                    cjson::releaseStringifyPtr(text);
+                }
+            }
+        },
+    };
+}
@@ -0,0 +1,142 @@
+// bench_main.cpp : Entry point for openset-bench
+//
+#include "common.h"
+#include "logger.h"
+#include "benchmarks.h"
+#include "harness.h"
+#include <string>
+#include <fstream>
+
+using namespace std::string_literals;
+
+int main(const int argc, char* argv[])
+{
+    std::string filter;
+    std::string outFile;
+    auto samples = 15;
+    auto list = false;
+
+    // multi-node load harness (--cluster)
+    auto cluster = false;
+    openset::bench::HarnessConfig_s harness;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        const std::string nextArg(i == argc - 1 ? "" : argv[i + 1]);
+
+        if (arg == "--filter"s)
+            filter = nextArg;
+        else if (arg == "--out"s)
+            outFile = nextArg;
+        else if (arg == "--samples"s)
+            samples = std::max(1, std::stoi(nextArg));
+        else if (arg == "--list"s)
+            list = true;
+        else if (arg == "--cluster"s)
+        {
+            cluster = true;
+            harness.nodes = std::max(1, std::stoi(nextArg));
+        }
+        else if (arg == "--openset"s)
+            harness.executable = nextArg;
+        else if (arg == "--data"s)
+            harness.dataPath = nextArg;
+        else if (arg == "--port"s)
+            harness.basePort = std::stoi(nextArg);
+        else if (arg == "--partitions"s)
+            harness.partitions = std::stoi(nextArg);
+        else if (arg == "--clients"s)
+            harness.clients = std::max(1, std::stoi(nextArg));
+        else if (arg == "--duration"s)
+            harness.duration = std::max(1, std::stoi(nextArg));
+        else if (arg == "--batch"s)
+            harness.batchSize = std::max(1, std::stoi(nextArg));
+        else if (arg == "--customers"s)
+            harness.workload.customers = std::max(1LL, std::stoll(nextArg));
+        else if (arg == "--skew"s)
+            harness.workload.customerSkew = std::stod(nextArg);
+        else if (arg == "--mix"s) // insert:query:segment weights, i.e. 80:15:5
+        {
+            const auto first = nextArg.find(':');
+            const auto second = nextArg.find(':', first + 1);
+            if (first != std::string::npos && second != std::string::npos)
+            {
+                harness.insertWeight = std::stoi(nextArg.substr(0, first));
+                harness.queryWeight = std::stoi(nextArg.substr(first + 1, second - first - 1));
+                harness.segmentWeight = std::stoi(nextArg.substr(second + 1));
+            }
+        }
+        else if (arg == "--help"s)
+        {
+            cout << "Command line options:" << endl << endl;
+            cout << "    --filter   <text>   ; only run benchmarks whose name contains text" << endl;
+            cout << "    --samples  <count>  ; timed batches per benchmark, defaults to 15" << endl;
+            cout << "    --out      <file>   ; write JSON results to file rather than stdout" << endl;
+            cout << "    --list              ; list benchmark names and exit" << endl;
+            cout << endl;
+            cout << "Load harness options:" << endl << endl;
+            cout << "    --cluster    <nodes>     ; start nodes on loopback and run the load harness" << endl;
+            cout << "    --openset    <path>      ; openset executable, defaults to ./openset" << endl;
+            cout << "    --data       <path>      ; node data folder, defaults to ./harness" << endl;
+            cout << "    --port       <port>      ; first node port, defaults to 9100" << endl;
+            cout << "    --partitions <count>     ; cluster partitions, defaults to 24" << endl;
+            cout << "    --clients    <count>     ; client threads, defaults to 8" << endl;
+            cout << "    --duration   <seconds>   ; timed load, defaults to 30" << endl;
+            cout << "    --batch      <events>    ; events per insert, defaults to 100" << endl;
+            cout << "    --customers  <count>     ; distinct customers, defaults to 100000" << endl;
+            cout << "    --skew       <zipf s>    ; customer activity skew, defaults to 1.1" << endl;
+            cout << "    --mix        <i:q:s>     ; insert:query:segment weights, defaults to 80:15:5" << endl;
+            cout << endl;
+            exit(0);
+        }
+    }
+
+    Logger::get().suspendLogging(true); // keep engine logging out of the results
+
+    if (cluster)
+    {
+        openset::bench::Harness loadHarness(harness);
+        auto report = loadHarness.run();
+        const auto json = cjson::stringify(&report, true);
+
+        if (outFile.length())
+        {
+            std::ofstream out(outFile);
+            out << json << endl;
+        }
+        else
+        {
+            cout << json << endl;
+        }
+
+        Logger::get().drain();
+        return report.find("error") ? 1 : 0;
+    }
+
+    auto benchmarks = allBenchmarks();
+
+    if (list)
+    {
+        for (auto& b : benchmarks)
+            cout << b.name << endl;
+        exit(0);
+    }
+
+    auto results = runBenchmarks(benchmarks, filter, samples);
+    const auto json = cjson::stringify(&results, true);
+
+    if (outFile.length())
+    {
+        std::ofstream out(outFile);
+        out << json << endl;
+    }
+    else
+    {
+        cout << json << endl;
+    }
+
+    Logger::get().drain();
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "../lib/cjson/cjson.h"
+#include "../src/common.h"
+
+/*
+    Micro-benchmark runner
+
+    Benchmarks are grouped into units (see benchmarks.h) the same way unit tests
+    are grouped in test/unittests.h. Each BenchItem_s is given a batch size and
+    must perform that many operations. The runner calls `setup` once, warms up,
+    then times `samples` batches and reports nanoseconds per operation.
+
+    Results are emitted as JSON so runs can be diffed across commits:
+
+    {
+        "seed": 1337,
+        "samples": 15,
+        "benchmarks": [
+            {
+                "name": "indexbits: opAnd 1M bits",
+                "ops": 1000,
+                "ns_per_op": { "min": 812.3, "median": 830.1, "p90": 861.7, "max": 901.2 },
+                "ops_per_sec": 1204674.2
+            },
+            ...
+        ]
+    }
+*/
+
+// fixed seed so synthetic data is identical between runs and commits
+static const uint64_t BENCH_SEED = 1337;
+
+struct BenchItem_s
+{
+    std::string name;
+    int64_t ops; // operations per timed batch
+    std::function<void()> setup;
+    std::function<void(int64_t)> run;
+};
+
+using Benchmarks = std::vector<BenchItem_s>;
+
+struct BenchResult_s
+{
+    std::string name;
+    int64_t ops;
+    double min;
+    double median;
+    double p90;
+    double max;
+};
+
+// deterministic generator used by all synthetic data builders
+inline std::mt19937_64& benchRandom()
+{
+    static std::mt19937_64 generator(BENCH_SEED);
+    return generator;
+}
+
+inline int64_t benchRandomInt(const int64_t low, const int64_t high)
+{
+    std::uniform_int_distribution<int64_t> dist(low, high);
+    return dist(benchRandom());
+}
+
+// keeps the optimizer from discarding results we never read
+inline volatile char benchSink;
+
+template <typename T>
+inline void benchKeep(T&& value)
+{
+    benchSink = *recast<volatile char*>(&value);
+}
+
+inline BenchResult_s runBenchmark(BenchItem_s& item, const int samples)
+{
+    using clock = std::chrono::steady_clock;
+
+    // reseed so each item sees the same data no matter which items ran before it
+    benchRandom().seed(BENCH_SEED);
+
+    if (item.setup)
+        item.setup();
+
+    // warm caches, pools and branch predictors
+    item.run(item.ops);
+
+    std::vector<double> nsPerOp;
+    nsPerOp.reserve(samples);
+
+    for (auto i = 0; i < samples; ++i)
+    {
+        const auto start = clock::now();
+        item.run(item.ops);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        nsPerOp.push_back(static_cast<double>(elapsed) / static_cast<double>(item.ops));
+    }
+
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+
+    return BenchResult_s{
+        item.name,
+        item.ops,
+        nsPerOp.front(),
+        nsPerOp[nsPerOp.size() / 2],
+        nsPerOp[(nsPerOp.size() * 9) / 10],
+        nsPerOp.back()
+    };
+}
+
+inline cjson runBenchmarks(Benchmarks& benchmarks, const std::string& filter, const int samples)
+{
+    cjson doc;
+    doc.set("seed", static_cast<int64_t>(BENCH_SEED));
+    doc.set("samples", samples);
+    auto list = doc.setArray("benchmarks");
+
+    for (auto& b : benchmarks)
+    {
+        if (filter.length() && b.name.find(filter) == std::string::npos)
+            continue;
+
+        const auto result = runBenchmark(b, samples);
+
+        std::cerr << "BENCH " << result.name << " - " << result.median << " ns/op (median)" << std::endl;
+
+        auto entry = list->pushObject();
+        entry->set("name", result.name);
+        entry->set("ops", result.ops);
+
+        auto timing = entry->setObject("ns_per_op");
+        timing->set("min", result.min);
+        timing->set("median", result.median);
+        timing->set("p90", result.p90);
+        timing->set("max", result.max);
+
+        entry->set("ops_per_sec", result.median > 0 ? 1'000'000'000.0 / result.median : 0.0);
+    }
+
+    return doc;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "benchmark.h"
+#include "bench_indexbits.h"
+#include "bench_grid.h"
+#include "bench_interpreter.h"
+#include "bench_lib.h"
+#include "../src/logger.h"
+
+inline Benchmarks allBenchmarks()
+{
+    Benchmarks all;
+
+    // adds all the benchmarks in a bench unit (bench units are in the includes above)
+    const auto add = [&all](Benchmarks newBenchmarks) {
+        all.insert(all.end(), newBenchmarks.begin(), newBenchmarks.end());
+    };
+
+    add(bench_indexbits());
+    add(bench_grid());
+    add(bench_interpreter());
+    add(bench_lib());
+
+    return all;
+}
@@ -0,0 +1,394 @@
+#include "harness.h"
+
+#include <thread>
+#include <algorithm>
+
+#include "common.h"
+#include "http_cli.h"
+#include "file/directory.h"
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+using namespace openset::bench;
+
+namespace
+{
+    const auto EVENT_QUERY = R"osl(
+select
+  count id
+  sum price
+end
+
+each_row where event.is(== "purchase")
+  << product
+end
+)osl"s;
+
+    const auto SEGMENT_QUERY = R"osl(
+@segment harness_buyers use_cached=false
+
+if event.ever(== "purchase")
+  return(true)
+end
+)osl"s;
+}
+
+Harness::Harness(HarnessConfig_s harnessConfig) :
+    config(std::move(harnessConfig))
+{}
+
+Harness::~Harness()
+{
+    stopNodes();
+}
+
+std::string Harness::nodeHost(const int node) const
+{
+    return config.host + ":" + to_string(config.basePort + node);
+}
+
+bool Harness::request(
+    openset::web::Rest& rest,
+    const std::string& method,
+    const std::string& path,
+    const std::vector<std::pair<std::string, std::string>>& params,
+    std::string payload,
+    cjson* response)
+{
+    openset::web::QueryParams queryParams;
+    for (auto& p : params)
+        queryParams.emplace(p.first, p.second);
+
+    auto error = true;
+
+    // Rest::request runs the client io_service until the call completes
+    rest.request(
+        method,
+        path,
+        queryParams,
+        &payload[0],
+        payload.length(),
+        [&error, response](const http::StatusCode status, const bool err, cjson json)
+    {
+        error = err;
+        if (response)
+            *response = std::move(json);
+    });
+
+    return !error;
+}
+
+bool Harness::startNodes()
+{
+#ifdef _MSC_VER
+    Logger::get().error("harness: starting nodes requires fork/exec (not supported on windows)");
+    return false;
+#else
+    openset::IO::Directory::mkdir(config.dataPath);
+
+    for (auto node = 0; node < config.nodes; ++node)
+    {
+        const auto port = to_string(config.basePort + node);
+        const auto path = config.dataPath + "/node_" + to_string(node);
+
+        openset::IO::Directory::mkdir(path);
+
+        const auto pid = fork();
+
+        if (pid < 0)
+        {
+            Logger::get().error("harness: could not fork node " + to_string(node));
+            return false;
+        }
+
+        if (pid == 0)
+        {
+            execl(
+                config.executable.c_str(),
+                config.executable.c_str(),
+                "--host", config.host.c_str(),
+                "--port", port.c_str(),
+                "--os-host", config.host.c_str(),
+                "--os-port", port.c_str(),
+                "--data", path.c_str(),
+                nullptr);
+
+            // only returns if exec failed
+            _exit(127);
+        }
+
+        pids.push_back(pid);
+    }
+
+    return true;
+#endif
+}
+
+void Harness::stopNodes()
+{
+#ifndef _MSC_VER
+    for (auto pid : pids)
+        kill(pid, SIGTERM);
+
+    for (auto pid : pids)
+        waitpid(pid, nullptr, 0);
+#endif
+
+    pids.clear();
+}
+
+bool Harness::waitForNodes() const
+{
+    for (auto node = 0; node < config.nodes; ++node)
+    {
+        openset::web::Rest rest(0, nodeHost(node));
+
+        auto up = false;
+        for (auto attempt = 0; attempt < 100 && !up; ++attempt)
+        {
+            up = request(rest, "GET", "/v1/status", {}, "");
+            if (!up)
+                ThreadSleep(100);
+        }
+
+        if (!up)
+        {
+            Logger::get().error("harness: node " + to_string(node) + " did not start on " + nodeHost(node));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Harness::formCluster() const
+{
+    openset::web::Rest rest(0, nodeHost(0));
+
+    if (!request(rest, "PUT", "/v1/cluster/init", { { "partitions", to_string(config.partitions) } }, ""))
+    {
+        Logger::get().error("harness: cluster/init failed");
+        return false;
+    }
+
+    for (auto node = 1; node < config.nodes; ++node)
+    {
+        const auto params = std::vector<std::pair<std::string, std::string>>{
+            { "host", config.host },
+            { "port", to_string(config.basePort + node) }
+        };
+
+        if (!request(rest, "PUT", "/v1/cluster/join", params, ""))
+        {
+            Logger::get().error("harness: cluster/join failed for node " + to_string(node));
+            return false;
+        }
+    }
+
+    // the sentinel moves partitions onto the new nodes, give it time to settle
+    for (auto attempt = 0; attempt < 120; ++attempt)
+    {
+        cjson status;
+        if (request(rest, "GET", "/v1/status", {}, "", &status) &&
+            status.xPathBool("/status/balanced", false) &&
+            status.xPathBool("/status/cluster_complete", false))
+            return true;
+
+        ThreadSleep(500);
+    }
+
+    Logger::get().info("harness: cluster did not report balanced, continuing anyway");
+    return true;
+}
+
+bool Harness::createTable() const
+{
+    openset::web::Rest rest(0, nodeHost(0));
+    WorkloadGenerator generator(config.workload);
+
+    auto definition = generator.tableDefinition();
+
+    if (!request(rest, "POST", "/v1/table/harness", {}, cjson::stringify(&definition)))
+    {
+        Logger::get().error("harness: could not create table");
+        return false;
+    }
+
+    // the segment must exist before segment queries are timed
+    openset::web::Rest segmentRest(0, nodeHost(0));
+    request(segmentRest, "POST", "/v1/query/harness/segment", {}, SEGMENT_QUERY);
+
+    return true;
+}
+
+void Harness::client(const int clientId)
+{
+    // every client gets its own seed so they don't all send the same customers
+    auto workload = config.workload;
+    workload.seed += clientId;
+
+    WorkloadGenerator generator(workload);
+    std::mt19937_64 random(workload.seed);
+
+    const auto totalWeight = config.insertWeight + config.queryWeight + config.segmentWeight;
+    std::uniform_int_distribution<int> pickOp(0, std::max(0, totalWeight - 1));
+
+    // one connection per node, requests are spread over the cluster like a load balancer would
+    std::vector<std::shared_ptr<openset::web::Rest>> connections;
+    for (auto node = 0; node < config.nodes; ++node)
+        connections.push_back(std::make_shared<openset::web::Rest>(0, nodeHost(node)));
+
+    auto& stats = clientStats[clientId];
+    auto requestCount = 0;
+
+    while (running)
+    {
+        const auto pick = pickOp(random);
+        auto& rest = *connections[(clientId + requestCount++) % config.nodes];
+
+        auto op = Op_e::insert;
+        if (pick >= config.insertWeight + config.queryWeight)
+            op = Op_e::segment;
+        else if (pick >= config.insertWeight)
+            op = Op_e::query;
+
+        std::string path;
+        std::string payload;
+
+        switch (op)
+        {
+        case Op_e::insert:
+        {
+            auto batch = generator.makeBatch(config.batchSize);
+            path = "/v1/insert/harness";
+            payload = cjson::stringify(&batch);
+        }
+        break;
+        case Op_e::query:
+            path = "/v1/query/harness/event";
+            payload = EVENT_QUERY;
+            break;
+        case Op_e::segment:
+            path = "/v1/query/harness/segment";
+            payload = SEGMENT_QUERY;
+            break;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto success = request(rest, "POST", path, {}, payload);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        auto& opStats = stats[static_cast<int>(op)];
+
+        if (!success)
+        {
+            ++opStats.errors;
+            continue;
+        }
+
+        opStats.latency.push_back(elapsed);
+        if (op == Op_e::insert)
+            opStats.events += config.batchSize;
+    }
+}
+
+cjson Harness::run()
+{
+    cjson report;
+
+    auto settings = report.setObject("settings");
+    settings->set("nodes", config.nodes);
+    settings->set("partitions", config.partitions);
+    settings->set("clients", config.clients);
+    settings->set("duration", config.duration);
+    settings->set("batch_size", config.batchSize);
+    settings->set("customers", config.workload.customers);
+    settings->set("customer_skew", config.workload.customerSkew);
+    settings->set("seed", static_cast<int64_t>(config.workload.seed));
+
+    const auto fail = [&](const std::string& error) -> cjson
+    {
+        stopNodes();
+        report.set("error", error);
+        return std::move(report);
+    };
+
+    if (!startNodes())
+        return fail("could not start nodes");
+
+    if (!waitForNodes())
+        return fail("nodes did not start");
+
+    if (!formCluster())
+        return fail("could not form cluster");
+
+    if (!createTable())
+        return fail("could not create table");
+
+    clientStats.assign(config.clients, std::vector<OpStats_s>(3));
+
+    running = true;
+
+    std::vector<std::thread> clients;
+    for (auto i = 0; i < config.clients; ++i)
+        clients.emplace_back(&Harness::client, this, i);
+
+    ThreadSleep(config.duration * 1000LL);
+    running = false;
+
+    for (auto& c : clients)
+        c.join();
+
+    stopNodes();
+
+    static const std::vector<std::string> opNames = { "insert", "query", "segment" };
+
+    auto list = report.setArray("workloads");
+
+    for (auto op = 0; op < 3; ++op)
+    {
+        // merge the per-client stats
+        std::vector<int64_t> latency;
+        int64_t errors = 0;
+        int64_t events = 0;
+
+        for (auto& c : clientStats)
+        {
+            latency.insert(latency.end(), c[op].latency.begin(), c[op].latency.end());
+            errors += c[op].errors;
+            events += c[op].events;
+        }
+
+        std::sort(latency.begin(), latency.end());
+
+        const auto percentile = [&latency](const double p) -> double
+        {
+            if (latency.empty())
+                return 0.0;
+            const auto idx = std::min(latency.size() - 1, static_cast<size_t>(p * latency.size()));
+            return static_cast<double>(latency[idx]) / 1000.0;
+        };
+
+        auto entry = list->pushObject();
+        entry->set("name", opNames[op]);
+        entry->set("requests", static_cast<int64_t>(latency.size()));
+        entry->set("errors", errors);
+        entry->set("requests_per_sec", static_cast<double>(latency.size()) / config.duration);
+
+        if (op == static_cast<int>(Op_e::insert))
+            entry->set("events_per_sec", static_cast<double>(events) / config.duration);
+
+        auto timing = entry->setObject("latency_ms");
+        timing->set("p50", percentile(0.50));
+        timing->set("p90", percentile(0.90));
+        timing->set("p99", percentile(0.99));
+        timing->set("max", latency.empty() ? 0.0 : static_cast<double>(latency.back()) / 1000.0);
+    }
+
+    return report;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "workload.h"
+#include "../lib/cjson/cjson.h"
+
+/*
+    Multi-node load harness
+
+    Starts `nodes` copies of the openset executable on loopback ports, forms
+    them into a cluster through the public REST API (cluster/init and
+    cluster/join), creates a table from the workload definition and then
+    drives a mix of insert, event query and segment query requests from
+    `clients` threads for `duration` seconds.
+
+    Every node is a real openset process, so HttpServe, the Mapper and the
+    rpc_* handlers run unchanged - nodes are separate processes because the
+    engine keeps its database, async pool and mapper in per-process globals.
+
+    The report has throughput and latency percentiles per request type in the
+    same JSON style as the micro-benchmarks.
+*/
+
+namespace openset
+{
+    namespace web
+    {
+        class Rest;
+    }
+
+    namespace bench
+    {
+        struct HarnessConfig_s
+        {
+            std::string executable {"./openset"};
+            std::string dataPath {"./harness"};
+            std::string host {"127.0.0.1"};
+            int basePort {9100};
+            int nodes {3};
+            int partitions {24};
+            int clients {8};
+            int duration {30};    // seconds of timed load
+            int batchSize {100};  // events per insert request
+
+            // relative weights of each request type in the mix
+            int insertWeight {80};
+            int queryWeight {15};
+            int segmentWeight {5};
+
+            WorkloadConfig_s workload;
+        };
+
+        class Harness
+        {
+        public:
+            enum class Op_e : int
+            {
+                insert = 0,
+                query = 1,
+                segment = 2
+            };
+
+        private:
+            struct OpStats_s
+            {
+                std::vector<int64_t> latency; // microseconds
+                int64_t errors {0};
+                int64_t events {0};
+            };
+
+            HarnessConfig_s config;
+            std::vector<int> pids;
+            std::atomic<bool> running {false};
+
+            // one OpStats_s per Op_e, per client thread - merged at report time
+            std::vector<std::vector<OpStats_s>> clientStats;
+
+            std::string nodeHost(int node) const;
+
+            // synchronous REST call, returns false on transport or HTTP error
+            static bool request(
+                openset::web::Rest& rest,
+                const std::string& method,
+                const std::string& path,
+                const std::vector<std::pair<std::string, std::string>>& params,
+                std::string payload,
+                cjson* response = nullptr);
+
+            bool startNodes();
+            bool waitForNodes() const;
+            bool formCluster() const;
+            bool createTable() const;
+            void client(int clientId);
+
+        public:
+            explicit Harness(HarnessConfig_s harnessConfig);
+            ~Harness();
+
+            void stopNodes();
+
+            // returns report JSON, on failure the report contains an "error" member
+            cjson run();
+        };
+    };
+};
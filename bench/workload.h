@@ -0,0 +1,220 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+
+#include "../lib/cjson/cjson.h"
+#include "../src/common.h"
+
+/*
+    Synthetic event stream generator
+
+    Produces insert batches that look like real traffic rather than uniform noise:
+
+    - customers are drawn from a Zipfian distribution, so a few customers are
+      very active and most are seen rarely (this is what makes partitions and
+      customer records uneven in production).
+    - every property has a configurable cardinality and values are Zipf skewed
+      within that cardinality (a few pages are popular, the long tail is not).
+    - each customer has its own clock. Events arrive in sessions: short gaps
+      inside a session, a long gap between sessions, with `eventsPerSession`
+      events per session on average.
+
+    The same generator produces the table definition so the two always agree.
+*/
+
+namespace openset
+{
+    namespace bench
+    {
+        // draws ranks [0, count) where rank k has weight 1 / (k + 1)^skew
+        class ZipfDistribution
+        {
+            std::vector<double> cdf;
+
+        public:
+            ZipfDistribution() = default;
+
+            ZipfDistribution(const int64_t count, const double skew)
+            {
+                cdf.reserve(count);
+
+                auto total = 0.0;
+                for (auto k = 0; k < count; ++k)
+                {
+                    total += 1.0 / std::pow(static_cast<double>(k + 1), skew);
+                    cdf.push_back(total);
+                }
+
+                for (auto& c : cdf)
+                    c /= total;
+            }
+
+            template <typename Generator>
+            int64_t operator()(Generator& generator) const
+            {
+                std::uniform_real_distribution<double> uniform(0.0, 1.0);
+                const auto iter = std::lower_bound(cdf.begin(), cdf.end(), uniform(generator));
+                return iter == cdf.end() ? static_cast<int64_t>(cdf.size()) - 1 : iter - cdf.begin();
+            }
+        };
+
+        struct PropertySpec_s
+        {
+            std::string name;
+            std::string type; // text, int, double or bool (same as table create)
+            int64_t cardinality;
+            bool isSet;
+        };
+
+        struct WorkloadConfig_s
+        {
+            uint64_t seed {1337};
+            int64_t customers {100'000};
+            double customerSkew {1.1};
+            double valueSkew {0.9};
+            int eventsPerSession {8};
+            int64_t sessionGapMin {3'600'000};       // 1 hour
+            int64_t sessionGapMax {7 * 86'400'000LL}; // 1 week
+            int64_t eventGapMin {1'000};
+            int64_t eventGapMax {300'000};           // 5 minutes, inside session time
+            int64_t startStamp {1545220000000LL};
+
+            std::vector<std::string> events { "page_view", "search", "add_to_cart", "purchase", "login" };
+
+            std::vector<PropertySpec_s> properties {
+                { "page", "text", 500, false },
+                { "referrer", "text", 5'000, false },
+                { "product", "text", 2'000, false },
+                { "tags", "text", 50, true },
+                { "price", "double", 10'000, false },
+                { "qty", "int", 10, false },
+            };
+        };
+
+        class WorkloadGenerator
+        {
+            WorkloadConfig_s config;
+            std::mt19937_64 generator;
+            ZipfDistribution customerDist;
+            ZipfDistribution eventDist;
+            std::vector<ZipfDistribution> valueDists;
+
+            // per customer clock, so every customer has its own session shape
+            std::unordered_map<int64_t, int64_t> clocks;
+
+            int64_t randomRange(const int64_t low, const int64_t high)
+            {
+                std::uniform_int_distribution<int64_t> dist(low, high);
+                return dist(generator);
+            }
+
+            int64_t nextStamp(const int64_t customer)
+            {
+                auto iter = clocks.find(customer);
+
+                if (iter == clocks.end())
+                    iter = clocks.emplace(customer, config.startStamp + randomRange(0, config.sessionGapMax)).first;
+                else if (randomRange(1, config.eventsPerSession) == 1) // start a new session
+                    iter->second += randomRange(config.sessionGapMin, config.sessionGapMax);
+                else
+                    iter->second += randomRange(config.eventGapMin, config.eventGapMax);
+
+                return iter->second;
+            }
+
+        public:
+            explicit WorkloadGenerator(WorkloadConfig_s workloadConfig) :
+                config(std::move(workloadConfig)),
+                generator(config.seed),
+                customerDist(config.customers, config.customerSkew),
+                eventDist(config.events.size(), config.valueSkew)
+            {
+                for (const auto& p : config.properties)
+                    valueDists.emplace_back(p.cardinality, config.valueSkew);
+            }
+
+            const WorkloadConfig_s& getConfig() const
+            {
+                return config;
+            }
+
+            static std::string customerId(const int64_t rank)
+            {
+                return "cust_" + to_string(rank);
+            }
+
+            // a random customer id, Zipf skewed
+            std::string pickCustomer()
+            {
+                return customerId(customerDist(generator));
+            }
+
+            // body for POST /v1/table/{table}
+            cjson tableDefinition() const
+            {
+                cjson doc;
+                doc.set("id_type", "textual");
+
+                auto props = doc.setArray("properties");
+                for (const auto& p : config.properties)
+                {
+                    auto prop = props->pushObject();
+                    prop->set("name", p.name);
+                    prop->set("type", p.type);
+                    if (p.isSet)
+                        prop->set("is_set", true);
+                }
+
+                auto order = doc.setArray("event_order");
+                for (const auto& e : config.events)
+                    order->push(e);
+
+                return doc;
+            }
+
+            // body for POST /v1/insert/{table}
+            cjson makeBatch(const int count)
+            {
+                cjson doc(cjson::Types_e::ARRAY);
+
+                for (auto i = 0; i < count; ++i)
+                {
+                    const auto customer = customerDist(generator);
+
+                    auto row = doc.pushObject();
+                    row->set("id", customerId(customer));
+                    row->set("stamp", nextStamp(customer));
+                    row->set("event", config.events[eventDist(generator)]);
+
+                    for (auto p = 0; p < static_cast<int>(config.properties.size()); ++p)
+                    {
+                        const auto& spec = config.properties[p];
+                        const auto value = valueDists[p](generator);
+
+                        if (spec.isSet)
+                        {
+                            auto list = row->setArray(spec.name);
+                            for (auto c = randomRange(0, 3); c > 0; --c)
+                                list->push(spec.name + "_" + to_string(valueDists[p](generator)));
+                        }
+                        else if (spec.type == "text")
+                            row->set(spec.name, spec.name + "_" + to_string(value));
+                        else if (spec.type == "double")
+                            row->set(spec.name, static_cast<double>(value) / 100.0);
+                        else if (spec.type == "bool")
+                            row->set(spec.name, (value & 1) == 1);
+                        else
+                            row->set(spec.name, value);
+                    }
+                }
+
+                return doc;
+            }
+        };
+    };
+};
@@ -540,7 +540,8 @@ private:
                 {
                     branch->membersTail = member;
                     member->siblingNext = nullptr;
-                    return;
+                    branch->memberCount = trim;
+                    break; // the members we kept are trimmed below
                 }
 
                 member = member->siblingNext;
@@ -552,9 +553,8 @@ private:
 
         while (it)
         {
-            if (it->nodeType == Types_e::VOIDED)
-                continue;
-            __recurseTrim(nodeName, it, trim);
+            if (it->nodeType != Types_e::VOIDED)
+                __recurseTrim(nodeName, it, trim);
             it = it->siblingNext;
         }
     }
@@ -49,6 +49,7 @@ void* PoolMem::getPtr(int64_t size)
 		// this is a big allocation (outside our bucket sizes), so grab it from heap
 		const auto alloc = reinterpret_cast<alloc_s*>(new char[size + MemConstants::PoolMemHeaderSize]);
 		alloc->poolIndex = -1; // -1 = non-pooled
+		++heapInUse;
 		return alloc->data;
 	}
 
@@ -57,6 +58,8 @@ void* PoolMem::getPtr(int64_t size)
 
 	csLock lock(mem.memLock);
 
+	++mem.inUse;
+
 	if (!mem.freed.empty())
 	{
 		const auto alloc = mem.freed.back();
@@ -82,6 +85,7 @@ void PoolMem::freePtr(void* ptr)
 	if (alloc->poolIndex == -1)
 	{
 		delete[](static_cast<char*>(ptr) - MemConstants::PoolMemHeaderSize);
+		--heapInUse;
 		return;
 	}
 
@@ -91,6 +95,7 @@ void PoolMem::freePtr(void* ptr)
 	
 	alloc->poolIndex = -2;
 	mem.freed.push_back(alloc);
+	--mem.inUse;
 
     // if a pool gets to large, trim it back
     if (mem.freed.size() > MemConstants::CullSize)
@@ -104,3 +109,16 @@ void PoolMem::freePtr(void* ptr)
     }
 }
 
+std::vector<PoolMem::BucketStats_s> PoolMem::getStats()
+{
+	std::vector<BucketStats_s> stats;
+	stats.reserve(breakPoints.size());
+
+	for (auto& mem : breakPoints)
+	{
+		csLock lock(mem.memLock);
+		stats.push_back({ mem.maxSize, mem.inUse, static_cast<int64_t>(mem.freed.size()) });
+	}
+
+	return stats;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include "threads/locks.h"
 
 namespace MemConstants
@@ -30,6 +31,7 @@ private:
 		int32_t index{ 0 };
 		const int64_t maxSize;
 		std::vector<alloc_s*> freed;
+		int64_t inUse{ 0 }; // updated under memLock
 
 		memory_s(const int64_t maxSize) :
 			maxSize(maxSize)
@@ -90,6 +92,8 @@ private:
 
 	std::vector<int> bucketLookup;
 
+	std::atomic<int64_t> heapInUse{ 0 };
+
 	PoolMem();
 	~PoolMem() = default; // we never clean anything up, this is forever.
 
@@ -104,6 +108,22 @@ public:
 
 	void* getPtr(int64_t size);
 	void freePtr(void* ptr);
+
+	struct BucketStats_s
+	{
+		int64_t maxSize;
+		int64_t inUse;
+		int64_t cached; // freed, held for reuse
+	};
+
+	// per bucket usage, taken one bucket lock at a time
+	std::vector<BucketStats_s> getStats();
+
+	// live allocations too big for a bucket
+	int64_t getHeapInUse() const
+	{
+		return heapInUse;
+	}
 };
 
 //extern PoolMem* POOL;
@@ -1,5 +1,7 @@
 #include "asyncloop.h"
 #include "asyncpool.h"
+#include "metrics.h"
+#include "trace.h"
 
 using namespace openset::async;
 
@@ -66,6 +68,7 @@ void AsyncLoop::purgeByTable(const std::string& tableName)
             delete a;
 
     active = std::move(newActive);
+    activeSize = static_cast<int32_t>(active.size());
 
     vector<OpenLoop*> newQueued;
     for (auto q: queued)
@@ -75,6 +78,7 @@ void AsyncLoop::purgeByTable(const std::string& tableName)
             delete q;
 
     queued = std::move(newQueued);
+    queueSize = static_cast<int32_t>(queued.size());
 
 }
 
@@ -94,11 +98,15 @@ void AsyncLoop::scheduleQueued()
     queueSize -= queued.size();
     active.insert(active.end(), make_move_iterator(queued.begin()), make_move_iterator(queued.end()));
     queued.clear();
+    activeSize = static_cast<int32_t>(active.size());
 }
 
 // this runs one iteration of the main Loop
 bool AsyncLoop::run(int64_t &nextRun)
 {
+    static auto& sliceTime = openset::metrics::Metrics::get().histogram(
+        "openset_async_slice_seconds", "time spent in a single OpenLoop::run slice");
+
     // actual number of worker cells that did anything
     auto runCount = 0;
 
@@ -123,6 +131,9 @@ bool AsyncLoop::run(int64_t &nextRun)
             w->checkTimer(now) &&
             w->state == oloopState_e::running) // check - some cells will complete in prepare
         {
+            // spans recorded by the cell carry the trace id of the request that made it
+            openset::trace::Context traceContext(w->traceId);
+
             if (!w->prepared)
             {
                 w->prepare();
@@ -139,10 +150,17 @@ bool AsyncLoop::run(int64_t &nextRun)
 
             w->runStart = now;
 
+            const auto sliceStart = std::chrono::steady_clock::now();
+            const auto traceStart = openset::trace::nowMicros();
+
             // count runs that have asked for an immediate re-run (returned true)
             if (w->run())
                 ++runCount;
 
+            sliceTime.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - sliceStart).count());
+            openset::trace::record("cell.slice", traceStart, openset::trace::nowMicros(), partition);
+
             // look for next scheduled (future) run operation
             if (w->state == oloopState_e::running &&
                 w->runAt > now && (nextRun == -1 || w->runAt < nextRun))
@@ -157,6 +175,7 @@ bool AsyncLoop::run(int64_t &nextRun)
 
     // swap rerun queue to active queue
     active = std::move(rerun);
+    activeSize = static_cast<int32_t>(active.size());
 
     // nothing to do
     return (!runCount) ? false : true;
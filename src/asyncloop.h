@@ -22,6 +22,8 @@ namespace openset
 			atomic<int32_t> queueSize;
 			// the active worker live
 			vector<OpenLoop*> active;		
+			// size of active, readable from other threads (metrics)
+			atomic<int32_t> activeSize{ 0 };
 			int64_t loopCount;
 
 		public:
@@ -58,6 +60,16 @@ namespace openset
 				return partition;
 			}
 
+			int32_t getActiveCount() const
+			{
+				return activeSize;
+			}
+
+			int32_t getQueuedCount() const
+			{
+				return queueSize;
+			}
+
 			// this runs one iteration of the main Loop
 			// short, sweet and called frequently
 			bool run(int64_t &nextRun);
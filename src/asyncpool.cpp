@@ -2,6 +2,7 @@
 #include "asyncpool.h"
 #include "config.h"
 #include "internoderouter.h"
+#include "trace.h"
 #include <cassert>
 
 using namespace openset::async;
@@ -53,6 +54,8 @@ void AsyncPool::suspendAsync()
 
     csLock lock(globalAsyncLock);
 
+    openset::trace::Span span("async.suspend");
+
     // get all async workers to suspend
     globalAsyncInitSuspend = true;
 
@@ -336,11 +339,15 @@ void AsyncPool::runner(int32_t workerId) noexcept
             // using atomic for thread safe increments
             globalAsyncSuspendedWorkerCount += 1;
 
+            const auto pausedStart = openset::trace::nowMicros();
+
             // Loop & sleep until suspend is cleared
             // while suspended check for deletions thread migrations
             while (globalAsyncInitSuspend)
                 ThreadSleep(10);
 
+            openset::trace::record("async.paused", pausedStart, openset::trace::nowMicros(), workerId);
+
             globalAsyncSuspendedWorkerCount -= 1;
         }
 
@@ -1,4 +1,8 @@
 #include "attributes.h"
+
+#include <algorithm>
+#include <cstring>
+
 #include "sba/sba.h"
 #include "table.h"
 #include "properties.h"
@@ -76,6 +80,21 @@ Attr_s* Attributes::getMake(const int32_t propIndex, const string& value)
     }
 }
 
+Attr_s* Attributes::getMake(const int32_t propIndex, const int64_t valueHash, const char* text, const int32_t length)
+{
+    if (auto attrPair = propertyIndex.find({ propIndex, valueHash }); attrPair == propertyIndex.end())
+    {
+        const auto attr = new(PoolMem::getPool().getPtr(sizeof(Attr_s)))Attr_s();
+        attr->text = blob->storeValue(propIndex, string(text, length));
+        propertyIndex.insert({attr_key_s{ propIndex, valueHash }, attr});
+        return attr;
+    }
+    else
+    {
+        return attrPair->second;
+    }
+}
+
 Attr_s* Attributes::get(const int32_t propIndex, const int64_t value) const
 {
     if (const auto attrPair = propertyIndex.find({ propIndex, value }); attrPair != propertyIndex.end())
@@ -114,17 +133,46 @@ void Attributes::clearDirty()
             continue;
 
         const auto attr = attrPair->second;
+        auto& changes = change.second;
+
+        // apply in customer order, stable so the last change made to a customer wins
+        std::stable_sort(
+            changes.begin(),
+            changes.end(),
+            [](const Attr_changes_s& left, const Attr_changes_s& right) -> bool
+            {
+                return left.linId < right.linId;
+            });
 
         bits.mount(attr->index, attr->ints, attr->ofs, attr->len, attr->linId);
 
-        for (const auto& t : change.second)
+        // grow once for the highest customer, rather than as bits are set
+        bits.lastBit(changes.back().linId);
+
+        auto flipped = false;
+
+        for (auto iter = changes.begin(); iter != changes.end(); ++iter)
         {
-            if (t.state)
-                bits.bitSet(t.linId);
+            // a customer can appear many times (once per event), only the last change counts
+            if (const auto next = iter + 1; next != changes.end() && next->linId == iter->linId)
+                continue;
+
+            if ((iter->state != 0) == bits.bitState(iter->linId))
+                continue;
+
+            flipped = true;
+
+            if (iter->state)
+                bits.bitSet(iter->linId);
             else
-                bits.bitClear(t.linId);
+                bits.bitClear(iter->linId);
         }
 
+        // nothing moved (i.e. an event name the customer already had), keep the stored
+        // copy rather than compressing it again. New attributes still get dropped below
+        if (!flipped && (attr->comp || attr->linId >= 0))
+            continue;
+
         if (!bits.population(bits.ints * 64)) //pop count zero? remove this
         {
             drop(change.first.index, change.first.value );
@@ -138,10 +186,17 @@ void Attributes::clearDirty()
 
             // compress the data, get it back in a pool ptr
             const auto compData = bits.store(compBytes, linId, ofs, len, table->indexCompression);
-            const auto destAttr = recast<Attr_s*>(PoolMem::getPool().getPtr(sizeof(Attr_s) + compBytes));
 
-            // copy header
-            memcpy(destAttr, attr, sizeof(Attr_s));
+            // write over the old copy if the new one fits, otherwise move to a bigger buffer
+            auto destAttr = attr;
+
+            if (compBytes > attr->comp)
+            {
+                destAttr = recast<Attr_s*>(PoolMem::getPool().getPtr(sizeof(Attr_s) + compBytes));
+                // copy header
+                memcpy(destAttr, attr, sizeof(Attr_s));
+            }
+
             if (compData)
             {
                 memcpy(destAttr->index, compData, compBytes);
@@ -158,8 +213,11 @@ void Attributes::clearDirty()
             // if we made a new destination, we have to update the
             // index to point to it, and free the old one up.
             // update the Attr pointer directly in the index
-            attrPair->second = destAttr;
-            PoolMem::getPool().freePtr(attr);
+            if (destAttr != attr)
+            {
+                attrPair->second = destAttr;
+                PoolMem::getPool().freePtr(attr);
+            }
         }
     }
     changeIndex.clear();
@@ -277,6 +335,22 @@ Attributes::AttrList Attributes::getPropertyValues(const int32_t propIndex, cons
     return result;
 }
 
+Attributes::AttrList Attributes::getPropertyValuesContaining(const int32_t propIndex, const string& text)
+{
+    Attributes::AttrList result;
+
+    for (auto &kv : propertyIndex)
+    {
+        if (kv.first.index != propIndex || kv.first.value == NONE || !kv.second->text)
+            continue;
+
+        if (strstr(kv.second->text, text.c_str()))
+            result.push_back(kv.second);
+    }
+
+    return result;
+}
+
 void Attributes::serialize(HeapStack* mem)
 {
     // grab 8 bytes, and set the block type at that address
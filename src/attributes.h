@@ -122,6 +122,7 @@ namespace openset::db
             LT,
             LTE,
             PRESENT,
+            CONTAINS, // text values containing a substring (see getPropertyValuesContaining)
         };
 
         using AttrListExpanded = vector<std::pair<int64_t,Attr_s*>>; // pair, value and bits
@@ -147,6 +148,8 @@ namespace openset::db
 
         Attr_s* getMake(const int32_t propIndex, const int64_t value);
         Attr_s* getMake(const int32_t propIndex, const string& value);
+        // text already hashed (i.e. a staged insert), the text is only stored if the attribute is new
+        Attr_s* getMake(const int32_t propIndex, const int64_t valueHash, const char* text, const int32_t length);
 
         Attr_s* get(const int32_t propIndex, const int64_t value) const;
         Attr_s* get(const int32_t propIndex, const string& value) const;
@@ -163,6 +166,8 @@ namespace openset::db
 
         AttrListExpanded getPropertyValues(const int32_t propIndex);
         AttrList getPropertyValues(const int32_t propIndex, const listMode_e mode, const int64_t value);
+        // text values of a property that contain `text`, every value is checked
+        AttrList getPropertyValuesContaining(const int32_t propIndex, const string& text);
 
         bool operator==(const Attributes& other) const
         {
@@ -16,10 +16,12 @@ const int32_t MAX_PROPERTIES = 4096;
 #define recast reinterpret_cast
 #define cast static_cast
 
+// a block type changes when its layout does, readers refuse types they don't know
 enum class serializedBlockType_e : int64_t
 {
 	attributes = 1,
-	people = 2
+	people = 2,    // PersonDataV1_s records, sent by nodes older than people_v2
+	people_v2 = 3  // PersonData_s records, with first and last stamps
 };
 
 /*
@@ -30,7 +30,8 @@ Config::Config(openset::config::CommandlineArgs args) :
 	host(args.hostLocal),
 	port(args.portLocal),
 	hostExternal(args.hostExternal),
-	portExternal(args.portExternal)
+	portExternal(args.portExternal),
+	ingestPort(args.ingestPort)
 {
 	globals::running = this;
 	setRootPath(args.path);
@@ -25,6 +25,7 @@ namespace openset
 			int portLocal = 8080;
 			std::string hostExternal = "127.0.0.1";
 			int portExternal = 8080;
+			int ingestPort = 0; // TCP ingest, 0 is off
 			std::string path = "./";
 
 			void fix()
@@ -57,6 +58,8 @@ namespace openset
 			string hostExternal{ "127.0.0.1" };
 			int portExternal{ 1022 };
 
+			int ingestPort{ 0 };
+
 			int64_t partitionMax{ 0 }; // server will be in "waiting" mode if no partitions
 			int64_t configVersion{ 0 };
 
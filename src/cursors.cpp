@@ -0,0 +1,108 @@
+#include "cursors.h"
+
+#include <random>
+
+using namespace openset::result;
+
+void ResultCursors::expire(const int64_t needed)
+{
+    const auto now = Now();
+
+    for (auto iter = cursors.begin(); iter != cursors.end();)
+    {
+        if (iter->second->lastUsed + CURSOR_TTL < now)
+        {
+            bytes -= iter->second->bytes;
+            iter = cursors.erase(iter);
+        }
+        else
+            ++iter;
+    }
+
+    while (!cursors.empty() && bytes + needed > CURSOR_MEMORY_MAX)
+    {
+        auto oldest = cursors.begin();
+        for (auto iter = cursors.begin(); iter != cursors.end(); ++iter)
+            if (iter->second->lastUsed < oldest->second->lastUsed)
+                oldest = iter;
+
+        bytes -= oldest->second->bytes;
+        cursors.erase(oldest);
+    }
+}
+
+std::string ResultCursors::add(const CursorPtr& cursor)
+{
+    if (cursor->bytes > CURSOR_MEMORY_MAX)
+        return {};
+
+    static thread_local std::mt19937_64 generator(std::random_device{}() ^ static_cast<uint64_t>(Now()));
+
+    char id[17];
+    snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(generator()));
+
+    csLock lock(cs);
+
+    expire(cursor->bytes);
+
+    cursor->lastUsed = Now();
+    cursors[id] = cursor;
+    bytes += cursor->bytes;
+
+    return id;
+}
+
+CursorPtr ResultCursors::find(const std::string& id)
+{
+    csLock lock(cs);
+
+    expire(0);
+
+    const auto iter = cursors.find(id);
+    if (iter == cursors.end())
+        return nullptr;
+
+    iter->second->lastUsed = Now();
+    return iter->second;
+}
+
+bool ResultCursors::drop(const std::string& id)
+{
+    csLock lock(cs);
+
+    const auto iter = cursors.find(id);
+    if (iter == cursors.end())
+        return false;
+
+    bytes -= iter->second->bytes;
+    cursors.erase(iter);
+    return true;
+}
+
+std::string ResultCursors::page(const std::string& id, const Cursor_s& cursor, const int64_t offset, const int64_t pageSize)
+{
+    const auto total = static_cast<int64_t>(cursor.groups.size());
+    const auto first = std::min(std::max<int64_t>(offset, 0), total);
+    const auto last = std::min(first + pageSize, total);
+
+    std::string result = "{\"_\":[";
+
+    for (auto i = first; i < last; ++i)
+    {
+        if (i != first)
+            result += ',';
+        result += cursor.groups[i];
+    }
+
+    result += ']';
+    result += cursor.tail;
+
+    result += ",\"cursor\":{\"id\":\"" + id + "\"";
+    result += ",\"offset\":" + to_string(first);
+    result += ",\"page_size\":" + to_string(pageSize);
+    result += ",\"total\":" + to_string(total);
+    result += ",\"next\":" + (last < total ? to_string(last) : "null"s);
+    result += "}}";
+
+    return result;
+}
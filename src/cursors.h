@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+#include "threads/locks.h"
+
+/*
+    Result cursors
+
+    An event query run with `page_size=` keeps its sorted result on the node
+    that coordinated it. The top level groups are kept as JSON, in result order,
+    and later pages are cut from them without running the query again.
+
+    Cursors expire when they haven't been read for CURSOR_TTL. When the cursors
+    on a node would use more than CURSOR_MEMORY_MAX the least recently read ones
+    are dropped first.
+*/
+
+namespace openset::result
+{
+    const int64_t CURSOR_TTL = 300'000;                   // 5 minutes since the last page
+    const int64_t CURSOR_MEMORY_MAX = 256LL * 1024 * 1024; // all cursors on the node
+    const int64_t CURSOR_PAGE_MAX = 10'000;
+
+    struct Cursor_s
+    {
+        std::string table;
+        std::vector<std::string> groups; // top level groups, as JSON
+        std::string tail;                // other result branches, as `,"name":{...}`
+        int64_t bytes{ 0 };
+        int64_t lastUsed{ Now() };
+    };
+
+    using CursorPtr = std::shared_ptr<Cursor_s>;
+
+    class ResultCursors
+    {
+        CriticalSection cs;
+        std::unordered_map<std::string, CursorPtr> cursors;
+        int64_t bytes{ 0 };
+
+        ResultCursors() = default;
+
+        // drops expired cursors, then the least recently read until `needed` more bytes fit
+        void expire(int64_t needed);
+
+    public:
+
+        // singleton
+        static ResultCursors& get()
+        {
+            static ResultCursors resultCursors;
+            return resultCursors;
+        }
+
+        // returns the cursor id, empty if the result is larger than CURSOR_MEMORY_MAX
+        std::string add(const CursorPtr& cursor);
+        // nullptr if the cursor expired or never existed. Counts as a read
+        CursorPtr find(const std::string& id);
+        bool drop(const std::string& id);
+
+        // a result document holding groups [offset, offset + pageSize) and a `cursor` branch
+        static std::string page(const std::string& id, const Cursor_s& cursor, int64_t offset, int64_t pageSize);
+    };
+}
@@ -101,6 +101,11 @@ void Customer::insert(cjson* rowData)
     grid.insertEvent(rowData);
 }
 
+void Customer::insert(const StagedRow_s* staged)
+{
+    grid.insertEvent(staged);
+}
+
 PersonData_s* Customer::commit()
 {
     const auto data = grid.commit();
@@ -79,6 +79,12 @@ namespace openset
 				grid.setSessionTime(sessionTime);
 			}
 
+			// rows outside the window are skipped when the customer is prepared
+			void setStampWindow(const int64_t from, const int64_t to)
+			{
+				grid.setStampWindow(from, to);
+			}
+
 			/**
 			 * \brief return reference to grid object
 			 * \return Grid const pointer (read only)
@@ -104,6 +110,12 @@ namespace openset
 			 */
 			void insert(cjson* rowData);
 
+			/**
+			 * \brief insert a row staged by RpcInsert into the Customer.grid object
+			 * \param staged row converted and resolved against the table schema
+			 */
+			void insert(const StagedRow_s* staged);
+
 			/**
 			 * \brief commit (re-compress) the data in Customer.grid
 			 *
@@ -76,6 +76,8 @@ PersonData_s* Customers::createCustomer(int64_t userId)
         newUser->idBytes = 0;
         newUser->bytes = 0;
         newUser->comp = 0;
+        newUser->firstStamp = 0;
+        newUser->lastStamp = 0;
         newUser->props = nullptr;
 
         if (!isReuse)
@@ -123,6 +125,8 @@ PersonData_s* Customers::createCustomer(string userIdString)
             newUser->idBytes = 0;
             newUser->bytes = 0;
             newUser->comp = 0;
+            newUser->firstStamp = 0;
+            newUser->lastStamp = 0;
             newUser->props = nullptr;
             newUser->setIdStr(userIdString);
 
@@ -173,7 +177,7 @@ void Customers::drop(const int64_t userId)
 void Customers::serialize(HeapStack* mem)
 {
     // grab 8 bytes, and set the block type at that address
-    *recast<serializedBlockType_e*>(mem->newPtr(sizeof(int64_t))) = serializedBlockType_e::people;
+    *recast<serializedBlockType_e*>(mem->newPtr(sizeof(int64_t))) = serializedBlockType_e::people_v2;
 
     // grab 8 more bytes, this will be the length of the attributes data within the block
     const auto sectionLength = recast<int64_t*>(mem->newPtr(sizeof(int64_t)));
@@ -196,7 +200,9 @@ int64_t Customers::deserialize(char* mem)
 {
     auto read = mem;
 
-    if (*recast<serializedBlockType_e*>(read) != serializedBlockType_e::people)
+    const auto blockType = *recast<serializedBlockType_e*>(read);
+
+    if (blockType != serializedBlockType_e::people_v2 && blockType != serializedBlockType_e::people)
         return 0;
 
     read += sizeof(int64_t);
@@ -220,11 +226,37 @@ int64_t Customers::deserialize(char* mem)
 
     while (read < end)
     {
-        const auto streamPerson = recast<PersonData_s*>(read);
-        const auto size = streamPerson->size();
+        PersonData_s* customer;
+        int64_t size;
+
+        if (blockType == serializedBlockType_e::people)
+        {
+            const auto streamPerson = recast<PersonDataV1_s*>(read);
+            size = streamPerson->size();
+
+            customer = recast<PersonData_s*>(PoolMem::getPool().getPtr(
+                PERSON_DATA_SIZE + streamPerson->comp + streamPerson->idBytes));
+
+            customer->id = streamPerson->id;
+            customer->linId = streamPerson->linId;
+            customer->bytes = streamPerson->bytes;
+            customer->comp = streamPerson->comp;
+            customer->idBytes = streamPerson->idBytes;
+            customer->props = streamPerson->props;
+            memcpy(customer->events, streamPerson->events, streamPerson->idBytes + streamPerson->comp);
+
+            // unknown until the customer is next committed, overlaps every window until then
+            customer->firstStamp = LLONG_MIN;
+            customer->lastStamp = LLONG_MAX;
+        }
+        else
+        {
+            const auto streamPerson = recast<PersonData_s*>(read);
+            size = streamPerson->size();
 
-        const auto customer = recast<PersonData_s*>(PoolMem::getPool().getPtr(size));
-        memcpy(customer, streamPerson, size);
+            customer = recast<PersonData_s*>(PoolMem::getPool().getPtr(size));
+            memcpy(customer, streamPerson, size);
+        }
 
         // grow if a record was excluded during serialization
         while (static_cast<int>(customerLinear.size()) <= customer->linId)
@@ -4,6 +4,8 @@
 #include "time/epoch.h"
 #include "sba/sba.h"
 #include "var/varblob.h"
+#include "trace.h"
+#include "staging.h"
 
 using namespace openset::db;
 
@@ -489,9 +491,15 @@ void Grid::prepare()
 
     setData.clear();
 
+    // per customer spans would flush the rings in milliseconds, so they are verbose only
+    const auto decodeStart = openset::trace::verbose ? openset::trace::nowMicros() : 0;
+
     const auto expandedBytes = cast<char*>(PoolMem::getPool().getPtr(rawData->bytes));
     LZ4_decompress_fast(rawData->getComp(), expandedBytes, rawData->bytes);
 
+    if (decodeStart)
+        openset::trace::record("grid.decode", decodeStart, openset::trace::nowMicros(), rawData->bytes);
+
     // make a blank row
     auto row = newRow();
     // read pointer - will increment through the compacted set
@@ -502,9 +510,19 @@ void Grid::prepare()
     int64_t lastSessionTime = 0;
     auto properties = table->getProperties();
 
+    // with a stamp window, rows before it are decoded and dropped (sessions still
+    // count them) and decoding stops at the first row after it. Rows are in stamp
+    // order and the stamp is the first value in a row
+    const auto windowed = stampFrom != LLONG_MIN || stampTo != LLONG_MAX;
+    auto rowSetStart = setData.size();
+
     while (read < end)
     {
         const auto cursor = reinterpret_cast<Cast_s*>(read);
+
+        if (windowed && cursor->propIndex == PROP_STAMP && cursor->val64 > stampTo)
+            break;
+
         /**
         * when we are querying we only need the properties
         * referenced in the query, as such, many properties
@@ -520,11 +538,26 @@ void Grid::prepare()
                     ++session;
                 lastSessionTime = row->cols[PROP_STAMP];
                 row->cols[propertyMap->sessionPropIndex] = session;
-            } // if we are parsing the property row we do not
+            }
+
+            read += sizeOfCastHeader;
+
+            if (windowed && row->cols[PROP_STAMP] < stampFrom)
+            {
+                // reuse the row, and drop any set values it collected
+                for (auto iter = row->cols; iter < row->cols + propertyMap->propertyCount; ++iter)
+                    *iter = NONE;
+                if (propertyMap->uuidPropIndex != -1)
+                    row->cols[propertyMap->uuidPropIndex] = rawData->id;
+                setData.resize(rowSetStart);
+                continue;
+            }
+
+            // if we are parsing the property row we do not
             // push it, we store it under `propRow`
             rows.push_back(row);
             row = newRow();
-            read += sizeOfCastHeader;
+            rowSetStart = setData.size();
             continue;
         }
         const auto mappedProperty = propertyMap->reverseMap[cursor->propIndex];
@@ -680,6 +713,10 @@ PersonData_s* Grid::commit()
     newPerson->comp = newCompBytes; // adjust offsets
     newPerson->bytes = bytesNeeded; // copy old id bytes
 
+    // rows are in stamp order, queries with a time window skip customers using these
+    newPerson->firstStamp = rows.empty() ? 0 : rows.front()->cols[PROP_STAMP];
+    newPerson->lastStamp = rows.empty() ? 0 : rows.back()->cols[PROP_STAMP];
+
     if (rawData->idBytes)
         memcpy(newPerson->getIdPtr(), rawData->getIdPtr(), static_cast<size_t>(rawData->idBytes)); // copy NEW flags
 
@@ -1191,6 +1228,196 @@ Grid::RowType_e Grid::insertParse(Properties* properties, cjson* doc, Col_s* ins
     return RowType_e::junk;
 }
 
+Grid::RowType_e Grid::insertParse(Properties* properties, const StagedRow_s* staged, Col_s* insertRow)
+{
+    auto hasEventProp = false;
+    auto eventPropCount = 0;
+    auto hasCustomerProps = false;
+
+    const auto values = staged->values();
+    const auto valuesEnd = values + staged->valueCount;
+
+    // grid column and property of the event property the values belong to, -1 if not mapped
+    auto col = -1;
+    auto schemaCol = -1;
+    Properties::Property_s* propInfo = nullptr;
+    size_t setStart = 0;
+
+    const auto makeAttr = [&](const StagedValue_s& value)
+    {
+        if (value.textLength >= 0)
+            attributes->getMake(schemaCol, value.value, staged->text(value), value.textLength);
+        else
+            attributes->getMake(schemaCol, value.value);
+
+        attributes->setDirty(this->rawData->linId, schemaCol, value.value);
+    };
+
+    for (auto value = values; value != valuesEnd; ++value)
+    {
+        switch (value->kind)
+        {
+        case StagedKind_e::property:
+            schemaCol = value->property;
+            col = propertyMap->reverseMap[schemaCol];
+
+            if (col < 0)
+                continue;
+
+            propInfo = properties->getProperty(schemaCol);
+
+            // the property was deleted or changed since the row was staged
+            if (propInfo->deleted || propInfo->isCustomerProperty)
+            {
+                col = -1;
+                continue;
+            }
+
+            // do we actually have event props, or just a bare 'event' property, well check below
+            if (propInfo->idx >= PROP_INDEX_USER_DATA)
+                ++eventPropCount;
+
+            // we need an the 'event' prop to be set to record event row properties,
+            if (schemaCol == PROP_EVENT)
+                hasEventProp = true;
+
+            attributes->getMake(schemaCol, NONE);
+            attributes->setDirty(this->rawData->linId, schemaCol, NONE);
+            break;
+
+        case StagedKind_e::value:
+            if (col < 0)
+                continue;
+
+            makeAttr(*value);
+
+            if (propInfo->isSet)
+            {
+                SetInfo_s info { 1, static_cast<int>(setData.size()) };
+                insertRow->cols[col] = *reinterpret_cast<int64_t*>(&info);
+                setData.push_back(value->value);
+            }
+            else
+            {
+                insertRow->cols[col] = value->value;
+            }
+
+            hasInsert = true;
+            break;
+
+        case StagedKind_e::set:
+            if (col < 0 || !propInfo->isSet)
+            {
+                col = -1;
+                continue;
+            }
+
+            setStart = setData.size();
+            {
+                SetInfo_s info { 0, static_cast<int>(setStart) };
+                insertRow->cols[col] = *reinterpret_cast<int64_t*>(&info);
+            }
+            hasInsert = true;
+            break;
+
+        case StagedKind_e::member:
+            if (col < 0)
+                continue;
+
+            makeAttr(*value);
+            setData.push_back(value->value);
+            {
+                SetInfo_s info { static_cast<int>(setData.size() - setStart), static_cast<int>(setStart) };
+                insertRow->cols[col] = *reinterpret_cast<int64_t*>(&info);
+            }
+            break;
+
+        case StagedKind_e::customer:
+            col = -1;
+            if (propertyMap->reverseMap[value->property] >= 0)
+                hasCustomerProps = true;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    // if there are no event row properties then we don't really have an event
+    // in which case we will skip inserting the empty event
+    if (eventPropCount == 0)
+        hasEventProp = false;
+
+    if (hasCustomerProps)
+    {
+        auto insertProps = getProps(true);
+        cvar* current = nullptr;
+
+        for (auto value = values; value != valuesEnd; ++value)
+        {
+            if (value->kind == StagedKind_e::customer)
+            {
+                current = nullptr;
+
+                if (propertyMap->reverseMap[value->property] < 0)
+                    continue;
+
+                const auto customerInfo = properties->getProperty(value->property);
+
+                if (customerInfo->deleted || !customerInfo->isCustomerProperty)
+                    continue;
+
+                current = &insertProps[customerInfo->name];
+                continue;
+            }
+
+            if (!current)
+                continue;
+
+            switch (value->kind)
+            {
+            case StagedKind_e::customerSet:
+                current->set();
+                break;
+            case StagedKind_e::customerInt:
+                if (value->member)
+                    *current += value->value;
+                else
+                    *current = value->value;
+                break;
+            case StagedKind_e::customerReal:
+                *current = value->getDouble();
+                break;
+            case StagedKind_e::customerBool:
+                if (value->member)
+                    *current += value->value != 0;
+                else
+                    *current = value->value != 0;
+                break;
+            case StagedKind_e::customerText:
+                if (value->member)
+                    *current += std::string(staged->text(*value), value->textLength);
+                else
+                    *current = std::string(staged->text(*value), value->textLength);
+                break;
+            default:
+                break;
+            }
+        }
+
+        setProps(insertProps);
+    }
+
+    if (hasCustomerProps && hasEventProp)
+        return RowType_e::event_and_prop;
+    if (hasCustomerProps)
+        return RowType_e::prop;
+    if (hasEventProp)
+        return RowType_e::event;
+
+    return RowType_e::junk;
+}
+
 void Grid::insertEvent(cjson* rowData)
 {
     const auto attrNode = rowData;
@@ -1222,6 +1449,31 @@ void Grid::insertEvent(cjson* rowData)
     if (stamp < 0)
         return;
 
+    placeRow(insertRow, stamp, MakeHash(eventName));
+}
+
+void Grid::insertEvent(const StagedRow_s* staged)
+{
+    const auto insertRow = newRow();
+    const auto properties = table->getProperties();
+
+    // apply the staged values (properties & props)
+    const auto insertType = insertParse(properties, staged, insertRow);
+
+    // is there any event here? if not, lets leave
+    if (insertType == RowType_e::junk || insertType == RowType_e::prop)
+        return;
+
+    if (staged->stamp < 0)
+        return;
+
+    placeRow(insertRow, staged->stamp, staged->eventHash);
+}
+
+void Grid::placeRow(Col_s* insertRow, const int64_t stamp, const int64_t hashedEvent)
+{
+    const auto properties = table->getProperties();
+
     insertRow->cols[PROP_STAMP] = stamp;
 
     auto rowCount = rows.size();
@@ -1258,7 +1510,6 @@ void Grid::insertEvent(cjson* rowData)
     };
     auto insertBefore = -1; // where a new row will be inserted if needed
 
-    const auto hashedEvent = MakeHash(eventName);
     const auto eventOrderInts = table->getEventOrderHashes();
     const auto getEventOrder = [&](int64_t value) -> int
     {
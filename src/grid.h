@@ -23,6 +23,7 @@ namespace openset
         class AttributeBlob;
         class PropertyMapping;
         class Grid;
+        struct StagedRow_s;
         struct PropertyMap_s;
         const int64_t int16_min = numeric_limits<int16_t>::min();
         const int64_t int16_max = numeric_limits<int16_t>::max();
@@ -73,6 +74,8 @@ namespace openset
             int32_t bytes;       // bytes when uncompressed
             int32_t comp;        // bytes when compressed
             int16_t idBytes;     // number of bytes in id string
+            int64_t firstStamp;  // stamp of the oldest event row (set by commit)
+            int64_t lastStamp;   // stamp of the newest event row
             char*   props;       // pointer to props - mutable and may change during a query, slow to repack into structure
             char    events[1];   // char* (1st byte) of packed event struct
 
@@ -94,12 +97,37 @@ namespace openset
             }
 
             int64_t size() const { return (sizeof(PersonData_s) - 1LL) + comp + idBytes; }
+
+            // could any event row fall between `from` and `to` (inclusive)
+            bool overlaps(const int64_t from, const int64_t to) const
+            {
+                return bytes && firstStamp <= to && lastStamp >= from;
+            }
+
             char* getIdPtr() { return events; }
             char* getComp() { return events + idBytes; }
         };
 
         const int64_t PERSON_DATA_SIZE = sizeof(PersonData_s) - 1LL;
 
+        /*
+        *  PersonData_s as it was before firstStamp and lastStamp. Partitions
+        *  transferred from older nodes arrive in this layout (a `people` block)
+        *  and are converted when they are read
+        */
+        struct PersonDataV1_s
+        {
+            int64_t id;
+            int32_t linId;
+            int32_t bytes;
+            int32_t comp;
+            int16_t idBytes;
+            char*   props;
+            char    events[1];
+
+            int64_t size() const { return (sizeof(PersonDataV1_s) - 1LL) + comp + idBytes; }
+        };
+
         struct Col_s
         {
             int64_t cols[MAX_PROPERTIES];
@@ -145,6 +173,10 @@ namespace openset
 
             int64_t sessionTime { 60'000LL * 30LL }; // 30 minutes
 
+            // rows outside the window are not decoded by `prepare`
+            int64_t stampFrom { LLONG_MIN };
+            int64_t stampTo { LLONG_MAX };
+
             Table* table { nullptr };
             Attributes* attributes { nullptr };
             AttributeBlob* blob { nullptr };
@@ -171,6 +203,12 @@ namespace openset
             bool mapSchema(Table* tablePtr, Attributes* attributesPtr);
             bool mapSchema(Table* tablePtr, Attributes* attributesPtr, const vector<string>& propertyNames);
             void setSessionTime(const int64_t sessionTime) { this->sessionTime = sessionTime; }
+            // queries only, a grid prepared with a window must never be committed
+            void setStampWindow(const int64_t from, const int64_t to)
+            {
+                stampFrom = from;
+                stampTo = to;
+            }
             cvar getProps(const bool propsMayChange);
             void setProps(cvar& var);
             void mount(PersonData_s* personData);
@@ -185,8 +223,14 @@ namespace openset
             };
 
             RowType_e insertParse(Properties* properties, cjson* doc, Col_s* insertRow);
+            RowType_e insertParse(Properties* properties, const StagedRow_s* staged, Col_s* insertRow);
+
+            // places a parsed event row in stamp/z-order, replacing an identical row
+            void placeRow(Col_s* insertRow, int64_t stamp, int64_t hashedEvent);
         public:
             void insertEvent(cjson* rowData);
+            // rows staged by RpcInsert, no JSON parsing or name hashing
+            void insertEvent(const StagedRow_s* staged);
             // re-encodes and compresses the row data after inserts
             PersonData_s* commit();
 
@@ -39,6 +39,12 @@ openset::web::Rest::Rest(const int64_t routeId, const std::string& server):
     client.config.timeout = 30; // 30 seconds to connect or fail
 }
 
+openset::web::Rest::Rest(const int64_t routeId, const std::string& server, std::shared_ptr<asio::io_service> service):
+    Rest(routeId, server)
+{
+    client.io_service = std::move(service);
+}
+
 void openset::web::Rest::request(const string& method, const string& path, const QueryParams& params,
                                  char* payload, const size_t length, const RestCbJson& cb)
 {
@@ -72,6 +78,15 @@ void openset::web::Rest::request(const string& method, const string& path, const
 
 void openset::web::Rest::request(const string& method, const string& path, const QueryParams& params,
                                  char* payload, const size_t length, const RestCbBin& cb)
+{
+    requestAsync(method, path, params, payload, length, cb);
+
+    client.io_service->reset();
+    client.io_service->run();
+}
+
+void openset::web::Rest::requestAsync(const string& method, const string& path, const QueryParams& params,
+                                      char* payload, const size_t length, const RestCbBin& cb)
 {
     const SimpleWeb::string_view buffer(payload, length);
     const auto url = path + makeParams(params);
@@ -95,7 +110,4 @@ void openset::web::Rest::request(const string& method, const string& path, const
             cb(status, isError, data, length);
         }
     );
-
-    client.io_service->reset();
-    client.io_service->run();
 }
@@ -32,6 +32,9 @@ namespace openset::web
 
         Rest(int64_t routeId, const std::string& server);;
 
+        // requests made with requestAsync complete on `service`, which the caller runs
+        Rest(int64_t routeId, const std::string& server, std::shared_ptr<asio::io_service> service);
+
         ~Rest() = default;
 
         int64_t getRouteId() const
@@ -44,6 +47,10 @@ namespace openset::web
 
         void request(const std::string& method, const std::string& path, const QueryParams& params,
                      char* payload, size_t length, const RestCbBin& cb);
+
+        // returns once the request is queued, `cb` is called from the io_service thread
+        void requestAsync(const std::string& method, const std::string& path, const QueryParams& params,
+                          char* payload, size_t length, const RestCbBin& cb);
     };
 
     using RestPtr = shared_ptr<Rest>;
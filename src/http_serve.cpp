@@ -3,6 +3,8 @@
 #include <iostream>
 #include <mutex>
 #include <queue>
+#include <future>
+#include <cstdio>
 
 #include "threads/locks.h"
 #include "server_http.hpp"
@@ -11,6 +13,8 @@
 #include "http_serve.h"
 #include "http_cli.h"
 #include "rpc.h"
+#include "metrics.h"
+#include "trace.h"
 
 using namespace std::string_literals;
 
@@ -45,23 +49,78 @@ namespace openset::web
         request->content.read(data, length);
         request->content.clear();
 
-        auto reply = [request, response](http::StatusCode status, const char* data, size_t length)
+        auto reply = [request, response](http::StatusCode status, const char* data, size_t length, const char* contentType)
         {
+            openset::trace::Span span("http.reply", static_cast<int64_t>(length));
+
             http::CaseInsensitiveMultimap header;
             header.emplace("Content-Length", to_string(length));
-            header.emplace("Content-Type", "application/json");
+            header.emplace("Content-Type", contentType);
             header.emplace("Access-Control-Allow-Origin", "*");
+            // backpressure (i.e. a full insert backlog), clients should back off before retrying
+            if (status == http::StatusCode::client_error_too_many_requests)
+                header.emplace("Retry-After", "1");
             response->write(status, header);
 
             if (data)
                 response->write(data, length);
         };
 
-        return make_shared<Message>(request->header, queryParts, request->method, request->path, request->query_string, data, length, reply);
+        // every part waits for the previous send to complete, so a slow client
+        // holds back the producer rather than the reply piling up in memory
+        auto stream = [request, response](const StreamPart_e part, http::StatusCode status, const char* data, size_t length, const char* contentType) -> bool
+        {
+            openset::trace::Span span("http.stream", static_cast<int64_t>(length));
+
+            switch (part)
+            {
+            case StreamPart_e::begin:
+            {
+                http::CaseInsensitiveMultimap header;
+                header.emplace("Transfer-Encoding", "chunked");
+                header.emplace("Content-Type", contentType);
+                header.emplace("Access-Control-Allow-Origin", "*");
+                response->write(status, header);
+            }
+            break;
+            case StreamPart_e::chunk:
+            {
+                // a zero length chunk would end the reply
+                if (!length)
+                    return true;
+
+                char sizeLine[24];
+                const auto sizeLength = snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", length);
+                response->write(sizeLine, sizeLength);
+                response->write(data, length);
+                response->write("\r\n", 2);
+            }
+            break;
+            case StreamPart_e::end:
+                response->write("0\r\n\r\n", 5);
+                break;
+            }
+
+            std::promise<bool> sent;
+            auto result = sent.get_future();
+            response->send([&sent](const SimpleWeb::error_code& error)
+            {
+                sent.set_value(!error);
+            });
+
+            return result.get();
+        };
+
+        return make_shared<Message>(request->header, queryParts, request->method, request->path, request->query_string, data, length, reply, stream);
     }
 
     void webWorker::runner()
     {
+        auto& requests = openset::metrics::Metrics::get().counter(
+            "openset_http_requests_total", "HTTP requests dispatched to REST workers");
+        auto& queueWait = openset::metrics::Metrics::get().histogram(
+            "openset_http_queue_wait_seconds", "time HTTP requests wait for a REST worker");
+
         while (true)
         {
             // wait on accept handler
@@ -86,7 +145,22 @@ namespace openset::web
 
             ++server->jobsRun;
 
+            const auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - message->getCreated()).count();
+
+            requests.inc();
+            queueWait.record(waited);
+
+            // a node forwarding a request passes its trace id along, otherwise this is a new trace
+            const auto forwardedId = strtoll(message->getParamString("trace_id").c_str(), nullptr, 10);
+            openset::trace::Context traceContext(forwardedId > 0 ? forwardedId : openset::trace::newTraceId());
+
+            const auto dispatchStart = openset::trace::nowMicros();
+            openset::trace::record("http.queue", dispatchStart - waited, dispatchStart);
+
             openset::comms::Dispatch(message);
+
+            openset::trace::record("http.dispatch", dispatchStart, openset::trace::nowMicros());
         }
     }
 
@@ -135,6 +209,10 @@ namespace openset::web
             queueMessage(std::move(MakeMessage(response, request)));
         };
 
+        server.resource["^/metrics$"]["GET"] = [&](SharedResponseT response, SharedRequestT request) {
+            queueMessage(std::move(MakeMessage(response, request)));
+        };
+
         server.resource["^/ping$"]["GET"] = [&](SharedResponseT response, SharedRequestT request) {
             http::CaseInsensitiveMultimap header;
             header.emplace("Content-Type", "application/json");
@@ -177,6 +255,14 @@ namespace openset::web
         mapEndpoints(server);
         makeWorkers();
 
+        openset::metrics::Metrics::get().gauge(
+            "openset_http_queue_depth",
+            "HTTP requests waiting for a REST worker",
+            [this](openset::metrics::GaugeSamples& samples)
+        {
+            samples.emplace_back("", static_cast<double>(messagesQueued));
+        });
+
         server.default_resource["GET"] = [](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) {
             response->write("{\"error\":\"unknown request\""s);
         };
@@ -5,6 +5,7 @@
 #include <condition_variable>
 #include <queue>
 #include <atomic>
+#include <chrono>
 #include "server_http.hpp"
 #include "sba/sba.h"
 #include "cjson/cjson.h"
@@ -26,7 +27,17 @@ namespace openset
 
 namespace openset::web
 {
-    using ReplyCB = std::function<void(const http::StatusCode status, const char*, const size_t)>;
+    using ReplyCB = std::function<void(const http::StatusCode status, const char*, const size_t, const char* contentType)>;
+
+    enum class StreamPart_e
+    {
+        begin,
+        chunk,
+        end
+    };
+
+    // chunked replies, returns false once the client has gone away
+    using StreamCB = std::function<bool(const StreamPart_e part, const http::StatusCode status, const char*, const size_t, const char* contentType)>;
 
     class Message
     {
@@ -38,6 +49,8 @@ namespace openset::web
         char* payload;
         size_t payloadLength;
         ReplyCB cb;
+        StreamCB streamCb;
+        std::chrono::steady_clock::time_point created { std::chrono::steady_clock::now() };
     public:
         Message(
             const http::CaseInsensitiveMultimap& header,
@@ -47,7 +60,8 @@ namespace openset::web
             const std::string& queryString,
             char* payload,
             const size_t payloadLength,
-            const ReplyCB& cb) :
+            const ReplyCB& cb,
+            const StreamCB& streamCb = nullptr) :
             header(header),
             query(query),
             method(method),
@@ -55,7 +69,8 @@ namespace openset::web
             queryString(queryString),
             payload(payload),
             payloadLength(payloadLength),
-            cb(cb)
+            cb(cb),
+            streamCb(streamCb)
         {};
 
         ~Message()
@@ -95,6 +110,11 @@ namespace openset::web
             return query;
         }
 
+        std::chrono::steady_clock::time_point getCreated() const
+        {
+            return created;
+        }
+
         bool isParam(const std::string& name)
         {
             if (const auto found = query.find(name); found != query.end())
@@ -145,13 +165,20 @@ namespace openset::web
         void reply(const http::StatusCode status, const char* replyData, const size_t replyLength) const
         {
             if (cb)
-                cb(status, replyData, replyLength);
+                cb(status, replyData, replyLength, "application/json");
         }
 
         void reply(const http::StatusCode status, const std::string& message) const
         {
             if (cb)
-                cb(status, &message[0], message.length());
+                cb(status, &message[0], message.length(), "application/json");
+        }
+
+        // non-JSON replies (i.e. Prometheus text on /metrics)
+        void reply(const http::StatusCode status, const std::string& message, const char* contentType) const
+        {
+            if (cb)
+                cb(status, &message[0], message.length(), contentType);
         }
 
         void reply(const http::StatusCode status, const cjson& message) const
@@ -160,10 +187,41 @@ namespace openset::web
             {
                 int64_t length;
                 const auto buffer = cjson::stringifyCstr(&message, length, false);
-                cb(status, buffer, length);
+                cb(status, buffer, length, "application/json");
                 cjson::releaseStringifyPtr(buffer);
             }
         }
+
+        bool canStream() const
+        {
+            return streamCb != nullptr;
+        }
+
+        /*
+         * Chunked replies - call beginStream, then streamChunk any number of times,
+         * then endStream. Each call returns once its data has been sent, so the
+         * caller never holds more than one chunk. Use reply() for errors found
+         * before the stream begins, the status can't change once it has.
+         */
+        bool beginStream(const http::StatusCode status, const char* contentType = "application/json") const
+        {
+            return streamCb && streamCb(StreamPart_e::begin, status, nullptr, 0, contentType);
+        }
+
+        bool streamChunk(const char* data, const size_t length) const
+        {
+            return streamCb && streamCb(StreamPart_e::chunk, http::StatusCode::success_ok, data, length, nullptr);
+        }
+
+        bool streamChunk(const std::string& data) const
+        {
+            return streamChunk(data.c_str(), data.length());
+        }
+
+        bool endStream() const
+        {
+            return streamCb && streamCb(StreamPart_e::end, http::StatusCode::success_ok, nullptr, 0, nullptr);
+        }
     };
 
     using MessagePtr = const shared_ptr<openset::web::Message>;
@@ -0,0 +1,254 @@
+#include "ingest.h"
+
+#include <thread>
+
+#include "common.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "database.h"
+#include "internoderouter.h"
+#include "sentinel.h"
+#include "rpc_insert.h"
+#include "cjson/cjson.h"
+
+using namespace openset::web;
+using namespace openset::comms;
+
+bool IngestServer::queueFrame(const char* data, const uint32_t length, int64_t& backlog, std::string& error)
+{
+    static auto& events = openset::metrics::Metrics::get().counter(
+        "openset_ingest_events_total", "events queued from the TCP ingest port");
+
+    openset::trace::Span span("ingest.frame");
+
+    uint16_t nameLength;
+    memcpy(&nameLength, data, sizeof(nameLength));
+
+    if (sizeof(nameLength) + nameLength > length)
+    {
+        error = "invalid table name length";
+        return false;
+    }
+
+    const std::string tableName(data + sizeof(nameLength), nameLength);
+    const auto payload = data + sizeof(nameLength) + nameLength;
+    const auto payloadLength = length - sizeof(nameLength) - nameLength;
+
+    auto table = openset::globals::database->getTable(tableName);
+
+    if (!table || table->deleted)
+    {
+        error = "missing or invalid table name";
+        return false;
+    }
+
+    cjson request(std::string{ payload, payloadLength }, cjson::Mode_e::string);
+
+    if (request.type() != cjson::Types_e::ARRAY)
+    {
+        error = "events must be a JSON array";
+        return false;
+    }
+
+    // like the HTTP insert, wait out partition map changes
+    for (auto attempt = 1;; ++attempt)
+    {
+        const auto now = Now();
+        if (!openset::globals::sentinel->wasDuringMapChange(now - 500, now))
+            break;
+        ThreadSleep(std::min(attempt * attempt * 20, 10'000));
+    }
+
+    const auto startTime = Now();
+    const auto rows = request.getNodes();
+
+    InsertResult_s accepted;
+
+    while (true)
+    {
+        const auto result = RpcInsert::queueRows(table.get(), rows, false);
+
+        if (result.status == InsertStatus_e::invalid)
+        {
+            error = result.error;
+            return false;
+        }
+
+        if (result.status == InsertStatus_e::accepted)
+        {
+            backlog = std::max(backlog, result.backlog);
+            accepted = result;
+            break;
+        }
+
+        // full, nothing was queued - stop reading until it drains
+        ThreadSleep(INGEST_BUSY_WAIT);
+    }
+
+    events.inc(static_cast<int64_t>(rows.size()));
+
+    if (openset::globals::mapper->countActiveRoutes() > 1 &&
+        openset::globals::sentinel->wasDuringMapChange(startTime, Now()))
+        ThreadSleep(1000);
+
+    // forks number the rows the same way we did, called on a single node too to release the sequences
+    RpcInsert::forwardRows(table.get(), "/v1/insert/" + tableName, accepted, payload, payloadLength);
+
+    return true;
+}
+
+std::vector<char> IngestServer::makeAck(const uint64_t frames, const int64_t backlog, const uint8_t status, const std::string& error)
+{
+    const auto errorLength = static_cast<uint16_t>(std::min<size_t>(error.length(), 65535));
+
+    std::vector<char> ack(sizeof(frames) + sizeof(backlog) + sizeof(status) + sizeof(errorLength) + errorLength);
+    auto write = ack.data();
+
+    memcpy(write, &frames, sizeof(frames));
+    write += sizeof(frames);
+    memcpy(write, &backlog, sizeof(backlog));
+    write += sizeof(backlog);
+    memcpy(write, &status, sizeof(status));
+    write += sizeof(status);
+    memcpy(write, &errorLength, sizeof(errorLength));
+    write += sizeof(errorLength);
+    memcpy(write, error.c_str(), errorLength);
+
+    return ack;
+}
+
+bool IngestServer::serve(const std::string& ip, const int port)
+{
+    try
+    {
+        const asio::ip::tcp::endpoint endpoint(asio::ip::address::from_string(ip), static_cast<unsigned short>(port));
+        acceptor = std::make_unique<asio::ip::tcp::acceptor>(service, endpoint);
+    }
+    catch (const std::exception& ex)
+    {
+        Logger::get().error("TCP ingest could not listen on " + ip + ":" + to_string(port) + " (" + ex.what() + ")");
+        return false;
+    }
+
+    openset::metrics::Metrics::get().gauge(
+        "openset_ingest_connections",
+        "open TCP ingest connections",
+        [this](openset::metrics::GaugeSamples& samples)
+    {
+        samples.emplace_back("", static_cast<double>(connections));
+    });
+
+    std::thread accepter(&IngestServer::acceptLoop, this);
+    accepter.detach();
+
+    Logger::get().info("TCP ingest listening on " + ip + ":" + to_string(port) + ".");
+    return true;
+}
+
+void IngestServer::acceptLoop()
+{
+    while (true)
+    {
+        auto socket = std::make_shared<asio::ip::tcp::socket>(service);
+
+        asio::error_code ec;
+        acceptor->accept(*socket, ec);
+
+        if (ec)
+        {
+            Logger::get().error("TCP ingest accept failed (" + ec.message() + ")");
+            ThreadSleep(100);
+            continue;
+        }
+
+        socket->set_option(asio::ip::tcp::no_delay(true), ec);
+
+        ++connections;
+        std::thread worker(&IngestServer::session, this, socket);
+        worker.detach();
+    }
+}
+
+void IngestServer::session(std::shared_ptr<asio::ip::tcp::socket> socket)
+{
+    static auto& framesTotal = openset::metrics::Metrics::get().counter(
+        "openset_ingest_frames_total", "frames read from TCP ingest connections");
+    static auto& rejectedTotal = openset::metrics::Metrics::get().counter(
+        "openset_ingest_rejected_total", "TCP ingest frames rejected");
+
+    uint64_t frames = 0;
+    int64_t unacked = 0;
+    int64_t backlog = 0;
+    std::vector<char> frame;
+
+    const auto sendAck = [&](const uint8_t status, const std::string& error) -> bool
+    {
+        const auto ack = makeAck(frames, backlog, status, error);
+
+        unacked = 0;
+        backlog = 0;
+
+        asio::error_code ec;
+        asio::write(*socket, asio::buffer(ack), ec);
+        return !ec;
+    };
+
+    while (true)
+    {
+        asio::error_code ec;
+
+        uint32_t length;
+        asio::read(*socket, asio::buffer(&length, sizeof(length)), ec);
+
+        if (ec)
+        {
+            // the producer shut down its side, ack what's left so it can close cleanly
+            if (ec == asio::error::eof && unacked)
+                sendAck(0, "");
+            break;
+        }
+
+        if (length < sizeof(uint16_t) || length > INGEST_MAX_FRAME)
+        {
+            // the stream can't be resynchronized after a bad length
+            ++frames;
+            rejectedTotal.inc();
+            sendAck(1, "invalid frame length");
+            break;
+        }
+
+        frame.resize(length);
+        asio::read(*socket, asio::buffer(frame.data(), length), ec);
+
+        if (ec)
+            break;
+
+        ++frames;
+        ++unacked;
+        framesTotal.inc();
+
+        std::string error;
+
+        if (!queueFrame(frame.data(), length, backlog, error))
+        {
+            rejectedTotal.inc();
+            if (!sendAck(1, error))
+                break;
+            continue;
+        }
+
+        // ack when the window fills, or when the producer has nothing more in flight
+        if (unacked >= INGEST_ACK_FRAMES || !socket->available(ec))
+        {
+            if (!sendAck(0, ""))
+                break;
+        }
+    }
+
+    asio::error_code ec;
+    socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    socket->close(ec);
+
+    --connections;
+}
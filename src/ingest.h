@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "asio.hpp"
+
+/*
+    TCP ingest
+
+    A long lived connection for producers that stream events continuously. It
+    skips HTTP parsing, the REST worker queue and a reply per batch. Rows are
+    routed and queued in the SideLog by the same code as POST /v1/insert
+    (RpcInsert::queueRows) and forwarded to the other nodes the same way.
+
+    Frames (integers are little endian):
+
+        uint32  length of the rest of the frame
+        uint16  table name length
+        char[]  table name
+        char[]  JSON array of events, same as the POST /v1/insert body
+
+    Producers send frames without waiting for a reply. The node acknowledges
+    every INGEST_ACK_FRAMES frames, whenever it has read everything sent so far,
+    and when the producer shuts down its side of the connection:
+
+        uint64  frames handled on this connection
+        int64   deepest insert backlog of the partitions written since the last ack
+        uint8   status - 0 every frame up to `frames` is queued, 1 frame `frames` was rejected
+        uint16  error length
+        char[]  error (empty when status is 0)
+
+    A rejected frame (unknown table, bad JSON, bad customer id) does not close
+    the connection. When partition backlogs are full the node stops reading
+    until they drain, so TCP flow control pushes back on the producer rather
+    than it getting 429s.
+*/
+
+namespace openset::web
+{
+    const int INGEST_ACK_FRAMES = 64;
+    const uint32_t INGEST_MAX_FRAME = 64 * 1024 * 1024;
+    const int INGEST_BUSY_WAIT = 50; // ms between attempts while backlogs are full
+
+    class IngestServer
+    {
+        asio::io_service service;
+        std::unique_ptr<asio::ip::tcp::acceptor> acceptor;
+        std::atomic<int32_t> connections { 0 };
+
+        void acceptLoop();
+        void session(std::shared_ptr<asio::ip::tcp::socket> socket);
+
+    public:
+        IngestServer() = default;
+        ~IngestServer() = default;
+
+        // listens on a background thread, a thread per connection, returns false if the port can't be bound
+        bool serve(const std::string& ip, int port);
+
+        // validates, routes, queues and forwards one frame (less its length), returns false with
+        // `error` set if it was rejected. `backlog` is raised to the deepest backlog written to
+        static bool queueFrame(const char* data, uint32_t length, int64_t& backlog, std::string& error);
+
+        // an acknowledgement, laid out as above
+        static std::vector<char> makeAck(uint64_t frames, int64_t backlog, uint8_t status, const std::string& error);
+    };
+}
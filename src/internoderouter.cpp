@@ -6,6 +6,7 @@
 
 #include "sba/sba.h"
 #include "internoderouter.h"
+#include "metrics.h"
 
 namespace openset
 {
@@ -83,8 +84,16 @@ int64_t openset::mapping::Mapper::getSlotNumber()
 
 void openset::mapping::Mapper::addRoute(const std::string routeName, const int64_t routeId, const std::string ip, const int32_t port)
 {
+    // fan-out latency per node, resolved here (outside our lock) so dispatch only records
+    const auto fanOutTime = &openset::metrics::Metrics::get().histogram(
+        "openset_fanout_seconds",
+        "cluster fan-out request latency by node",
+        "node=\"" + routeName + "\"");
+
     csLock lock(cs); // lock
 
+    fanOutTimers[routeId] = fanOutTime;
+
     // name if first
     if (auto name = names.find(routeId); name == names.end())
         names.emplace(routeId, routeName); // new name
@@ -119,6 +128,7 @@ void openset::mapping::Mapper::removeRoute(const int64_t routeId)
         routes.erase(rt);
         // clear the name out - will be in dictionary
         names.erase(names.find(routeId));
+        fanOutTimers.erase(routeId);
     }
 
     if (const auto rp = restPool.find(routeId); rp != restPool.end())
@@ -375,10 +385,12 @@ openset::mapping::Mapper::Responses openset::mapping::Mapper::dispatchCluster(
 
     // we copy the routes so that another thread won't corrupt them
     decltype(routes) tRoutes;
+    decltype(fanOutTimers) tTimers;
 
     {
         csLock lock(cs);
         tRoutes = routes;
+        tTimers = fanOutTimers;
     }
 
     // dispatchAsync to all our nodes
@@ -389,7 +401,20 @@ openset::mapping::Mapper::Responses openset::mapping::Mapper::dispatchCluster(
             if (!internalDispatch && r.first == globals::running->nodeId)
                 continue;
 
-            if (!dispatchAsync(r.first, method, path, params, data, length, doneCb))
+            // fan-out latency per node, measured from send to response
+            const auto timer = tTimers.find(r.first);
+            const auto fanOutTime = timer == tTimers.end() ? nullptr : timer->second;
+            const auto sent = std::chrono::steady_clock::now();
+
+            const auto timedCb = [doneCb, fanOutTime, sent](const http::StatusCode status, const bool error, char* data, const size_t size)
+            {
+                if (fanOutTime)
+                    fanOutTime->record(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - sent).count());
+                doneCb(status, error, data, size);
+            };
+
+            if (!dispatchAsync(r.first, method, path, params, data, length, timedCb))
             {
                 result.routeError = true;
                 break;
@@ -23,6 +23,11 @@ namespace openset
 		class Message;
 	}
 
+	namespace metrics
+	{
+		class Histogram;
+	}
+
 	namespace mapping
 	{
 		class Mapper
@@ -33,6 +38,8 @@ namespace openset
 			using RouteNames = unordered_map<int64_t, string>;
 			// map route to HTTP string
 			using Routes = unordered_map<int64_t, std::pair<std::string, int>>;
+			// map route to its fan-out latency histogram (looked up once, when the route is added)
+			using RouteTimers = unordered_map<int64_t, metrics::Histogram*>;
             
             using RestConnection = shared_ptr<openset::web::Rest>;
 
@@ -98,6 +105,7 @@ namespace openset
 			PartitionMap partitionMap;
 			Routes routes;
 			RouteNames names;
+			RouteTimers fanOutTimers;
 
 			// we increment every time we make a mailbox - use atomics as they are thread safe
 			atomic<int64_t> slotCounter;
@@ -73,6 +73,8 @@ int main(const int argc, char* argv[])
                 args.hostExternal = argv[i + 1];
             else if (arg == "--os-port"s)
                 args.portExternal = std::stoi(nextArg);
+            else if (arg == "--ingest-port"s)
+                args.ingestPort = std::stoi(nextArg);
             else if (arg == "--data"s)
                 args.path = argv[i + 1];
             else if (arg == "--test"s)
@@ -96,6 +98,7 @@ int main(const int argc, char* argv[])
         cout << "    --os-host  <host/ip, defaults to hostname>  ; optional external host/ip" << endl;
         cout << "    --os-port  <port, defaults to --port value> ; optional external port" << endl;
         cout << "    --data     <relative or absolute path>      ; where commits will be stored" << endl;
+        cout << "    --ingest-port <port>                        ; optional TCP ingest port (off by default)" << endl;
         cout << "    --test                                      ; will run unit tests" << endl;
         cout << endl;
         exit(0);
@@ -5,149 +5,521 @@
 #include "tablepartitioned.h"
 #include "http_cli.h"
 
-void openset::revent::Broker_s::webHookThread(MessageBroker* broker)
+namespace
 {
-    thread th([&, broker]()
+    const auto WEBHOOK_THREADS = 2;
+    const auto WEBHOOK_MAX_MESSAGES = 500;
+    const auto WEBHOOK_MAX_BACKOFF = 300'000; // 5 minutes
+
+    // webhook requests complete here rather than on the pool threads
+    const auto webHookService = std::make_shared<asio::io_service>();
+}
+
+bool openset::revent::Broker_s::deliver()
+{
+    std::string hostPort;
+    std::string sendPath;
+
+    { // scoped lock
+        csLock lock(cs);
+        hostPort = host + ":" + to_string(port);
+        sendPath = path;
+    }
+
+    if (!rest || restHost != hostPort)
     {
+        rest = std::make_shared<openset::web::Rest>(0, hostPort, webHookService);
+        restHost = hostPort;
+    }
 
-        const auto maxMessages = 500;
-        const auto maxBackOff = 300 * 4; // 5 minutes (in 250ms sleeps)
+    // a failed batch is sent again before anything new
+    if (pending.empty())
+        pending = log->read(this, WEBHOOK_MAX_MESSAGES);
 
-        vector<TriggerMessage_s> messageList;
+    if (pending.empty())
+        return false;
 
-        auto backOff = 0;
+    cjson payload;
 
-        atomic<bool> done = false;
-        atomic<bool> retry = false;
+    auto messageArray = payload.setArray("messages");
 
-        const auto done_cb = [&](
-            const http::StatusCode status, const bool error, char* data, const size_t size)
+    for (auto& m : pending)
+    {
+        auto msg = messageArray->pushObject();
+        msg->set("stamp", m.stamp);
+        msg->set("stamp_iso", Epoch::EpochToISO8601(m.stamp));
+        msg->set("id", m.uuid);
+        msg->set("state", m.state == TriggerMessage_s::State_e::entered ? "entered" : "exited");
+    }
+
+    // the payload and the client are kept alive until the response arrives
+    auto buffer = std::make_shared<std::string>(cjson::stringify(&payload));
+
+    const auto backlog = log->head - cursor;
+
+    rest->requestAsync(
+        "POST",
+        sendPath,
         {
-            done = true;
-            retry = error;
-        };
+            { "segment", segmentName },
+            { "subscriber", subscriberName },
+            { "count", to_string(pending.size())},
+            { "remaining", to_string(backlog) }
+        },
+        &(*buffer)[0],
+        buffer->length(),
+        [this, buffer, client = rest](const http::StatusCode status, const bool isError, char* data, const size_t size)
+        {
+            if (data)
+                PoolMem::getPool().freePtr(data);
+
+            if (!isError)
+                pending.clear(); // we got an OK
 
-        auto hostPort = host + ":" + to_string(port);
-        auto rest = std::make_shared<openset::web::Rest>(0, hostPort);
-        std::string lastHost = hostPort;
+            // `this` may be gone once the pool has seen the result
+            WebHookPool::get().delivered(this, !isError);
+        });
 
-        while (true)
+    return true;
+}
+
+bool openset::revent::Broker_s::answerPull(const PullWait_s& wait, const bool force)
+{
+    std::vector<TriggerMessage_s> messages;
+    auto sequence = log->peek(this, wait.max, messages);
+
+    if (messages.empty() && !force)
+        return false;
+
+    std::string body;
+
+    if (wait.binary)
+    {
+        // [int64 seq][int64 stamp][int8 state][int32 id length][id bytes] per message
+        const auto append = [&body](const void* data, const size_t length)
+        {
+            body.append(static_cast<const char*>(data), length);
+        };
+
+        for (const auto& m : messages)
+        {
+            const auto state = static_cast<int8_t>(m.state);
+            const auto idLength = static_cast<int32_t>(m.uuid.length());
+            append(&sequence, sizeof(sequence));
+            append(&m.stamp, sizeof(m.stamp));
+            append(&state, sizeof(state));
+            append(&idLength, sizeof(idLength));
+            append(m.uuid.data(), idLength);
+            ++sequence;
+        }
+    }
+    else
+    {
+        // one JSON object per line, built directly rather than through cjson
+        for (const auto& m : messages)
         {
-            hostPort = host + ":" + to_string(port);
+            body += "{\"seq\":" + to_string(sequence) + ",\"stamp\":" + to_string(m.stamp) + ",\"id\":\"";
 
-            { // scoped lock
-                csLock lock(cs);
-                if (lastHost != hostPort)
-                {
-                    rest = std::make_shared<openset::web::Rest>(0, hostPort);
-                    lastHost = hostPort;
-                }
-                if (shutdownRequested)
+            for (const auto c : m.uuid)
+            {
+                if (c == '"' || c == '\\')
+                    body += '\\';
+                if (static_cast<unsigned char>(c) < 0x20)
                 {
-                    shutdownComplete = true;
-                    return;
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    body += escaped;
+                    continue;
                 }
+                body += c;
             }
 
-            if (!messageList.size())
-            {
-                messageList = broker->pop(segmentName, subscriberName, maxMessages);
-            }
+            body += m.state == TriggerMessage_s::State_e::entered ? "\",\"state\":\"entered\"}\n" : "\",\"state\":\"exited\"}\n";
+            ++sequence;
+        }
+    }
+
+    wait.message->reply(
+        http::StatusCode::success_ok,
+        body,
+        wait.binary ? "application/octet-stream" : "application/x-ndjson");
+
+    return true;
+}
+
+void openset::revent::WebHookPool::add(Broker_s* broker)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    broker->registered = true;
+    registry.push_back(broker);
+
+    // threads are started with the first subscriber
+    if (threads.empty())
+    {
+        for (auto i = 0; i < WEBHOOK_THREADS; ++i)
+        {
+            threads.emplace_back(&WebHookPool::runner, this);
+            threads.back().detach();
+        }
+
+        // runs webhook responses, `work` keeps it going while nothing is in flight
+        threads.emplace_back([]()
+        {
+            asio::io_service::work work(*webHookService);
+            webHookService->run();
+        });
+        threads.back().detach();
+    }
+}
+
+void openset::revent::WebHookPool::remove(Broker_s* broker)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    broker->registered = false;
+    registry.erase(std::remove(registry.begin(), registry.end(), broker), registry.end());
+    readyQueue.erase(std::remove(readyQueue.begin(), readyQueue.end(), broker), readyQueue.end());
+
+    idle.wait(guard, [broker]() { return !broker->inFlight; });
+
+    // don't leave long-polls hanging
+    auto waits = std::move(broker->pullWaits);
+    broker->pullWaits.clear();
+
+    guard.unlock();
+
+    for (const auto& wait : waits)
+        broker->answerPull(wait, true);
+}
+
+void openset::revent::WebHookPool::park(Broker_s* broker, PullWait_s wait)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    if (!broker->registered)
+    {
+        guard.unlock();
+        broker->answerPull(wait, true);
+        return;
+    }
 
-            if (messageList.size())
+    if (!broker->retryAt || wait.deadline < broker->retryAt)
+        broker->retryAt = wait.deadline;
+
+    broker->pullWaits.push_back(std::move(wait));
+
+    // messages may have landed after the caller looked
+    if (broker->log->head != broker->cursor)
+    {
+        if (broker->inFlight)
+        {
+            broker->wakePending = true;
+        }
+        else if (!broker->ready)
+        {
+            broker->ready = true;
+            readyQueue.push_back(broker);
+        }
+    }
+
+    wakeup.notify_one();
+}
+
+void openset::revent::WebHookPool::wake(Broker_s* broker)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    if (!broker->registered || broker->ready)
+        return;
+
+    // nobody is waiting on this pull subscriber
+    if (broker->pull && broker->pullWaits.empty())
+        return;
+
+    if (broker->inFlight)
+    {
+        broker->wakePending = true;
+        return;
+    }
+
+    // backing off after a failure, the runner will pick it up when the retry is due
+    if (!broker->pull && broker->retryAt)
+        return;
+
+    broker->ready = true;
+    readyQueue.push_back(broker);
+    wakeup.notify_one();
+}
+
+void openset::revent::WebHookPool::runner()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (true)
+    {
+        if (!readyQueue.empty())
+        {
+            const auto broker = readyQueue.front();
+            readyQueue.pop_front();
+
+            broker->ready = false;
+            broker->inFlight = true;
+            broker->wakePending = false;
+
+            if (broker->pull)
             {
-                cjson payload;
+                auto waits = std::move(broker->pullWaits);
+                broker->pullWaits.clear();
 
-                auto messageArray = payload.setArray("messages");
+                guard.unlock();
 
-                for (auto& m : messageList)
-                {
-                    auto msg = messageArray->pushObject();
-                    msg->set("stamp", m.stamp);
-                    msg->set("stamp_iso", Epoch::EpochToISO8601(m.stamp));
-                    msg->set("id", m.uuid);
-                    msg->set("state", m.state == TriggerMessage_s::State_e::entered ? "entered" : "exited");
-                }
+                // answer long-polls that have messages or have run out of time
+                std::vector<PullWait_s> waiting;
+                const auto now = Now();
 
-                auto buffer = cjson::stringify(&payload);
+                for (auto& wait : waits)
+                    if (!broker->answerPull(wait, wait.deadline <= now))
+                        waiting.push_back(std::move(wait));
 
-                const auto backlog = broker->size(segmentName, subscriberName);
+                guard.lock();
 
-                done = false;
-                retry = false;
+                broker->inFlight = false;
+                broker->retryAt = 0;
 
-                rest->request(
-                    "POST",
-                    path,
-                    {
-                        { "segment", segmentName },
-                        { "subscriber", subscriberName },
-                        { "count", to_string(messageList.size())},
-                        { "remaining", to_string(backlog) }
-                    },
-                    &buffer[0],
-                    buffer.length(),
-                    done_cb);
+                for (auto& wait : waiting)
+                    broker->pullWaits.push_back(std::move(wait));
 
-                // wait for response from remote endpoint
-                while (!done)
-                    ThreadSleep(55); // TODO move to eventing method
+                for (const auto& wait : broker->pullWaits)
+                    if (!broker->retryAt || wait.deadline < broker->retryAt)
+                        broker->retryAt = wait.deadline;
 
-                if (retry)
-                {
-                    ++backOff;
-                }
-                else
+                if (broker->registered && broker->wakePending && !broker->pullWaits.empty())
                 {
-                    messageList.clear(); // reset the messageList, we got an OK
-                    backOff = backlog ? 0 : 1; // immediate, or wait 250ms second if empty
+                    broker->ready = true;
+                    readyQueue.push_back(broker);
                 }
+
+                broker->wakePending = false;
+                idle.notify_all();
+                continue;
             }
-            else
-            {
-                // no data, check for data in 250ms.
-                backOff = 1;
-            }
 
-            if (backOff > maxBackOff)
-                backOff = maxBackOff;
+            // the response finishes the delivery, unless there was nothing to send
+            guard.unlock();
+            const auto sent = broker->deliver();
+            guard.lock();
+
+            if (!sent)
+                finish(broker, true);
+
+            continue;
+        }
+
+        // queue anything whose retry is due, and find the next one
+        const auto now = Now();
+        int64_t nextRetry = 0;
+
+        for (auto broker : registry)
+        {
+            if (!broker->retryAt)
+                continue;
 
-            // loop on short sleeps for back off period. This way we won't
-            // block for long if a thread shutdown request is encountered.
-            for (auto sleeps = 0; sleeps < backOff; ++sleeps)
+            if (broker->retryAt <= now)
             {
-                {
-                    csLock lock(cs); // scoped lock
-                    if (shutdownRequested)
-                    {
-                        shutdownComplete = true;
-                        return;
-                    }
-                }
-                ThreadSleep(250);
+                broker->retryAt = 0;
+                broker->ready = true;
+                readyQueue.push_back(broker);
+            }
+            else if (!nextRetry || broker->retryAt < nextRetry)
+            {
+                nextRetry = broker->retryAt;
             }
         }
-    });
 
-    th.detach();
-}
+        if (!readyQueue.empty())
+            continue;
 
-openset::revent::MessageBroker::~MessageBroker() = default;
+        if (nextRetry)
+            wakeup.wait_for(guard, std::chrono::milliseconds(nextRetry - now));
+        else
+            wakeup.wait(guard);
+    }
+}
 
-std::vector<openset::revent::Queue*> openset::revent::MessageBroker::getAllQueues(const int64_t segmentId)
+void openset::revent::WebHookPool::finish(Broker_s* broker, const bool success)
 {
-    std::vector<openset::revent::Queue*> queues;
+    broker->inFlight = false;
 
-    for (auto &q:queueMap)
+    if (success)
     {
-        if (q.first == segmentId)
+        broker->backOff = 0;
+
+        // more to send, go to the back of the line so others get a turn
+        if (broker->registered &&
+            (broker->wakePending || broker->log->head != broker->cursor))
         {
-            for (auto &t:q.second)
-                queues.push_back(&t.second);
+            broker->ready = true;
+            readyQueue.push_back(broker);
+            wakeup.notify_one();
         }
     }
+    else
+    {
+        broker->backOff = broker->backOff ? std::min<int64_t>(broker->backOff * 2, WEBHOOK_MAX_BACKOFF) : 250;
+        broker->retryAt = Now() + broker->backOff;
+        // a sleeping runner may be waiting on a later retry
+        wakeup.notify_one();
+    }
+
+    broker->wakePending = false;
+    idle.notify_all();
+}
+
+void openset::revent::WebHookPool::delivered(Broker_s* broker, const bool success)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    finish(broker, success);
+}
 
-    return queues;
+openset::revent::MessageBroker::~MessageBroker()
+{
+    // the pool must not outlive our subscribers
+    for (auto& sub : subscribers)
+        WebHookPool::get().remove(sub.second.get());
+}
+
+void openset::revent::SegmentLog_s::append(std::vector<TriggerMessage_s>& messages)
+{
+    csLock lock(cs); // scoped lock
+
+    // make room by letting go of anything expired before growing the ring
+    if (head + static_cast<int64_t>(messages.size()) - tail > static_cast<int64_t>(ring.size()))
+        expire();
+
+    const auto needed = head + static_cast<int64_t>(messages.size()) - tail;
+
+    if (needed > static_cast<int64_t>(ring.size()))
+    {
+        auto capacity = ring.size();
+        while (static_cast<int64_t>(capacity) < needed)
+            capacity *= 2;
+
+        std::vector<TriggerMessage_s> grown(capacity);
+
+        for (auto sequence = tail; sequence < head; ++sequence)
+            grown[sequence & (capacity - 1)] = std::move(ring[sequence & (ring.size() - 1)]);
+
+        ring = std::move(grown);
+    }
+
+    auto sequence = head.load();
+
+    for (auto& m : messages)
+        ring[sequence++ & (ring.size() - 1)] = std::move(m);
+
+    head = sequence;
+
+    messages.clear();
+
+    for (auto reader : readers)
+        WebHookPool::get().wake(reader);
+}
+
+int64_t openset::revent::SegmentLog_s::peek(Broker_s* reader, const int64_t max, std::vector<TriggerMessage_s>& into)
+{
+    csLock lock(cs); // scoped lock
+
+    const auto first = std::max(reader->cursor.load(), tail);
+    const auto end = std::min(head.load(), first + max);
+
+    into.reserve(end - first);
+
+    for (auto sequence = first; sequence < end; ++sequence)
+        into.push_back(ring[sequence & (ring.size() - 1)]);
+
+    return first;
+}
+
+void openset::revent::SegmentLog_s::ack(Broker_s* reader, const int64_t sequence)
+{
+    csLock lock(cs); // scoped lock
+
+    // cursors only move forward, and never past the head
+    if (sequence > reader->cursor)
+        reader->cursor = std::min(sequence, head.load());
+}
+
+std::vector<openset::revent::TriggerMessage_s> openset::revent::SegmentLog_s::read(Broker_s* reader, const int64_t max)
+{
+    std::vector<TriggerMessage_s> result;
+
+    csLock lock(cs); // scoped lock
+
+    auto sequence = std::max(reader->cursor.load(), tail);
+    const auto end = std::min(head.load(), sequence + max);
+
+    result.reserve(end - sequence);
+
+    for (; sequence < end; ++sequence)
+        result.push_back(ring[sequence & (ring.size() - 1)]);
+
+    reader->cursor = sequence;
+
+    return result;
+}
+
+void openset::revent::SegmentLog_s::expire()
+{
+    const auto now = Now();
+    auto slowest = head.load();
+
+    for (auto reader : readers)
+    {
+        // anything older than this is expired
+        const auto expireLine = now - reader->hold;
+
+        auto sequence = std::max(reader->cursor.load(), tail);
+
+        while (sequence < head && ring[sequence & (ring.size() - 1)].stamp < expireLine)
+            ++sequence;
+
+        reader->cursor = sequence;
+
+        if (sequence < slowest)
+            slowest = sequence;
+    }
+
+    // release the strings held by messages every reader is done with
+    for (; tail < slowest; ++tail)
+        ring[tail & (ring.size() - 1)] = TriggerMessage_s{};
+}
+
+void openset::revent::SegmentLog_s::addReader(Broker_s* reader)
+{
+    csLock lock(cs); // scoped lock
+
+    // new subscribers start with the next message, as if they had an empty queue
+    reader->cursor = head.load();
+    readers.push_back(reader);
+}
+
+void openset::revent::SegmentLog_s::removeReader(Broker_s* reader)
+{
+    csLock lock(cs); // scoped lock
+
+    readers.erase(std::remove(readers.begin(), readers.end(), reader), readers.end());
+    expire();
+}
+
+std::shared_ptr<openset::revent::SegmentLog_s> openset::revent::MessageBroker::getLog(const int64_t segmentId)
+{
+    csLock lock(cs); // scoped lock
+
+    if (const auto iter = logs.find(segmentId); iter != logs.end())
+        return iter->second;
+
+    return nullptr;
 }
 
 void openset::revent::MessageBroker::registerSubscriber(
@@ -156,7 +528,8 @@ void openset::revent::MessageBroker::registerSubscriber(
     const std::string& host,
     const int port,
     const std::string& path,
-    const int64_t hold)
+    const int64_t hold,
+    const bool pull)
 {
     csLock lock(cs); // scoped lock
 
@@ -167,118 +540,91 @@ void openset::revent::MessageBroker::registerSubscriber(
     {
         // update config
         {
-            csLock subLock(sub->second.cs); // scoped lock
-            sub->second.hold = hold;
-            sub->second.host = host;
-            sub->second.port = port;
-            sub->second.path = path;
+            csLock subLock(sub->second->cs); // scoped lock
+            sub->second->hold = hold;
+            sub->second->host = host;
+            sub->second->port = port;
+            sub->second->path = path;
         }
     }
     else // not found
     {
-        auto newSub = subscribers.emplace(key, Broker_s{ segmentName, subscriberName, host, port, path, hold });
+        auto& info = *(subscribers[key] = std::make_shared<Broker_s>(
+            segmentName, subscriberName, host, port, path, hold, pull));
 
-        // emplace returns a goofy pair of pairs, our pair is in .first
-        auto &info = newSub.first->second;
+        // if there is no log for this trigger yet, make one
+        auto& log = logs[info.triggerId];
+        if (!log)
+            log = std::make_shared<SegmentLog_s>();
 
-        // if the queueMap is missing an entry for this trigger
-        // add a subscribers object keyed to this triggerId
-        if (!queueMap.count(info.triggerId))
-            queueMap.emplace(info.triggerId, Subscriptions{});
+        info.log = log;
+        log->addReader(&info);
 
-        auto &queue = queueMap[info.triggerId]; // for some readability
+        // deliveries (and long-polls) run on the shared webhook pool
+        WebHookPool::get().add(&info);
+    }
+}
 
-        // if the queueMap->subscriptions object does not contain
-        // a queue for this subscriberId, then add one
-        if (!queue.count(info.subscriberId))
-            queue.emplace(info.subscriberId, Queue{});
+std::shared_ptr<openset::revent::Broker_s> openset::revent::MessageBroker::getSubscriber(
+    const std::string& segmentName,
+    const std::string& subscriberName)
+{
+    csLock lock(cs); // scoped lock
 
-        // start a thread for this sub
-        info.webHookThread(this);
-    }
+    const auto sub = subscribers.find(std::make_pair(segmentName, subscriberName));
+    return sub == subscribers.end() ? nullptr : sub->second;
 }
 
 bool openset::revent::MessageBroker::removeSubscriber(
     const std::string& segmentName,
     const std::string& subscriberName)
 {
-    const auto key = std::make_pair(segmentName, subscriberName);
-    const auto sub = subscribers.find(key);
+    std::shared_ptr<Broker_s> broker;
 
-    if (sub != subscribers.end()) // found
     {
-        { // scoped lock
-            csLock subLock(sub->second.cs);
-            sub->second.shutdownRequested = true;
-        }
-
-        while (true) // wait for thread to confirm shutdown
-        {
-            { // scoped lock
-                csLock subLock(sub->second.cs);
-                if (sub->second.shutdownComplete)
-                    break;
-            }
-            ThreadSleep(55);
-        }
-
-        // worker thread has been gracefully stopped
         csLock lock(cs); // scoped lock
-        subscribers.erase(key);
-        return true;
-    }
-
-    return false;
-}
 
-void openset::revent::MessageBroker::backClean()
-{
-    // Note - internal function lock from the caller
-    for (auto &sub : subscribers)
-    {
+        const auto sub = subscribers.find(std::make_pair(segmentName, subscriberName));
 
-        auto t = queueMap.find(sub.second.triggerId);
+        if (sub == subscribers.end()) // not found
+            return false;
 
-        if (t == queueMap.end())
-            continue;
+        broker = sub->second;
+        subscribers.erase(sub);
+    }
 
-        auto s = t->second.find(sub.second.subscriberId);
+    // waits out any delivery in flight and answers parked pulls, outside our
+    // lock so pushes aren't held up. Pulls arriving later see it unregistered
+    WebHookPool::get().remove(broker.get());
 
-        if (s == t->second.end())
-            continue;
+    csLock lock(cs); // scoped lock
 
-        auto& q = s->second;
+    const auto log = broker->log;
+    log->removeReader(broker.get());
 
-        // anything older than this is expired
-        const auto expireLine = Now() - sub.second.hold;
+    // the last subscriber takes the log with it, pushes for this segment are discarded again
+    if (log->readers.empty())
+        if (const auto iter = logs.find(broker->triggerId); iter != logs.end() && iter->second == log)
+            logs.erase(iter);
 
-        // pop anything expired from the queue
-        while (!q.empty() && q.front().stamp < expireLine)
-            q.pop();
-    }
+    return true;
 }
 
 void openset::revent::MessageBroker::push(
     int64_t segmentId,
     std::vector<TriggerMessage_s>& messages)
 {
-    csLock lock(cs); // scoped lock
+    // no subscribers, no log - messages are discarded
+    const auto log = getLog(segmentId);
 
-    // get list of all subscribers waiting on messages for this trigger
-    auto subQueues = getAllQueues(segmentId);
-
-    // each segment can have multiple subQueues (different subscribers)
-    // to accomodate this we basically insert the message multiple times,
-    // once for each subQueue
-    for (auto &m : messages)
+    if (!log)
     {
-        // insert message m in each subscribed queue for this trigger
-        for (auto q : subQueues)
-            q->push(m);
-
+        messages.clear();
+        return;
     }
 
-    backClean();
+    // one append, no matter how many subscribers read it
+    log->append(messages);
 }
 
 std::vector<openset::revent::TriggerMessage_s> openset::revent::MessageBroker::pop(
@@ -286,68 +632,50 @@ std::vector<openset::revent::TriggerMessage_s> openset::revent::MessageBroker::p
     const std::string& subscriberName,
     const int64_t max)
 {
-    std::vector<openset::revent::TriggerMessage_s> result;
+    const auto reader = getSubscriber(segmentName, subscriberName);
 
+    if (!reader)
+        return {};
+
+    // only the segment log is locked while messages are copied out
+    return reader->log->read(reader.get(), max);
+}
+
+int64_t openset::revent::MessageBroker::size(const std::string& segmentName, const std::string& subscriberName)
+{
     csLock lock(cs); // scoped lock
 
     const auto key = std::make_pair(segmentName, subscriberName);
     const auto sub = subscribers.find(key);
 
-    if (sub != subscribers.end()) // found
-    {
-        auto t = queueMap.find(sub->second.triggerId);
-
-        if (t == queueMap.end())
-            return result;
+    if (sub == subscribers.end()) // not found
+        return 0;
 
-        auto s = t->second.find(sub->second.subscriberId);
-
-        if (s == t->second.end())
-            return result;
+    return sub->second->log->head - sub->second->cursor;
+}
 
-        auto count = 0;
+std::vector<std::tuple<std::string, std::string, int64_t>> openset::revent::MessageBroker::getQueueSizes()
+{
+    std::vector<std::tuple<std::string, std::string, int64_t>> result;
 
-        while (s->second.size() && count < max)
-        {
-            result.push_back(s->second.front());
-            s->second.pop();
-            ++count;
-        }
+    csLock lock(cs); // scoped lock
 
-        return result;
-    }
+    for (auto& sub : subscribers)
+        result.emplace_back(
+            sub.second->segmentName,
+            sub.second->subscriberName,
+            sub.second->log->head - sub.second->cursor);
 
     return result;
-
 }
 
-int64_t openset::revent::MessageBroker::size(const std::string& segmentName, const std::string& subscriberName)
+void openset::revent::MessageBroker::run()
 {
     csLock lock(cs); // scoped lock
 
-    const auto key = std::make_pair(segmentName, subscriberName);
-    const auto sub = subscribers.find(key);
-
-    if (sub != subscribers.end()) // found
+    for (auto& log : logs)
     {
-        if (auto t = queueMap.find(sub->second.triggerId); t == queueMap.end())
-        {
-            return 0;
-        }
-        else
-        {
-            if (const auto s = t->second.find(sub->second.subscriberId); s == t->second.end())
-                return 0;
-            else
-                return s->second.size();
-        }
+        csLock logLock(log.second->cs);
+        log.second->expire();
     }
-
-    return 0;
-}
-
-void openset::revent::MessageBroker::run()
-{
-    csLock lock(cs); // scoped lock
-    backClean();
 }
@@ -1,10 +1,15 @@
 #pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <queue>
+#include <thread>
 #include <unordered_map>
 
 #include "common.h"
 #include "threads/locks.h"
-#include <queue>
+#include <atomic>
+#include <memory>
 
 namespace openset
 {
@@ -14,6 +19,12 @@ namespace openset
         class TablePartitioned;
     };
 
+    namespace web // forwards
+    {
+        class Rest;
+        class Message;
+    };
+
     namespace revent
     {
         struct TriggerMessage_s
@@ -53,9 +64,22 @@ namespace openset
             {
                 uuid = std::move(other.uuid);
             }
+
+            TriggerMessage_s& operator=(const TriggerMessage_s& other) = default;
+            TriggerMessage_s& operator=(TriggerMessage_s&& other) noexcept = default;
         };
 
         class MessageBroker;
+        struct SegmentLog_s;
+
+        // a long-poll waiting for messages on a pull subscriber
+        struct PullWait_s
+        {
+            std::shared_ptr<openset::web::Message> message;
+            int64_t max { 0 };
+            bool binary { false };
+            int64_t deadline { 0 }; // reply (empty if need be) by this time
+        };
 
         struct Broker_s
         {
@@ -67,17 +91,35 @@ namespace openset
             int64_t triggerId;
             int64_t subscriberId;
             int64_t hold;
-            bool shutdownRequested { false };
-            bool shutdownComplete { false };
+            bool pull { false }; // consumers long-poll instead of receiving webhooks
             CriticalSection cs;
 
+            // the log for this segment, and the sequence of the next message this subscriber will read
+            std::shared_ptr<SegmentLog_s> log;
+            std::atomic<int64_t> cursor { 0 };
+
+            // delivery state - guarded by the WebHookPool lock
+            bool registered { false };
+            bool ready { false };       // in the pool's ready queue
+            bool inFlight { false };    // a delivery is being built or awaiting its response
+            bool wakePending { false }; // messages arrived while in flight
+            int64_t retryAt { 0 };      // after a failed delivery, or the next pull deadline
+            int64_t backOff { 0 };
+            std::vector<PullWait_s> pullWaits;
+
+            // owned by whoever holds the delivery in flight
+            std::vector<TriggerMessage_s> pending; // sent but not acknowledged
+            std::shared_ptr<openset::web::Rest> rest;
+            std::string restHost;
+
             Broker_s(
                 const std::string& segmentName,
                 const std::string& subscriberName,
                 const std::string& host,
                 const int port,
                 const std::string& path,
-                const int64_t hold) :
+                const int64_t hold,
+                const bool pull) :
                 segmentName(segmentName),
                 subscriberName(subscriberName),
                 host(host),
@@ -85,36 +127,126 @@ namespace openset
                 path(path),
                 triggerId(MakeHash(segmentName)),
                 subscriberId(MakeHash(subscriberName)),
-                hold(hold)
+                hold(hold),
+                pull(pull)
+            {}
+
+            // start a POST of the next batch to the subscriber's webhook. Returns false
+            // if there was nothing to send, otherwise the response is handed to
+            // WebHookPool::delivered
+            bool deliver();
+
+            // reply to a long-poll with messages from the cursor on. Returns false
+            // without replying if there are none, unless `force` is set
+            bool answerPull(const PullWait_s& wait, bool force);
+        };
+
+        /* WebHookPool
+         *
+         * Webhook delivery for every subscriber on the node runs on a handful of
+         * shared threads. A subscriber is queued when its segment log is appended
+         * to, a thread picks it up and starts a POST of one batch. The thread is
+         * free again as soon as the request is queued; the response arrives on the
+         * pool's io thread, which re-queues the subscriber if there is more to send.
+         * Idle subscribers cost nothing, and each has at most one delivery in flight.
+         * Failed deliveries back off without holding a thread.
+         */
+        class WebHookPool
+        {
+            std::mutex lock;
+            std::condition_variable wakeup;
+            std::condition_variable idle;
+            std::deque<Broker_s*> readyQueue;
+            std::vector<Broker_s*> registry;
+            std::vector<std::thread> threads;
+
+            WebHookPool() = default;
+            void runner();
+            // a delivery ended, call with the lock held
+            void finish(Broker_s* broker, bool success);
+
+        public:
+            // singleton
+            static WebHookPool& get()
+            {
+                static WebHookPool pool;
+                return pool;
+            }
+
+            void add(Broker_s* broker);
+            // returns once no delivery is in flight for the subscriber
+            void remove(Broker_s* broker);
+            // messages are waiting for the subscriber
+            void wake(Broker_s* broker);
+            // the subscriber answered (or failed to answer) a delivery
+            void delivered(Broker_s* broker, bool success);
+            // hold a long-poll until messages arrive or its deadline passes
+            void park(Broker_s* broker, PullWait_s wait);
+        };
+
+        /* SegmentLog_s
+         *
+         * One append-only log per segment. Every subscriber to the segment reads
+         * the same log through its own cursor, so a message is stored once regardless
+         * of subscriber count.
+         *
+         * Messages live in a power of two ring addressed by sequence number. The ring
+         * grows when full, and messages are dropped from the tail once every reader has
+         * moved past them, either by reading them or because they outlived the reader's hold.
+         */
+        struct SegmentLog_s
+        {
+            CriticalSection cs; // appends, reads and trimming
+            std::vector<TriggerMessage_s> ring;
+            int64_t tail { 0 }; // sequence of the oldest message held
+            std::atomic<int64_t> head { 0 }; // sequence the next message will get
+            std::vector<Broker_s*> readers;
+
+            SegmentLog_s() :
+                ring(1024)
             {}
 
-            void webHookThread(MessageBroker* broker);
+            // append messages and clear the messages vector
+            void append(std::vector<TriggerMessage_s>& messages);
+
+            // copy up to max messages from a reader's cursor and advance the cursor
+            std::vector<TriggerMessage_s> read(Broker_s* reader, int64_t max);
+
+            // copy up to max messages from a reader's cursor, leaving the cursor
+            // alone. Returns the sequence of the first message copied
+            int64_t peek(Broker_s* reader, int64_t max, std::vector<TriggerMessage_s>& into);
+
+            // move a reader's cursor forward to `sequence` (everything before it is consumed)
+            void ack(Broker_s* reader, int64_t sequence);
+
+            // move readers past messages older than their hold, and drop
+            // messages no reader needs. Note - caller locks
+            void expire();
+
+            void addReader(Broker_s* reader);
+            void removeReader(Broker_s* reader);
         };
 
-        // independent queue for each subscriber
-        using Queue = queue<TriggerMessage_s>;
-        // map of subscriber ID to message queue
-        using Subscriptions = unordered_map<int64_t, Queue>;
-        // map of trigger ids, to subscribers
-        using QueueMap = unordered_map<int64_t, Subscriptions>;
+        // map of trigger ids, to segment logs
+        using LogMap = unordered_map<int64_t, std::shared_ptr<SegmentLog_s>>;
 
-        // subscriber information note: std::pair<triggerName, subscriberName>
-        using SubscriberMap = std::unordered_map<std::pair<std::string, std::string>, Broker_s>;
+        // subscriber information note: std::pair<triggerName, subscriberName>. Shared so a
+        // request still holding a subscriber keeps it alive after it is removed
+        using SubscriberMap = std::unordered_map<std::pair<std::string, std::string>, std::shared_ptr<Broker_s>>;
 
         class MessageBroker
         {
         public:
             CriticalSection cs;
-            QueueMap queueMap;
+            LogMap logs;
             SubscriberMap subscribers;
 
             MessageBroker() = default;
             ~MessageBroker();
 
         private:
-            // returns a list of all queues regardless of Subscriber
-            std::vector<Queue*> getAllQueues(const int64_t segmentId);
-            void backClean();
+            // returns the log for a segment, or nullptr if it has no subscribers
+            std::shared_ptr<SegmentLog_s> getLog(const int64_t segmentId);
 
         public:
 
@@ -128,18 +260,22 @@ namespace openset
                 const std::string& host,
                 const int port,
                 const std::string& path,
-                const int64_t hold);
+                const int64_t hold,
+                const bool pull = false);
+
+            // returns nullptr if not found
+            std::shared_ptr<Broker_s> getSubscriber(const std::string& segmentName, const std::string& subscriberName);
 
             // delete a subscriber
             bool removeSubscriber(const std::string& segmentName, const std::string& subscriberName);
 
-            // pushes a local cache of messages from a tablePartitioned object
-            // into the various subscriber caches and clears the messages vector upon completion
+            // appends a local cache of messages from a tablePartitioned object
+            // to the segment log and clears the messages vector upon completion
             void push(
                 int64_t segmentId,
                 std::vector<TriggerMessage_s>& messages);
 
-            // pop up to "max" items from a subscribers queue
+            // pop up to "max" items from a subscribers cursor
             std::vector<TriggerMessage_s> pop(
                 const std::string& segmentName,
                 const std::string& subscriberName,
@@ -147,6 +283,9 @@ namespace openset
 
             int64_t size(const std::string& segmentName, const std::string& subscriberName);
 
+            // <segmentName, subscriberName, queue length> for every subscriber
+            std::vector<std::tuple<std::string, std::string, int64_t>> getQueueSizes();
+
             // perform queue maintenance, expire old messages, etc.
             void run();
         };
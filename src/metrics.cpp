@@ -0,0 +1,195 @@
+#include "metrics.h"
+
+#include <cstdio>
+
+using namespace openset::metrics;
+
+namespace
+{
+    std::atomic<int> nextShard{ 0 };
+
+    std::string formatValue(const double value)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    std::string withLabels(const std::string& name, const std::string& labels, const std::string& extra = "")
+    {
+        if (labels.empty() && extra.empty())
+            return name;
+        if (labels.empty())
+            return name + "{" + extra + "}";
+        if (extra.empty())
+            return name + "{" + labels + "}";
+        return name + "{" + labels + "," + extra + "}";
+    }
+
+    void writeHeader(std::string& out, const std::string& name, const std::string& help, const std::string& type)
+    {
+        out += "# HELP " + name + " " + help + "\n";
+        out += "# TYPE " + name + " " + type + "\n";
+    }
+}
+
+int openset::metrics::shardIndex()
+{
+    static thread_local const auto index = nextShard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return index;
+}
+
+int64_t Counter::value() const
+{
+    int64_t total = 0;
+    for (const auto& shard : shards)
+        total += shard.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+int Histogram::bucketIndex(const int64_t micros)
+{
+    if (micros < HISTOGRAM_SUB_BUCKETS)
+        return micros < 0 ? 0 : static_cast<int>(micros);
+
+    // position of the highest set bit picks the power of two range, the
+    // next HISTOGRAM_SUB_BITS bits pick the linear sub-bucket inside it
+    auto msb = 0;
+    for (auto v = micros; v > 1; v >>= 1)
+        ++msb;
+
+    const auto sub = static_cast<int>(micros >> (msb - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    const auto index = (msb - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+
+    return index < HISTOGRAM_BUCKETS ? index : HISTOGRAM_BUCKETS - 1;
+}
+
+int64_t Histogram::bucketUpperBound(const int index)
+{
+    if (index < HISTOGRAM_SUB_BUCKETS)
+        return index;
+
+    const auto shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    const auto sub = index % HISTOGRAM_SUB_BUCKETS;
+    const auto lower = static_cast<int64_t>(HISTOGRAM_SUB_BUCKETS + sub) << shift;
+
+    return lower + (1LL << shift) - 1;
+}
+
+Histogram::Snapshot_s Histogram::snapshot() const
+{
+    Snapshot_s result;
+
+    for (const auto& shard : shards)
+    {
+        for (auto i = 0; i < HISTOGRAM_BUCKETS; ++i)
+            result.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+        result.count += shard.count.load(std::memory_order_relaxed);
+    }
+
+    return result;
+}
+
+Metrics::Family_s& Metrics::getFamily(const std::string& name, const std::string& help, const std::string& type)
+{
+    auto iter = families.find(name);
+
+    if (iter == families.end())
+    {
+        order.push_back(name);
+        iter = families.emplace(name, Family_s{}).first;
+        iter->second.help = help;
+        iter->second.type = type;
+    }
+
+    return iter->second;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels)
+{
+    csLock lock(cs);
+
+    auto& family = getFamily(name, help, "counter");
+    auto& counter = family.counters[labels];
+
+    if (!counter)
+        counter = std::make_unique<Counter>();
+
+    return *counter;
+}
+
+Histogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& labels)
+{
+    csLock lock(cs);
+
+    auto& family = getFamily(name, help, "histogram");
+    auto& histogram = family.histograms[labels];
+
+    if (!histogram)
+        histogram = std::make_unique<Histogram>();
+
+    return *histogram;
+}
+
+void Metrics::gauge(const std::string& name, const std::string& help, const GaugeCB& callback)
+{
+    csLock lock(cs);
+    getFamily(name, help, "gauge").gauge = callback;
+}
+
+void Metrics::writeGauge(std::string& out, const std::string& name, const std::string& help, const GaugeSamples& samples)
+{
+    writeHeader(out, name, help, "gauge");
+
+    for (const auto& sample : samples)
+        out += withLabels(name, sample.first) + " " + formatValue(sample.second) + "\n";
+}
+
+void Metrics::render(std::string& out)
+{
+    csLock lock(cs);
+
+    for (const auto& name : order)
+    {
+        auto& family = families[name];
+
+        if (family.gauge)
+        {
+            GaugeSamples samples;
+            family.gauge(samples);
+            writeGauge(out, name, family.help, samples);
+            continue;
+        }
+
+        writeHeader(out, name, family.help, family.type);
+
+        for (const auto& counter : family.counters)
+            out += withLabels(name, counter.first) + " " + std::to_string(counter.second->value()) + "\n";
+
+        for (const auto& histogram : family.histograms)
+        {
+            const auto snapshot = histogram.second->snapshot();
+            const auto& labels = histogram.first;
+
+            // Prometheus buckets are cumulative, we emit one per power of two
+            // (the end of each group of sub-buckets), with le in seconds
+            int64_t cumulative = 0;
+
+            for (auto i = 0; i < HISTOGRAM_BUCKETS; ++i)
+            {
+                cumulative += snapshot.counts[i];
+
+                if (i % HISTOGRAM_SUB_BUCKETS != HISTOGRAM_SUB_BUCKETS - 1)
+                    continue;
+
+                const auto le = static_cast<double>(Histogram::bucketUpperBound(i) + 1) / 1'000'000.0;
+                out += withLabels(name + "_bucket", labels, "le=\"" + formatValue(le) + "\"") + " " + std::to_string(cumulative) + "\n";
+            }
+
+            out += withLabels(name + "_bucket", labels, "le=\"+Inf\"") + " " + std::to_string(snapshot.count) + "\n";
+            out += withLabels(name + "_sum", labels) + " " + formatValue(static_cast<double>(snapshot.sum) / 1'000'000.0) + "\n";
+            out += withLabels(name + "_count", labels) + " " + std::to_string(snapshot.count) + "\n";
+        }
+    }
+}
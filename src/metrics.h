@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "threads/locks.h"
+
+/*
+    Node metrics, exposed in Prometheus text format on GET /metrics
+
+    Counters and histograms are sharded - each thread picks a shard the first
+    time it records, and shards are cache line aligned so recording is a
+    relaxed atomic add on a line no other thread is writing. Shards are only
+    summed when /metrics is scraped.
+
+    Histograms are HDR style (log-linear): every power of two range is split
+    into four linear sub-buckets, so relative error is under 25% from one
+    microsecond to over an hour with a fixed 128 bucket array.
+
+    Gauges are callbacks evaluated at scrape time, so queue depths and the like
+    cost nothing between scrapes.
+*/
+
+namespace openset::metrics
+{
+    const int METRIC_SHARDS = 16;
+    const int HISTOGRAM_SUB_BITS = 2;
+    const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+    const int HISTOGRAM_BUCKETS = 32 * HISTOGRAM_SUB_BUCKETS;
+
+    // the shard used by the calling thread
+    int shardIndex();
+
+    class Counter
+    {
+        struct alignas(64) Shard_s
+        {
+            std::atomic<int64_t> value{ 0 };
+        };
+
+        Shard_s shards[METRIC_SHARDS];
+
+    public:
+        void inc(const int64_t by = 1)
+        {
+            shards[shardIndex()].value.fetch_add(by, std::memory_order_relaxed);
+        }
+
+        int64_t value() const;
+    };
+
+    class Histogram
+    {
+        struct alignas(64) Shard_s
+        {
+            std::atomic<int64_t> counts[HISTOGRAM_BUCKETS];
+            std::atomic<int64_t> sum{ 0 };
+            std::atomic<int64_t> count{ 0 };
+
+            Shard_s()
+            {
+                for (auto& c : counts)
+                    c = 0;
+            }
+        };
+
+        Shard_s shards[METRIC_SHARDS];
+
+    public:
+        struct Snapshot_s
+        {
+            int64_t counts[HISTOGRAM_BUCKETS]{};
+            int64_t sum{ 0 };
+            int64_t count{ 0 };
+        };
+
+        static int bucketIndex(int64_t micros);
+        // highest value (in microseconds) that lands in bucket `index`
+        static int64_t bucketUpperBound(int index);
+
+        void record(const int64_t micros)
+        {
+            auto& shard = shards[shardIndex()];
+            shard.counts[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+            shard.sum.fetch_add(micros, std::memory_order_relaxed);
+            shard.count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Snapshot_s snapshot() const;
+    };
+
+    // records the lifetime of the timer into a histogram
+    class ScopedTimer
+    {
+        Histogram* histogram;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScopedTimer(Histogram* histogram) :
+            histogram(histogram),
+            start(std::chrono::steady_clock::now())
+        {}
+
+        ~ScopedTimer()
+        {
+            histogram->record(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+    };
+
+    // <labels, value> - labels are pre-formatted, i.e. `partition="3"`
+    using GaugeSamples = std::vector<std::pair<std::string, double>>;
+    using GaugeCB = std::function<void(GaugeSamples&)>;
+
+    class Metrics
+    {
+        struct Family_s
+        {
+            std::string help;
+            std::string type;
+            // keyed by label string
+            std::unordered_map<std::string, std::unique_ptr<Counter>> counters;
+            std::unordered_map<std::string, std::unique_ptr<Histogram>> histograms;
+            GaugeCB gauge;
+        };
+
+        CriticalSection cs;
+        // ordered by registration so scrapes are stable
+        std::vector<std::string> order;
+        std::unordered_map<std::string, Family_s> families;
+
+        Metrics() = default;
+
+        Family_s& getFamily(const std::string& name, const std::string& help, const std::string& type);
+
+    public:
+
+        // singleton
+        static Metrics& get()
+        {
+            static Metrics metrics;
+            return metrics;
+        }
+
+        // returned references live forever, callers should look them up once and keep them
+        Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+        Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+        void gauge(const std::string& name, const std::string& help, const GaugeCB& callback);
+
+        // appends every registered metric in Prometheus text format
+        void render(std::string& out);
+
+        static void writeGauge(std::string& out, const std::string& name, const std::string& help, const GaugeSamples& samples);
+    };
+}
@@ -1,5 +1,6 @@
 #include "oloop.h"
 #include "asyncpool.h"
+#include "trace.h"
 
 using namespace openset::async;
 
@@ -11,6 +12,7 @@ OpenLoop::OpenLoop(std::string owningTable, oloopPriority_e priority) :
     owningTable(std::move(owningTable)),
 	runAt(0),
 	runStart(0),
+	traceId(openset::trace::getContext()),
 	prepared(false),
 	loop(nullptr)
 {}
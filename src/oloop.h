@@ -29,6 +29,7 @@ namespace openset
             std::string owningTable;
 			int64_t runAt;
 			int64_t runStart; // time or call to run
+			int64_t traceId; // trace id of the request that created the cell
 			bool prepared;
 			AsyncLoop* loop;
 
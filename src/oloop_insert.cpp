@@ -1,4 +1,9 @@
 #include "oloop_insert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
 #include "cjson/cjson.h"
 #include "str/strtools.h"
 
@@ -9,8 +14,10 @@
 #include "asyncpool.h"
 #include "tablepartitioned.h"
 #include "sidelog.h"
+#include "staging.h"
 #include "internoderouter.h"
 #include "queryinterpreter.h"
+#include "metrics.h"
 
 using namespace std;
 using namespace openset::async;
@@ -42,31 +49,43 @@ void OpenLoopInsert::prepare()
     tablePartitioned->checkForSegmentChanges();
 }
 
-void OpenLoopInsert::OnInsert(const std::string& uuid, SegmentPartitioned_s* segment)
+void OpenLoopInsert::OnInsert(Customer& person, const std::bitset<MAX_PROPERTIES>& touched)
 {
-    Customer person;
+    const auto personData = person.getMeta();
 
-    // map a table, partition and entire schema to the Customer object
-    auto mappedColumns = segment->interpreter->getReferencedColumns();
-    if (!person.mapTable(tablePartitioned->table, loop->partition, mappedColumns))
-        return;
+    // run any segments flagged for "onInsert" in proper z-order
+    for (auto segment : tablePartitioned->getOnInsertSegments())
+    {
+        // we can't crunch segment math on insert, but we can expire it, so it crunches the next time it's used
+        if (segment->macros.isSegmentMath)
+        {
+            tablePartitioned->setSegmentRefresh(segment->segmentName, 0);
+            continue;
+        }
 
-    // mount the customer
-    const auto personData = tablePartitioned->people.createCustomer(uuid);
-    person.mount(personData);
-    person.prepare();
+        // the new events didn't change anything this script looks at
+        if (!segment->isTouched(touched))
+            continue;
 
-    segment->interpreter->mount(&person);
-    segment->interpreter->exec();
+        // ensure we have bits mounted for this segment
+        segment->prepare(tablePartitioned->attributes);
+        // get a cached interpreter (or make one) and set the bits
+        const auto interpreter = segment->getInsertInterpreter(tablePartitioned->people.customerCount());
 
-    // get return values from script
-    auto returns = segment->interpreter->getLastReturn();
+        // the insert grid is already prepared with every property, so every script runs on
+        // it as is rather than mounting and decompressing the customer again
+        interpreter->mount(&person);
+        interpreter->exec();
 
-    // set bit according to interpreter results
-    const auto stateChange = segment->setBit(personData->linId, returns.size() && returns[0].getBool() == true);
-    if (stateChange != SegmentPartitioned_s::SegmentChange_e::noChange)
-    {
-        tablePartitioned->pushMessage(segment->segmentHash, stateChange, personData->getIdStr());
+        // get return values from script
+        const auto returns = interpreter->getLastReturn();
+
+        // set bit according to interpreter results
+        const auto stateChange = segment->setBit(personData->linId, returns.size() && returns[0].getBool() == true);
+        if (stateChange != SegmentPartitioned_s::SegmentChange_e::noChange)
+        {
+            tablePartitioned->pushMessage(segment->segmentHash, stateChange, personData->getIdStr());
+        }
     }
 }
 
@@ -107,6 +126,14 @@ bool OpenLoopInsert::run()
 
     sleepCounter = 0;
 
+    static auto& applyTime = openset::metrics::Metrics::get().histogram(
+        "openset_insert_apply_seconds", "time to apply one batch of SideLog inserts to a partition");
+    static auto& insertedEvents = openset::metrics::Metrics::get().counter(
+        "openset_insert_events_total", "events applied from the SideLog");
+
+    openset::metrics::ScopedTimer applyTimer(&applyTime);
+    insertedEvents.inc(static_cast<int64_t>(inserts.size()));
+
     // reusable object representing a customer
     Customer person;
 
@@ -120,70 +147,84 @@ bool OpenLoopInsert::run()
         return false;
     }
 
-    // we are going to convert the events into JSON, and in the process
-    // we are going to group the events by their user_ids.
-    // We will then insert all the events for a given customer in one
-    // pass. This can greatly reduce redundant calls to Mount and Commit
-    // which can be expensive as they both call LZ4 (which is fast, but still
-    // has it's overhead)
-    std::unordered_map < std::string, std::vector<cjson>> evtByPerson;
-    auto insertIter = inserts.begin();
-
-    for (; insertIter != inserts.end(); ++insertIter)
-    {
-        cjson row(*insertIter, cjson::Mode_e::string);
+    // rows were staged by RpcInsert, we group them by customer so all the
+    // events for a given customer are inserted in one pass. This can greatly
+    // reduce redundant calls to Mount and Commit which can be expensive as
+    // they both call LZ4 (which is fast, but still has it's overhead)
+    const auto numericIds = tablePartitioned->table->numericCustomerIds;
 
-        // we will take profile or table to specify the table name
-        auto uuidString = tablePartitioned->table->numericCustomerIds ?
-            to_string(row.xPathInt("/id", 0)) :
-            row.xPathString("/id", "");
+    std::vector<const StagedRow_s*> rows;
+    rows.reserve(inserts.size());
 
-        toLower(uuidString);
+    for (const auto data : inserts)
+    {
+        const auto row = recast<const StagedRow_s*>(data);
 
         // do we have what we need to insert?
-        if (uuidString.length())
-            evtByPerson[uuidString].emplace_back(std::move(row));
+        if (numericIds || row->idLength)
+            rows.push_back(row);
     }
 
-    // after we have processed the data, move the head forward
-    SideLog::getSideLog().updateReadHead(table.get(), loop->partition, readHandle);
+    // text ids are compared as well, two ids could share a hash. Stable, so a
+    // customer's events keep their arrival order
+    const auto sameCustomer = [](const StagedRow_s* a, const StagedRow_s* b)
+    {
+        return a->customerId == b->customerId &&
+            a->idLength == b->idLength &&
+            memcmp(a->idText(), b->idText(), a->idLength) == 0;
+    };
+
+    std::stable_sort(rows.begin(), rows.end(), [](const StagedRow_s* a, const StagedRow_s* b)
+    {
+        if (a->customerId != b->customerId)
+            return a->customerId < b->customerId;
+        return std::string_view(a->idText(), a->idLength) < std::string_view(b->idText(), b->idLength);
+    });
+
+    const auto hasInsertSegments = !tablePartitioned->getOnInsertSegments().empty();
 
     // now insert without locks
-    for (auto& uuid : evtByPerson)
+    for (auto first = rows.begin(); first != rows.end();)
     {
-        const auto personData = tablePartitioned->table->numericCustomerIds ?
-            tablePartitioned->people.createCustomer(stoll(uuid.first)) :
-            tablePartitioned->people.createCustomer(uuid.first);
+        auto last = first;
+        while (last != rows.end() && sameCustomer(*first, *last))
+            ++last;
+
+        const auto personData = numericIds ?
+            tablePartitioned->people.createCustomer((*first)->customerId) :
+            tablePartitioned->people.createCustomer((*first)->getId());
         person.mount(personData);
         person.prepare();
 
-        // insert events for this uuid
-        for (auto &json : uuid.second)
-            person.insert(&json);
+        // properties set by the new events, every event row sets stamp and event
+        std::bitset<MAX_PROPERTIES> touched;
+        touched.set(PROP_STAMP);
+        touched.set(PROP_EVENT);
 
-        person.commit();
-
-        // run any segments flagged for "onInsert" in proper z-order
-        const auto insertSegments = tablePartitioned->getOnInsertSegments();
-        for (auto segment : insertSegments)
+        // insert events for this customer
+        for (auto iter = first; iter != last; ++iter)
         {
-            // ensure we have bits mounted for this segment
-            segment->prepare(tablePartitioned->attributes);
-            // get a cached interpreter (or make one) and set the bits
-            const auto interpreter = segment->getInterpreter(tablePartitioned->people.customerCount());
+            person.insert(*iter);
 
-            // we can't crunch segment math on refresh, but we can expire it, so it crunches the next time it's used
-            if (interpreter->macros.isSegmentMath)
+            if (hasInsertSegments)
             {
-                tablePartitioned->setSegmentRefresh(segment->segmentName, 0);
-                continue;
+                const auto values = (*iter)->values();
+                for (auto i = 0; i < (*iter)->valueCount; ++i)
+                    touched.set(values[i].property);
             }
-
-            OnInsert(uuid.first, segment);
         }
 
+        person.commit();
+
+        if (hasInsertSegments)
+            OnInsert(person, touched);
+
+        first = last;
     }
 
+    // the staged rows belong to the SideLog, it can trim them once the head moves past them
+    SideLog::getSideLog().updateReadHead(table.get(), loop->partition, readHandle);
+
     tablePartitioned->attributes.clearDirty();
 
     return true;
@@ -3,6 +3,7 @@
 #include "common.h"
 #include "oloop.h"
 #include "database.h"
+#include <bitset>
 #include <unordered_set>
 
 namespace openset
@@ -10,6 +11,7 @@ namespace openset
     namespace db
     {
         struct SegmentPartitioned_s;
+        class Customer;
         class Database;
         class TablePartitioned;
     };
@@ -47,7 +49,9 @@ namespace openset
             ~OpenLoopInsert() final;
 
             void prepare() final;
-            void OnInsert(const std::string& uuid, db::SegmentPartitioned_s* segment);
+            // evaluates the onInsert segments against the customer that was just committed,
+            // skipping scripts that reference none of the `touched` properties
+            void OnInsert(db::Customer& person, const std::bitset<MAX_PROPERTIES>& touched);
             bool run() final;
             void partitionRemoved() final {};
         };
@@ -0,0 +1,137 @@
+#include "oloop_load.h"
+
+#include <algorithm>
+
+#include "customers.h"
+#include "customer.h"
+#include "table.h"
+#include "tablepartitioned.h"
+#include "internoderouter.h"
+#include "asyncloop.h"
+
+using namespace std;
+using namespace openset::async;
+using namespace openset::db;
+
+void BulkBatch_s::add()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    ++outstanding;
+}
+
+void BulkBatch_s::done()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        --outstanding;
+    }
+    applied.notify_all();
+}
+
+void BulkBatch_s::wait()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    applied.wait(guard, [this]() { return outstanding == 0; });
+}
+
+void BulkLoad_s::sort()
+{
+    std::sort(keys.begin(), keys.end(), [](const Key_s& a, const Key_s& b)
+    {
+        if (a.customer != b.customer)
+            return a.customer < b.customer;
+        if (a.stamp != b.stamp)
+            return a.stamp < b.stamp;
+        return a.row < b.row; // keep file order for events sharing a stamp
+    });
+}
+
+OpenLoopLoad::OpenLoopLoad(openset::db::Database::TablePtr table, std::shared_ptr<BulkLoad_s> load) :
+    OpenLoop(table->getName()),
+    table(std::move(table)),
+    tablePartitioned(nullptr),
+    load(std::move(load)),
+    position(0),
+    customers(0)
+{}
+
+OpenLoopLoad::~OpenLoopLoad()
+{
+    // finished, purged or removed, the reader can move on either way
+    if (load->batch)
+        load->batch->done();
+}
+
+void OpenLoopLoad::prepare()
+{
+    tablePartitioned = table->getPartitionObjects(loop->partition, false);
+
+    if (!tablePartitioned)
+        suicide();
+}
+
+bool OpenLoopLoad::run()
+{
+    const auto mapInfo = globals::mapper->partitionMap.getState(tablePartitioned->partition, globals::running->nodeId);
+
+    // same rule as OpenLoopInsert, wait until this partition is an owner or clone
+    if (mapInfo != openset::mapping::NodeState_e::active_owner &&
+        mapInfo != openset::mapping::NodeState_e::active_clone)
+    {
+        scheduleFuture(1000);
+        return false;
+    }
+
+    // reusable object representing a customer
+    Customer person;
+
+    // map a table, partition and entire schema to the Customer object
+    if (!person.mapTable(tablePartitioned->table, loop->partition))
+    {
+        // deleted partition - remove worker loop
+        suicide();
+        return false;
+    }
+
+    const auto& keys = load->keys;
+
+    while (position < keys.size())
+    {
+        const auto& customer = keys[position].customer;
+
+        const auto personData = tablePartitioned->table->numericCustomerIds ?
+            tablePartitioned->people.createCustomer(stoll(customer)) :
+            tablePartitioned->people.createCustomer(customer);
+        person.mount(personData);
+        person.prepare();
+
+        // keys are sorted, so this customer's events are together and in stamp order
+        for (; position < keys.size() && keys[position].customer == customer; ++position)
+            person.insert(load->rows[keys[position].row].get());
+
+        // one compression per customer
+        person.commit();
+        ++customers;
+
+        if (sliceComplete())
+        {
+            // queries running between slices see current index bitmaps
+            tablePartitioned->attributes.clearDirty();
+            return true;
+        }
+    }
+
+    tablePartitioned->attributes.clearDirty();
+
+    // on_insert segments are not evaluated per customer here, expire them so they
+    // are recalculated the next time they are used
+    for (const auto segment : tablePartitioned->getOnInsertSegments())
+        tablePartitioned->setSegmentRefresh(segment->segmentName, 0);
+
+    Logger::get().info(
+        "bulk load on " + table->getName() + " partition " + to_string(loop->partition) + ": " +
+        to_string(keys.size()) + " events, " + to_string(customers) + " customers.");
+
+    suicide();
+    return false;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+#include "common.h"
+#include "oloop.h"
+#include "database.h"
+#include "cjson/cjson.h"
+
+namespace openset
+{
+    namespace db
+    {
+        class TablePartitioned;
+    };
+};
+
+namespace openset
+{
+    namespace async
+    {
+        // rows read from the file before they are applied, a file is loaded in
+        // batches of this many rows (across this node's partitions) to bound memory
+        const int64_t BULK_LOAD_BATCH_ROWS = 250'000;
+
+        // the reader waits for a batch to be applied before reading the next one
+        struct BulkBatch_s
+        {
+            std::mutex lock;
+            std::condition_variable applied;
+            int outstanding { 0 }; // cells that haven't finished
+
+            void add();
+            void done();
+            void wait();
+        };
+
+        // rows bound for one partition, keys are sorted by (customer, stamp)
+        struct BulkLoad_s
+        {
+            struct Key_s
+            {
+                std::string customer;
+                int64_t stamp;
+                int32_t row;
+            };
+
+            // a cjson can't be moved once it has members (they point back at it)
+            std::vector<std::unique_ptr<cjson>> rows;
+            std::vector<Key_s> keys;
+            std::shared_ptr<BulkBatch_s> batch;
+
+            void sort();
+        };
+
+        /*
+            LoadCell - applies one batch of a bulk load to one partition.
+
+                Every customer in the batch is mounted, given all of their
+                events in stamp order (so the grid only appends), and
+                committed once. Index bitmaps are cleaned up after every
+                slice, as OpenLoopInsert does. The cell checks in with the
+                batch when it is destroyed, however it ends.
+        */
+
+        class OpenLoopLoad : public OpenLoop
+        {
+        private:
+
+            openset::db::Database::TablePtr table;
+            openset::db::TablePartitioned* tablePartitioned;
+            std::shared_ptr<BulkLoad_s> load;
+            size_t position;
+            int64_t customers;
+
+        public:
+
+            OpenLoopLoad(openset::db::Database::TablePtr table, std::shared_ptr<BulkLoad_s> load);
+            ~OpenLoopLoad() final;
+
+            void prepare() final;
+            bool run() final;
+            void partitionRemoved() final {};
+        };
+    };
+};
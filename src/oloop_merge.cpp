@@ -0,0 +1,152 @@
+#include "oloop_merge.h"
+
+#include <unordered_set>
+
+#include "asyncpool.h"
+#include "trace.h"
+
+using namespace openset::async;
+using namespace openset::result;
+
+void MergeJob_s::mergeShard(const int shard)
+{
+    const auto low = shard ? &splitters[shard - 1] : nullptr;
+    const auto high = shard < static_cast<int>(splitters.size()) ? &splitters[shard] : nullptr;
+
+    shards[shard] = ResultMuxDemux::mergeResultRange(resultColumnCount, resultSetCount, *resultSets, low, high);
+    merged[shard] = 1;
+}
+
+// merge cells don't touch table data, so they don't belong to a table
+OpenLoopMerge::OpenLoopMerge(std::shared_ptr<MergeJob_s> job, const int shard) :
+    OpenLoop("", oloopPriority_e::realtime),
+    job(std::move(job)),
+    shard(shard)
+{}
+
+OpenLoopMerge::~OpenLoopMerge()
+{
+    // purged or removed cells never run, the caller merges their range
+    checkIn();
+}
+
+void OpenLoopMerge::checkIn()
+{
+    if (checkedIn)
+        return;
+
+    checkedIn = true;
+
+    {
+        std::lock_guard<std::mutex> lock(job->lock);
+        --job->outstanding;
+    }
+
+    job->conditional.notify_all();
+}
+
+void OpenLoopMerge::prepare()
+{}
+
+bool OpenLoopMerge::run()
+{
+    {
+        openset::trace::Context context(job->traceId);
+        openset::trace::Span span("query.merge_shard", shard);
+        job->mergeShard(shard);
+    }
+
+    checkIn();
+
+    suicide();
+    return false;
+}
+
+void OpenLoopMerge::partitionRemoved()
+{
+    // the destructor checks in
+}
+
+ResultSet::RowVector OpenLoopMerge::merge(
+    const int resultColumnCount,
+    const int resultSetCount,
+    std::vector<ResultSet*>& resultSets)
+{
+    const auto rowCount = ResultMuxDemux::prepareMerge(resultSets);
+    const auto pool = openset::globals::async;
+
+    // one partition per worker, cells queued on the same worker would run one after another
+    std::vector<int> partitionList;
+
+    if (pool && rowCount >= MERGE_SHARD_MIN_ROWS * 2)
+    {
+        const auto maxCells = rowCount / MERGE_SHARD_MIN_ROWS - 1; // the caller merges a range too
+        std::unordered_set<int> workers;
+
+        csLock lock(pool->poolLock);
+
+        for (auto i = 0; i < pool->getPartitionMax() && static_cast<int64_t>(partitionList.size()) < maxCells; ++i)
+        {
+            const auto p = pool->partitions[i];
+            if (p && p->isInitialized() && workers.insert(p->worker).second)
+                partitionList.push_back(i);
+        }
+    }
+
+    const auto splitters = partitionList.empty() ?
+        std::vector<RowKey>() :
+        ResultMuxDemux::mergeSplitters(resultSets, static_cast<int>(partitionList.size()) + 1);
+
+    if (splitters.empty())
+        return ResultMuxDemux::mergeResultRange(resultColumnCount, resultSetCount, resultSets, nullptr, nullptr);
+
+
+    const auto shardCount = static_cast<int>(splitters.size()) + 1;
+
+    const auto job = std::make_shared<MergeJob_s>();
+    job->resultColumnCount = resultColumnCount;
+    job->resultSetCount = resultSetCount;
+    job->resultSets = &resultSets;
+    job->splitters = splitters;
+    job->traceId = openset::trace::getContext();
+    job->shards.resize(shardCount);
+    job->merged.assign(shardCount, 0);
+
+    // the first range is ours, cells take the rest
+    partitionList.resize(shardCount - 1);
+    auto nextShard = 1;
+
+    pool->cellFactory(partitionList, [&](AsyncLoop*) -> OpenLoop*
+    {
+        {
+            std::lock_guard<std::mutex> lock(job->lock);
+            ++job->outstanding;
+        }
+        return new OpenLoopMerge(job, nextShard++);
+    });
+
+    job->mergeShard(0);
+
+    {
+        std::unique_lock<std::mutex> lock(job->lock);
+        job->conditional.wait(lock, [&]() { return job->outstanding == 0; });
+    }
+
+    // ranges whose cells were removed (or were never queued)
+    for (auto i = 0; i < shardCount; ++i)
+        if (!job->merged[i])
+            job->mergeShard(i);
+
+    ResultSet::RowVector rows;
+
+    size_t total = 0;
+    for (const auto& shardRows : job->shards)
+        total += shardRows.size();
+
+    rows.reserve(total);
+
+    for (auto& shardRows : job->shards)
+        rows.insert(rows.end(), shardRows.begin(), shardRows.end());
+
+    return rows;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common.h"
+#include "oloop.h"
+#include "result.h"
+
+namespace openset
+{
+    namespace async
+    {
+        // results with fewer rows than this per shard are merged on the calling thread
+        const int64_t MERGE_SHARD_MIN_ROWS = 25'000;
+
+        // a merge split into key ranges, shared by the cells merging it
+        struct MergeJob_s
+        {
+            int resultColumnCount { 0 };
+            int resultSetCount { 0 };
+            std::vector<openset::result::ResultSet*>* resultSets { nullptr };
+            std::vector<openset::result::RowKey> splitters;
+            int64_t traceId { 0 };
+
+            // one per range, each written by only one thread
+            std::vector<openset::result::ResultSet::RowVector> shards;
+            std::vector<int> merged;
+
+            std::mutex lock;
+            std::condition_variable conditional;
+            int outstanding { 0 }; // cells not yet checked in
+
+            void mergeShard(int shard);
+        };
+
+        /*
+            OpenLoopMerge - merges one key range of a coordinator result.
+
+            The sorted result sets are split at keys taken from the largest set, each
+            range is merged on its own async worker (the calling thread takes the first
+            one) and the ranges are concatenated, they are already in key order. Rows
+            with the same key are always in the same range, so no accumulator is touched
+            by two cells.
+
+            A cell that is removed before it runs still checks in, its range is merged
+            by the calling thread.
+        */
+        class OpenLoopMerge : public OpenLoop
+        {
+            std::shared_ptr<MergeJob_s> job;
+            int shard;
+            bool checkedIn { false };
+
+            void checkIn();
+
+        public:
+
+            explicit OpenLoopMerge(std::shared_ptr<MergeJob_s> job, int shard);
+
+            ~OpenLoopMerge() final;
+
+            void prepare() final;
+            bool run() final;
+            void partitionRemoved() final;
+
+            // replaces mergeResultSets. Waits for the cells, so it must not be called
+            // from an async worker
+            static openset::result::ResultSet::RowVector merge(
+                int resultColumnCount,
+                int resultSetCount,
+                std::vector<openset::result::ResultSet*>& resultSets);
+        };
+    }
+}
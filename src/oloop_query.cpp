@@ -4,6 +4,8 @@
 #include "tablepartitioned.h"
 #include "internoderouter.h"
 
+#include <cmath>
+
 using namespace openset::async;
 using namespace openset::query;
 using namespace openset::result;
@@ -56,12 +58,19 @@ void OpenLoopQuery::prepare()
 
     maxLinearId = parts->people.customerCount();
 
+    if (macros.analyze)
+        analyze.started = std::chrono::steady_clock::now();
+
     // generate the index for this query
     indexing.mount(table.get(), macros, loop->partition, maxLinearId);
     bool countable;
     index      = indexing.getIndex("_", countable);
     population = index->population(maxLinearId);
 
+    if (macros.analyze)
+        analyze.indexMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - analyze.started).count();
+
     interpreter = new Interpreter(macros);
     interpreter->setResultObject(result);
 
@@ -116,12 +125,20 @@ void OpenLoopQuery::prepare()
     }
 
     person.setSessionTime(macros.sessionTime);
+    person.setStampWindow(macros.stampFrom, macros.stampTo);
+
+    windowed = macros.stampFrom != LLONG_MIN || macros.stampTo != LLONG_MAX;
+
+    if (macros.sample < 1.0)
+        sampleThreshold = static_cast<int64_t>(std::llround(macros.sample * SAMPLE_BUCKETS));
 
     startTime = Now();
 }
 
 bool OpenLoopQuery::run()
 {
+    ++analyze.slices;
+
     while (true)
     {
         if (sliceComplete())
@@ -137,7 +154,7 @@ bool OpenLoopQuery::run()
                 0,
                 CellQueryResult_s {
                     instance,
-                    {},
+                    macros.analyze ? getAnalyzeStats() : std::unordered_map<string, int64_t>{},
                     interpreter->error,
                 });
 
@@ -149,7 +166,39 @@ bool OpenLoopQuery::run()
 
         if (const auto personData = parts->people.getCustomerByLIN(currentLinId); personData != nullptr)
         {
+            // outside the sample, skip it before paying for the mount and decode
+            if (sampleThreshold != SAMPLE_BUCKETS && !inSample(personData->id, sampleThreshold))
+                continue;
+
+            // no events in the time window, skip it before decompressing anything
+            if (windowed && !personData->overlaps(macros.stampFrom, macros.stampTo))
+            {
+                ++analyze.outsideWindow;
+                continue;
+            }
+
             ++runCount;
+
+            if (macros.analyze)
+            {
+                using namespace std::chrono;
+
+                const auto mountStart = steady_clock::now();
+                person.mount(personData);
+                const auto decodeStart = steady_clock::now();
+                person.prepare();
+                const auto execStart = steady_clock::now();
+                interpreter->mount(&person);
+                interpreter->exec();
+                const auto execEnd = steady_clock::now();
+
+                analyze.mountMicros += duration_cast<microseconds>(decodeStart - mountStart).count();
+                analyze.decodeMicros += duration_cast<microseconds>(execStart - decodeStart).count();
+                analyze.execMicros += duration_cast<microseconds>(execEnd - execStart).count();
+                analyze.rowsDecoded += person.getGrid()->getRows()->size();
+                continue;
+            }
+
             person.mount(personData);
             person.prepare();
             interpreter->mount(&person);
@@ -158,6 +207,28 @@ bool OpenLoopQuery::run()
     }
 }
 
+std::unordered_map<string, int64_t> OpenLoopQuery::getAnalyzeStats() const
+{
+    return {
+        { "partition", loop->partition },
+        { "customers_total", maxLinearId },
+        { "customers_selected", population },
+        { "customers_scanned", runCount },
+        { "customers_outside_window", analyze.outsideWindow },
+        { "rows_decoded", analyze.rowsDecoded },
+        { "slices", analyze.slices },
+        { "index_us", analyze.indexMicros },
+        { "mount_us", analyze.mountMicros },
+        { "decode_us", analyze.decodeMicros },
+        { "exec_us", analyze.execMicros },
+        {
+            "elapsed_us",
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - analyze.started).count()
+        },
+    };
+}
+
 void OpenLoopQuery::partitionRemoved()
 {
     shuttle->reply(
@@ -1,4 +1,5 @@
 #pragma once
+#include <chrono>
 #include "common.h"
 #include "database.h"
 #include "oloop.h"
@@ -37,6 +38,34 @@ namespace openset
 			openset::db::IndexBits* index;
 			openset::result::ResultSet* result;
 
+			// EXPLAIN ANALYZE counters, only collected when macros.analyze is set
+			struct Analyze_s
+			{
+				std::chrono::steady_clock::time_point started;
+				int64_t indexMicros { 0 };
+				int64_t mountMicros { 0 };
+				int64_t decodeMicros { 0 };
+				int64_t execMicros { 0 };
+				int64_t rowsDecoded { 0 };
+				int64_t outsideWindow { 0 };
+				int64_t slices { 0 };
+			} analyze;
+
+			std::unordered_map<string, int64_t> getAnalyzeStats() const;
+
+			// sampled queries (macros.sample < 1) scan the customers whose id hashes below
+			// the threshold, so a customer is in every sample of a given rate or in none
+			static const int64_t SAMPLE_BUCKETS = 1'000'000;
+			int64_t sampleThreshold { SAMPLE_BUCKETS };
+
+			// macros.stampFrom/stampTo are set, customers without events in the window are skipped
+			bool windowed { false };
+
+			static bool inSample(const int64_t customerId, const int64_t threshold)
+			{
+				return static_cast<int64_t>(static_cast<uint64_t>(HashPair(customerId, 0x53414d50)) % SAMPLE_BUCKETS) < threshold;
+			}
+
 			explicit OpenLoopQuery(
 				ShuttleLambda<openset::result::CellQueryResult_s>* shuttle,
 				openset::db::Database::TablePtr table,
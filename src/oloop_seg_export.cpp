@@ -0,0 +1,130 @@
+#include "oloop_seg_export.h"
+#include "http_serve.h"
+#include "table.h"
+#include "tablepartitioned.h"
+#include "errors.h"
+
+using namespace openset::async;
+
+OpenLoopSegmentExport::OpenLoopSegmentExport(
+    Shuttle<int>* shuttle,
+    const openset::db::Database::TablePtr table,
+    const std::string& segmentName,
+    const ExportFormat_e format) :
+    OpenLoop(table->getName(), oloopPriority_e::realtime),
+    shuttle(shuttle),
+    table(table),
+    segmentName(segmentName),
+    format(format)
+{}
+
+OpenLoopSegmentExport::~OpenLoopSegmentExport()
+{
+    // bits loaded from the index are ours, live segment bits belong to the partition
+    if (bits && deleteBits)
+        delete bits;
+
+    if (parts && prepared)
+        --parts->segmentUsageCount;
+}
+
+void OpenLoopSegmentExport::appendId(const openset::db::PersonData_s* personData)
+{
+    if (table->numericCustomerIds)
+    {
+        if (format == ExportFormat_e::binary)
+            output.append(recast<const char*>(&personData->id), sizeof(int64_t));
+        else
+        {
+            output += to_string(personData->id);
+            output += '\n';
+        }
+        return;
+    }
+
+    const auto id = personData->events;
+    const auto length = static_cast<int32_t>(personData->idBytes);
+
+    if (format == ExportFormat_e::binary)
+    {
+        output.append(recast<const char*>(&length), sizeof(int32_t));
+        output.append(id, length);
+        return;
+    }
+
+    output += '"';
+    for (auto i = 0; i < length; ++i)
+    {
+        const auto c = id[i];
+        if (c == '"' || c == '\\')
+        {
+            output += '\\';
+            output += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            output += escaped;
+        }
+        else
+            output += c;
+    }
+    output += "\"\n";
+}
+
+void OpenLoopSegmentExport::prepare()
+{
+    parts = table->getPartitionObjects(loop->partition, false);
+
+    if (!parts)
+    {
+        partitionRemoved();
+        suicide();
+        return;
+    }
+
+    // keeps segment changes from replacing the bits between slices
+    ++parts->segmentUsageCount;
+
+    maxLinearId = parts->people.customerCount();
+
+    // a segment this partition hasn't seen has no members here
+    bits = parts->getSegmentCallback()(segmentName, deleteBits);
+}
+
+bool OpenLoopSegmentExport::run()
+{
+    if (bits)
+    {
+        openset::db::PersonData_s* personData;
+        auto count = 0;
+
+        while (bits->linearIter(currentLinId, maxLinearId))
+        {
+            if ((personData = parts->people.getCustomerByLIN(currentLinId)) != nullptr)
+                appendId(personData);
+
+            // let other cells run, we pick up from currentLinId
+            if ((++count & 1023) == 0 && sliceComplete())
+                return true;
+        }
+    }
+
+    shuttle->reply(http::StatusCode::success_ok, output.data(), static_cast<int64_t>(output.length()));
+
+    suicide();
+    return false;
+}
+
+void OpenLoopSegmentExport::partitionRemoved()
+{
+    shuttle->reply(
+        http::StatusCode::client_error_bad_request,
+        openset::errors::Error{
+            openset::errors::errorClass_e::run_time,
+            openset::errors::errorCode_e::partition_migrated,
+            "please retry query"
+        }.getErrorJSON()
+    );
+}
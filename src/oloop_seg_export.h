@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.h"
+#include "oloop.h"
+#include "shuttle.h"
+#include "database.h"
+#include "indexbits.h"
+
+namespace openset
+{
+    namespace db
+    {
+        class Table;
+        class TablePartitioned;
+    };
+
+    namespace async
+    {
+        enum class ExportFormat_e : int
+        {
+            ndjson, // one id per line, as a JSON string (or number for numeric ids)
+            binary  // int64 per numeric id, or int32 length and bytes per text id
+        };
+
+        /*
+            OpenLoopSegmentExport - lists the customer ids in a segment for one partition.
+
+            Walks the segment bits and reads ids from the customer list, event data
+            is never decoded. Replies with the partition's ids in one buffer.
+        */
+        class OpenLoopSegmentExport : public OpenLoop
+        {
+            Shuttle<int>* shuttle;
+            openset::db::Database::TablePtr table;
+            std::string segmentName;
+            ExportFormat_e format;
+
+            openset::db::TablePartitioned* parts { nullptr };
+            openset::db::IndexBits* bits { nullptr };
+            bool deleteBits { false };
+            int64_t maxLinearId { 0 };
+            int64_t currentLinId { -1 };
+            std::string output;
+
+            void appendId(const openset::db::PersonData_s* personData);
+
+        public:
+
+            explicit OpenLoopSegmentExport(
+                Shuttle<int>* shuttle,
+                const openset::db::Database::TablePtr table,
+                const std::string& segmentName,
+                ExportFormat_e format);
+
+            ~OpenLoopSegmentExport() final;
+
+            void prepare() final;
+            bool run() final;
+            void partitionRemoved() final;
+        };
+    }
+}
@@ -49,27 +49,67 @@ void OpenLoopSegmentRefresh::storeSegment() const
         Logger::get().info("segment refresh on " + table->getName() + "/" + segmentName + ". (delta " + to_string(delta) + ")");
 }
 
-void OpenLoopSegmentRefresh::emitSegmentDifferences(openset::db::IndexBits* before, openset::db::IndexBits* after) const
+int64_t OpenLoopSegmentRefresh::emitSegmentDifferences(openset::db::IndexBits* before, openset::db::IndexBits* after) const
 {
     openset::db::PersonData_s* personData;
+    int64_t changes = 0;
 
     /*
-     * This will have to be made faster, but essentially it allows to look for changes in/out changes on the segment
-     * for segments calculated using segment math
+     * looks for customers entering or leaving segments that were calculated with indexes or segment
+     * math. Words that are the same before and after are skipped without looking at their bits
      */
-    for (int64_t i = 0; i < maxLinearId; ++i)
+    const auto words = (maxLinearId + 63) / 64;
+
+    for (int64_t word = 0; word < words; ++word)
     {
-        const auto beforeBit = before->bitState(i);
-        const auto afterBit = after->bitState(i);
+        const auto beforeWord = word < before->ints ? before->bits[word] : 0;
+        const auto afterWord = word < after->ints ? after->bits[word] : 0;
 
-        if ((personData = parts->people.getCustomerByLIN(i)) == nullptr)
+        if (beforeWord == afterWord)
             continue;
 
-        if (afterBit && !beforeBit)
-            parts->pushMessage(segmentHash, SegmentPartitioned_s::SegmentChange_e::enter, personData->getIdStr());
-        else if (!afterBit && beforeBit)
-            parts->pushMessage(segmentHash, SegmentPartitioned_s::SegmentChange_e::exit, personData->getIdStr());
+        const auto end = std::min(word * 64 + 64, maxLinearId);
+
+        for (auto i = word * 64; i < end; ++i)
+        {
+            const auto beforeBit = before->bitState(i);
+            const auto afterBit = after->bitState(i);
+
+            if (beforeBit == afterBit)
+                continue;
+
+            ++changes;
+
+            if ((personData = parts->people.getCustomerByLIN(i)) == nullptr)
+                continue;
+
+            if (afterBit)
+                parts->pushMessage(segmentHash, SegmentPartitioned_s::SegmentChange_e::enter, personData->getIdStr());
+            else
+                parts->pushMessage(segmentHash, SegmentPartitioned_s::SegmentChange_e::exit, personData->getIdStr());
+        }
     }
+
+    return changes;
+}
+
+bool OpenLoopSegmentRefresh::isRefreshDue() const
+{
+    if (parts->isRefreshDue(segmentName))
+        return true;
+
+    if (!macros.isSegmentMath)
+        return false;
+
+    // a segment this one reads was refreshed earlier in this cell
+    std::vector<std::string> reads;
+    SegmentMath::dependencies(macros.segmentMath, reads);
+
+    for (const auto& read : reads)
+        if (refreshed.count(read))
+            return true;
+
+    return false;
 }
 
 
@@ -80,25 +120,52 @@ bool OpenLoopSegmentRefresh::nextExpired()
     while (true)
     {
 
-        if (segmentsIter == parts->segments.end())
+        if (refreshIndex >= refreshOrder.size())
         {
             respawn();
             return false;
         }
 
-        segmentName = segmentsIter->first;
+        segmentName = refreshOrder[refreshIndex++];
         segmentHash = MakeHash(segmentName);
 
-        if (!parts->isRefreshDue(segmentName))
-        {
-            ++segmentsIter;
+        const auto segmentIter = parts->segments.find(segmentName);
+        if (segmentIter == parts->segments.end())
+            continue;
+
+        macros = segmentIter->second.macros;
+        segmentInfo = &segmentIter->second;
+
+        if (!isRefreshDue())
             continue;
-        }
 
-        macros = segmentsIter->second.macros;
-        segmentInfo = &parts->segments[segmentName];
+        refreshed.insert(segmentName);
 
-        //cout << "segment refresh: " << segmentName << endl;
+        // is this calculated using other segments (i.e. the functions
+        // population, intersection, union, difference and compliment)
+        // meaning we do not have to iterate user records or run the script
+        if (macros.isSegmentMath)
+        {
+            bits = parts->getBits(segmentName);
+            startPopulation = bits->population(maxLinearId);
+
+            IndexBits beforeBits;
+            beforeBits.opCopy(*bits);
+
+            if (segmentMath->evaluate(macros.segmentMath, bits))
+            {
+                if (emitSegmentDifferences(&beforeBits, bits))
+                {
+                    ++segmentInfo->changeCount;
+                    segmentMath->invalidate(segmentName);
+                }
+            }
+            else
+                Logger::get().error("attempted refresh on " + table->getName() + "/" + segmentName + ". segment math - set could not be found");
+
+            storeSegment();
+            continue;
+        }
 
         // generate the index for this query
         indexing.mount(table.get(), macros, loop->partition, maxLinearId);
@@ -113,17 +180,20 @@ bool OpenLoopSegmentRefresh::nextExpired()
 
         // is this something we can calculate using purely
         // indexes? (query logic shows we can simply use binary operators to calculate the segment)
-        if (countable && !macros.isSegmentMath)
+        if (countable)
         {
             // look for changes
-            emitSegmentDifferences(bits, index);
+            if (emitSegmentDifferences(bits, index))
+            {
+                ++segmentInfo->changeCount;
+                segmentMath->invalidate(segmentName);
+            }
             // index contains result
             bits->opCopy(*index);
 
             // index is the result when binary index math can be used.
             // copy the index
             storeSegment();
-            ++segmentsIter;
             continue;
         }
 
@@ -142,35 +212,14 @@ bool OpenLoopSegmentRefresh::nextExpired()
             return false;
         }
 
-        // is this calculated using other segments (i.e. the functions
-        // population, intersection, union, difference and compliment)
-        // meaning we do not have to iterate user records
-        if (macros.isSegmentMath)
-        {
-            IndexBits beforeBits;
-            beforeBits.opCopy(*bits);
-
-            interpreter->interpretMode = InterpretMode_e::count;
-
-            // mount empty customer record (required but not used in segment math queries).
-            interpreter->mount(&person);
-            interpreter->exec();
-
-            emitSegmentDifferences(&beforeBits, bits);
-
-            storeSegment();
-
-            ++segmentsIter;
-            continue;
-        };
-
         // we want to evaluate anyone in a prior version of the index to get state change
         index->opOr(*bits);
 
         // reset the linear iterator current index
         currentLinId = -1;
 
-        ++segmentsIter;
+        // segment math reading this segment will see the refreshed bits
+        segmentMath->invalidate(segmentName);
 
         // we have to execute actual code that iterates people
         return true;
@@ -192,9 +241,26 @@ void OpenLoopSegmentRefresh::prepare()
     parts->checkForSegmentChanges();
     ++parts->segmentUsageCount;
 
-    segmentsIter = parts->segments.begin();
     maxLinearId = parts->people.customerCount();
 
+    refreshOrder.clear();
+    for (const auto& segment : parts->segments)
+        refreshOrder.push_back(segment.first);
+
+    SegmentMath::order(
+        refreshOrder,
+        [&](const std::string& name) -> const Macro_s*
+        {
+            const auto iter = parts->segments.find(name);
+            return iter == parts->segments.end() ? nullptr : &iter->second.macros;
+        },
+        [&](const std::string& name) -> int
+        {
+            return parts->segments.find(name)->second.zIndex;
+        });
+
+    segmentMath = std::make_unique<SegmentMathEval>(parts->getSegmentCallback(), maxLinearId);
+
     nextExpired();
 }
 
@@ -7,6 +7,7 @@
 #include "queryindexing.h"
 #include "queryinterpreter.h"
 #include "result.h"
+#include "segmentmath.h"
 #include "tablepartitioned.h"
 
 namespace openset
@@ -37,7 +38,13 @@ namespace openset
             openset::db::IndexBits* index {nullptr};
             openset::db::IndexBits* bits {nullptr};
 
-            std::unordered_map<std::string, SegmentPartitioned_s>::iterator segmentsIter;
+            // segment names, ordered so segment math comes after the segments it reads
+            std::vector<std::string> refreshOrder;
+            size_t refreshIndex { 0 };
+            // segments refreshed by this cell, segment math reading them is refreshed too
+            std::unordered_set<std::string> refreshed;
+            // shared segment math results for this refresh
+            std::unique_ptr<openset::query::SegmentMathEval> segmentMath;
 
             SegmentPartitioned_s* segmentInfo {nullptr};
 
@@ -52,7 +59,10 @@ namespace openset
             // store segments that have a TTL
             void storeSegment() const;
 
-            void emitSegmentDifferences(openset::db::IndexBits* before, openset::db::IndexBits* after) const;
+            // returns the number of customers that entered or exited
+            int64_t emitSegmentDifferences(openset::db::IndexBits* before, openset::db::IndexBits* after) const;
+
+            bool isRefreshDue() const;
 
             bool nextExpired();
 
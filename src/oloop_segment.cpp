@@ -93,27 +93,48 @@ void OpenLoopSegment::storeSegments()
     }
 }
 
-void OpenLoopSegment::emitSegmentDifferences(openset::db::IndexBits* before, openset::db::IndexBits* after) const
+int64_t OpenLoopSegment::emitSegmentDifferences(openset::db::IndexBits* before, openset::db::IndexBits* after) const
 {
     openset::db::PersonData_s* personData;
+    int64_t changes = 0;
 
     /*
-     * This will have to be made faster, but essentially it allows to look for changes in/out changes on the segment
-     * for segments calculated using segment math
+     * looks for customers entering or leaving segments that were calculated with indexes or segment
+     * math. Words that are the same before and after are skipped without looking at their bits
      */
-    for (int64_t i = 0; i < maxLinearId; ++i)
+    const auto words = (maxLinearId + 63) / 64;
+
+    for (int64_t word = 0; word < words; ++word)
     {
-        const auto beforeBit = before->bitState(i);
-        const auto afterBit = after->bitState(i);
+        const auto beforeWord = word < before->ints ? before->bits[word] : 0;
+        const auto afterWord = word < after->ints ? after->bits[word] : 0;
 
-        if ((personData = parts->people.getCustomerByLIN(i)) == nullptr)
+        if (beforeWord == afterWord)
             continue;
 
-        if (afterBit && !beforeBit)
-            parts->pushMessage(segmentHash, SegmentPartitioned_s::SegmentChange_e::enter, personData->getIdStr());
-        else if (!afterBit && beforeBit)
-            parts->pushMessage(segmentHash, SegmentPartitioned_s::SegmentChange_e::exit, personData->getIdStr());
+        const auto end = std::min(word * 64 + 64, maxLinearId);
+
+        for (auto i = word * 64; i < end; ++i)
+        {
+            const auto beforeBit = before->bitState(i);
+            const auto afterBit = after->bitState(i);
+
+            if (beforeBit == afterBit)
+                continue;
+
+            ++changes;
+
+            if ((personData = parts->people.getCustomerByLIN(i)) == nullptr)
+                continue;
+
+            if (afterBit)
+                parts->pushMessage(segmentHash, SegmentPartitioned_s::SegmentChange_e::enter, personData->getIdStr());
+            else
+                parts->pushMessage(segmentHash, SegmentPartitioned_s::SegmentChange_e::exit, personData->getIdStr());
+        }
     }
+
+    return changes;
 }
 
 bool OpenLoopSegment::nextMacro()
@@ -158,11 +179,6 @@ bool OpenLoopSegment::nextMacro()
 
         auto& macros = macroIter->second;
 
-        // generate the index for this query
-        indexing.mount(table.get(), macros, loop->partition, maxLinearId);
-        bool countable;
-        index = indexing.getIndex("_", countable);
-
         // get the bits for this segment
         auto bits = parts->getBits(segmentName);
         beforeBits.opCopy(*bits);
@@ -179,12 +195,54 @@ bool OpenLoopSegment::nextMacro()
             // cached copy not found... carry on!
         }
 
+        // is this calculated using other segments (i.e. the functions
+        // population, intersection, union, difference and compliment)
+        // meaning we do not have to iterate user records or run the script
+        if (macros.isSegmentMath)
+        {
+            if (!segmentMath->evaluate(macros.segmentMath, bits))
+            {
+                openset::errors::Error error;
+                error.set(
+                    openset::errors::errorClass_e::run_time,
+                    openset::errors::errorCode_e::set_math_param_invalid,
+                    segmentName + " - set could not be found");
+
+                shuttle->reply(0, CellQueryResult_s { instance, {}, error });
+
+                parts->attributes.clearDirty();
+                suicide();
+                return false;
+            }
+
+            if (emitSegmentDifferences(&beforeBits, bits))
+            {
+                ++segmentInfo->changeCount;
+                segmentMath->invalidate(segmentName);
+            }
+
+            // add to resultBits upon query completion
+            storeResult(segmentName, bits->population(maxLinearId));
+
+            ++macroIter;
+            continue;
+        }
+
+        // generate the index for this query
+        indexing.mount(table.get(), macros, loop->partition, maxLinearId);
+        bool countable;
+        index = indexing.getIndex("_", countable);
+
         // is this something we can calculate using purely
         // indexes? (nifty)
-        if (countable && !macros.isSegmentMath)
+        if (countable)
         {
             // look for changes
-            emitSegmentDifferences(bits, index);
+            if (emitSegmentDifferences(bits, index))
+            {
+                ++segmentInfo->changeCount;
+                segmentMath->invalidate(segmentName);
+            }
             // index contains result
             bits->opCopy(*index);
 
@@ -211,31 +269,15 @@ bool OpenLoopSegment::nextMacro()
             return false;
         }
 
-        // is this calculated using other segments (i.e. the functions
-        // population, intersection, union, difference and compliment)
-        // meaning we do not have to iterate user records
-        if (macros.isSegmentMath)
-        {
-            interpreter->interpretMode = InterpretMode_e::count;
-
-            interpreter->mount(&person);
-            interpreter->exec();
-
-            emitSegmentDifferences(&beforeBits, bits);
-
-            // add to resultBits upon query completion
-            storeResult(segmentName, bits->population(maxLinearId));
-
-            ++macroIter;
-            continue;
-        };
-
         // we want to evaluate anyone in a prior version of the index to get state change
         index->opOr(*bits);
 
         // reset the linear iterator current index
         currentLinId = -1;
 
+        // segment math reading this segment will see the new bits
+        segmentMath->invalidate(segmentName);
+
         ++macroIter;
 
         // we have to execute actual code that iterates people
@@ -260,6 +302,33 @@ void OpenLoopSegment::prepare()
 
     maxLinearId = parts->people.customerCount();
 
+    // segments in this query that are read by segment math are calculated first
+    std::vector<std::string> names;
+    for (const auto& macro : macrosList)
+        names.push_back(macro.first);
+
+    SegmentMath::order(
+        names,
+        [&](const std::string& name) -> const Macro_s*
+        {
+            for (const auto& macro : macrosList)
+                if (macro.first == name)
+                    return &macro.second;
+            return nullptr;
+        },
+        [](const std::string&) -> int { return 0; });
+
+    QueryPairs ordered;
+    for (const auto& name : names)
+        for (const auto& macro : macrosList)
+            if (macro.first == name)
+                ordered.push_back(macro);
+
+    macrosList = std::move(ordered);
+    macroIter = macrosList.begin();
+
+    segmentMath = std::make_unique<SegmentMathEval>(parts->getSegmentCallback(), maxLinearId);
+
     startTime = Now();
 
     // Note - OpenLoopSegment can return in the prepare if none of the queries
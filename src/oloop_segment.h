@@ -8,6 +8,7 @@
 #include "queryindexing.h"
 #include "queryinterpreter.h"
 #include "result.h"
+#include "segmentmath.h"
 #include "tablepartitioned.h"
 
 namespace openset
@@ -41,6 +42,8 @@ namespace openset
             openset::db::IndexBits* index;
             openset::db::IndexBits beforeBits;
             openset::result::ResultSet* result;
+            // shared segment math results for this query
+            std::unique_ptr<openset::query::SegmentMathEval> segmentMath;
 
             query::QueryPairs::iterator macroIter;
             //query::Macro_s macros;
@@ -64,7 +67,8 @@ namespace openset
             // store segments that have a TTL
             void storeSegments();
 
-            void emitSegmentDifferences(openset::db::IndexBits* before, openset::db::IndexBits* after) const;
+            // returns the number of customers that entered or exited
+            int64_t emitSegmentDifferences(openset::db::IndexBits* before, openset::db::IndexBits* after) const;
 
             bool nextMacro();
 
@@ -32,6 +32,11 @@ namespace openset
             dist_count_person,
             value,
             var,
+            median,
+            p75,
+            p90,
+            p95,
+            p99,
             second_number,
             second_date,
             minute_number,
@@ -169,6 +174,10 @@ namespace openset
             marshal_compliment,
             marshal_difference,
             marshal_session_count,
+            marshal_session_start,
+            marshal_session_end,
+            marshal_session_duration,
+            marshal_session_length,
             marshal_return,
             marshal_break,
             marshal_continue,
@@ -199,7 +208,6 @@ namespace openset
             marshal_clear,
             marshal_keys,
             marshal_range,
-            // not implemented
             marshal_str_split,
             marshal_str_find,
             marshal_str_rfind,
@@ -223,7 +231,7 @@ namespace openset
             PUSH_TBL,
             BIT_OR,
             BIT_AND,
-
+            FIND,   // text property contains the value (from `find(prop, "text") != -1`)
         };
     }
 }
@@ -313,6 +321,19 @@ namespace openset
             { "variable", Modifiers_e::var },
             { "var", Modifiers_e::var },
             { "lambda", Modifiers_e::var },
+            { "median", Modifiers_e::median },
+            { "p50", Modifiers_e::median },
+            { "p75", Modifiers_e::p75 },
+            { "p90", Modifiers_e::p90 },
+            { "p95", Modifiers_e::p95 },
+            { "p99", Modifiers_e::p99 },
+        }; // Percentile modifiers to the quantile they report (these accumulate into a QuantileSketch_s)
+        static const unordered_map<Modifiers_e, double> PercentileModifiers = {
+            { Modifiers_e::median, 0.50 },
+            { Modifiers_e::p75, 0.75 },
+            { Modifiers_e::p90, 0.90 },
+            { Modifiers_e::p95, 0.95 },
+            { Modifiers_e::p99, 0.99 },
         }; // Modifier to String (for debug output)
         static const unordered_map<Modifiers_e, string> ModifierDebugStrings = {
             { Modifiers_e::sum, "SUM" },
@@ -323,6 +344,11 @@ namespace openset
             { Modifiers_e::dist_count_person, "DCNTPP" },
             { Modifiers_e::value, "VALUE" },
             { Modifiers_e::var, "VAR" },
+            { Modifiers_e::median, "MEDIAN" },
+            { Modifiers_e::p75, "P75" },
+            { Modifiers_e::p90, "P90" },
+            { Modifiers_e::p95, "P95" },
+            { Modifiers_e::p99, "P99" },
             { Modifiers_e::second_number, "SECOND" },
             { Modifiers_e::second_date, "DT_SECOND" },
             { Modifiers_e::minute_number, "MINUTE" },
@@ -479,6 +505,10 @@ namespace openset
             { "compliment", Marshals_e::marshal_compliment },
             { "difference", Marshals_e::marshal_difference },
             { "session_count", Marshals_e::marshal_session_count },
+            { "session_start", Marshals_e::marshal_session_start },
+            { "session_end", Marshals_e::marshal_session_end },
+            { "session_duration", Marshals_e::marshal_session_duration },
+            { "session_length", Marshals_e::marshal_session_length },
             { "return", Marshals_e::marshal_return },
             { "continue", Marshals_e::marshal_continue },
             { "break", Marshals_e::marshal_break },
@@ -508,16 +538,27 @@ namespace openset
             { "__pop", Marshals_e::marshal_pop },
             { "__clear", Marshals_e::marshal_clear },
             { "keys", Marshals_e::marshal_keys },
-            { "__split", Marshals_e::marshal_str_split },
-            { "__find", Marshals_e::marshal_str_find },
-            { "__rfind", Marshals_e::marshal_str_rfind },
-            { "__slice", Marshals_e::marshal_str_slice },
-            { "__strip", Marshals_e::marshal_str_strip },
+            { "split", Marshals_e::marshal_str_split },
+            { "find", Marshals_e::marshal_str_find },
+            { "rfind", Marshals_e::marshal_str_rfind },
+            { "replace", Marshals_e::marshal_str_replace },
+            { "slice", Marshals_e::marshal_str_slice },
+            { "strip", Marshals_e::marshal_str_strip },
             { "range", Marshals_e::marshal_range },
             { "url_decode", Marshals_e::marshal_url_decode },
             { "get_row", Marshals_e::marshal_get_row },
             { "__eval_column_filter", Marshals_e::marshal_eval_column_filter}
         };
+        // string functions the interpreter can evaluate once per distinct text value
+        static const unordered_set<Marshals_e> DictionaryMarshals = {
+            { Marshals_e::marshal_str_split },
+            { Marshals_e::marshal_str_find },
+            { Marshals_e::marshal_str_rfind },
+            { Marshals_e::marshal_str_replace },
+            { Marshals_e::marshal_str_slice },
+            { Marshals_e::marshal_str_strip },
+            { Marshals_e::marshal_url_decode },
+        };
         static const unordered_set<Marshals_e> SegmentMathMarshals = {
             { Marshals_e::marshal_population },
             { Marshals_e::marshal_intersection },
@@ -525,8 +566,13 @@ namespace openset
             { Marshals_e::marshal_compliment },
             { Marshals_e::marshal_difference },
         };
+        // these read the `session` property, it is added to the query when they are used
         static const unordered_set<string> SessionMarshals = {
             "session_count",
+            "session_start",
+            "session_end",
+            "session_duration",
+            "session_length",
         };
 
         // these are marshals that do not take params by default, so they appear
@@ -537,6 +583,10 @@ namespace openset
             { "last_stamp" },
             { "first_stamp" },
             { "session_count" },
+            { "session_start" },
+            { "session_end" },
+            { "session_duration" },
+            { "session_length" },
             { "row_count" },
             { "break" },
             { "exit" },
@@ -603,6 +653,7 @@ namespace openset
             { HintOp_e::BIT_AND, "AND" },
             { HintOp_e::PUSH_VAL, "PSH_VAL" },
             { HintOp_e::PUSH_TBL, "PSH_TBL" },
+            { HintOp_e::FIND, "FIND" },
         };
         static const unordered_map<std::string, HintOp_e> OpToHintOp = {
             { ">=", HintOp_e::GTE },
@@ -613,6 +664,7 @@ namespace openset
             { "!=", HintOp_e::NEQ },
             { "[==]", HintOp_e::EQ },
             { "[!=]", HintOp_e::NEQ },
+            { "[find]", HintOp_e::FIND },
             { "&&", HintOp_e::BIT_AND },
             { "||", HintOp_e::BIT_OR }
         };
@@ -844,6 +896,7 @@ namespace openset
             bool isNext {false};
             bool isLookAhead {false}; // for within
             bool isLookBack {false}; // for within
+            bool isSessions {false}; // only the first row of each session
 
             int evalBlock {-1};
             int continueBlock {-1};
@@ -883,6 +936,16 @@ namespace openset
         using HintPairs = vector<HintPair>;
         using ParamVars = unordered_map<string, cvar>;
         using SegmentList = vector<std::string>; // struct containing compiled macro
+
+        // a segment math script (population, intersection, union, compliment, difference)
+        // as an expression tree, so it can be calculated with bitmap operations
+        struct SegmentMathNode_s
+        {
+            Marshals_e op { Marshals_e::marshal_population };
+            std::string segment;                   // leaf nodes read this segment
+            std::vector<SegmentMathNode_s> params; // empty for leaf nodes
+            std::string key;                       // nodes with equal keys calculate the same bits
+        };
         using LambdaLookAside = vector<int>;
         using PropLookAside = vector<int>;
 
@@ -906,6 +969,8 @@ namespace openset
             int sessionColumn { -1 };
 
             int64_t sessionTime { 60'000LL * 30LL }; // 30 minutes
+            int64_t stampFrom { LLONG_MIN }; // rows outside the window can't change the result, they
+            int64_t stampTo { LLONG_MAX };   // are not decoded and customers without rows in it are skipped
             std::string rawScript;
             bool isSegment { false };
             bool useProps { false };      // uses customer props
@@ -913,9 +978,12 @@ namespace openset
             bool useGlobals { false };    // uses global for table
             bool useCached { false };     // for segments allow use of cached values within TTL
             bool isSegmentMath { false }; // for segments, the index has the value, script execution not required
+            SegmentMathNode_s segmentMath; // set when isSegmentMath
             bool useSessions { false };   // uses session functions, we can cache these
             bool useStampedRowIds { false }; // count using row stamp rather than row uniqueness
             bool onInsert { false };
+            bool analyze { false };       // collect per-partition timings and counts (EXPLAIN ANALYZE)
+            double sample { 1.0 };        // fraction of customers scanned, results are scaled up (1 = exact)
             int zIndex { 100 };
         };
 
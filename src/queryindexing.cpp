@@ -78,7 +78,9 @@ openset::db::IndexBits Indexing::compositeBits(Attributes::listMode_e mode)
             negate = true; // != VAL -- anything other than VAL
     }
 
-    auto attrList = parts->attributes.getPropertyValues(propInfo->idx, mode, entry.hash);
+    auto attrList = mode == Attributes::listMode_e::CONTAINS ?
+        parts->attributes.getPropertyValuesContaining(propInfo->idx, entry.value.getString()) :
+        parts->attributes.getPropertyValues(propInfo->idx, mode, entry.hash);
 
     auto& resultBits = entry.bits; // where our bits will all accumulate
     resultBits.reset();
@@ -197,6 +199,10 @@ IndexBits Indexing::buildIndex(HintOpList &index, bool countable)
             compositeBits(Attributes::listMode_e::LTE);
             ++count;
             break;
+        case HintOp_e::FIND:
+            compositeBits(Attributes::listMode_e::CONTAINS);
+            ++count;
+            break;
         case HintOp_e::PUSH_VAL:
             if (!columnName.length())
             {
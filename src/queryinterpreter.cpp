@@ -8,6 +8,7 @@
 //const int MAX_EXEC_COUNT = 1'000'000'000;
 const int MAX_RECURSE_COUNT = 10;
 const int STACK_DEPTH       = 64;
+const int DICTIONARY_CACHE_MAX = 65'536; // cached values per dictionary call
 
 openset::query::Interpreter::Interpreter(Macro_s& macros, const InterpretMode_e interpretMode)
     : macros(macros),
@@ -69,6 +70,41 @@ void openset::query::Interpreter::configure()
             return;
         }
     }
+
+    // find dictionary calls - a string function whose first param is a text property and
+    // whose other params are literals. Params are pushed last to first, so the code is the
+    // literals, then PSHTBLCOL, then the MARSHAL
+    const auto& code = macros.code;
+    for (auto i = 1; i < static_cast<int>(code.size()); ++i)
+    {
+        const auto& call = code[i];
+        if (call.op != OpCode_e::MARSHAL ||
+            !DictionaryMarshals.count(cast<Marshals_e>(call.index)) ||
+            call.extra < 1 ||
+            i < call.extra)
+            continue;
+
+        const auto& push = code[i - 1];
+        if (push.op != OpCode_e::PSHTBLCOL)
+            continue;
+
+        const auto& tableVar = macros.vars.tableVars[push.index];
+        if (tableVar.schemaType != PropertyTypes_e::textProp || tableVar.isSet || tableVar.schemaColumn == PROP_UUID)
+            continue;
+
+        auto literals = true;
+        for (auto param = 2; param <= call.extra; ++param)
+        {
+            const auto op = code[i - param].op;
+            if (op != OpCode_e::PSHLITSTR && op != OpCode_e::PSHLITINT && op != OpCode_e::PSHLITFLT &&
+                op != OpCode_e::PSHLITTRUE && op != OpCode_e::PSHLITFALSE && op != OpCode_e::PSHLITNUL)
+                literals = false;
+        }
+
+        if (literals)
+            dictionaryCalls.emplace(i, DictionaryCache{});
+    }
+
     isConfigured = true;
 }
 
@@ -100,6 +136,8 @@ void openset::query::Interpreter::mount(Customer* person)
     rows     = grid->getRows(); // const
     rowCount = rows->size();
 
+    sessionsMapped = false;
+
     if (firstRun)
     {
         // this script references the global cvar, so
@@ -258,12 +296,19 @@ void openset::query::Interpreter::marshal_tally(const int paramCount, const Col_
             switch (resCol.modifier)
             {
             case Modifiers_e::sum:
+                // the count of summed values sizes the margin of a sampled sum
                 if (columns->cols[resCol.column] != NONE)
                 {
                     if (resultColumns->columns[resultIndex].value == NONE)
+                    {
                         resultColumns->columns[resultIndex].value = columns->cols[resCol.column];
+                        resultColumns->columns[resultIndex].count = 1;
+                    }
                     else
+                    {
                         resultColumns->columns[resultIndex].value += columns->cols[resCol.column];
+                        resultColumns->columns[resultIndex].count++;
+                    }
                 }
                 break;
             case Modifiers_e::min:
@@ -309,6 +354,20 @@ void openset::query::Interpreter::marshal_tally(const int paramCount, const Col_
                 else
                     resultColumns->columns[resultIndex].value++; //+= fixToInt(resCol.value);
                 break;
+            case Modifiers_e::median:
+            case Modifiers_e::p75:
+            case Modifiers_e::p90:
+            case Modifiers_e::p95:
+            case Modifiers_e::p99:
+                if (columns->cols[resCol.column] != NONE)
+                {
+                    if (resultColumns->columns[resultIndex].value == NONE)
+                        resultColumns->columns[resultIndex].value = reinterpret_cast<int64_t>(result->newSketch());
+                    reinterpret_cast<result::QuantileSketch_s*>(resultColumns->columns[resultIndex].value)->add(
+                        static_cast<double>(columns->cols[resCol.column]));
+                    resultColumns->columns[resultIndex].count++;
+                }
+                break;
             default:
                 break;
             }
@@ -835,10 +894,11 @@ void openset::query::Interpreter::marshal_difference(const int paramCount)
         ++stackPtr;
         return;
     }
-    --stackPtr;
-    const auto b = *stackPtr;
+    // params are pushed last to first, so the top of the stack is the first param
     --stackPtr;
     const auto a = *stackPtr;
+    --stackPtr;
+    const auto b = *stackPtr;
 
     // if we acquired IndexBits from getSegment_cb we must
     // delete them after we are done, or it'll leak
@@ -886,20 +946,20 @@ void openset::query::Interpreter::marshal_difference(const int paramCount)
         delete bBits;
 }
 
-void openset::query::Interpreter::marshal_slice(const int paramCount)
+namespace
 {
-    if (paramCount != 3)
-        throw std::runtime_error("slice [:] malformed");
-    if ((stackPtr - 3)->typeOf() != cvar::valueType::REF)
-        throw std::runtime_error("slice [:] first parameter must be reference type");
-    const auto reference = stackPtr - 3;
-    auto startIndex      = (stackPtr - 2)->getInt64();
-    auto endIndex        = (stackPtr - 1)->getInt64();
-    stackPtr -= 2;
-
-    // we will return our result at this position
-    // local function to sort our missing, negative, or out of range indexes
-    const auto fixIndexes = [](size_t valueLength, int64_t& startIndex, int64_t& endIndex)
+    // string functions take their text as a value, or as a reference when called on a variable
+    cvar* stringArgument(cvar* param, const char* name)
+    {
+        const auto value = param->typeOf() == cvar::valueType::REF ? param->getReference() : param;
+        const auto type  = value->typeOf();
+        if (type == cvar::valueType::DICT || type == cvar::valueType::SET || type == cvar::valueType::LIST)
+            throw std::runtime_error(std::string(name) + " expecting string or convertible type");
+        return value;
+    }
+
+    // python style indexes - missing, negative and out of range indexes are fixed up
+    void fixSliceIndexes(const int64_t valueLength, int64_t& startIndex, int64_t& endIndex)
     {
         if (startIndex == NONE)
             startIndex = 0;
@@ -921,136 +981,179 @@ void openset::query::Interpreter::marshal_slice(const int paramCount)
         // we will swap for a valid range if they are reversed for whatever reason
         if (endIndex < startIndex)
             std::swap(startIndex, endIndex);
-    };
-    const auto refType = reference->getReference()->typeOf();
-    if (refType == cvar::valueType::DICT || refType == cvar::valueType::SET)
-        throw std::runtime_error("slice [:] expecting list, string or convertible type");
-    // SET and DICT will merge, LIST will append, so you can append objects
-    if (refType == cvar::valueType::LIST)
-    {
-        const auto value       = reference->getReference()->getList();
-        const auto valueLength = value->size();
-        fixIndexes(valueLength, startIndex, endIndex);
-        cvar result(cvar::valueType::LIST);
-        auto resultList = result.getList();
+    }
+}
+
+// slice(text, start, [end]) - also slices lists
+void openset::query::Interpreter::marshal_slice(const int paramCount)
+{
+    if (paramCount != 2 && paramCount != 3)
+        throw std::runtime_error("slice malformed");
+
+    auto source = (stackPtr - 1)->typeOf() == cvar::valueType::REF ? (stackPtr - 1)->getReference() : stackPtr - 1;
+    auto startIndex = (stackPtr - 2)->getInt64();
+    auto endIndex   = paramCount == 3 ? (stackPtr - 3)->getInt64() : NONE;
+
+    const auto sourceType = source->typeOf();
+    if (sourceType == cvar::valueType::DICT || sourceType == cvar::valueType::SET)
+        throw std::runtime_error("slice expecting list, string or convertible type");
+
+    cvar result;
+
+    if (sourceType == cvar::valueType::LIST)
+    {
+        const auto value = source->getList();
+        fixSliceIndexes(static_cast<int64_t>(value->size()), startIndex, endIndex);
+        result.list();
+        const auto resultList = result.getList();
         resultList->insert(resultList->begin(), value->begin() + startIndex, value->begin() + endIndex);
-        *(stackPtr - 1) = std::move(result);
+    }
+    else if (*source == NONE)
+    {
+        result = NONE;
     }
     else
     {
-        auto value             = reference->getReference()->getString(); // convert type of needed
-        const auto valueLength = value.length();
-        fixIndexes(valueLength, startIndex, endIndex);
-        cvar result(cvar::valueType::STR);
-        const auto resultString = result.getStringPtr(); // grab the actual pointer to the string in the cvar
-        *resultString           = value.substr(startIndex, endIndex - startIndex);
-        *(stackPtr - 1)         = std::move(result);
+        const auto value = source->getString();
+        fixSliceIndexes(static_cast<int64_t>(value.length()), startIndex, endIndex);
+        result = value.substr(startIndex, endIndex - startIndex);
     }
+
+    stackPtr -= paramCount - 1;
+    *(stackPtr - 1) = std::move(result);
 }
 
+// find(text, look_for, [start]) and rfind(text, look_for, [start]) - returns the position or -1
 void openset::query::Interpreter::marshal_find(const int paramCount, const bool reverse)
 {
-    if (paramCount < 2)
-        throw std::runtime_error("find malformed");
-    if ((stackPtr - paramCount)->typeOf() != cvar::valueType::REF)
-        throw std::runtime_error(".find first parameter must be reference type");
-    auto count    = paramCount;
-    size_t length = 0;
-    if (count == 4)
-    {
-        length = (stackPtr - 1)->getInt32();
-        --stackPtr;
-        --count;
-    }
-    size_t firstPos = 0;
-    if (count == 3)
+    if (paramCount != 2 && paramCount != 3)
+        throw std::runtime_error(reverse ? "rfind malformed" : "find malformed");
+
+    const auto source   = stringArgument(stackPtr - 1, reverse ? "rfind" : "find");
+    const auto lookFor  = (stackPtr - 2)->getString();
+    const auto startPos = paramCount == 3 ? (stackPtr - 3)->getInt64() : NONE;
+
+    auto pos = std::string::npos;
+
+    if (*source != NONE)
     {
-        firstPos = (stackPtr - 1)->getInt32();
-        --stackPtr;
+        const auto text = source->getString();
+
+        if (reverse)
+            pos = text.rfind(lookFor, startPos == NONE || startPos < 0 ? std::string::npos : startPos);
+        else
+            pos = text.find(lookFor, startPos == NONE || startPos < 0 ? 0 : startPos);
     }
-    const auto reference = stackPtr - 2;
-    const auto lookFor   = stackPtr - 1;
-    const auto refType   = reference->getReference()->typeOf();
-    auto str             = reference->getReference()->getString();
-
-    // python allows a second index, C++ takes a length, lets convert
-    if (length && !reverse)
-        str = str.substr(0, length);
-    if (refType == cvar::valueType::DICT || refType == cvar::valueType::SET || refType == cvar::valueType::LIST)
-        throw std::runtime_error(".find expecting string or convertable type");
-    const auto pos = (reverse)
-                         ? str.rfind(lookFor->getString())
-                         : str.find(lookFor->getString(), firstPos);
-    *(stackPtr - 1) = (pos == std::string::npos)
-                          ? -1
-                          : static_cast<int32_t>(pos);
+
+    stackPtr -= paramCount - 1;
+    *(stackPtr - 1) = pos == std::string::npos ? static_cast<int64_t>(-1) : static_cast<int64_t>(pos);
 }
 
-void openset::query::Interpreter::marshal_split(const int paramCount) const
+// split(text, separator) - returns a list
+void openset::query::Interpreter::marshal_split(const int paramCount)
 {
     if (paramCount != 2)
         throw std::runtime_error("split malformed");
-    if ((stackPtr - paramCount)->typeOf() != cvar::valueType::REF)
-        throw std::runtime_error(".split first parameter must be reference type");
-    const auto reference = stackPtr - 2;
-    const auto lookFor   = stackPtr - 1;
-    const auto refType   = reference->getReference()->typeOf();
-    if (refType == cvar::valueType::DICT || refType == cvar::valueType::SET || refType == cvar::valueType::LIST)
-        throw std::runtime_error(".find expecting string or convertable type");
-    const auto source    = reference->getReference()->getString();
-    const auto search    = lookFor->getString();
-    const auto searchLen = search.length(); // make a result list
+
+    const auto source    = stringArgument(stackPtr - 1, "split");
+    const auto separator = (stackPtr - 2)->getString();
+
+    if (separator.empty())
+        throw std::runtime_error("split separator is empty");
+
     cvar result(cvar::valueType::LIST);
-    size_t startIdx = 0;
-    while (true)
+
+    if (*source != NONE)
     {
-        const auto pos = source.find(search, startIdx);
-        if (pos == std::string::npos)
-            break;
-        result += source.substr(startIdx, pos - startIdx);
-        startIdx = pos + searchLen;
+        const auto text = source->getString();
+
+        size_t startIdx = 0;
+        while (true)
+        {
+            const auto pos = text.find(separator, startIdx);
+            if (pos == std::string::npos)
+                break;
+            result += text.substr(startIdx, pos - startIdx);
+            startIdx = pos + separator.length();
+        }
+        result += text.substr(startIdx);
+    }
+
+    --stackPtr;
+    *(stackPtr - 1) = std::move(result);
+}
+
+// replace(text, old, new, [count])
+void openset::query::Interpreter::marshal_replace(const int paramCount)
+{
+    if (paramCount != 3 && paramCount != 4)
+        throw std::runtime_error("replace malformed");
+
+    const auto source  = stringArgument(stackPtr - 1, "replace");
+    const auto oldText = (stackPtr - 2)->getString();
+    const auto newText = (stackPtr - 3)->getString();
+    auto count         = paramCount == 4 ? (stackPtr - 4)->getInt64() : NONE;
+
+    cvar result;
+
+    if (*source == NONE)
+    {
+        result = NONE;
+    }
+    else
+    {
+        auto text = source->getString();
+
+        if (!oldText.empty())
+        {
+            size_t pos = 0;
+            while (count == NONE || count-- > 0)
+            {
+                pos = text.find(oldText, pos);
+                if (pos == std::string::npos)
+                    break;
+                text.replace(pos, oldText.length(), newText);
+                pos += newText.length();
+            }
+        }
+
+        result = std::move(text);
     }
-    auto cleanup = source.substr(startIdx);
-    if (cleanup.length())
-        result += cleanup; // leave the List on the stack
+
+    stackPtr -= paramCount - 1;
     *(stackPtr - 1) = std::move(result);
 }
 
-void openset::query::Interpreter::marshal_strip(const int paramCount) const
+// strip(text) - removes leading and trailing white space
+void openset::query::Interpreter::marshal_strip(const int paramCount)
 {
     if (paramCount != 1)
         throw std::runtime_error("strip malformed");
-    if ((stackPtr - paramCount)->typeOf() != cvar::valueType::REF)
-        throw std::runtime_error(".strip first parameter must be reference type");
-    const auto reference = stackPtr - 1;
-    const auto refType   = reference->getReference()->typeOf();
-    if (refType == cvar::valueType::DICT || refType == cvar::valueType::SET || refType == cvar::valueType::LIST)
-        throw std::runtime_error(".strip expecting string or convertable type");
-    auto text             = reference->getReference()->getString();
-    const auto whiteSpace = " \t\n\r"s;
-    if (const auto start = text.find_first_not_of(whiteSpace); start == text.find_last_not_of(whiteSpace) && start ==
-        std::string::npos)
-        text.clear();
-    else
+
+    const auto source = stringArgument(stackPtr - 1, "strip");
+
+    if (*source == NONE)
     {
-        if (const auto end = text.find_last_not_of(whiteSpace); end != std::string::npos)
-            text.resize(end + 1);
-        if (start != std::string::npos)
-            text = text.substr(start);
+        *(stackPtr - 1) = NONE;
+        return;
     }
 
-    // leave the List on the stack
-    *(stackPtr - 1) = text;
+    const auto text       = source->getString();
+    const auto whiteSpace = " \t\n\r"s;
+
+    const auto start = text.find_first_not_of(whiteSpace);
+
+    if (start == std::string::npos)
+        *(stackPtr - 1) = ""s;
+    else
+        *(stackPtr - 1) = text.substr(start, text.find_last_not_of(whiteSpace) - start + 1);
 }
 
 void openset::query::Interpreter::marshal_url_decode(const int paramCount) const
 {
     if (paramCount != 1)
         throw std::runtime_error("url_decode malformed");
-    const auto paramType = (stackPtr - 1)->typeOf();
-    if (paramType == cvar::valueType::DICT || paramType == cvar::valueType::SET || paramType == cvar::valueType::LIST)
-        throw std::runtime_error(".url_decode expecting string or convertible type");
-    const auto url = (stackPtr - 1)->getString();
+    const auto url = stringArgument(stackPtr - 1, "url_decode")->getString();
     auto& result   = *(stackPtr - 1);
     result.dict();
     result["host"]   = NONE;
@@ -1101,6 +1204,110 @@ void openset::query::Interpreter::marshal_url_decode(const int paramCount) const
         result["path"] = url.substr(start);
 }
 
+bool openset::query::Interpreter::dictionaryCall(Instruction_s* inst, int64_t& currentRow)
+{
+    const auto cache = dictionaryCalls.find(inst - &macros.code.front());
+    if (cache == dictionaryCalls.end())
+        return false;
+
+    // PSHTBLCOL left the value hash, nil is evaluated as usual
+    const auto hash = (stackPtr - 1)->getInt64();
+    if (hash == NONE)
+        return false;
+
+    if (const auto cached = cache->second.find(hash); cached != cache->second.end())
+    {
+        stackPtr -= inst->extra - 1;
+        *(stackPtr - 1) = cached->second;
+        return true;
+    }
+
+    // resolve the text the way PSHTBLCOL would have, then run the function
+    const auto attr = attrs->get(macros.vars.tableVars[(inst - 1)->index].schemaColumn, hash);
+    if (attr && attr->text)
+        *(stackPtr - 1) = attr->text;
+
+    marshal(inst, currentRow);
+
+    if (cache->second.size() < DICTIONARY_CACHE_MAX && !error.inError())
+        cache->second.emplace(hash, *(stackPtr - 1));
+
+    return true;
+}
+
+void openset::query::Interpreter::mapSessions()
+{
+    if (macros.sessionColumn == -1)
+        throw std::runtime_error("session property could not be found");
+
+    const auto column = macros.sessionColumn;
+
+    sessionStarts.clear();
+
+    for (auto i = 0; i < rowCount; ++i)
+        if (!i || (*rows)[i]->cols[column] != (*rows)[i - 1]->cols[column])
+            sessionStarts.push_back(i);
+
+    sessionStarts.push_back(rowCount);
+    sessionsMapped = true;
+}
+
+std::pair<int, int> openset::query::Interpreter::sessionRows(const int row)
+{
+    if (!sessionsMapped)
+        mapSessions();
+
+    // first session starting after `row` (or the rowCount entry)
+    const auto next = std::upper_bound(sessionStarts.begin(), sessionStarts.end() - 1, row);
+    return { *(next - 1), *next - 1 };
+}
+
+void openset::query::Interpreter::marshal_session(const Marshals_e marshal, const int64_t currentRow)
+{
+    if (currentRow < 0 || currentRow >= rowCount)
+    {
+        *stackPtr = NONE;
+        ++stackPtr;
+        return;
+    }
+
+    const auto session = sessionRows(static_cast<int>(currentRow));
+    const auto start = (*rows)[session.first]->cols[PROP_STAMP];
+    const auto end = (*rows)[session.second]->cols[PROP_STAMP];
+
+    switch (marshal)
+    {
+    case Marshals_e::marshal_session_start:
+        *stackPtr = start;
+        break;
+    case Marshals_e::marshal_session_end:
+        *stackPtr = end;
+        break;
+    case Marshals_e::marshal_session_duration:
+        *stackPtr = end - start;
+        break;
+    case Marshals_e::marshal_session_length:
+        *stackPtr = static_cast<int64_t>(session.second - session.first + 1);
+        break;
+    default:
+        *stackPtr = NONE;
+    }
+
+    ++stackPtr;
+}
+
+int64_t openset::query::Interpreter::nextRow(const Filter_s& filter, const int64_t row)
+{
+    if (!filter.isSessions)
+        return filter.isReverse ? row - 1 : row + 1;
+
+    // sessions are visited on their first row
+    if (filter.isReverse)
+        return row > 0 ? sessionRows(static_cast<int>(row - 1)).first : -1;
+
+    return sessionRows(static_cast<int>(row)).second + 1;
+}
+
 void openset::query::Interpreter::marshal_get_row(const int paramCount) const
 {
     if (paramCount != 1)
@@ -1580,6 +1787,12 @@ bool openset::query::Interpreter::marshal(Instruction_s* inst, int64_t& currentR
         ++stackPtr;
         *(stackPtr - 1) = rowCount ? rows->back()->cols[macros.sessionColumn] : 0;
         break;
+    case Marshals_e::marshal_session_start:
+    case Marshals_e::marshal_session_end:
+    case Marshals_e::marshal_session_duration:
+    case Marshals_e::marshal_session_length:
+        marshal_session(cast<Marshals_e>(inst->index), currentRow);
+        break;
     case Marshals_e::marshal_str_split:
         marshal_split(inst->extra);
         break;
@@ -1589,6 +1802,9 @@ bool openset::query::Interpreter::marshal(Instruction_s* inst, int64_t& currentR
     case Marshals_e::marshal_str_rfind:
         marshal_find(inst->extra, true);
         break;
+    case Marshals_e::marshal_str_replace:
+        marshal_replace(inst->extra);
+        break;
     case Marshals_e::marshal_str_slice:
         marshal_slice(inst->extra);
         break;
@@ -1827,6 +2043,12 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
                                 stackPtr->getSet()->emplace(std::string(attr->text));
                         }
                     }
+                    else if (!dictionaryCalls.empty() && dictionaryCalls.count(inst - &macros.code.front() + 1))
+                    {
+                        // the next instruction is a dictionary call, it only resolves
+                        // the text when the hash isn't cached
+                        *stackPtr = colValue;
+                    }
                     else
                     {
                         const auto attr = attrs->get(macros.vars.tableVars[inst->index].schemaColumn, colValue);
@@ -2209,6 +2431,8 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
             ++stackPtr;
             break;
         case OpCode_e::MARSHAL:
+            if (!dictionaryCalls.empty() && dictionaryCall(inst, currentRow))
+                break;
             if (marshal(inst, currentRow))
                 return;
             break;
@@ -2451,6 +2675,14 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
             if (filter.isNext)
                 filter.isReverse ? --currentRow : ++currentRow;
 
+            // .sessions - start on the first row of a session, going forward
+            // from inside a session starts on the next one
+            if (filter.isSessions && currentRow >= 0 && currentRow < rowCount)
+            {
+                const auto session = sessionRows(static_cast<int>(currentRow));
+                currentRow = filter.isReverse || session.first == currentRow ? session.first : session.second + 1;
+            }
+
             // .limit - set match limit
             int64_t matches = 0;
             auto matchLimit = LLONG_MAX;
@@ -2518,7 +2750,7 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
                 {
                     if (filter.isReverse)
                         break;
-                    ++currentRow;
+                    currentRow = nextRow(filter, currentRow);
                     continue;
                 }
 
@@ -2526,7 +2758,7 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
                 {
                     if (filter.isReverse)
                     {
-                        --currentRow;
+                        currentRow = nextRow(filter, currentRow);
                         continue;
                     }
                     break;
@@ -2567,7 +2799,7 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
                 if (loopState == LoopState_e::in_continue)
                     loopState = LoopState_e::run;
 
-                filter.isReverse ? --currentRow : ++currentRow;
+                currentRow = nextRow(filter, currentRow);
             }
 
             --nestDepth;
@@ -2608,6 +2840,14 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
             if (filter.isNext)
                 filter.isReverse ? --currentRow : ++currentRow;
 
+            // .sessions - start on the first row of a session, going forward
+            // from inside a session starts on the next one
+            if (filter.isSessions && currentRow >= 0 && currentRow < rowCount)
+            {
+                const auto session = sessionRows(static_cast<int>(currentRow));
+                currentRow = filter.isReverse || session.first == currentRow ? session.first : session.second + 1;
+            }
+
             // .limit - set match limit
             int64_t matches = 0;
             auto matchLimit = LLONG_MAX;
@@ -2693,7 +2933,7 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
                 {
                     if (filter.isReverse)
                         break;
-                    ++currentRow;
+                    currentRow = nextRow(filter, currentRow);
                     continue;
                 }
 
@@ -2701,7 +2941,7 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
                 {
                     if (filter.isReverse)
                     {
-                        --currentRow;
+                        currentRow = nextRow(filter, currentRow);
                         continue;
                     }
                     break;
@@ -2754,7 +2994,7 @@ void openset::query::Interpreter::opRunner(Instruction_s* inst, int64_t currentR
                 if (loopState == LoopState_e::in_continue)
                     loopState = LoopState_e::run;
 
-                filter.isReverse ? --currentRow : ++currentRow;
+                currentRow = nextRow(filter, currentRow);
             }
 
             --nestDepth;
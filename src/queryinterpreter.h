@@ -175,6 +175,10 @@ namespace openset
             errors::Error error;
             int32_t eventCount{ -1 }; // -1 is uninitialized, calculation cached here
 
+            // first row of each session followed by rowCount, mapped on first use after mount
+            std::vector<int> sessionStarts;
+            bool sessionsMapped{ false };
+
             // callbacks to external code (i.e. triggers)
             function<IndexBits*(const string&, bool&)> getSegment_cb{ nullptr };
 
@@ -192,6 +196,12 @@ namespace openset
             ValuesSeen eventDistinct; // distinct to group id
             ValuesSeenKey distinctKey;
 
+            // string functions called on a text property with literal arguments depend only
+            // on the property value, so they are evaluated once per distinct value (see configure).
+            // Keyed by the offset of the MARSHAL instruction, then by value hash
+            using DictionaryCache = robin_hood::unordered_map<int64_t, cvar, robin_hood::hash<int64_t>>;
+            robin_hood::unordered_map<int64_t, DictionaryCache, robin_hood::hash<int64_t>> dictionaryCalls;
+
             // used to load global variables into user variable space
             bool firstRun{ true };
 
@@ -258,13 +268,25 @@ namespace openset
 
             void marshal_slice(const int paramCount);
             void marshal_find(const int paramCount, const bool reverse = false);
-            void marshal_split(const int paramCount) const;
-            void marshal_strip(const int paramCount) const;
+            void marshal_split(const int paramCount);
+            void marshal_replace(const int paramCount);
+            void marshal_strip(const int paramCount);
 
             void marshal_url_decode(const int paramCount) const;
 
             void marshal_get_row(const int paramCount) const;
 
+            void mapSessions();
+            // first and last row of the session containing `row`
+            std::pair<int, int> sessionRows(int row);
+            void marshal_session(Marshals_e marshal, int64_t currentRow);
+
+            // next row for an iterator, with `.sessions()` the first row of the next session
+            int64_t nextRow(const Filter_s& filter, int64_t row);
+
+            // runs a cached string function, returns false if `inst` is not a dictionary call
+            bool dictionaryCall(Instruction_s* inst, int64_t& currentRow);
+
             // get a string from the literals script block by ID
             string getLiteral(const int64_t id) const;
 
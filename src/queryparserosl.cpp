@@ -1,6 +1,7 @@
 #include "queryparserosl.h"
 
 #include "properties.h"
+#include "cjson/cjson.h"
 #include <iterator>
 #include <sstream>
 #include <iomanip>
@@ -267,3 +268,60 @@ string openset::query::MacroDbg(Macro_s& macro)
     outSpacer();
     return ss.str();
 }
+
+cjson openset::query::MacroExplain(Macro_s& macro)
+{
+    cjson doc;
+
+    doc.set("script", macro.rawScript);
+    doc.set("session_time", macro.sessionTime);
+    doc.set("count_method", macro.indexIsCountable ? "index" : "events");
+
+    auto indexNode = doc.setObject("index");
+    indexNode->set("captured", macro.capturedIndex);
+    indexNode->set("reduced", macro.rawIndex);
+
+    // the hint program Indexing runs (RPN) to build the customer selection
+    auto planNode = indexNode->setArray("plan");
+    for (auto& i : macro.index)
+    {
+        auto opNode = planNode->pushObject();
+        opNode->set("op", HintOperatorsDebug.find(i.op)->second);
+
+        if (i.op == HintOp_e::PUSH_TBL || i.op == HintOp_e::PUSH_VAL)
+            opNode->set("value", i.value.getString());
+    }
+
+    auto aggNode = doc.setArray("aggregates");
+    for (auto& v : macro.vars.columnVars)
+    {
+        auto agg = aggNode->pushObject();
+        agg->set("alias", v.alias);
+        agg->set("modifier", ModifierDebugStrings.find(v.modifier)->second);
+        if (v.column != -1)
+            agg->set("property", v.actual);
+        if (v.distinctColumnName != v.actual)
+            agg->set("distinct", v.distinctColumnName);
+    }
+
+    auto propNode = doc.setArray("properties");
+    for (auto& v : macro.vars.tableVars)
+        propNode->push(v.actual);
+
+    auto segmentNode = doc.setArray("segments");
+    for (auto& segment : macro.segments)
+        segmentNode->push(segment);
+
+    doc.set("instructions", static_cast<int64_t>(macro.code.size()));
+    doc.set("uses_sessions", macro.useSessions);
+    doc.set("uses_props", macro.useProps);
+
+    if (macro.stampFrom != LLONG_MIN || macro.stampTo != LLONG_MAX)
+    {
+        auto windowNode = doc.setObject("stamp_window");
+        windowNode->set("from", macro.stampFrom);
+        windowNode->set("to", macro.stampTo);
+    }
+
+    return doc;
+}
@@ -9,7 +9,11 @@
 #include "properties.h"
 #include "errors.h"
 #include "var/var.h"
+#include "cjson/cjson.h"
+#include "time/epoch.h"
+#include "segmentmath.h"
 #include <queue>
+#include <functional>
 
 namespace openset::query
 {
@@ -839,6 +843,7 @@ namespace openset::query
                 "||",
                 "&&",
                 "==",
+                "!=",
                 "=",
                 ">=",
                 "<=",
@@ -973,6 +978,12 @@ namespace openset::query
                 "sum",
                 "value",
                 "var",
+                "median",
+                "p50",
+                "p75",
+                "p90",
+                "p95",
+                "p99",
                 "code"
             };
 
@@ -1101,6 +1112,17 @@ namespace openset::query
 
                 const auto propInfo = tableColumns->getProperty(columnName);
 
+                // percentiles are sketched from values, text and bools have none to rank
+                if (PercentileModifiers.count(modifier) &&
+                    propInfo->type != db::PropertyTypes_e::intProp &&
+                    propInfo->type != db::PropertyTypes_e::doubleProp)
+                    throw QueryParse2Error_s {
+                        errors::errorClass_e::parse,
+                        errors::errorCode_e::syntax_error,
+                        "percentile aggregates need an int or double property",
+                        lastDebug
+                    };
+
                 Variable_s var(columnName, asName, "property", modifier);
                 var.distinctColumnName = keyColumn;
 
@@ -1550,6 +1572,13 @@ namespace openset::query
 
                 if (isMarshal(token))
                 {
+                    // session functions are computed from the session property
+                    if (SessionMarshals.count(token))
+                    {
+                        usesSessions = true;
+                        columnIndex("session");
+                    }
+
                     if (nextToken == "(")
                     {
                         const int beforeIdx = idx;
@@ -2315,6 +2344,26 @@ namespace openset::query
                     ++count;
                     ++idx;
                 }
+                else if (token == "__chain_sessions" && !isColumn)
+                {
+                    std::vector<std::pair<Blocks::Line,int>> params;
+                    idx = parseParams(words, idx + 1, params);
+
+                    if (params.size())
+                        throw QueryParse2Error_s {
+                            errors::errorClass_e::parse,
+                            errors::errorCode_e::syntax_error,
+                            ".sessions() takes no parameters",
+                            lastDebug
+                        };
+
+                    usesSessions = true;
+                    columnIndex("session");
+
+                    filter.isSessions = true;
+                    ++count;
+                    ++idx;
+                }
                 else if (token == "__chain_next" && !isColumn)
                 {
                     std::vector<std::pair<Blocks::Line,int>> params;
@@ -3148,6 +3197,7 @@ namespace openset::query
 
             // lets us know if we are read-only
             inMacros.writesProps = writesProps;
+            inMacros.useSessions = usesSessions;
 
             index = 0;
             for (auto& v : stringLiterals)
@@ -3165,6 +3215,34 @@ namespace openset::query
             inMacros.filters = filters;
         }
 
+        // `find(text_prop, "literal") != -1` (or `>= 0`, `> -1`) is a substring test the
+        // index can answer from attribute text. Returns the offset of the last token
+        // of the test, or -1 if this isn't one
+        int seekSubstringTest(const Blocks::Line& tokens, const int start) const
+        {
+            if (tokens[start] != "find" || start + 7 >= static_cast<int>(tokens.size()))
+                return -1;
+
+            if (tokens[start + 1] != "(" ||
+                !isTableColumn(tokens[start + 2]) ||
+                tokens[start + 3] != "," ||
+                !isString(tokens[start + 4]) ||
+                tokens[start + 5] != ")")
+                return -1;
+
+            const auto propInfo = tableColumns->getProperty(tokens[start + 2]);
+            if (!propInfo || propInfo->type != db::PropertyTypes_e::textProp)
+                return -1;
+
+            const auto& op = tokens[start + 6];
+            const auto& value = tokens[start + 7];
+
+            if ((op == "!=" && value == "-1") || (op == ">=" && value == "0") || (op == ">" && value == "-1"))
+                return start + 7;
+
+            return -1;
+        }
+
         bool processLogic()
         {
             bool countable = true;
@@ -3253,6 +3331,13 @@ namespace openset::query
                             continue;
 
                         }
+                        else if (const auto testEnd = seekSubstringTest(tokens, idx); testEnd != -1)
+                        {
+                            tokensUnchained.emplace_back(tokens[idx + 2]);
+                            tokensUnchained.emplace_back("[find]");
+                            tokensUnchained.emplace_back(tokens[idx + 4]);
+                            idx = testEnd;
+                        }
                         else if (isMarshal(token))
                         {
                             tokensUnchained.emplace_back("VOID");
@@ -3605,6 +3690,7 @@ namespace openset::query
                 "!=",
                 "[==]",
                 "[!=]",
+                "[find]",
                 ">",
                 "<",
                 "<=",
@@ -3723,6 +3809,192 @@ namespace openset::query
                 inMacros.rawIndex += word + " ";
         }
 
+        /* When every row the script can read is inside a `.range()` with constant
+         * bounds, rows outside those ranges can't change the result. The union of
+         * the ranges becomes the stamp window, those rows are not decoded and
+         * customers without rows in the window are skipped.
+         *
+         * Anything that could see the rest of a customer's history leaves the window
+         * open: property reads or `tally` outside a ranged scope, unranged row
+         * iteration, `.from(row)`, `.sessions()`, row numbers, whole history and
+         * session functions and customer props. Only event queries use the window.
+         */
+        void compileStampWindow(Macro_s& inMacros) const
+        {
+            if (inMacros.useProps)
+                return;
+
+            static const std::unordered_set<Marshals_e> historyMarshals {
+                Marshals_e::marshal_row,
+                Marshals_e::marshal_first_stamp,
+                Marshals_e::marshal_last_stamp,
+                Marshals_e::marshal_row_count,
+                Marshals_e::marshal_session_count,
+                Marshals_e::marshal_session_start,
+                Marshals_e::marshal_session_end,
+                Marshals_e::marshal_session_duration,
+                Marshals_e::marshal_session_length,
+                Marshals_e::marshal_get_row,
+            };
+
+            for (const auto marshal : inMacros.marshalsReferenced)
+                if (historyMarshals.count(marshal))
+                    return;
+
+            const auto& code = inMacros.code;
+            const auto& filters = inMacros.filters;
+
+            int64_t from = LLONG_MAX;
+            int64_t to = LLONG_MIN;
+
+            // stamp returned by a block that is a single literal
+            const auto literalStamp = [&](const int block, int64_t& stamp) -> bool
+            {
+                const auto offset = static_cast<size_t>(inMacros.lambdas[block]) + 1; // past the LAMBDA
+
+                if (offset + 1 >= code.size() || code[offset + 1].op != OpCode_e::RETURN)
+                    return false;
+
+                if (code[offset].op == OpCode_e::PSHLITINT)
+                {
+                    stamp = Epoch::fixMilli(code[offset].value);
+                    return true;
+                }
+
+                if (code[offset].op == OpCode_e::PSHLITSTR)
+                {
+                    const auto& text = inMacros.vars.literals[code[offset].index].value;
+                    if (!Epoch::isISO8601(text))
+                        return false;
+                    stamp = Epoch::ISO8601ToEpoch(text);
+                    return stamp != -1;
+                }
+
+                return false;
+            };
+
+            // widens the window by the filter range, false if the range isn't constant
+            const auto addRange = [&](const Filter_s& filter) -> bool
+            {
+                int64_t start, end;
+
+                if (!filter.isRange ||
+                    !literalStamp(filter.rangeStartBlock, start) ||
+                    !literalStamp(filter.rangeEndBlock, end))
+                    return false;
+
+                from = std::min(from, std::min(start, end));
+                to = std::max(to, std::max(start, end));
+                return true;
+            };
+
+            // `scoped` is true when the row cursor can only be on rows inside a range
+            std::function<bool(int, bool)> walk;
+
+            // blocks a filter runs with the caller's cursor, and the per row test
+            const auto walkFilter = [&](const Filter_s& filter, const bool scoped) -> bool
+            {
+                return (filter.limitBlock == -1 || walk(filter.limitBlock, scoped)) &&
+                    (filter.withinStartBlock == -1 || walk(filter.withinStartBlock, scoped)) &&
+                    (filter.withinWindowBlock == -1 || walk(filter.withinWindowBlock, scoped)) &&
+                    (filter.evalBlock == -1 || walk(filter.evalBlock, true));
+            };
+
+            walk = [&](const int block, const bool scoped) -> bool
+            {
+                // block zero is the main code, it has no LAMBDA
+                for (auto offset = static_cast<size_t>(inMacros.lambdas[block]) + (block ? 1 : 0); offset < code.size(); ++offset)
+                {
+                    const auto& inst = code[offset];
+
+                    switch (inst.op)
+                    {
+                    case OpCode_e::RETURN:
+                    case OpCode_e::TERM:
+                        return true;
+
+                    case OpCode_e::PSHTBLCOL:
+                        if (!scoped)
+                            return false;
+                        break;
+
+                    case OpCode_e::MARSHAL:
+                        if (!scoped && static_cast<Marshals_e>(inst.index) == Marshals_e::marshal_tally)
+                            return false;
+                        break;
+
+                    case OpCode_e::PSHTBLFLT:
+                    {
+                        // property filters without a range inherit the range of the scope
+                        const auto& filter = filters[inst.value];
+
+                        if (filter.isContinue && filter.continueBlock != -1)
+                            return false;
+
+                        if (filter.isRange ? !addRange(filter) : !scoped)
+                            return false;
+
+                        if (!walkFilter(filter, scoped))
+                            return false;
+                    }
+                    break;
+
+                    case OpCode_e::CALL_EACH:
+                    case OpCode_e::CALL_SUM:
+                    case OpCode_e::CALL_AVG:
+                    case OpCode_e::CALL_MIN:
+                    case OpCode_e::CALL_MAX:
+                    case OpCode_e::CALL_CNT:
+                    case OpCode_e::CALL_DCNT:
+                    case OpCode_e::CALL_TST:
+                    {
+                        // row iterators always need their own range
+                        const auto& filter = filters[inst.value];
+
+                        if (filter.isContinue && filter.continueBlock != -1)
+                            return false;
+
+                        // a session can start before the window
+                        if (filter.isSessions)
+                            return false;
+
+                        if (!addRange(filter) || !walkFilter(filter, scoped))
+                            return false;
+
+                        if (!walk(static_cast<int>(inst.index), true) ||
+                            (inst.extra != -1 && !walk(static_cast<int>(inst.extra), true)))
+                            return false;
+                    }
+                    break;
+
+                    case OpCode_e::CALL_IF:
+                        if (!walk(static_cast<int>(inst.index), scoped) || !walk(static_cast<int>(inst.extra), scoped))
+                            return false;
+                        break;
+
+                    case OpCode_e::CALL_FOR:
+                        if (!walk(static_cast<int>(inst.index), scoped))
+                            return false;
+                        break;
+
+                    case OpCode_e::CALL_ROW: // returns a row number
+                        return false;
+
+                    default:
+                        break;
+                    }
+                }
+
+                return true;
+            };
+
+            if (!walk(0, false) || from > to)
+                return;
+
+            inMacros.stampFrom = from;
+            inMacros.stampTo = to;
+        }
+
         bool compileQuery(const std::string& query, openset::db::Properties* columnsPtr, Macro_s& inMacros, ParamVars* templateVars)
         {
 
@@ -3756,6 +4028,10 @@ namespace openset::query
 
                 compile(inMacros);
                 compileIndex(inMacros);
+                compileStampWindow(inMacros);
+
+                // scripts that only combine other segments are calculated without the interpreter
+                SegmentMath::compile(inMacros);
 
                 return true;
             }
@@ -3925,6 +4201,8 @@ namespace openset::query
     };
 
     string MacroDbg(Macro_s& macro);
+    // JSON version of the plan parts of MacroDbg (index hints, aggregates, etc.)
+    cjson MacroExplain(Macro_s& macro);
 
 };
 
@@ -1,9 +1,12 @@
 ﻿#include "result.h"
 #include <algorithm>
+#include <cmath>
 #include <sstream>
 #include "cjson/cjson.h"
+#include "sba/sba.h"
 //#include "mem/bigring.h"
 #include "tablepartitioned.h"
+#include "oloop_merge.h"
 
 using namespace openset::result;
 
@@ -169,6 +172,9 @@ void mergeResultTypes(
 {
     const size_t resultWidth = resultSets[0]->resultWidth;
     std::vector<ResultTypes_e> accTypes(resultWidth);
+    // sets that never ran the query (i.e. empty partitions) report `sum` for every
+    // column, modifiers are merged like types so a sketch is never summed
+    std::vector<openset::query::Modifiers_e> accModifiers(resultWidth, openset::query::Modifiers_e::sum);
 
     for (auto& a : accTypes)
         a = ResultTypes_e::Int;
@@ -182,10 +188,17 @@ void mergeResultTypes(
             if (a != ResultTypes_e::Int)
                 accTypes[idx] = a;
         }
+
+        for (size_t i = 0; i < s->accModifiers.size() && i < resultWidth; ++i)
+            if (s->accModifiers[i] != openset::query::Modifiers_e::sum)
+                accModifiers[i] = s->accModifiers[i];
     }
 
     for (auto s : resultSets)
+    {
         s->accTypes = accTypes;
+        s->accModifiers = accModifiers;
+    }
 }
 
 robin_hood::unordered_map<int64_t, const char*, robin_hood::hash<int64_t>> mergeResultText(
@@ -212,104 +225,81 @@ robin_hood::unordered_map<int64_t, const char*, robin_hood::hash<int64_t>> merge
 * STL was used here because it has great iterators, but a little is lost in
 * readabilty. I apologize in advance for the **blah stuff.
 *
-* Step one make a vector of iterators for each result in the results vector.
+* Step one make a vector of ranges, one for each result in the results vector
 * (note, the results vector contains vectors of sorted results).
 *
 * Step two, iterate until there are no items remaining to be merged.
 *
-* The iteration step evaluates each result iterator (at it's current location)
+* The iteration step evaluates each result range (at it's current location)
 * to decide if it has the lowest value (our key type has comparison operators
 * overloaded for this purpose).
 *
-* After all iterators have been checked the one with the lowest value is either
+* After all ranges have been checked the one with the lowest value is either
 * pushed into the merged list, or if it has the same key as last item in the
 * merged list, it is instead summed into that item.
 *
 * When 'lowestIdx' is equal to end() it means all results passed to merge
 * have been merged.
 */
-ResultSet::RowVector mergeResultSets(
+using RowRange = std::pair<ResultSet::RowVector::iterator, ResultSet::RowVector::iterator>;
+
+ResultSet::RowVector mergeRowRanges(
     const int resultColumnCount,
     const int resultSetCount,
-    std::vector<openset::result::ResultSet*>& resultSets)
+    const std::vector<openset::query::Modifiers_e>& modifiers,
+    std::vector<RowRange>& ranges)
 {
-    mergeResultTypes(resultSets);
-
-    vector<ResultSet::RowVector*> mergeList;
-
-    auto count = 0;
-
-    for (auto& r : resultSets)
-    {
-        // sort the list
-        r->makeSortedList();
-
-        // if no data, skip
-        if (!r->sortedResult.size())
-            continue;
-
-        // add it the merge list
-        mergeList.push_back(&r->sortedResult);
-        count += static_cast<int>(r->sortedResult.size());
-    }
+    size_t count = 0;
+    for (const auto& range : ranges)
+        count += static_cast<size_t>(range.second - range.first);
 
     ResultSet::RowVector merged;
     merged.reserve(count);
 
-    if (mergeList.size() == 0)
+    if (ranges.size() == 0)
         return merged;
 
-    vector<ResultSet::RowVector::iterator> iterators;
-    iterators.reserve(mergeList.size());
-
     const auto shiftIterations = resultSetCount ? resultSetCount : 1;
     const auto shiftSize       = resultColumnCount;
 
-    // get an iterator the beginning of each result in results
-    for (auto r : mergeList)
-        iterators.emplace_back(r->begin());
-
-    auto& modifiers = resultSets[0]->accModifiers;
-
     while (true)
     {
-        auto lowestIdx = iterators.end();
-        auto idx       = 0;
+        auto lowestIdx = ranges.end();
 
-        // we have an iterator of iterators (it)
-        // we have multiple iterators from multiple results, we are looking for
+        // we have an iterator of ranges (it)
+        // we have multiple ranges from multiple results, we are looking for
         // the one with the lowest key.
-        for (auto it = iterators.begin(); it != iterators.end(); ++it, ++idx)
+        for (auto it = ranges.begin(); it != ranges.end(); ++it)
         {
             // get the iterator for the result set pointed to by "it"
-            const auto t = (*it);
+            const auto t = it->first;
 
-            if (t == mergeList[idx]->end()) // this iterator is done, so skip
+            if (t == it->second) // this range is done, so skip
                 continue;
 
             // is it less than equal or
             // not set (lowestIdx defaults to end(), so not set)
-            if (lowestIdx == iterators.end() ||
-                (*t).first < (**lowestIdx).first ||
-                (*t).first == (**lowestIdx).first)
+            if (lowestIdx == ranges.end() ||
+                (*t).first < (*lowestIdx->first).first ||
+                (*t).first == (*lowestIdx->first).first)
             {
                 lowestIdx = it;
             }
         }
 
-        if (lowestIdx != iterators.end())
+        if (lowestIdx != ranges.end())
         {
             if (merged.size() == 0)
             {
-                merged.push_back(**lowestIdx);
+                merged.push_back(*lowestIdx->first);
             }
             else
             {
-                if (merged.back().first == (**lowestIdx).first)
+                if (merged.back().first == (*lowestIdx->first).first)
                 {
                     // make lambda or function
                     auto& left  = merged.back().second;
-                    auto& right = (**lowestIdx).second;
+                    auto& right = (*lowestIdx->first).second;
 
                     for (auto shiftCount = 0, shiftOffset = 0; shiftCount < shiftIterations; ++shiftCount, shiftOffset
                          += shiftSize)
@@ -357,6 +347,16 @@ ResultSet::RowVector mergeResultSets(
                                         left->columns[valueIndex].value += right->columns[valueIndex].value;
                                         left->columns[valueIndex].count += right->columns[valueIndex].count;
                                         break;
+                                    case openset::query::Modifiers_e::median:
+                                    case openset::query::Modifiers_e::p75:
+                                    case openset::query::Modifiers_e::p90:
+                                    case openset::query::Modifiers_e::p95:
+                                    case openset::query::Modifiers_e::p99:
+                                        // value holds a sketch pointer, merge the sketches
+                                        recast<QuantileSketch_s*>(left->columns[valueIndex].value)->merge(
+                                            recast<QuantileSketch_s*>(right->columns[valueIndex].value));
+                                        left->columns[valueIndex].count += right->columns[valueIndex].count;
+                                        break;
                                     default: ;
                                     }
                                 }
@@ -366,12 +366,12 @@ ResultSet::RowVector mergeResultSets(
                 }
                 else
                 {
-                    merged.push_back(**lowestIdx);
+                    merged.push_back(*lowestIdx->first);
                 }
             }
 
-            // increment the iterator pointed to by lowestIdx in our list of iterators
-            ++(*lowestIdx);
+            // advance the range pointed to by lowestIdx
+            ++lowestIdx->first;
         }
         else
         {
@@ -383,6 +383,87 @@ ResultSet::RowVector mergeResultSets(
     return merged;
 }
 
+ResultSet::RowVector mergeResultSets(
+    const int resultColumnCount,
+    const int resultSetCount,
+    std::vector<openset::result::ResultSet*>& resultSets)
+{
+    ResultMuxDemux::prepareMerge(resultSets);
+    return ResultMuxDemux::mergeResultRange(resultColumnCount, resultSetCount, resultSets, nullptr, nullptr);
+}
+
+int64_t ResultMuxDemux::prepareMerge(std::vector<openset::result::ResultSet*>& resultSets)
+{
+    mergeResultTypes(resultSets);
+
+    int64_t count = 0;
+
+    for (auto& r : resultSets)
+    {
+        // sort the list
+        r->makeSortedList();
+        count += static_cast<int64_t>(r->sortedResult.size());
+    }
+
+    return count;
+}
+
+std::vector<RowKey> ResultMuxDemux::mergeSplitters(
+    const std::vector<openset::result::ResultSet*>& resultSets,
+    const int shards)
+{
+    // the largest set stands in for the key space, keys at even steps
+    // through it split the space into ranges of about the same size
+    const ResultSet* largest = nullptr;
+    for (const auto r : resultSets)
+        if (!largest || r->sortedResult.size() > largest->sortedResult.size())
+            largest = r;
+
+    std::vector<RowKey> splitters;
+
+    if (!largest || largest->sortedResult.empty() || shards < 2)
+        return splitters;
+
+    const auto size = largest->sortedResult.size();
+
+    for (auto i = 1; i < shards; ++i)
+    {
+        const auto& key = largest->sortedResult[size * i / shards].first;
+        if (splitters.empty() || splitters.back() < key)
+            splitters.push_back(key);
+    }
+
+    return splitters;
+}
+
+ResultSet::RowVector ResultMuxDemux::mergeResultRange(
+    const int resultColumnCount,
+    const int resultSetCount,
+    std::vector<openset::result::ResultSet*>& resultSets,
+    const RowKey* low,
+    const RowKey* high)
+{
+    const auto byKey = [](const ResultSet::RowPair& row, const RowKey& key) -> bool
+    {
+        return row.first < key;
+    };
+
+    std::vector<RowRange> ranges;
+
+    for (auto& r : resultSets)
+    {
+        auto& rows = r->sortedResult;
+        const auto first = low ? std::lower_bound(rows.begin(), rows.end(), *low, byKey) : rows.begin();
+        const auto last = high ? std::lower_bound(first, rows.end(), *high, byKey) : rows.end();
+
+        // if no data, skip
+        if (first != last)
+            ranges.emplace_back(first, last);
+    }
+
+    return mergeRowRanges(resultColumnCount, resultSetCount, resultSets[0]->accModifiers, ranges);
+}
+
 void ResultMuxDemux::mergeMacroLiterals(
     const openset::query::Macro_s macros,
     std::vector<openset::result::ResultSet*>& resultSets)
@@ -440,6 +521,12 @@ char* ResultMuxDemux::multiSetToInternode(
 
     const auto accumulatorSize = resultWidth * sizeof(Accumulation_s);
 
+    // percentile columns hold sketch pointers, the sketches follow the accumulator
+    std::vector<int> sketchColumns;
+    for (auto i = 0; i < static_cast<int>(resultWidth); ++i)
+        if (query::PercentileModifiers.count(resultSets[0]->accModifiers[i]))
+            sketchColumns.push_back(i);
+
     // iterate the result set
     for (const auto r : rows)
     {
@@ -451,6 +538,19 @@ char* ResultMuxDemux::multiSetToInternode(
         // copy the values
         memcpy(keyPtr, r.first.key, sizeof(openset::result::RowKey));
         memcpy(accumulatorPtr, r.second->columns, accumulatorSize);
+
+        // compressed sketches, in column order, for columns that have a value
+        for (const auto column : sketchColumns)
+        {
+            if (r.second->columns[column].value == NONE)
+                continue;
+
+            const auto sketch = recast<QuantileSketch_s*>(r.second->columns[column].value);
+            sketch->compress();
+
+            const auto packed = sketch->packedBytes();
+            memcpy(mem.newPtr(packed), sketch, packed);
+        }
     }
 
     // lets encode the text.
@@ -479,6 +579,45 @@ char* ResultMuxDemux::multiSetToInternode(
     return mem.flatten();
 }
 
+char* ResultMuxDemux::appendAnalyze(char* buffer, int64_t& bufferLength, cjson* stats)
+{
+    int64_t jsonLength;
+    const auto jsonText = cjson::stringifyCstr(stats, jsonLength, false);
+
+    const auto newLength = bufferLength + jsonLength + 8 + 2;
+    const auto newBuffer = static_cast<char*>(PoolMem::getPool().getPtr(newLength));
+
+    auto write = newBuffer;
+    memcpy(write, buffer, bufferLength);
+    write += bufferLength;
+    memcpy(write, jsonText, jsonLength);
+    write += jsonLength;
+    *recast<int64_t*>(write) = jsonLength;
+    write += 8;
+    write[0] = 0x03;
+    write[1] = 0x04;
+
+    cjson::releaseStringifyPtr(jsonText);
+    PoolMem::getPool().freePtr(buffer);
+
+    bufferLength = newLength;
+    return newBuffer;
+}
+
+bool ResultMuxDemux::getAnalyze(const char* data, const int64_t blockLength, cjson* stats)
+{
+    if (!data || blockLength < 10 || data[blockLength - 2] != 0x03 || data[blockLength - 1] != 0x04)
+        return false;
+
+    const auto jsonLength = *recast<const int64_t*>(data + blockLength - 10);
+
+    if (jsonLength <= 0 || jsonLength > blockLength - 10)
+        return false;
+
+    cjson::parse(std::string(data + blockLength - 10 - jsonLength, jsonLength), stats, true);
+    return true;
+}
+
 bool ResultMuxDemux::isInternode(
     char* data,
     const int64_t blockLength)
@@ -531,6 +670,11 @@ openset::result::ResultSet* ResultMuxDemux::internodeToResultSet(
 
     const auto accumulatorSize = resultWidth * sizeof(Accumulation_s);
 
+    std::vector<int> sketchColumns;
+    for (auto i = 0; i < static_cast<int>(resultWidth); ++i)
+        if (query::PercentileModifiers.count(result->accModifiers[i]))
+            sketchColumns.push_back(i);
+
     for (auto i = 0; i < blockCount; ++i)
     {
         if (read >= end)
@@ -542,6 +686,21 @@ openset::result::ResultSet* ResultMuxDemux::internodeToResultSet(
         auto accumulatorPtr = recast<openset::result::Accumulator*>(read);
         read += accumulatorSize;
 
+        // sketches are unpacked to full size (they grow when merged) and the
+        // accumulator value is pointed at the copy
+        for (const auto column : sketchColumns)
+        {
+            if (accumulatorPtr->columns[column].value == NONE)
+                continue;
+
+            const auto packed = recast<QuantileSketch_s*>(read);
+            const auto sketch = result->newSketch();
+            memcpy(sketch, packed, packed->packedBytes());
+            read += sketch->packedBytes();
+
+            accumulatorPtr->columns[column].value = recast<int64_t>(sketch);
+        }
+
         result->sortedResult.emplace_back(*keyPtr, accumulatorPtr);
     }
 
@@ -562,51 +721,39 @@ openset::result::ResultSet* ResultMuxDemux::internodeToResultSet(
     return result;
 }
 
-void ResultMuxDemux::resultSetToJson(
-    const int resultColumnCount,
-    const int resultSetCount,
-    std::vector<openset::result::ResultSet*>& resultSets,
-    cjson* doc)
+// appends rows [first, last) to `current` (a "_" array), rows with deeper keys
+// become branches of the row before them
+void rowsToJson(
+    cjson* current,
+    const ResultSet::RowVector::iterator first,
+    const ResultSet::RowVector::iterator last,
+    const int shiftIterations,
+    const int shiftSize,
+    const std::vector<ResultTypes_e>& types,
+    const std::vector<openset::query::Modifiers_e>& modifiers,
+    const std::function<const char*(int64_t)>& getText,
+    const double sample)
 {
-    auto mergedText = mergeResultText(resultSets);
-    auto rows       = mergeResultSets(resultColumnCount, resultSetCount, resultSets);
-
-    const auto shiftIterations = resultSetCount ? resultSetCount : 1;
-    const auto shiftSize       = resultColumnCount;
-
-    // this will retrieve either the string literals from the macros,
-    // the merged localText or exorcise a lock and look in the blob
-    const auto getText = [&](int64_t valueHash) -> const char*
-    {
-        if (const auto textPair = mergedText.find(valueHash); textPair != mergedText.end())
-            return textPair->second;
-
-        // nothing found, NA_TEXT
-        return NA_TEXT;
-    };
-
     RowKey lastKey {};
     lastKey.clear();
 
-    // we are going to move the root down a node
-    auto current = doc->pushArray();
-    current->setName("_");
-
-    auto maxDepth = 0;
-    for (auto& r : rows)
+    // Sampled results are scaled by 1/sample. Margins are approximate: counts treat
+    // every counted item as sampled independently, and sums also assume the summed
+    // values are of similar size. Customers are sampled as a whole, so items that
+    // always occur together make the true interval wider.
+    const auto sampled = sample > 0.0 && sample < 1.0;
+    const auto countMargin = [sample](const double count) -> double
     {
-        const auto depth = r.first.getDepth();
-        if (depth > maxDepth)
-            maxDepth = depth;
-    }
-
-    auto& modifiers = resultSets[0]->accModifiers;
-    auto& types     = resultSets[0]->accTypes;
+        return 1.96 * std::sqrt(count * (1.0 - sample)) / sample;
+    };
+    const auto sumMargin = [sample](const double estimate, const int64_t count) -> double
+    {
+        return count ? 1.96 * std::abs(estimate) * std::sqrt((1.0 - sample) / count) : 0.0;
+    };
 
-    auto rowCounter = -1;
-    for (auto& r : rows)
+    for (auto iter = first; iter != last; ++iter)
     {
-        ++rowCounter;
+        auto& r = *iter;
 
         // currentKey is r.first if that makes reading this easier :)
         auto& currentKey = r.first;
@@ -667,12 +814,36 @@ void ResultMuxDemux::resultSetToJson(
             // one result properties branch will be "c", if multiple it will be "c", "c2", "c3", "c4"
             array->setName(!shiftCount ? "c" : "c" + to_string(shiftCount + 1));
 
+            // margins follow the same naming, "e", "e2"...
+            const auto margins = sampled ? entry->pushArray() : nullptr;
+            if (margins)
+                margins->setName(!shiftCount ? "e" : "e" + to_string(shiftCount + 1));
+
             for (auto dataIndex = shiftOffset, colIndex = 0; dataIndex < shiftOffset + shiftSize; ++dataIndex, ++
                  colIndex)
             {
                 const auto& value = r.second->columns[dataIndex].value;
                 const auto& count = r.second->columns[dataIndex].count;
 
+                if (margins)
+                {
+                    const auto isScaled =
+                        modifiers[colIndex] == openset::query::Modifiers_e::sum ||
+                        modifiers[colIndex] == openset::query::Modifiers_e::count ||
+                        modifiers[colIndex] == openset::query::Modifiers_e::dist_count_person;
+
+                    if (!isScaled)
+                        margins->pushNull();
+                    else if (value == NONE)
+                        margins->push(0.0);
+                    else if (modifiers[colIndex] == openset::query::Modifiers_e::sum)
+                        margins->push(sumMargin(
+                            (types[colIndex] == ResultTypes_e::Double ? value / 10000.0 : static_cast<double>(value)) / sample,
+                            count));
+                    else
+                        margins->push(countMargin(static_cast<double>(value)));
+                }
+
                 // Is this a null, a double, a string or anything else (ints)
                 if (r.second->columns[dataIndex].value == NONE)
                 {
@@ -682,19 +853,32 @@ void ResultMuxDemux::resultSetToJson(
                     else
                         array->pushNull();
                 }
+                else if (sampled && modifiers[colIndex] == openset::query::Modifiers_e::sum)
+                {
+                    if (types[colIndex] == ResultTypes_e::Double)
+                        array->push((value / 10000.0) / sample);
+                    else
+                        array->push(static_cast<int64_t>(std::llround(value / sample)));
+                }
+                else if (sampled && (
+                    modifiers[colIndex] == openset::query::Modifiers_e::count ||
+                    modifiers[colIndex] == openset::query::Modifiers_e::dist_count_person))
+                {
+                    array->push(static_cast<int64_t>(std::llround(value / sample)));
+                }
                 else
                 {
                     switch (modifiers[colIndex])
                     {
-                    case query::Modifiers_e::sum:
-                    case query::Modifiers_e::min:
-                    case query::Modifiers_e::max:
+                    case openset::query::Modifiers_e::sum:
+                    case openset::query::Modifiers_e::min:
+                    case openset::query::Modifiers_e::max:
                         if (types[colIndex] == ResultTypes_e::Double)
                             array->push(value / 10000.0);
                         else
                             array->push(value);
                         break;
-                    case query::Modifiers_e::avg:
+                    case openset::query::Modifiers_e::avg:
                         if (!count)
                             array->pushNull();
                         else if (types[colIndex] == ResultTypes_e::Double)
@@ -702,11 +886,25 @@ void ResultMuxDemux::resultSetToJson(
                         else
                             array->push(value / static_cast<double>(count));
                         break;
-                    case query::Modifiers_e::count:
-                    case query::Modifiers_e::dist_count_person:
+                    case openset::query::Modifiers_e::count:
+                    case openset::query::Modifiers_e::dist_count_person:
                         array->push(value);
                         break;
-                    case query::Modifiers_e::value:
+                    case openset::query::Modifiers_e::median:
+                    case openset::query::Modifiers_e::p75:
+                    case openset::query::Modifiers_e::p90:
+                    case openset::query::Modifiers_e::p95:
+                    case openset::query::Modifiers_e::p99:
+                    {
+                        const auto estimate = recast<QuantileSketch_s*>(value)->quantile(
+                            openset::query::PercentileModifiers.at(modifiers[colIndex]));
+                        if (types[colIndex] == ResultTypes_e::Double)
+                            array->push(estimate / 10000.0);
+                        else
+                            array->push(estimate);
+                    }
+                    break;
+                    case openset::query::Modifiers_e::value:
                         if (types[colIndex] == ResultTypes_e::Text)
                             array->push(getText(value));
                         else if (types[colIndex] == ResultTypes_e::Double)
@@ -716,7 +914,7 @@ void ResultMuxDemux::resultSetToJson(
                         else
                             array->push(value);
                         break;
-                    case query::Modifiers_e::var:
+                    case openset::query::Modifiers_e::var:
                     {
                         if (types[colIndex] == ResultTypes_e::Text)
                             array->push(getText(value));
@@ -738,8 +936,8 @@ void ResultMuxDemux::resultSetToJson(
 
         // check to see if the next row is wider (rows[count+1].first is next key)
         // if it is, lets add a nesting level and set current to that level
-        if (rowCounter < static_cast<int>(rows.size()) - 1 &&
-            rows[rowCounter + 1].first.getDepth() > currentKey.getDepth())
+        if (iter + 1 != last &&
+            (iter + 1)->first.getDepth() > currentKey.getDepth())
         {
             current = entry->pushArray();
             current->setName("_");
@@ -747,6 +945,21 @@ void ResultMuxDemux::resultSetToJson(
 
         lastKey = r.first;
     }
+}
+
+void ResultMuxDemux::resultSetToJson(
+    const int resultColumnCount,
+    const int resultSetCount,
+    std::vector<openset::result::ResultSet*>& resultSets,
+    cjson* doc,
+    const double sample,
+    const bool parallelMerge)
+{
+    auto rows = parallelMerge ?
+        openset::async::OpenLoopMerge::merge(resultColumnCount, resultSetCount, resultSets) :
+        mergeResultSets(resultColumnCount, resultSetCount, resultSets);
+
+    resultRowsToJson(resultColumnCount, resultSetCount, resultSets, rows, doc, sample);
 
     /*
     if (macros.isSegment)
@@ -777,6 +990,157 @@ void ResultMuxDemux::resultSetToJson(
     */
 }
 
+void ResultMuxDemux::resultRowsToJson(
+    const int resultColumnCount,
+    const int resultSetCount,
+    std::vector<openset::result::ResultSet*>& resultSets,
+    ResultSet::RowVector& rows,
+    cjson* doc,
+    const double sample)
+{
+    auto mergedText = mergeResultText(resultSets);
+
+    const auto shiftIterations = resultSetCount ? resultSetCount : 1;
+    const auto shiftSize       = resultColumnCount;
+
+    // this will retrieve either the string literals from the macros,
+    // the merged localText or exorcise a lock and look in the blob
+    const auto getText = [&](int64_t valueHash) -> const char*
+    {
+        if (const auto textPair = mergedText.find(valueHash); textPair != mergedText.end())
+            return textPair->second;
+
+        // nothing found, NA_TEXT
+        return NA_TEXT;
+    };
+
+    // we are going to move the root down a node
+    auto current = doc->pushArray();
+    current->setName("_");
+
+    rowsToJson(
+        current,
+        rows.begin(),
+        rows.end(),
+        shiftIterations,
+        shiftSize,
+        resultSets[0]->accTypes,
+        resultSets[0]->accModifiers,
+        getText,
+        sample);
+}
+
+bool ResultMuxDemux::resultSetToJsonStream(
+    const int resultColumnCount,
+    const int resultSetCount,
+    std::vector<openset::result::ResultSet*>& resultSets,
+    const ResultSortMode_e sortMode,
+    const ResultSortOrder_e sortOrder,
+    const int sortColumn,
+    const int trim,
+    const bool trimTop,
+    const double sample,
+    const std::function<bool(const std::string&)>& emit,
+    const bool parallelMerge)
+{
+    auto mergedText = mergeResultText(resultSets);
+    auto rows       = parallelMerge ?
+        openset::async::OpenLoopMerge::merge(resultColumnCount, resultSetCount, resultSets) :
+        mergeResultSets(resultColumnCount, resultSetCount, resultSets);
+
+    const auto shiftIterations = resultSetCount ? resultSetCount : 1;
+    const auto shiftSize       = resultColumnCount;
+    const auto& types          = resultSets[0]->accTypes;
+    const auto& modifiers      = resultSets[0]->accModifiers;
+
+    const auto getText = [&](int64_t valueHash) -> const char*
+    {
+        if (const auto textPair = mergedText.find(valueHash); textPair != mergedText.end())
+            return textPair->second;
+        return NA_TEXT;
+    };
+
+    const auto sortAndTrim = [&](cjson* doc, const bool trimDoc)
+    {
+        switch (sortMode)
+        {
+        case ResultSortMode_e::key:
+            jsonResultSortByGroup(doc, sortOrder);
+            break;
+        case ResultSortMode_e::column:
+            jsonResultSortByColumn(doc, sortOrder, sortColumn);
+            break;
+        default: ;
+        }
+        if (trimDoc)
+            jsonResultTrim(doc, trim);
+    };
+
+    // merged keys sort parents ahead of their children, so a top level group is
+    // a depth one row and the rows up to the next one. <first, last>
+    std::vector<std::pair<int64_t, int64_t>> groups;
+    for (auto i = 0; i < static_cast<int>(rows.size()); ++i)
+    {
+        if (rows[i].first.getDepth() != 1)
+            continue;
+        if (!groups.empty())
+            groups.back().second = i;
+        groups.emplace_back(i, static_cast<int64_t>(rows.size()));
+    }
+
+    // order the groups by their top level rows alone, the same way the whole
+    // document would be sorted and trimmed
+    cjson top;
+    const auto topList = top.pushArray();
+    topList->setName("_");
+
+    for (const auto& group : groups)
+        rowsToJson(
+            topList,
+            rows.begin() + group.first,
+            rows.begin() + group.first + 1,
+            shiftIterations,
+            shiftSize,
+            types,
+            modifiers,
+            getText,
+            sample);
+
+    auto groupIndex = 0;
+    for (auto entry : topList->getNodes())
+        entry->set("i", groupIndex++);
+
+    sortAndTrim(&top, trimTop);
+
+    // then build, sort and emit each group on its own
+    for (auto entry : topList->getNodes())
+    {
+        const auto& group = groups[entry->xPathInt("/i", 0)];
+
+        cjson branch;
+        const auto branchList = branch.pushArray();
+        branchList->setName("_");
+
+        rowsToJson(
+            branchList,
+            rows.begin() + group.first,
+            rows.begin() + group.second,
+            shiftIterations,
+            shiftSize,
+            types,
+            modifiers,
+            getText,
+            sample);
+
+        sortAndTrim(&branch, true);
+
+        if (!emit(cjson::stringify(branchList->at(0))))
+            return false;
+    }
+
+    return true;
+}
+
 void ResultMuxDemux::jsonResultHistogramFill(
     cjson* doc,
     const int64_t bucket,
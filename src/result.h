@@ -11,6 +11,7 @@
 #include "querycommon.h"
 #include "table.h"
 #include "errors.h"
+#include "sketch.h"
 
 namespace openset
 {
@@ -206,6 +207,15 @@ namespace openset
 
             Accumulator* getMakeAccumulator(RowKey& key);
 
+            // percentile columns hold a pointer to one of these in their accumulator value,
+            // the sketch lives in `mem` with the rest of the result set
+            QuantileSketch_s* newSketch()
+            {
+                const auto sketch = recast<QuantileSketch_s*>(mem.newPtr(sizeof(QuantileSketch_s)));
+                sketch->init();
+                return sketch;
+            }
+
             // this is a cache of text values local to our partition (thread), blob requires
             // a lock, whereas this does not, we will merge them after.
             void addLocalText(const int64_t hashId, cvar& value)
@@ -296,15 +306,67 @@ namespace openset
 
             static bool isInternode(char* data, int64_t blockLength);
 
+            // EXPLAIN ANALYZE - fork nodes append their stats to the internode block
+            // as [internode block][JSON][int64 JSON length][0x03 0x04]. internodeToResultSet
+            // reads by count, so it never sees the trailer. Frees `buffer` and returns a new one.
+            static char* appendAnalyze(char* buffer, int64_t& bufferLength, cjson* stats);
+            static bool getAnalyze(const char* data, int64_t blockLength, cjson* stats);
+
             static ResultSet* internodeToResultSet(
                 char* data,
                 int64_t blockLength);
 
+            // merging in pieces (see OpenLoopMerge). prepareMerge sorts the sets and
+            // returns the row count, mergeSplitters picks up to `shards` - 1 keys that
+            // split the key space, mergeResultRange merges the keys in [low, high),
+            // a null bound is open
+            static int64_t prepareMerge(std::vector<ResultSet*>& resultSets);
+            static std::vector<RowKey> mergeSplitters(const std::vector<ResultSet*>& resultSets, int shards);
+            static ResultSet::RowVector mergeResultRange(
+                int resultColumnCount,
+                int resultSetCount,
+                std::vector<ResultSet*>& resultSets,
+                const RowKey* low,
+                const RowKey* high);
+
+            // `sample` < 1 scales sums and counts up from a sampled query and adds
+            // "e" branches holding the margin of a 95% interval for each column.
+            // `parallelMerge` merges large results on the async workers, never
+            // set it from a thread that is itself an async worker
             static void resultSetToJson(
                 int resultColumnCount,
                 int resultSetCount,
                 std::vector<ResultSet*>& resultSets,
-                cjson* doc);
+                cjson* doc,
+                double sample = 1.0,
+                bool parallelMerge = false);
+
+            // the second half of resultSetToJson, for rows that are already merged
+            // (i.e. the ranges of mergeResultRange put back together)
+            static void resultRowsToJson(
+                int resultColumnCount,
+                int resultSetCount,
+                std::vector<ResultSet*>& resultSets,
+                ResultSet::RowVector& rows,
+                cjson* doc,
+                double sample = 1.0);
+
+            // builds the same document as resultSetToJson, sorted and trimmed, but one
+            // top level group at a time. Each group is passed to `emit` as JSON as soon as
+            // it is built, so only one is held at once. Stops if emit returns false.
+            // With `trimTop` false every top level group is emitted (i.e. for paging)
+            static bool resultSetToJsonStream(
+                int resultColumnCount,
+                int resultSetCount,
+                std::vector<ResultSet*>& resultSets,
+                ResultSortMode_e sortMode,
+                ResultSortOrder_e sortOrder,
+                int sortColumn,
+                int trim,
+                bool trimTop,
+                double sample,
+                const std::function<bool(const std::string&)>& emit,
+                bool parallelMerge = false);
 
             static void jsonResultHistogramFill(
                 cjson* doc,
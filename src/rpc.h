@@ -52,6 +52,12 @@ namespace openset::comms
         // RpcQuery
         { "POST", std::regex(R"(^/v1/query/([a-z0-9_]+)/event(\/|\?|\#|)$)"), RpcQuery::event, { { 1, "table" } } },
         { "POST", std::regex(R"(^/v1/query/([a-z0-9_]+)/segment(\/|\?|\#|)$)"), RpcQuery::segment, { { 1, "table" } } },
+        {
+            "GET",
+            std::regex(R"(^/v1/query/([a-z0-9_]+)/segment/([a-z0-9_\.]+)/export(\/|\?|\#|)$)"),
+            RpcQuery::segment_export,
+            { { 1, "table" }, { 2, "name" } }
+        },
         { "GET", std::regex(R"(^/v1/query/([a-z0-9_]+)/customer(\/|\?|\#|)$)"), RpcQuery::customer, { { 1, "table" } } },
         {
             "GET",
@@ -66,8 +72,21 @@ namespace openset::comms
             { { 1, "table" }, { 2, "name" } }
         },
         { "POST", std::regex(R"(^/v1/query/([a-z0-9_]+)/batch(\/|\?|\#|)$)"), RpcQuery::batch, { { 1, "table" } } },
+        {
+            "GET",
+            std::regex(R"(^/v1/query/([a-z0-9_]+)/cursor/([a-f0-9]+)(\/|\?|\#|)$)"),
+            RpcQuery::cursor,
+            { { 1, "table" }, { 2, "id" } }
+        },
+        {
+            "DELETE",
+            std::regex(R"(^/v1/query/([a-z0-9_]+)/cursor/([a-f0-9]+)(\/|\?|\#|)$)"),
+            RpcQuery::cursor_drop,
+            { { 1, "table" }, { 2, "id" } }
+        },
         // RpcInsert
         { "POST", std::regex(R"(^/v1/insert/([a-z0-9_]+)(\/|\?|\#|)$)"), RpcInsert::insert, { { 1, "table" } } },
+        { "POST", std::regex(R"(^/v1/load/([a-z0-9_]+)(\/|\?|\#|)$)"), RpcInsert::load, { { 1, "table" } } },
         // Subscriptions
         {
             "DELETE",
@@ -81,6 +100,12 @@ namespace openset::comms
             RpcSub::sub_create,
             { { 1, "table" }, { 2, "segment" }, { 3, "subname" } }
         },
+        {
+            "GET",
+            std::regex(R"(^/v1/subscription/([a-z0-9_]+)/([a-z0-9_\.]+)/([a-z0-9_\.]+)(\/|\?|\#|)$)"),
+            RpcSub::sub_pull,
+            { { 1, "table" }, { 2, "segment" }, { 3, "subname" } }
+        },
         // RpcInternode
         { "GET", std::regex(R"(^/v1/internode/is_member$)"), RpcInternode::is_member, {} },
         { "POST", std::regex(R"(^/v1/internode/join_to_cluster$)"), RpcInternode::join_to_cluster, {} },
@@ -90,7 +115,10 @@ namespace openset::comms
         { "POST", std::regex(R"(^/v1/internode/map_change$)"), RpcInternode::map_change, {} },
         { "POST", std::regex(R"(^/v1/internode/translog$)"), RpcInternode::transfer_translog, {} },
         // Status
-        { "GET", std::regex(R"(^/v1/status(\/|\?|\#|)$)"), RpcStatus::status, {} }
+        { "GET", std::regex(R"(^/v1/status(\/|\?|\#|)$)"), RpcStatus::status, {} },
+        { "GET", std::regex(R"(^/metrics(\/|\?|\#|)$)"), RpcStatus::metrics, {} },
+        { "GET", std::regex(R"(^/v1/trace(\/|\?|\#|)$)"), RpcStatus::trace, {} },
+        { "PUT", std::regex(R"(^/v1/trace(\/|\?|\#|)$)"), RpcStatus::traceControl, {} }
     };
     void Dispatch(web::MessagePtr message);
 };
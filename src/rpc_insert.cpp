@@ -2,6 +2,10 @@
 #include <regex>
 #include <thread>
 #include <random>
+#include <fstream>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 #include "common.h"
 #include "rpc_global.h"
@@ -11,10 +15,14 @@
 #include "str/strtools.h"
 #include "sba/sba.h"
 #include "oloop_insert.h"
+#include "oloop_load.h"
+#include "time/epoch.h"
+#include "file/file.h"
 
 #include "asyncpool.h"
 #include "sentinel.h"
 #include "sidelog.h"
+#include "staging.h"
 #include "database.h"
 #include "result.h"
 #include "table.h"
@@ -30,10 +38,645 @@ using namespace openset::comms;
 using namespace openset::db;
 using namespace openset::result;
 
+namespace
+{
+    // unread SideLog entries a partition may have before inserts are refused
+    const int64_t PARTITION_BACKLOG_MAX = 100'000;
+    // insert batches still being forwarded to other nodes before inserts are refused
+    const int32_t OUTSTANDING_FORKS_MAX = 64;
+
+    std::atomic<int32_t> outstandingForks { 0 };
+
+    // batches queued for one node are sent together, up to this many payload bytes
+    const size_t FORK_COALESCE_BYTES = 4 * 1024 * 1024;
+
+    // one accepted batch, shared by the queue of every node it is forwarded to.
+    // It counts as outstanding until every node has it
+    struct Fork_s
+    {
+        std::string path;
+        std::string token;
+        std::string base; // per partition, the origin's rows before these a node won't be sent
+        char* payload;
+        size_t length;
+
+        Fork_s(std::string path, std::string token, std::string base, const char* data, const size_t length) :
+            path(std::move(path)),
+            token(std::move(token)),
+            base(std::move(base)),
+            payload(static_cast<char*>(PoolMem::getPool().getPtr(length))),
+            length(length)
+        {
+            memcpy(payload, data, length);
+            ++outstandingForks;
+        }
+
+        ~Fork_s()
+        {
+            PoolMem::getPool().freePtr(payload);
+            --outstandingForks;
+        }
+    };
+
+    using ForkPtr = std::shared_ptr<Fork_s>;
+
+    /* ForkSender
+     *
+     * Forwards accepted batches to the other nodes. Each node has a queue and one
+     * long-lived thread that sends everything queued since its last request as a
+     * single POST (consecutive batches for the same table, up to FORK_COALESCE_BYTES),
+     * each batch keeping its own insert token. A failed request is retried with back
+     * off, and later batches wait behind it, so a node receives batches in the order
+     * they were accepted. Nodes that leave the cluster have their queue dropped.
+     */
+    class ForkSender
+    {
+        struct Node_s
+        {
+            std::deque<ForkPtr> queue;
+            std::condition_variable ready;
+        };
+
+        std::mutex lock;
+        std::unordered_map<int64_t, std::unique_ptr<Node_s>> nodes;
+
+        ForkSender() = default;
+
+        // the next run of batches for one request, waits until there is one
+        std::vector<ForkPtr> take(Node_s* node)
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            node->ready.wait(guard, [node]() { return !node->queue.empty(); });
+
+            std::vector<ForkPtr> batches;
+            size_t bytes = 0;
+
+            while (!node->queue.empty())
+            {
+                const auto& next = node->queue.front();
+
+                if (!batches.empty() &&
+                    (next->path != batches.front()->path || bytes + next->length > FORK_COALESCE_BYTES))
+                    break;
+
+                bytes += next->length;
+                batches.push_back(next);
+                node->queue.pop_front();
+            }
+
+            return batches;
+        }
+
+        void runner(const int64_t routeId, Node_s* node)
+        {
+            openset::web::QueryParams params;
+            params.emplace("fork", "true");
+            params.emplace("batches", "true");
+
+            while (true)
+            {
+                const auto batches = take(node);
+
+                // [{"token":"...","base":"...","rows":[...]},...] - the rows are the payloads as they arrived
+                std::string payload;
+                payload.reserve(FORK_COALESCE_BYTES / 4);
+                payload += '[';
+
+                for (const auto& batch : batches)
+                {
+                    if (payload.length() > 1)
+                        payload += ',';
+                    payload += "{\"token\":\"" + batch->token + "\",\"base\":\"" + batch->base + "\",\"rows\":";
+                    payload.append(batch->payload, batch->length);
+                    payload += '}';
+                }
+
+                payload += ']';
+
+                for (auto attempt = 0;; ++attempt)
+                {
+                    // gone from the map, its partitions were moved to nodes that got these rows
+                    if (!openset::globals::mapper->isRoute(routeId))
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        node->queue.clear();
+                        break;
+                    }
+
+                    // back off while the node is unreachable, up to 5 seconds
+                    if (attempt)
+                        ThreadSleep(std::min(attempt * 250, 5'000));
+
+                    const auto result = openset::globals::mapper->dispatchSync(
+                        routeId,
+                        "POST",
+                        batches.front()->path,
+                        params,
+                        &payload[0],
+                        payload.length());
+
+                    if (result && result->code == openset::http::StatusCode::success_ok)
+                        break;
+                }
+            }
+        }
+
+    public:
+        // singleton
+        static ForkSender& get()
+        {
+            static ForkSender sender;
+            return sender;
+        }
+
+        // release a batch numbered by this node, and queue it for every other node
+        void send(
+            const Table* table,
+            const std::string& path,
+            const InsertResult_s& result,
+            const char* payload,
+            const size_t length)
+        {
+            std::vector<int64_t> routeIds;
+            {
+                csLock mapperLock(openset::globals::mapper->cs);
+                for (const auto& route : openset::globals::mapper->routes)
+                    if (route.first != openset::globals::running->nodeId)
+                        routeIds.push_back(route.first);
+            }
+
+            const auto origin = SideLog::getSideLog().getOrigin();
+            const auto lasts = result.token.origins.find(origin);
+
+            if (lasts == result.token.origins.end())
+                return;
+
+            // released and queued under one lock, so every node gets batches in release order
+            std::lock_guard<std::mutex> guard(lock);
+
+            ConsistencyToken_s base;
+            base.merge(origin, SideLog::getSideLog().release(table, result.firsts, lasts->second));
+
+            if (routeIds.empty())
+                return;
+
+            const auto fork = std::make_shared<Fork_s>(path, result.token.toString(), base.toString(), payload, length);
+
+            for (const auto routeId : routeIds)
+            {
+                auto& node = nodes[routeId];
+
+                if (!node)
+                {
+                    node = std::make_unique<Node_s>();
+                    std::thread(&ForkSender::runner, this, routeId, node.get()).detach();
+                }
+
+                node->queue.push_back(fork);
+                node->ready.notify_one();
+            }
+        }
+    };
+
+    void replyTooBusy(const openset::web::MessagePtr& message, const std::string& reason, const int64_t backlog)
+    {
+        // Retry-After is added to every 429 by the HTTP server
+        cjson response;
+        auto error = response.setObject("error");
+        error->set("class", "insert");
+        error->set("message", reason);
+        response.set("backlog", backlog);
+        response.set("outstanding_forks", static_cast<int64_t>(outstandingForks));
+        message->reply(openset::http::StatusCode::client_error_too_many_requests, response);
+    }
+
+    // splits a CSV line, handling quoted fields and "" escapes
+    std::vector<std::string> splitCsv(const std::string& line)
+    {
+        std::vector<std::string> fields;
+        std::string field;
+        auto quoted = false;
+
+        for (size_t i = 0; i < line.length(); ++i)
+        {
+            const auto c = line[i];
+
+            if (quoted)
+            {
+                if (c == '"' && i + 1 < line.length() && line[i + 1] == '"')
+                {
+                    field += '"';
+                    ++i;
+                }
+                else if (c == '"')
+                    quoted = false;
+                else
+                    field += c;
+            }
+            else if (c == '"')
+                quoted = true;
+            else if (c == ',')
+            {
+                fields.push_back(std::move(field));
+                field.clear();
+            }
+            else
+                field += c;
+        }
+
+        fields.push_back(std::move(field));
+        return fields;
+    }
+
+    // builds an insert row from CSV fields, values are typed using the table schema
+    bool csvToRow(openset::db::Table* table, const std::vector<std::string>& header, const std::vector<std::string>& fields, cjson& row)
+    {
+        const auto properties = table->getProperties();
+
+        for (auto i = 0; i < static_cast<int>(header.size()) && i < static_cast<int>(fields.size()); ++i)
+        {
+            const auto& name = header[i];
+            const auto& value = fields[i];
+
+            if (value.empty())
+                continue;
+
+            try
+            {
+                if (name == "id")
+                {
+                    if (table->numericCustomerIds)
+                        row.set(name, static_cast<int64_t>(std::stoll(value)));
+                    else
+                        row.set(name, value);
+                }
+                else if (name == "stamp")
+                {
+                    // epoch or ISO 8601
+                    if (value.find_first_not_of("0123456789") == std::string::npos)
+                        row.set(name, static_cast<int64_t>(std::stoll(value)));
+                    else
+                        row.set(name, value);
+                }
+                else
+                {
+                    const auto property = name == "event" ? nullptr : properties->getProperty(name);
+
+                    switch (property ? property->type : openset::db::PropertyTypes_e::textProp)
+                    {
+                    case openset::db::PropertyTypes_e::intProp:
+                        row.set(name, static_cast<int64_t>(std::stoll(value)));
+                        break;
+                    case openset::db::PropertyTypes_e::doubleProp:
+                        row.set(name, std::stod(value));
+                        break;
+                    case openset::db::PropertyTypes_e::boolProp:
+                        row.set(name, value == "1" || value == "true" || value == "TRUE");
+                        break;
+                    default:
+                        row.set(name, value);
+                    }
+                }
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // sorts a batch of rows, queues an OpenLoopLoad cell for every partition with
+    // rows and waits until they have all been applied, returns partitions loaded
+    int64_t applyBatch(
+        const openset::db::Database::TablePtr& table,
+        std::unordered_map<int32_t, std::shared_ptr<BulkLoad_s>>& loads)
+    {
+        if (loads.empty())
+            return 0;
+
+        const auto batch = std::make_shared<BulkBatch_s>();
+        std::vector<int> partitionList;
+
+        for (auto& load : loads)
+        {
+            load.second->sort();
+            load.second->batch = batch;
+            partitionList.push_back(load.first);
+        }
+
+        openset::globals::async->cellFactory(partitionList, [table, &loads, &batch](AsyncLoop* loop) -> OpenLoop*
+        {
+            batch->add();
+            return new OpenLoopLoad(table, loads[loop->partition]);
+        });
+
+        // cells hold their own references, the reader keeps at most one batch in memory
+        loads.clear();
+        batch->wait();
+
+        return static_cast<int64_t>(partitionList.size());
+    }
+
+    // reads an NDJSON or CSV file in batches of BULK_LOAD_BATCH_ROWS, each batch is
+    // applied to this node's partitions before the next is read, rows for
+    // partitions elsewhere are skipped
+    void loadFile(const openset::db::Database::TablePtr& table, const std::string& fileName, const bool csv)
+    {
+        const auto partitions = openset::globals::async;
+        const auto partitionMax = partitions->getPartitionMax();
+
+        std::ifstream file(fileName);
+        std::string line;
+        std::vector<std::string> header;
+
+        std::unordered_map<int32_t, std::shared_ptr<BulkLoad_s>> loads;
+        int64_t lineCount = 0;
+        int64_t rejected = 0;
+        int64_t batchRows = 0;
+        int64_t batches = 0;
+        int64_t partitionLoads = 0;
+
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            if (line.empty())
+                continue;
+
+            ++lineCount;
+
+            // parsed in place, rows are handed to the load by pointer
+            auto row = std::make_unique<cjson>();
+
+            if (csv)
+            {
+                if (header.empty())
+                {
+                    header = splitCsv(line);
+                    continue;
+                }
+
+                if (!csvToRow(table.get(), header, splitCsv(line), *row))
+                {
+                    ++rejected;
+                    continue;
+                }
+            }
+            else
+            {
+                cjson::parse(line, row.get(), true);
+            }
+
+            const auto personNode = row->xPath("/id");
+            const auto stampNode = row->xPath("/stamp");
+
+            if (!personNode || !stampNode)
+            {
+                ++rejected;
+                continue;
+            }
+
+            // route exactly as RpcInsert::insert does
+            std::string customer;
+            int64_t uuid;
+
+            if (personNode->type() == cjson::Types_e::STR)
+            {
+                customer = personNode->getString();
+                toLower(customer);
+                uuid = MakeHash(customer);
+            }
+            else
+            {
+                uuid = personNode->getInt();
+                customer = to_string(uuid);
+            }
+
+            if (customer.empty() || (table->numericCustomerIds != (personNode->type() == cjson::Types_e::INT)))
+            {
+                ++rejected;
+                continue;
+            }
+
+            const auto destination = cast<int32_t>((std::abs(uuid) % 13337) % partitionMax);
+
+            if (!partitions->isPartition(destination))
+                continue;
+
+            const auto stamp = stampNode->type() == cjson::Types_e::STR ?
+                Epoch::fixMilli(Epoch::ISO8601ToEpoch(stampNode->getString())) :
+                Epoch::fixMilli(stampNode->getInt());
+
+            auto& load = loads[destination];
+            if (!load)
+                load = std::make_shared<BulkLoad_s>();
+
+            load->keys.push_back(BulkLoad_s::Key_s{ std::move(customer), stamp, static_cast<int32_t>(load->rows.size()) });
+            load->rows.emplace_back(std::move(row));
+
+            if (++batchRows >= BULK_LOAD_BATCH_ROWS)
+            {
+                partitionLoads += applyBatch(table, loads);
+                batchRows = 0;
+                ++batches;
+            }
+        }
+
+        if (batchRows)
+        {
+            partitionLoads += applyBatch(table, loads);
+            ++batches;
+        }
+
+        Logger::get().info(
+            "bulk load of " + fileName + " read " + to_string(lineCount) + " lines, " + to_string(rejected) +
+            " rejected, applied in " + to_string(batches) + " batches (" + to_string(partitionLoads) +
+            " partition loads).");
+    }
+}
+
+InsertResult_s RpcInsert::queueRows(
+    Table* table,
+    const std::vector<cjson*>& rows,
+    const bool isFork,
+    const std::string& insertToken,
+    const std::string& forkBase)
+{
+    const auto partitions = openset::globals::async;
+
+    InsertResult_s result;
+
+    // rows are validated and routed before the SideLog is locked
+    std::vector<int32_t> destinations;
+    destinations.reserve(rows.size());
+
+    for (auto row : rows)
+    {
+        const auto personNode = row->xPath("/id");
+
+        if (!personNode)
+        {
+            result.status = InsertStatus_e::invalid;
+            result.error = "missing customer id";
+            return result;
+        }
+
+        if (table->numericCustomerIds && personNode->type() != cjson::Types_e::INT)
+        {
+            result.status = InsertStatus_e::invalid;
+            result.error = "this table is configured for numeric customer ids";
+            return result;
+        }
+
+        if (!table->numericCustomerIds && personNode->type() != cjson::Types_e::STR)
+        {
+            result.status = InsertStatus_e::invalid;
+            result.error = "this table is configured for textual customer ids";
+            return result;
+        }
+
+        // straight up numeric ID nodes don't need hashing, actually hashing would be very bad.
+        // We can use numeric IDs (i.e. a customer id) directly.
+        int64_t uuid = 0;
+
+        if (personNode->type() == cjson::Types_e::STR)
+        {
+            auto uuString = personNode->getString();
+            toLower(uuString);
+
+            if (uuString.length())
+                uuid = MakeHash(uuString);
+        }
+        else
+            uuid = personNode->getInt();
+
+        destinations.push_back(cast<int32_t>((std::abs(uuid) % 13337) % partitions->getPartitionMax()));
+    }
+
+    // forks have already been accepted by the node the client called, refusing them
+    // here would make that node resend the batch to every node
+    if (!isFork && openset::globals::mapper->countActiveRoutes() > 1 && outstandingForks >= OUTSTANDING_FORKS_MAX)
+    {
+        result.status = InsertStatus_e::busy;
+        result.error = "too many inserts waiting to be forwarded to other nodes";
+        return result;
+    }
+
+    std::unordered_map<int32_t, int64_t> batchCounts;
+    for (const auto destination : destinations)
+        ++batchCounts[destination];
+
+    // convert the rows once, here, so the insert cells never parse JSON
+    std::vector<StagedRow_s*> staging;
+    staging.reserve(rows.size());
+    for (auto row : rows)
+        staging.push_back(InsertStaging::stage(table, row));
+
+    SideLog::getSideLog().lock();
+
+    // deepest backlog of the local partitions this batch lands on
+    {
+        for (const auto& count : batchCounts)
+        {
+            if (!partitions->isPartition(count.first))
+                continue;
+
+            const auto unread = SideLog::getSideLog().getUnread(count.first);
+            result.backlog = std::max(result.backlog, unread);
+
+            if (!isFork && unread + count.second > PARTITION_BACKLOG_MAX)
+            {
+                SideLog::getSideLog().unlock();
+
+                for (auto staged : staging)
+                    PoolMem::getPool().freePtr(staged);
+
+                result.status = InsertStatus_e::busy;
+                result.error = "partition " + to_string(count.first) + " insert backlog is full";
+                result.backlog = unread;
+                return result;
+            }
+        }
+    }
+
+    // number the rows for read-your-writes tokens. A fork reuses the numbers the accepting
+    // node gave out - the batch routes the same way here, so each partition's rows are
+    // numbered consecutively ending at the sequence in the token
+    auto origin = SideLog::getSideLog().getOrigin();
+    SequenceMap forkNext;
+
+    if (isFork)
+    {
+        const auto token = ConsistencyToken_s::parse(insertToken);
+        origin = token.origins.size() == 1 ? token.origins.begin()->first : 0;
+
+        if (origin)
+            for (const auto& position : token.origins.begin()->second)
+                if (const auto count = batchCounts.find(position.first); count != batchCounts.end())
+                    forkNext[position.first] = position.second - count->second + 1;
+    }
+
+    SequenceMap positions;
+
+    for (auto i = 0; i < static_cast<int>(rows.size()); ++i)
+    {
+        const auto destination = destinations[i];
+        int64_t sequence = 0;
+
+        if (!isFork)
+            sequence = SideLog::getSideLog().nextSequence(table, destination);
+        else if (const auto next = forkNext.find(destination); next != forkNext.end())
+            sequence = next->second++;
+
+        if (sequence)
+        {
+            result.firsts.emplace(destination, sequence);
+            positions[destination] = sequence;
+        }
+
+        const auto staged = staging[i];
+        SideLog::getSideLog().add(table, destination, recast<char*>(staged), staged->length, sequence ? origin : 0, sequence);
+    }
+
+    // where the origin's rows start on each partition. This node numbers and queues its
+    // own rows in order, a fork is told by the origin (see SideLog::release)
+    if (origin && !isFork)
+    {
+        for (const auto& first : result.firsts)
+            SideLog::getSideLog().seed(table, first.first, origin, first.second - 1);
+    }
+    else if (origin)
+    {
+        const auto bases = ConsistencyToken_s::parse(forkBase).origins;
+        if (const auto originBases = bases.find(origin); originBases != bases.end())
+            for (const auto& base : originBases->second)
+                SideLog::getSideLog().seed(table, base.first, origin, base.second);
+    }
+
+    SideLog::getSideLog().unlock();
+
+    if (origin && !positions.empty())
+        result.token.merge(origin, positions);
+
+    return result;
+}
+
+void RpcInsert::forwardRows(
+    const Table* table,
+    const std::string& path,
+    const InsertResult_s& result,
+    const char* payload,
+    const size_t payloadLength)
+{
+    ForkSender::get().send(table, path, result, payload, payloadLength);
+}
+
 void RpcInsert::insertRetry(const openset::web::MessagePtr& message, const RpcMapping& matches, const int retryCount)
 {
     const auto database = openset::globals::database;
-    const auto partitions = openset::globals::async;
 
     const auto request = message->getJSON();
     const auto tableName = matches.find("table"s)->second;
@@ -90,118 +733,72 @@ void RpcInsert::insertRetry(const openset::web::MessagePtr& message, const RpcMa
         return;
     }
 
-    auto rows = request.getNodes();
-    Logger::get().info("Inserting " + to_string(rows.size()) + " events.");
-
-    // vectors go gather locally inserted, or remotely distributed events from this set
-    //std::unordered_map<int, std::vector<char*>> localGather;
-    //std::unordered_map<int64_t, std::vector<char*>> remoteGather;
-
-    SideLog::getSideLog().lock();
-
-    for (auto row : rows)
+    // forwarded by the node that accepted them, several batches each numbered by its own token
+    if (isFork && message->getParamBool("batches"))
     {
-        const auto personNode = row->xPath("/id");
-
-        if (!personNode)
+        for (const auto batch : request.getNodes())
         {
-            RpcError(
-                openset::errors::Error{
-                    openset::errors::errorClass_e::insert,
-                    openset::errors::errorCode_e::general_error,
-                    "missing customer id" },
-                    message);
-            return;
+            const auto tokenNode = batch->xPath("/token");
+            const auto baseNode = batch->xPath("/base");
+            const auto rowsNode = batch->xPath("/rows");
+
+            if (!tokenNode || !baseNode || !rowsNode)
+                continue;
+
+            // the accepting node validated these, there is nobody to return an error to
+            const auto result = queueRows(
+                table.get(), rowsNode->getNodes(), true, tokenNode->getString(), baseNode->getString());
+            if (result.status == InsertStatus_e::invalid)
+                Logger::get().error("forwarded insert rejected (" + result.error + ")");
         }
 
-        if (table->numericCustomerIds && personNode->type() != cjson::Types_e::INT)
-        {
-            RpcError(
-                openset::errors::Error{
-                    openset::errors::errorClass_e::insert,
-                    openset::errors::errorCode_e::general_error,
-                    "this table is configured for numeric customer ids" },
-                    message);
-            return;
-        }
-
-        if (!table->numericCustomerIds && personNode->type() != cjson::Types_e::STR)
-        {
-            RpcError(
-                openset::errors::Error{
-                    openset::errors::errorClass_e::insert,
-                    openset::errors::errorCode_e::general_error,
-                    "this table is configured for textual customer ids" },
-                    message);
-            return;
-        }
-
-        // straight up numeric ID nodes don't need hashing, actually hashing would be very bad.
-        // We can use numeric IDs (i.e. a customer id) directly.
-        int64_t uuid = 0;
-
-        if (personNode->type() == cjson::Types_e::STR)
-        {
-            auto uuString = personNode->getString();
-            toLower(uuString);
+        cjson response;
+        response.set("message", "yummy");
+        message->reply(http::StatusCode::success_ok, response);
+        return;
+    }
 
-            if (uuString.length())
-                uuid = MakeHash(uuString);
-        }
-        else
-            uuid = personNode->getInt();
+    auto rows = request.getNodes();
+    Logger::get().info("Inserting " + to_string(rows.size()) + " events.");
 
-        const auto destination = cast<int32_t>((std::abs(uuid) % 13337) % partitions->getPartitionMax());
+    const auto result = queueRows(table.get(), rows, isFork, message->getParamString("insert_token"));
 
-        int64_t len;
-        SideLog::getSideLog().add(table.get(), destination, cjson::stringifyCstr(row, len));
+    if (result.status == InsertStatus_e::invalid)
+    {
+        RpcError(
+            openset::errors::Error{
+                openset::errors::errorClass_e::insert,
+                openset::errors::errorCode_e::general_error,
+                result.error },
+                message);
+        return;
     }
 
-    SideLog::getSideLog().unlock();
+    if (result.status == InsertStatus_e::busy)
+    {
+        replyTooBusy(message, result.error, result.backlog);
+        return;
+    }
 
     const auto localEndTime = Now();
 
-    if (!isFork && openset::globals::mapper->countActiveRoutes() > 1)
+    if (!isFork)
     {
-        if (openset::globals::sentinel->wasDuringMapChange(startTime, localEndTime))
+        if (openset::globals::mapper->countActiveRoutes() > 1 &&
+            openset::globals::sentinel->wasDuringMapChange(startTime, localEndTime))
             ThreadSleep(1000);
 
-        const auto method = message->getMethod();
-        const auto path = message->getPath();
-        auto newParams = message->getQuery();
-        newParams.emplace("fork", "true");
-        const auto payloadLength = message->getPayloadLength();
-        const auto payload = static_cast<char*>(PoolMem::getPool().getPtr(payloadLength));
-        memcpy(payload, message->getPayload(), payloadLength);
-
-        std::thread t([=](){
-
-            while (true)
-            {
-                auto result = openset::globals::mapper->dispatchCluster(
-                    method,
-                    path,
-                    newParams,
-                    payload,
-                    payloadLength,
-                    false);
-
-                const auto isGood = !result.routeError;
-
-                openset::globals::mapper->releaseResponses(result);
-
-                if (isGood)
-                    break;
-            }
-
-            PoolMem::getPool().freePtr(payload);
-        });
-
-        t.detach();
+        // forks number the rows the same way we did. Called on a single node too, to release the sequences
+        forwardRows(table.get(), message->getPath(), result, message->getPayload(), message->getPayloadLength());
     }
 
     cjson response;
     response.set("message", "yummy");
+    // producers can throttle themselves on this
+    response.set("backlog", result.backlog);
+    // pass as `token` to a query to read these rows back
+    if (!isFork && !result.token.empty())
+        response.set("token", result.token.toString());
 
     // broadcast active nodes to caller - they may round-robin to these
     auto routesList = response.setArray("routes");
@@ -223,3 +820,62 @@ void RpcInsert::insert(const openset::web::MessagePtr& message, const RpcMapping
 {
     insertRetry(message, matches, 1);
 }
+
+void RpcInsert::load(const openset::web::MessagePtr& message, const RpcMapping& matches)
+{
+    // every node reads the file and keeps the rows for its own partitions
+    if (ForwardRequest(message) != ForwardStatus_e::alreadyForwarded)
+        return;
+
+    const auto tableName = matches.find("table"s)->second;
+    const auto fileName = message->getParamString("file");
+
+    auto table = openset::globals::database->getTable(tableName);
+
+    if (!table || table->deleted)
+    {
+        RpcError(
+            openset::errors::Error{
+                openset::errors::errorClass_e::insert,
+                openset::errors::errorCode_e::general_error,
+                "missing or invalid table name" },
+                message);
+        return;
+    }
+
+    if (!fileName.length() || !openset::IO::File::FileExists(fileName))
+    {
+        RpcError(
+            openset::errors::Error{
+                openset::errors::errorClass_e::insert,
+                openset::errors::errorCode_e::general_error,
+                "file not found on node: '" + fileName + "'" },
+                message);
+        return;
+    }
+
+    const auto extension = fileName.length() > 4 ? fileName.substr(fileName.length() - 4) : ""s;
+    const auto format = message->getParamString("format", extension == ".csv" ? "csv" : "ndjson");
+
+    if (format != "csv" && format != "ndjson")
+    {
+        RpcError(
+            openset::errors::Error{
+                openset::errors::errorClass_e::insert,
+                openset::errors::errorCode_e::general_error,
+                "format must be 'ndjson' or 'csv'" },
+                message);
+        return;
+    }
+
+    // loading can take a long time, reply now and load in the background
+    std::thread loader(loadFile, table, fileName, format == "csv");
+    loader.detach();
+
+    cjson response;
+    response.set("message", "loading");
+    response.set("table", tableName);
+    response.set("file", fileName);
+    response.set("format", format);
+    message->reply(http::StatusCode::success_ok, response);
+}
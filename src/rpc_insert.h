@@ -3,6 +3,8 @@
 #include "shuttle.h"
 #include "database.h"
 #include "http_serve.h"
+#include "http_cli.h"
+#include "sidelog.h"
 #include "rpc_global.h"
 
 using namespace openset::async;
@@ -10,11 +12,50 @@ using namespace openset::db;
 
 namespace openset::comms
 {
+    enum class InsertStatus_e : int32_t
+    {
+        accepted = 0,
+        invalid = 1,
+        busy = 2
+    };
+
+    struct InsertResult_s
+    {
+        InsertStatus_e status { InsertStatus_e::accepted };
+        std::string error;
+        int64_t backlog { 0 }; // deepest unread SideLog backlog of the local partitions the rows landed on
+        ConsistencyToken_s token; // where the rows were queued, for read-your-writes
+        SequenceMap firsts; // first sequence the rows were given per partition
+    };
+
     class RpcInsert
     {
         static void insertRetry(const openset::web::MessagePtr& message, const RpcMapping& matches, const int retryCount);
     public:
+        // validates and routes `rows`, then queues the rows for local partitions in the SideLog.
+        // Shared by the HTTP insert and the TCP ingest port. Forks are never refused as busy,
+        // and number their rows using `insertToken`, the token of the node that accepted them,
+        // and `forkBase`, where that node's rows start for this node (see SideLog::release).
+        static InsertResult_s queueRows(
+            Table* table,
+            const std::vector<cjson*>& rows,
+            bool isFork,
+            const std::string& insertToken = "",
+            const std::string& forkBase = "");
+        // releases the sequences of an accepted batch and queues it for the rest of the cluster.
+        // Call for every accepted batch, even on a single node. Each node's batches are sent in
+        // order by a long-lived thread that coalesces whatever has queued into one fork request,
+        // retrying until the node has them. The payload is copied.
+        static void forwardRows(
+            const Table* table,
+            const std::string& path,
+            const InsertResult_s& result,
+            const char* payload,
+            size_t payloadLength);
+
         // POST /v1/insert/{table}
         static void insert(const openset::web::MessagePtr& message, const RpcMapping& matches);
+        // POST /v1/load/{table}?file={path on node}&format={ndjson|csv}
+        static void load(const openset::web::MessagePtr& message, const RpcMapping& matches);
     };
 }
\ No newline at end of file
@@ -204,7 +204,8 @@ void RpcInternode::transfer_init(const openset::web::MessagePtr& message, const
 
             PoolMem::getPool().freePtr(blockPtr);
 
-            if (!responseMessage)
+            // a receiver that can't read the blocks refuses them
+            if (!responseMessage || responseMessage->code != http::StatusCode::success_ok)
                 Logger::get().error("partition transfer error " + t->getName() + ".");
             else
                 Logger::get().info(
@@ -255,11 +256,26 @@ void RpcInternode::transfer_receive(const openset::web::MessagePtr& message, con
     // make async partition object (loop, etc).
     openset::globals::async->initPartition(partitionId);
 
-    read += parts->attributes.deserialize(read);
-    read += parts->people.deserialize(read);
+    // a zero length is a block this node can't read (i.e. from a newer node)
+    const auto attributesLength = parts->attributes.deserialize(read);
+    read += attributesLength;
+    const auto peopleLength = attributesLength ? parts->people.deserialize(read) : 0;
 
     openset::globals::async->resumeAsync();
 
+    if (!attributesLength || !peopleLength)
+    {
+        Logger::get().error("transfer refused for table " + tableName + ", unknown block format.");
+        RpcError(
+            openset::errors::Error{
+                openset::errors::errorClass_e::config,
+                openset::errors::errorCode_e::general_config_error,
+                "transfer block format not supported by this node"
+            },
+            message);
+        return;
+    }
+
     Logger::get().info("transfer comlete");
 
     // reply when done
@@ -1,6 +1,9 @@
 #include <stdexcept>
 #include <cinttypes>
 #include <regex>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include "rpc_global.h"
 #include "rpc_query.h"
 #include "common.h"
@@ -13,6 +16,7 @@
 #include "oloop_customer.h"
 #include "oloop_property.h"
 #include "oloop_histogram.h"
+#include "oloop_seg_export.h"
 #include "asyncpool.h"
 #include "asyncloop.h"
 #include "config.h"
@@ -27,6 +31,10 @@
 #include "internoderouter.h"
 #include "names.h"
 #include "http_serve.h"
+#include "sidelog.h"
+#include "cursors.h"
+#include "trace.h"
+#include "time/epoch.h"
 
 using namespace std;
 using namespace openset::comms;
@@ -56,6 +64,96 @@ enum class queryFunction_e : int32_t
 * result set. This greatly reduces the number of data sets that need to be held
 * in memory and marged by the originator.
 */
+/*
+* Read-your-writes.
+*
+* `token` is the token returned by /v1/insert (see ConsistencyToken_s). Each
+* node waits only for the partitions it is answering for that have not
+* yet applied the rows named in the token, up to `token_wait` milliseconds,
+* then replies with an error if they are still behind.
+*/
+bool waitForToken(const openset::web::MessagePtr& message, const Table* table, const std::vector<int>& partitionList)
+{
+    if (!message->isParam("token"))
+        return true;
+
+    const auto token = ConsistencyToken_s::parse(message->getParamString("token"));
+    const auto timeout = std::max<int64_t>(0, std::min<int64_t>(message->getParamInt("token_wait", 5'000), 60'000));
+    const auto deadline = Now() + timeout;
+
+    const std::unordered_set<int> local(partitionList.begin(), partitionList.end());
+
+    // <partition, origin, sequence> still behind
+    std::vector<std::tuple<int32_t, int64_t, int64_t>> waiting;
+
+    for (const auto& origin : token.origins)
+        for (const auto& position : origin.second)
+            if (local.count(position.first))
+                waiting.emplace_back(position.first, origin.first, position.second);
+
+    openset::trace::Span span("query.token_wait");
+
+    while (true)
+    {
+        const auto version = SideLog::getSideLog().getAppliedVersion();
+
+        waiting.erase(
+            std::remove_if(waiting.begin(), waiting.end(), [table](const std::tuple<int32_t, int64_t, int64_t>& item)
+            {
+                return SideLog::getSideLog().isApplied(table, std::get<0>(item), std::get<1>(item), std::get<2>(item));
+            }),
+            waiting.end());
+
+        if (waiting.empty())
+            return true;
+
+        if (Now() >= deadline)
+        {
+            RpcError(
+                openset::errors::Error{
+                    openset::errors::errorClass_e::query,
+                    openset::errors::errorCode_e::general_query_error,
+                    "timed out waiting for partition " + to_string(std::get<0>(waiting.front())) + " to apply the insert token" },
+                message);
+            return false;
+        }
+
+        // insert cells signal as they apply rows
+        SideLog::getSideLog().waitApplied(version, deadline);
+    }
+}
+
+/*
+* Time window params (`from` and `to`), ISO 8601 or epoch milliseconds.
+*
+* Returns false if the param is present but isn't a time, `stamp` is
+* left alone if the param is missing.
+*/
+bool getStampParam(const openset::web::MessagePtr& message, const std::string& name, int64_t& stamp)
+{
+    if (!message->isParam(name))
+        return true;
+
+    const auto text = message->getParamString(name);
+
+    if (Epoch::isISO8601(text))
+    {
+        stamp = Epoch::ISO8601ToEpoch(text);
+        return stamp != -1;
+    }
+
+    try
+    {
+        size_t used = 0;
+        stamp = Epoch::fixMilli(std::stoll(text, &used));
+        return used == text.length();
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
 shared_ptr<cjson> forkQuery(
     const Database::TablePtr& table,
     const openset::web::MessagePtr& message,
@@ -68,10 +166,17 @@ shared_ptr<cjson> forkQuery(
     const int64_t bucket              = 0,
     const int64_t forceMin            = std::numeric_limits<int64_t>::min(),
     const int64_t forceMax            = std::numeric_limits<int64_t>::min(),
+    const bool analyze                = false,
+    const double sample               = 1.0,
+    const bool stream                 = false,
+    const int64_t pageSize            = 0,
     const int64_t retryCount          = 1)
 {
     auto newParams = message->getQuery();
     newParams.emplace("fork", "true");
+    // the forks record their spans under our trace id
+    if (newParams.find("trace_id") == newParams.end())
+        newParams.emplace("trace_id", to_string(openset::trace::getContext()));
     const auto startTime = Now(); // special case... if we ran this query during a map change, run it again (re-fork)
     if (openset::globals::sentinel->wasDuringMapChange(startTime - 1, startTime))
     {
@@ -92,12 +197,18 @@ shared_ptr<cjson> forkQuery(
             bucket,
             forceMin,
             forceMax,
+            analyze,
+            sample,
+            stream,
+            pageSize,
             retryCount + 1);
     }
     const auto setCount = resultSetCount
                               ? resultSetCount
                               : 1; // call all nodes and gather results - JSON is what's coming back
     // NOTE - it would be fully possible to flatten results to binary
+    const auto dispatchStart = std::chrono::steady_clock::now();
+    const auto dispatchTraceStart = openset::trace::nowMicros();
     auto result = openset::globals::mapper->dispatchCluster(
         message->getMethod(),
         message->getPath(),
@@ -106,6 +217,9 @@ shared_ptr<cjson> forkQuery(
         message->getPayloadLength(),
         true);
     const auto dispatchEndTime = Now();
+    const auto dispatchMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - dispatchStart).count();
+    openset::trace::record("query.fork_dispatch", dispatchTraceStart, openset::trace::nowMicros(), retryCount);
     // special case... if we ran this query during a map change, run it again (re-fork)
     if (openset::globals::sentinel->wasDuringMapChange(startTime, dispatchEndTime))
     {
@@ -126,13 +240,30 @@ shared_ptr<cjson> forkQuery(
             bucket,
             forceMin,
             forceMax,
+            analyze,
+            sample,
+            stream,
+            pageSize,
             retryCount + 1);
     }
     std::vector<ResultSet*> resultSets;
+    auto resultJson = make_shared<cjson>();
+    // EXPLAIN ANALYZE - every fork appended its partition stats to its result block
+    const auto analyzeNodes = analyze ? resultJson->setObject("analyze")->setArray("nodes") : nullptr;
     for (auto& r : result.responses)
     {
         if (ResultMuxDemux::isInternode(r.data, r.length))
+        {
             resultSets.push_back(ResultMuxDemux::internodeToResultSet(r.data, r.length));
+            if (analyzeNodes)
+            {
+                const auto nodeStats = analyzeNodes->pushObject();
+                if (!ResultMuxDemux::getAnalyze(r.data, r.length, nodeStats))
+                    nodeStats->set("error", "no analyze data");
+                nodeStats->set("result_rows", static_cast<int64_t>(resultSets.back()->sortedResult.size()));
+                nodeStats->set("result_bytes", static_cast<int64_t>(r.length));
+            }
+        }
         else
         {
             // there is an error message from one of the participing nodes
@@ -176,8 +307,116 @@ shared_ptr<cjson> forkQuery(
             return nullptr;
         }
     }
-    auto resultJson = make_shared<cjson>();
-    ResultMuxDemux::resultSetToJson(resultColumnCount, setCount, resultSets, resultJson.get()); // free up the responses
+    const auto mergeStart = std::chrono::steady_clock::now();
+    openset::trace::Span mergeSpan("query.merge", static_cast<int64_t>(resultSets.size()));
+
+    // chunked reply - top level groups are sent as they are built, the body is the
+    // same document a buffered reply would have.
+    // cursor - top level groups are kept on this node and the first page is returned
+    if (stream || pageSize)
+    {
+        const auto cursor = pageSize ? std::make_shared<openset::result::Cursor_s>() : nullptr;
+        auto tooLarge = false;
+        auto first = true;
+        auto open = cursor ||
+            (message->beginStream(openset::http::StatusCode::success_ok) && message->streamChunk("{\"_\":["s));
+
+        if (open)
+            open = ResultMuxDemux::resultSetToJsonStream(
+                resultColumnCount,
+                setCount,
+                resultSets,
+                sortMode,
+                sortOrder,
+                sortColumn,
+                trim,
+                !cursor, // a cursor pages through every top level group
+                sample,
+                [&](const std::string& group) -> bool
+                {
+                    if (cursor)
+                    {
+                        cursor->bytes += static_cast<int64_t>(group.length());
+                        if (cursor->bytes > openset::result::CURSOR_MEMORY_MAX)
+                        {
+                            tooLarge = true;
+                            return false;
+                        }
+                        cursor->groups.push_back(group);
+                        return true;
+                    }
+
+                    const auto sent = message->streamChunk(first ? group : "," + group);
+                    first = false;
+                    return sent;
+                },
+                true); // merged on the async workers, we are on a web thread
+
+        const auto responseCount = static_cast<int64_t>(result.responses.size());
+        openset::globals::mapper->releaseResponses(result);
+        for (auto r : resultSets)
+            delete r;
+
+        if (open)
+        {
+            if (sample < 1.0)
+            {
+                const auto sampleNode = resultJson->setObject("sample");
+                sampleNode->set("rate", sample);
+                sampleNode->set("confidence", 0.95);
+            }
+            if (analyze)
+            {
+                const auto coordinator = resultJson->xPath("/analyze")->setObject("coordinator");
+                coordinator->set("node", openset::globals::mapper->getRouteName(openset::globals::running->nodeId));
+                coordinator->set("dispatch_us", static_cast<int64_t>(dispatchMicros));
+                coordinator->set("merge_us", static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - mergeStart).count()));
+                coordinator->set("result_sets", responseCount);
+            }
+
+            // remaining branches (sample, analyze) close the document
+            std::string branches;
+            for (auto node : resultJson->getNodes())
+                branches += ",\"" + node->name() + "\":" + cjson::stringify(node);
+
+            if (cursor)
+            {
+                cursor->table = table->getName();
+                cursor->tail = branches;
+                cursor->bytes += static_cast<int64_t>(branches.length());
+
+                const auto id = openset::result::ResultCursors::get().add(cursor);
+                if (id.length())
+                {
+                    message->reply(
+                        openset::http::StatusCode::success_ok,
+                        openset::result::ResultCursors::page(id, *cursor, 0, pageSize));
+                    Logger::get().info("RpcQuery (cursor " + id + ") on " + table->getName());
+                    return nullptr;
+                }
+
+                tooLarge = true;
+            }
+            else if (message->streamChunk("]" + branches + "}"))
+                message->endStream();
+        }
+
+        if (tooLarge)
+            RpcError(
+                openset::errors::Error {
+                    openset::errors::errorClass_e::query,
+                    openset::errors::errorCode_e::general_query_error,
+                    "result is too large for a cursor - narrow the query or use stream=true"
+                },
+                message);
+
+        if (!cursor)
+            Logger::get().info("RpcQuery (streamed) on " + table->getName());
+        return nullptr;
+    }
+
+    ResultMuxDemux::resultSetToJson(resultColumnCount, setCount, resultSets, resultJson.get(), sample, true); // free up the responses
     openset::globals::mapper->releaseResponses(result);
     // clean up all those resultSet*
     for (auto r : resultSets)
@@ -194,7 +433,23 @@ shared_ptr<cjson> forkQuery(
         break;
     default: ;
     }
-    ResultMuxDemux::jsonResultTrim(resultJson.get(), trim); // local function to fill Meta data in result JSON
+    ResultMuxDemux::jsonResultTrim(resultJson.get(), trim);
+    if (sample < 1.0)
+    {
+        const auto sampleNode = resultJson->setObject("sample");
+        sampleNode->set("rate", sample);
+        sampleNode->set("confidence", 0.95);
+    }
+    if (analyze)
+    {
+        const auto coordinator = resultJson->xPath("/analyze")->setObject("coordinator");
+        coordinator->set("node", openset::globals::mapper->getRouteName(openset::globals::running->nodeId));
+        coordinator->set("dispatch_us", static_cast<int64_t>(dispatchMicros));
+        coordinator->set("merge_us", static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - mergeStart).count()));
+        coordinator->set("result_sets", static_cast<int64_t>(result.responses.size()));
+    }
+    // local function to fill Meta data in result JSON
     const auto fillMeta = [](const openset::query::VarList& mapping, cjson* jsonArray)
     {
         for (auto c : mapping)
@@ -317,6 +572,28 @@ openset::query::ParamVars getInlineVaraibles(const openset::web::MessagePtr& mes
     return paramVars;
 }
 
+// EXPLAIN ANALYZE - appends this node's per-partition stats to a fork reply (see ResultMuxDemux::appendAnalyze)
+char* appendNodeAnalyze(
+    char* buffer,
+    int64_t& bufferLength,
+    const vector<response_s<CellQueryResult_s>>& responses,
+    const int64_t mergeMicros)
+{
+    cjson stats;
+    stats.set("node", openset::globals::mapper->getRouteName(openset::globals::running->nodeId));
+    stats.set("merge_us", mergeMicros);
+
+    auto partitionList = stats.setArray("partitions");
+    for (const auto& r : responses)
+    {
+        auto partitionNode = partitionList->pushObject();
+        for (const auto& stat : r.data.stats)
+            partitionNode->set(stat.first, stat.second);
+    }
+
+    return ResultMuxDemux::appendAnalyze(buffer, bufferLength, &stats);
+}
+
 void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping& matches)
 {
     auto database             = globals::database;
@@ -327,6 +604,14 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
     const auto debug          = message->getParamBool("debug");
     const auto isFork         = message->getParamBool("fork");
     const auto useStampCounts = message->getParamBool("stamp_counts");
+    const auto explain        = message->getParamBool("explain");
+    const auto analyze        = message->getParamBool("analyze");
+    const auto sample         = message->getParamDouble("sample", 1.0);
+    const auto pageSize       = message->getParamBool("cursor") || message->isParam("page_size")
+                                    ? message->getParamInt("page_size", 100)
+                                    : 0;
+    // a cursor reply is a single page, it is never streamed
+    const auto stream         = !pageSize && message->getParamBool("stream") && message->canStream();
     const auto trimSize       = message->getParamInt("trim", -1);
     const auto sortOrder      = message->getParamString("order", "desc") == "asc"
                                     ? ResultSortOrder_e::Asc
@@ -365,6 +650,41 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
             message);
         return;
     }
+    if (!(sample > 0.0 && sample <= 1.0))
+    {
+        RpcError(
+            errors::Error {
+                errors::errorClass_e::query,
+                errors::errorCode_e::general_error,
+                "sample must be greater than 0 and at most 1"
+            },
+            message);
+        return;
+    }
+    int64_t stampFrom = LLONG_MIN;
+    int64_t stampTo   = LLONG_MAX;
+    if (!getStampParam(message, "from", stampFrom) || !getStampParam(message, "to", stampTo))
+    {
+        RpcError(
+            errors::Error {
+                errors::errorClass_e::query,
+                errors::errorCode_e::general_error,
+                "from and to must be ISO 8601 times or epoch milliseconds"
+            },
+            message);
+        return;
+    }
+    if (!isFork && message->isParam("page_size") && (pageSize < 1 || pageSize > openset::result::CURSOR_PAGE_MAX))
+    {
+        RpcError(
+            errors::Error {
+                errors::errorClass_e::query,
+                errors::errorCode_e::general_error,
+                "page_size must be between 1 and " + to_string(openset::result::CURSOR_PAGE_MAX)
+            },
+            message);
+        return;
+    }
     auto table = database->getTable(tableName);
     if (!table)
     {
@@ -386,6 +706,11 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
     {
         p.compileQuery(queryCode.c_str(), table->getProperties(), queryMacros, &paramVars);
         queryMacros.useStampedRowIds = useStampCounts;
+        queryMacros.analyze = analyze;
+        queryMacros.sample = sample;
+        // the params narrow any window found in the script
+        queryMacros.stampFrom = std::max(queryMacros.stampFrom, stampFrom);
+        queryMacros.stampTo = std::min(queryMacros.stampTo, stampTo);
     }
     catch (const std::runtime_error& ex)
     {
@@ -435,6 +760,11 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
         message->reply(http::StatusCode::success_ok, &debugOutput[0], debugOutput.length());
         return;
     }
+    if (explain)
+    {
+        message->reply(http::StatusCode::success_ok, query::MacroExplain(queryMacros));
+        return;
+    }
     auto sortColumn = 0;
     if (sortMode != ResultSortMode_e::key && sortColumnName.size())
     {
@@ -485,7 +815,14 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
             sortMode,
             sortOrder,
             sortColumn,
-            trimSize);
+            trimSize,
+            0,
+            std::numeric_limits<int64_t>::min(),
+            std::numeric_limits<int64_t>::min(),
+            analyze,
+            sample,
+            stream,
+            pageSize);
         if (json) // if null/empty we had an error
             message->reply(http::StatusCode::success_ok, *json);
         return;
@@ -496,6 +833,10 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
         {
             mapping::NodeState_e::active_owner
         });
+
+    // read-your-writes - wait for the inserts named in the token to reach our partitions
+    if (!waitForToken(message, table.get(), activeList))
+        return;
     // Shared Results - Partitions spread across working threads (AsyncLoop's made by AsyncPool)
     //      we don't have to worry about locking anything shared between partitions in the same
     //      thread as they are executed serially, rather than in parallel.
@@ -520,11 +861,13 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
         // 1. Merge Macro Literals
         ResultMuxDemux::mergeMacroLiterals(queryMacros, resultSets); // 2. Merge the rows
         int64_t bufferLength = 0;
-        const auto buffer    = ResultMuxDemux::multiSetToInternode(
+        auto buffer          = ResultMuxDemux::multiSetToInternode(
             queryMacros.vars.columnVars.size(),
             queryMacros.segments.size(),
             resultSets,
             bufferLength); // reply will be responsible for buffer
+        if (queryMacros.analyze)
+            buffer = appendNodeAnalyze(buffer, bufferLength, {}, 0);
         message->reply(http::StatusCode::success_ok, buffer, bufferLength);
         PoolMem::getPool().freePtr(buffer); // clean up stray resultSets
         Logger::get().info("event query on " + table->getName());
@@ -566,12 +909,15 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
                 }
             }
 
+            const auto mergeStart = std::chrono::steady_clock::now();
+            const auto mergeTraceStart = openset::trace::nowMicros();
+
             // 1. Merge the Macro Literals
             // 2. Merge the rows
             ResultMuxDemux::mergeMacroLiterals(queryMacros, resultSets);
 
             int64_t bufferLength = 0;
-            const auto buffer    = ResultMuxDemux::multiSetToInternode(
+            auto buffer          = ResultMuxDemux::multiSetToInternode(
                 queryMacros.vars.columnVars.size(),
                 queryMacros.segments.size(),
                 //queryMacros.indexes.size(),
@@ -587,6 +933,16 @@ void RpcQuery::event(const openset::web::MessagePtr& message, const RpcMapping&
 
             cout << cjson::stringify(&tDoc, true );
             */
+            if (queryMacros.analyze)
+                buffer = appendNodeAnalyze(
+                    buffer,
+                    bufferLength,
+                    responses,
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - mergeStart).count());
+
+            openset::trace::record("query.fork_merge", mergeTraceStart, openset::trace::nowMicros(), static_cast<int64_t>(responses.size()));
+
             message->reply(http::StatusCode::success_ok, buffer, bufferLength);
             PoolMem::getPool().freePtr(buffer);
 
@@ -774,6 +1130,10 @@ void RpcQuery::segment(const openset::web::MessagePtr& message, const RpcMapping
             mapping::NodeState_e::active_owner
         });
 
+    // read-your-writes - wait for the inserts named in the token to reach our partitions
+    if (!waitForToken(message, table.get(), activeList))
+        return;
+
     resultSets.reserve(partitions->getWorkerCount());
 
     for (auto i = 0; i < partitions->getWorkerCount(); ++i)
@@ -1154,6 +1514,10 @@ void RpcQuery::property(openset::web::MessagePtr& message, const RpcMapping& mat
         {
             mapping::NodeState_e::active_owner
         });
+
+    // read-your-writes - wait for the inserts named in the token to reach our partitions
+    if (!waitForToken(message, table.get(), activeList))
+        return;
     // Shared Results - Partitions spread across working threads (AsyncLoop's made by AsyncPool)
     //      we don't have to worry about locking anything shared between partitions in the same
     //      thread as they are executed serially, rather than in parallel.
@@ -1352,6 +1716,9 @@ void RpcQuery::customer(openset::web::MessagePtr& message, const RpcMapping& mat
     // this query is local - we will fire up a single async get user task on this node
     if (targetRoute == globals::running->nodeId)
     {
+        if (!waitForToken(message, table.get(), { targetPartition }))
+            return;
+
         // lets use the super basic shuttle.
         const auto shuttle = new Shuttle<int>(message);
         auto loop          = globals::async->getPartition(targetPartition);
@@ -1548,6 +1915,10 @@ void RpcQuery::histogram(openset::web::MessagePtr& message, const RpcMapping& ma
         {
             mapping::NodeState_e::active_owner
         });
+
+    // read-your-writes - wait for the inserts named in the token to reach our partitions
+    if (!waitForToken(message, table.get(), activeList))
+        return;
     // Shared Results - Partitions spread across working threads (AsyncLoop's made by AsyncPool)
     //      we don't have to worry about locking anything shared between partitions in the same
     //      thread as they are executed serially, rather than in parallel.
@@ -1883,3 +2254,326 @@ void RpcQuery::batch(openset::web::MessagePtr& message, const RpcMapping& matche
         });
     runner.detach();
 }
+
+void RpcQuery::cursor(const openset::web::MessagePtr& message, const RpcMapping& matches)
+{
+    const auto tableName = matches.find("table"s)->second;
+    const auto cursorId  = matches.find("id"s)->second;
+    const auto offset    = message->getParamInt("offset", 0);
+    const auto pageSize  = message->getParamInt("page_size", 100);
+
+    if (offset < 0 || pageSize < 1 || pageSize > openset::result::CURSOR_PAGE_MAX)
+    {
+        RpcError(
+            errors::Error {
+                errors::errorClass_e::query,
+                errors::errorCode_e::general_error,
+                "offset must be positive and page_size between 1 and " + to_string(openset::result::CURSOR_PAGE_MAX)
+            },
+            message);
+        return;
+    }
+
+    // cursors live on the node that coordinated the query
+    const auto cursor = openset::result::ResultCursors::get().find(cursorId);
+
+    if (!cursor || cursor->table != tableName)
+    {
+        RpcError(
+            errors::Error {
+                errors::errorClass_e::query,
+                errors::errorCode_e::general_error,
+                "cursor not found or expired - re-run the query"
+            },
+            message);
+        return;
+    }
+
+    message->reply(http::StatusCode::success_ok, openset::result::ResultCursors::page(cursorId, *cursor, offset, pageSize));
+}
+
+void RpcQuery::cursor_drop(const openset::web::MessagePtr& message, const RpcMapping& matches)
+{
+    const auto cursorId = matches.find("id"s)->second;
+
+    cjson response;
+    response.set("message", "dropped");
+    response.set("dropped", openset::result::ResultCursors::get().drop(cursorId));
+    message->reply(http::StatusCode::success_ok, response);
+}
+
+namespace
+{
+    // one partition of a segment export, requested while the one before it streams
+    struct ExportFetch_s
+    {
+        std::mutex lock;
+        std::condition_variable ready;
+        bool done { false };
+        openset::http::StatusCode code { openset::http::StatusCode::success_ok };
+        std::string local; // from a cell on this node
+        openset::mapping::Mapper::DataBlockPtr remote; // or from the node that owns it
+
+        void finish(const openset::http::StatusCode status, std::string ids, openset::mapping::Mapper::DataBlockPtr response)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                code = status;
+                local = std::move(ids);
+                remote = std::move(response);
+                done = true;
+            }
+            ready.notify_all();
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.wait(guard, [this]() { return done; });
+        }
+
+        const char* data() const
+        {
+            return remote ? remote->data : local.data();
+        }
+
+        size_t length() const
+        {
+            return remote ? remote->length : local.length();
+        }
+    };
+
+    using ExportFetchPtr = std::shared_ptr<ExportFetch_s>;
+
+    // hands an export cell's reply to the originating request rather than to a client
+    class ExportShuttle : public Shuttle<int>
+    {
+        ExportFetchPtr fetch;
+
+    public:
+        ExportShuttle(const openset::web::MessagePtr& message, ExportFetchPtr fetch) :
+            Shuttle<int>(message),
+            fetch(std::move(fetch))
+        {}
+
+        void reply(const openset::http::StatusCode status, const string messageString) override
+        {
+            fetch->finish(status, messageString, nullptr);
+            release();
+        }
+
+        void reply(const openset::http::StatusCode status, const char* data, const int64_t length) override
+        {
+            fetch->finish(status, std::string(data, length), nullptr);
+            release();
+        }
+    };
+
+    // starts listing a partition's segment members. Partitions on this node are queued
+    // as cells directly, others are requested from their owner on a background thread
+    ExportFetchPtr fetchExportPartition(
+        const openset::web::MessagePtr& message,
+        const Database::TablePtr& table,
+        const std::string& segmentName,
+        const ExportFormat_e format,
+        const int partition)
+    {
+        auto fetch = std::make_shared<ExportFetch_s>();
+        const auto partitionMap = openset::globals::mapper->getPartitionMap();
+
+        if (partitionMap->isOwner(partition, openset::globals::running->nodeId))
+        {
+            if (const auto loop = openset::globals::async->getPartition(partition); loop)
+            {
+                loop->queueCell(new OpenLoopSegmentExport(new ExportShuttle(message, fetch), table, segmentName, format));
+                return fetch;
+            }
+        }
+
+        int64_t owner = -1;
+        for (const auto node : partitionMap->getNodesByPartitionId(partition))
+        {
+            if (partitionMap->isOwner(partition, node) && node != openset::globals::running->nodeId)
+            {
+                owner = node;
+                break;
+            }
+        }
+
+        if (owner == -1)
+        {
+            fetch->finish(openset::http::StatusCode::client_error_bad_request, {}, nullptr);
+            return fetch;
+        }
+
+        auto params = message->getQuery();
+        params.emplace("fork", "true");
+        params.emplace("partition", to_string(partition));
+
+        // the fetch is shared, so an export that ends early leaves this to finish on its own
+        std::thread([fetch, owner, method = message->getMethod(), path = message->getPath(), params]()
+        {
+            const auto response = openset::globals::mapper->dispatchSync(owner, method, path, params, nullptr, 0);
+            fetch->finish(
+                response ? response->code : openset::http::StatusCode::client_error_bad_request,
+                {},
+                response);
+        }).detach();
+
+        return fetch;
+    }
+}
+
+void RpcQuery::segment_export(const openset::web::MessagePtr& message, const RpcMapping& matches)
+{
+    const auto tableName   = matches.find("table"s)->second;
+    const auto segmentName = matches.find("name"s)->second;
+    const auto isFork      = message->getParamBool("fork");
+    const auto formatName  = message->getParamString("format", "ndjson");
+
+    if (formatName != "ndjson" && formatName != "binary")
+    {
+        RpcError(
+            errors::Error {
+                errors::errorClass_e::query,
+                errors::errorCode_e::general_error,
+                "format must be ndjson or binary"
+            },
+            message);
+        return;
+    }
+
+    const auto format = formatName == "binary" ? ExportFormat_e::binary : ExportFormat_e::ndjson;
+
+    const auto table = globals::database->getTable(tableName);
+    if (!table)
+    {
+        RpcError(
+            errors::Error {
+                errors::errorClass_e::query,
+                errors::errorCode_e::general_error,
+                "table could not be found"
+            },
+            message);
+        return;
+    }
+
+    const auto partitionMap = globals::mapper->getPartitionMap();
+
+    // We are a fork - list the members in one of our partitions
+    if (isFork)
+    {
+        const auto partition = static_cast<int>(message->getParamInt("partition", -1));
+        const auto loop = partitionMap->isOwner(partition, globals::running->nodeId)
+                              ? globals::async->getPartition(partition)
+                              : nullptr;
+
+        if (!loop)
+        {
+            RpcError(
+                errors::Error {
+                    errors::errorClass_e::query,
+                    errors::errorCode_e::route_error,
+                    "potential node failure - please re-issue the request"
+                },
+                message);
+            return;
+        }
+
+        if (!waitForToken(message, table.get(), { partition }))
+            return;
+
+        loop->queueCell(new OpenLoopSegmentExport(new Shuttle<int>(message), table, segmentName, format));
+        return;
+    }
+
+    /*
+    * We are originating the export.
+    *
+    * Partitions are sent on as chunks in order, and the next partition is
+    * requested while the current one streams, so no node (this one included)
+    * holds more than two partitions of ids. Partitions on this node are run
+    * as cells directly rather than over HTTP. The reply starts with the first
+    * partition, if a later one fails the reply ends without its final chunk.
+    */
+    const auto contentType = format == ExportFormat_e::binary ? "application/octet-stream" : "application/x-ndjson";
+    const auto stream = message->canStream();
+    const auto partitionMax = globals::async->getPartitionMax();
+
+    // forks wait for the token themselves, local partitions are waited on up front
+    // so a timeout can still be replied to
+    std::vector<int> localPartitions;
+    for (auto partition = 0; partition < partitionMax; ++partition)
+        if (partitionMap->isOwner(partition, globals::running->nodeId))
+            localPartitions.push_back(partition);
+
+    if (!waitForToken(message, table.get(), localPartitions))
+        return;
+
+    std::string buffered;
+    auto begun = false;
+    int64_t bytes = 0;
+
+    auto next = partitionMax ? fetchExportPartition(message, table, segmentName, format, 0) : nullptr;
+
+    for (auto partition = 0; partition < partitionMax; ++partition)
+    {
+        const auto response = next;
+        next = partition + 1 < partitionMax
+                   ? fetchExportPartition(message, table, segmentName, format, partition + 1)
+                   : nullptr;
+
+        response->wait();
+
+        if (response->code != http::StatusCode::success_ok)
+        {
+            if (begun)
+            {
+                Logger::get().error("segment export on " + tableName + "/" + segmentName + " stopped at partition " + to_string(partition));
+                return;
+            }
+
+            // pass on an error from the node that owns the partition
+            if (response->length() && response->data()[0] == '{')
+                message->reply(http::StatusCode::client_error_bad_request, response->data(), response->length());
+            else
+                RpcError(
+                    errors::Error {
+                        errors::errorClass_e::config,
+                        errors::errorCode_e::route_error,
+                        "potential node failure - please re-issue the request"
+                    },
+                    message);
+            return;
+        }
+
+        bytes += static_cast<int64_t>(response->length());
+
+        if (!stream)
+        {
+            buffered.append(response->data(), response->length());
+            continue;
+        }
+
+        if (!begun)
+        {
+            if (!message->beginStream(http::StatusCode::success_ok, contentType))
+                return;
+            begun = true;
+        }
+
+        if (!message->streamChunk(response->data(), response->length()))
+            return; // client went away
+    }
+
+    Logger::get().info("segment export on " + tableName + "/" + segmentName + " (" + to_string(bytes) + " bytes)");
+
+    if (!stream)
+    {
+        message->reply(http::StatusCode::success_ok, buffered, contentType);
+        return;
+    }
+
+    if (begun || message->beginStream(http::StatusCode::success_ok, contentType))
+        message->endStream();
+}
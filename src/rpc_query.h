@@ -25,5 +25,11 @@ namespace openset::comms
         static void histogram(const openset::web::MessagePtr& message, const RpcMapping& matches);
         // POST /v1/query/{table}/batch
         static void batch(const openset::web::MessagePtr& message, const RpcMapping& matches);
+        // GET /v1/query/{table}/segment/{name}/export?format={ndjson|binary}
+        static void segment_export(const openset::web::MessagePtr& message, const RpcMapping& matches);
+        // GET /v1/query/{table}/cursor/{id}?offset={n}&page_size={n}
+        static void cursor(const openset::web::MessagePtr& message, const RpcMapping& matches);
+        // DELETE /v1/query/{table}/cursor/{id}
+        static void cursor_drop(const openset::web::MessagePtr& message, const RpcMapping& matches);
     };
 }
\ No newline at end of file
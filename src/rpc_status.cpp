@@ -1,5 +1,7 @@
 #include "rpc_status.h"
 
+#include <string_view>
+
 #include "cjson/cjson.h"
 
 #include "common.h"
@@ -8,6 +10,11 @@
 #include "database.h"
 #include "internoderouter.h"
 #include "http_serve.h"
+#include "asyncpool.h"
+#include "table.h"
+#include "sidelog.h"
+#include "metrics.h"
+#include "trace.h"
 
 void openset::comms::RpcStatus::status(const openset::web::MessagePtr & message, const RpcMapping & matches)
 {
@@ -30,3 +37,169 @@ void openset::comms::RpcStatus::status(const openset::web::MessagePtr & message,
 
     message->reply(http::StatusCode::success_ok, doc);
 }
+
+void openset::comms::RpcStatus::metrics(const openset::web::MessagePtr& message, const RpcMapping& matches)
+{
+    using namespace openset::metrics;
+
+    std::string out;
+
+    // counters, histograms and registered gauges
+    Metrics::get().render(out);
+
+    // engine state is read at scrape time
+    GaugeSamples sideLog;
+    for (const auto& backlog : SideLog::getSideLog().getBacklog())
+        sideLog.emplace_back("partition=\"" + to_string(backlog.first) + "\"", static_cast<double>(backlog.second));
+    Metrics::writeGauge(out, "openset_sidelog_backlog", "SideLog entries not yet applied, by partition", sideLog);
+
+    GaugeSamples cells;
+    if (const auto async = openset::globals::async; async)
+    {
+        csLock lock(async->poolLock);
+
+        for (auto partition = 0; partition < PARTITION_MAX; ++partition)
+        {
+            const auto info = async->partitions[partition];
+            if (!info || !info->ooLoop)
+                continue;
+
+            const auto label = "partition=\"" + to_string(partition) + "\",state=";
+            cells.emplace_back(label + "\"active\"", info->ooLoop->getActiveCount());
+            cells.emplace_back(label + "\"queued\"", info->ooLoop->getQueuedCount());
+        }
+    }
+    Metrics::writeGauge(out, "openset_async_cells", "OpenLoop cells in each partition loop", cells);
+
+    GaugeSamples brokers;
+    for (const auto& tableName : openset::globals::database->getTableNames())
+    {
+        const auto table = openset::globals::database->getTable(tableName);
+        if (!table)
+            continue;
+
+        for (const auto& [segment, subscriber, length] : table->getMessages()->getQueueSizes())
+            brokers.emplace_back(
+                "table=\"" + tableName + "\",segment=\"" + segment + "\",subscriber=\"" + subscriber + "\"",
+                static_cast<double>(length));
+    }
+    Metrics::writeGauge(out, "openset_broker_queue_length", "segment messages waiting for a subscriber", brokers);
+
+    GaugeSamples pool;
+    for (const auto& bucket : PoolMem::getPool().getStats())
+    {
+        const auto label = "size=\"" + to_string(bucket.maxSize) + "\",state=";
+        pool.emplace_back(label + "\"in_use\"", static_cast<double>(bucket.inUse));
+        pool.emplace_back(label + "\"cached\"", static_cast<double>(bucket.cached));
+    }
+    pool.emplace_back("size=\"heap\",state=\"in_use\"", static_cast<double>(PoolMem::getPool().getHeapInUse()));
+    Metrics::writeGauge(out, "openset_poolmem_blocks", "PoolMem blocks by bucket size", pool);
+
+    message->reply(http::StatusCode::success_ok, out, "text/plain; version=0.0.4");
+}
+
+void openset::comms::RpcStatus::trace(const openset::web::MessagePtr& message, const RpcMapping& matches)
+{
+    const auto isFork = message->getParamBool("fork");
+
+    // window in epoch milliseconds, the last ten seconds by default
+    const auto to = message->getParamInt("to", Now());
+    const auto from = message->getParamInt("from", to - 10'000);
+    const auto traceId = strtoll(message->getParamString("trace_id").c_str(), nullptr, 10);
+
+    if (isFork)
+    {
+        const auto nodeId = globals::running->nodeId;
+        // Chrome trace pids are 32 bit
+        const auto pid = nodeId % 1'000'000'000;
+
+        cjson events(cjson::Types_e::ARRAY);
+
+        auto processName = events.pushObject();
+        processName->set("name", "process_name");
+        processName->set("ph", "M");
+        processName->set("pid", pid);
+        processName->setObject("args")->set("name", globals::mapper->getRouteName(nodeId));
+
+        openset::trace::toChromeTrace(&events, pid, from * 1000, to * 1000 + 999, traceId);
+
+        // forks reply with the bare event array, the coordinator splices the arrays together
+        message->reply(http::StatusCode::success_ok, cjson::stringify(&events));
+        return;
+    }
+
+    auto newParams = message->getQuery();
+    newParams.emplace("fork", "true");
+    // every node gets the same window
+    newParams.erase("from");
+    newParams.erase("to");
+    newParams.emplace("from", to_string(from));
+    newParams.emplace("to", to_string(to));
+
+    auto result = openset::globals::mapper->dispatchCluster(
+        message->getMethod(),
+        message->getPath(),
+        newParams,
+        nullptr,
+        0,
+        true);
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    auto first = true;
+
+    // a node that fails to answer leaves a gap, the rest of the trace is still useful
+    for (auto& r : result.responses)
+    {
+        if (!r.data || !r.length || r.code != http::StatusCode::success_ok)
+            continue;
+
+        // the events are copied as text, the array's `[` and `]` are dropped
+        const std::string_view nodeEvents { r.data, static_cast<size_t>(r.length) };
+        const auto open = nodeEvents.find('[');
+        const auto close = nodeEvents.rfind(']');
+
+        if (open == std::string_view::npos || close == std::string_view::npos || close <= open + 1)
+            continue;
+
+        if (!first)
+            out += ',';
+        first = false;
+
+        out.append(nodeEvents.data() + open + 1, close - open - 1);
+    }
+
+    out += "]}";
+
+    openset::globals::mapper->releaseResponses(result);
+
+    message->reply(http::StatusCode::success_ok, out);
+}
+
+void openset::comms::RpcStatus::traceControl(const openset::web::MessagePtr& message, const RpcMapping& matches)
+{
+    openset::trace::enabled = message->getParamBool("enabled", openset::trace::enabled);
+    openset::trace::verbose = message->getParamBool("verbose", openset::trace::verbose);
+
+    // forward to the rest of the cluster so every node traces the same way
+    if (!message->getParamBool("fork"))
+    {
+        auto newParams = message->getQuery();
+        newParams.emplace("fork", "true");
+
+        auto result = openset::globals::mapper->dispatchCluster(
+            message->getMethod(),
+            message->getPath(),
+            newParams,
+            nullptr,
+            0,
+            true);
+
+        openset::globals::mapper->releaseResponses(result);
+    }
+
+    cjson doc;
+    doc.set("enabled", static_cast<bool>(openset::trace::enabled));
+    doc.set("verbose", static_cast<bool>(openset::trace::verbose));
+
+    message->reply(http::StatusCode::success_ok, doc);
+}
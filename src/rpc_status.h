@@ -12,5 +12,11 @@ namespace openset::comms
     public:
         // GET /v1/status
         static void status(const openset::web::MessagePtr& message, const RpcMapping& matches);
+        // GET /metrics
+        static void metrics(const openset::web::MessagePtr& message, const RpcMapping& matches);
+        // GET /v1/trace
+        static void trace(const openset::web::MessagePtr& message, const RpcMapping& matches);
+        // PUT /v1/trace
+        static void traceControl(const openset::web::MessagePtr& message, const RpcMapping& matches);
     };
 }
\ No newline at end of file
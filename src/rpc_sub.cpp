@@ -357,6 +357,35 @@ void RpcSub::sub_create(openset::web::MessagePtr message, const RpcMapping& matc
     const auto host = config.xPathString("/host", "");
     const auto port = config.xPathInt("/port", 80);
     const auto path = config.xPathString("/path", "/");
+    const auto pull = config.xPathString("/mode", "webhook") == "pull";
+
+    // pull subscribers have no endpoint to test, consumers long-poll GET /v1/subscription/...
+    if (pull)
+    {
+        csLock lock(globals::running->cs);
+
+        if (!table->getSegmentRefresh()->count(segmentName))
+        {
+            RpcError(
+                openset::errors::Error{
+                    openset::errors::errorClass_e::config,
+                    openset::errors::errorCode_e::general_config_error,
+                    "segment: '" + segmentName + "' not found." },
+                    message);
+            return;
+        }
+
+        table->getMessages()->registerSubscriber(segmentName, subName, "", 0, "", retention, true);
+
+        cjson response;
+        response.set("message", "created");
+        response.set("table", tableName);
+        response.set("segment", segmentName);
+        response.set("subname", subName);
+        response.set("mode", "pull");
+        message->reply(http::StatusCode::success_ok, response);
+        return;
+    }
 
     if (!host.size() || !path.size() || !port)
     {
@@ -427,3 +456,57 @@ void RpcSub::sub_create(openset::web::MessagePtr message, const RpcMapping& matc
     std::thread tc(testAndCreate);
     tc.detach();
 }
+
+void RpcSub::sub_pull(openset::web::MessagePtr message, const RpcMapping& matches)
+{
+    // not forwarded - every node holds the messages for its own customers, consumers poll each node
+    auto database = openset::globals::database;
+
+    const auto tableName = matches.find("table"s)->second;
+    const auto segmentName = matches.find("segment"s)->second;
+    const auto subName = matches.find("subname"s)->second;
+
+    const auto table = database->getTable(tableName);
+
+    if (!table)
+    {
+        RpcError(
+            openset::errors::Error{
+                openset::errors::errorClass_e::config,
+                openset::errors::errorCode_e::general_config_error,
+                "table not found" },
+                message);
+        return;
+    }
+
+    const auto subscriber = table->getMessages()->getSubscriber(segmentName, subName);
+
+    if (!subscriber || !subscriber->pull)
+    {
+        RpcError(
+            openset::errors::Error{
+                openset::errors::errorClass_e::config,
+                openset::errors::errorCode_e::general_config_error,
+                "pull subscriber not found: '" + subName + "'" },
+                message);
+        return;
+    }
+
+    // everything before `cursor` has been processed by the consumer
+    if (message->isParam("cursor"))
+        subscriber->log->ack(subscriber.get(), message->getParamInt("cursor"));
+
+    const auto wait = std::max<int64_t>(0, std::min<int64_t>(message->getParamInt("wait", 0), 30'000));
+
+    openset::revent::PullWait_s pullWait;
+    pullWait.message = message;
+    pullWait.max = std::max<int64_t>(1, std::min<int64_t>(message->getParamInt("max", 10'000), 100'000));
+    pullWait.binary = message->getParamString("format") == "binary";
+    pullWait.deadline = Now() + wait;
+
+    if (subscriber->answerPull(pullWait, wait == 0))
+        return;
+
+    // nothing yet, the webhook pool replies when messages arrive or the wait is over
+    openset::revent::WebHookPool::get().park(subscriber.get(), std::move(pullWait));
+}
@@ -22,5 +22,7 @@ namespace openset::comms
         static void sub_delete(const openset::web::MessagePtr message, const RpcMapping& matches);
         // POST /v1/subscription/{table}/{segment_name}/{sub_name}
         static void sub_create(const openset::web::MessagePtr message, const RpcMapping& matches);
+        // GET /v1/subscription/{table}/{segment_name}/{sub_name}?cursor=&wait=&max=&format=
+        static void sub_pull(const openset::web::MessagePtr message, const RpcMapping& matches);
     };
 }
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include "segmentmath.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace openset::query;
+using namespace openset::db;
+
+namespace
+{
+    const char* segmentMathName(const Marshals_e op)
+    {
+        switch (op)
+        {
+        case Marshals_e::marshal_intersection:
+            return "intersection";
+        case Marshals_e::marshal_union:
+            return "union";
+        case Marshals_e::marshal_compliment:
+            return "compliment";
+        case Marshals_e::marshal_difference:
+            return "difference";
+        default:
+            return "population";
+        }
+    }
+
+    // parameter counts accepted by the interpreter for the same functions
+    int segmentMathParams(const Marshals_e op)
+    {
+        switch (op)
+        {
+        case Marshals_e::marshal_intersection:
+        case Marshals_e::marshal_union:
+        case Marshals_e::marshal_difference:
+            return 2;
+        default:
+            return 1;
+        }
+    }
+}
+
+bool SegmentMath::compile(Macro_s& macros)
+{
+    macros.isSegmentMath = false;
+
+    auto usesSegmentMath = false;
+    for (const auto marshal : macros.marshalsReferenced)
+        if (SegmentMathMarshals.count(marshal))
+            usesSegmentMath = true;
+
+    if (!usesSegmentMath)
+        return false;
+
+    // replay the code on a stack of nodes. Parameters are pushed last to
+    // first, so the first one popped is the first parameter
+    std::vector<SegmentMathNode_s> stack;
+
+    for (const auto& inst : macros.code)
+    {
+        switch (inst.op)
+        {
+        case OpCode_e::PSHLITSTR:
+        {
+            SegmentMathNode_s leaf;
+            leaf.segment = macros.vars.literals[inst.index].value;
+            leaf.key = "\"" + leaf.segment + "\"";
+            stack.push_back(std::move(leaf));
+        }
+        break;
+        case OpCode_e::MARSHAL:
+        {
+            const auto marshal = static_cast<Marshals_e>(inst.index);
+
+            // `return(...)` leaves the expression where it is
+            if (marshal == Marshals_e::marshal_return && inst.extra == 1)
+                break;
+
+            if (!SegmentMathMarshals.count(marshal) ||
+                inst.extra != segmentMathParams(marshal) ||
+                static_cast<int64_t>(stack.size()) < inst.extra)
+                return false;
+
+            SegmentMathNode_s node;
+            node.op = marshal;
+
+            for (auto i = 0; i < inst.extra; ++i)
+            {
+                node.params.push_back(std::move(stack.back()));
+                stack.pop_back();
+            }
+
+            if (marshal == Marshals_e::marshal_population)
+            {
+                // population(x) is x
+                stack.push_back(std::move(node.params[0]));
+                break;
+            }
+
+            std::vector<std::string> keys;
+            for (const auto& param : node.params)
+                keys.push_back(param.key);
+
+            // order doesn't matter to these, so `a & b` and `b & a` share a key
+            if (marshal == Marshals_e::marshal_intersection || marshal == Marshals_e::marshal_union)
+                std::sort(keys.begin(), keys.end());
+
+            node.key = segmentMathName(marshal) + "("s;
+            for (const auto& key : keys)
+                node.key += (&key == &keys.front() ? "" : ",") + key;
+            node.key += ")";
+
+            stack.push_back(std::move(node));
+        }
+        break;
+        case OpCode_e::NOP:
+        case OpCode_e::PSHLITFALSE: // the implied return at the end of the script
+        case OpCode_e::RETURN:
+        case OpCode_e::TERM:
+            break;
+        default:
+            // anything else needs the interpreter
+            return false;
+        }
+    }
+
+    if (stack.size() != 1)
+        return false;
+
+    macros.segmentMath = std::move(stack.back());
+    macros.isSegmentMath = true;
+    return true;
+}
+
+void SegmentMath::dependencies(const SegmentMathNode_s& node, std::vector<std::string>& names)
+{
+    if (node.params.empty())
+    {
+        if (std::find(names.begin(), names.end(), node.segment) == names.end())
+            names.push_back(node.segment);
+        return;
+    }
+
+    for (const auto& param : node.params)
+        dependencies(param, names);
+}
+
+void SegmentMath::order(
+    std::vector<std::string>& names,
+    const std::function<const Macro_s*(const std::string&)>& getMacros,
+    const std::function<int(const std::string&)>& getZIndex)
+{
+    std::stable_sort(
+        names.begin(),
+        names.end(),
+        [&](const std::string& left, const std::string& right) -> bool
+        {
+            return getZIndex(left) < getZIndex(right);
+        });
+
+    const std::unordered_set<std::string> known(names.begin(), names.end());
+    std::unordered_set<std::string> visited;
+    std::vector<std::string> ordered;
+
+    // depth first, a segment is added after everything it reads. Cycles are cut
+    // where they are found, those segments read whatever the other one last had
+    std::function<void(const std::string&)> visit = [&](const std::string& name)
+    {
+        if (visited.count(name))
+            return;
+        visited.insert(name);
+
+        const auto macros = getMacros(name);
+        if (macros && macros->isSegmentMath)
+        {
+            std::vector<std::string> reads;
+            dependencies(macros->segmentMath, reads);
+
+            for (const auto& read : reads)
+                if (known.count(read))
+                    visit(read);
+        }
+
+        ordered.push_back(name);
+    };
+
+    for (const auto& name : names)
+        visit(name);
+
+    names = std::move(ordered);
+}
+
+SegmentMathEval::SegmentMathEval(GetSegmentCB getSegment, const int64_t maxLinearId) :
+    getSegment(std::move(getSegment)),
+    maxLinearId(maxLinearId)
+{}
+
+SegmentMathEval::~SegmentMathEval()
+{
+    for (auto& item : memo)
+        delete item.second;
+}
+
+IndexBits* SegmentMathEval::get(const SegmentMathNode_s& node)
+{
+    const auto iter = memo.find(node.key);
+    if (iter != memo.end())
+        return iter->second;
+
+    if (node.params.empty())
+    {
+        auto loaded = false;
+        const auto bits = getSegment(node.segment, loaded);
+
+        // segments from the index are decompressed copies, keep them for the next reader.
+        // Live segment bits are read in place
+        if (bits && loaded)
+            memo[node.key] = bits;
+
+        return bits;
+    }
+
+    const auto first = get(node.params[0]);
+    if (!first)
+        return nullptr;
+
+    const auto result = new IndexBits();
+    result->opCopy(*first);
+
+    for (auto i = 1; i < static_cast<int>(node.params.size()); ++i)
+    {
+        const auto bits = get(node.params[i]);
+
+        if (!bits)
+        {
+            delete result;
+            return nullptr;
+        }
+
+        switch (node.op)
+        {
+        case Marshals_e::marshal_intersection:
+            // opAnd ignores an empty source, but the intersection with nothing is nothing
+            if (!bits->ints)
+                result->reset();
+            else
+                result->opAnd(*bits);
+            break;
+        case Marshals_e::marshal_union:
+            result->opOr(*bits);
+            break;
+        case Marshals_e::marshal_difference:
+            result->opAndNot(*bits);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (node.op == Marshals_e::marshal_compliment)
+    {
+        // cover every customer, not just up to the last bit the source had
+        result->grow((maxLinearId + 64) / 64);
+        result->opNot();
+    }
+
+    memo[node.key] = result;
+    return result;
+}
+
+bool SegmentMathEval::evaluate(const SegmentMathNode_s& node, IndexBits* result)
+{
+    const auto bits = get(node);
+
+    if (!bits)
+        return false;
+
+    result->opCopy(*bits);
+    return true;
+}
+
+void SegmentMathEval::invalidate(const std::string& segmentName)
+{
+    const auto leafKey = "\"" + segmentName + "\"";
+
+    for (auto iter = memo.begin(); iter != memo.end();)
+    {
+        if (iter->first.find(leafKey) != std::string::npos)
+        {
+            delete iter->second;
+            iter = memo.erase(iter);
+        }
+        else
+            ++iter;
+    }
+}
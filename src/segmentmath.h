@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "querycommon.h"
+#include "indexbits.h"
+
+/*
+    Segment math
+
+    Segments made only from other segments (i.e. `intersection("a", "b")`) are
+    compiled into an expression tree rather than run through the interpreter.
+    The segments of a table form a DAG through these trees, and refresh cells
+    order segments so every segment is calculated after the segments it reads.
+
+    SegmentMathEval calculates trees with bitmap operations. Every inner node
+    it calculates is kept (keyed on the node key, which is the same for equal
+    sub-expressions), so segments that share sub-expressions calculate them
+    once per refresh.
+*/
+
+namespace openset::query
+{
+    class SegmentMath
+    {
+    public:
+        // sets isSegmentMath and segmentMath if the compiled script is a single
+        // segment math expression on literal segment names
+        static bool compile(Macro_s& macros);
+
+        // segment names read by the expression
+        static void dependencies(const SegmentMathNode_s& node, std::vector<std::string>& names);
+
+        // orders `names` so segments come after the segments their segment math reads,
+        // otherwise by z_index. `getMacros` returns nullptr for names it doesn't know
+        static void order(
+            std::vector<std::string>& names,
+            const std::function<const Macro_s*(const std::string&)>& getMacros,
+            const std::function<int(const std::string&)>& getZIndex);
+    };
+
+    class SegmentMathEval
+    {
+    public:
+        using GetSegmentCB = std::function<db::IndexBits*(const std::string&, bool&)>;
+
+    private:
+        GetSegmentCB getSegment;
+        int64_t maxLinearId;
+        // calculated nodes, and segments loaded from the index
+        std::unordered_map<std::string, db::IndexBits*> memo;
+
+        db::IndexBits* get(const SegmentMathNode_s& node);
+
+    public:
+        SegmentMathEval(GetSegmentCB getSegment, int64_t maxLinearId);
+        ~SegmentMathEval();
+
+        SegmentMathEval(const SegmentMathEval&) = delete;
+        SegmentMathEval& operator=(const SegmentMathEval&) = delete;
+
+        // calculates `node` into `result`. Returns false if a segment could not be found
+        bool evaluate(const SegmentMathNode_s& node, db::IndexBits* result);
+
+        // drops calculated nodes that read `segmentName`, call when it changes
+        void invalidate(const std::string& segmentName);
+    };
+}
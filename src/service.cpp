@@ -11,6 +11,7 @@
 #include "sentinel.h"
 
 #include "http_serve.h"
+#include "ingest.h"
 
 
 #include <thread>
@@ -53,6 +54,10 @@ namespace openset
 
 		openset::mapping::Sentinel teamster(&mapper, &db);
 
+		web::IngestServer ingest;
+		if (globals::running->ingestPort)
+			ingest.serve(ip, globals::running->ingestPort);
+
 		web::HttpServe httpd;
 		httpd.serve(ip, port); // this function will never return
 
@@ -2,6 +2,10 @@
 
 #include <unordered_map>
 #include <limits>
+#include <map>
+#include <random>
+#include <mutex>
+#include <condition_variable>
 
 #include "sba/sba.h"
 #include "threads/locks.h"
@@ -9,23 +13,201 @@
 
 #include "common.h"
 #include "table.h"
+#include "str/strtools.h"
 
 namespace openset::db
 {
+    // <partition, sequence>
+    using SequenceMap = std::unordered_map<int32_t, int64_t>;
+
+    /*
+        Read-your-writes tokens
+
+        The node that accepts an insert numbers the rows it queues per table and
+        partition, and forwards the numbers with the batch so every node files
+        a row under the same <origin, sequence>. The insert reply carries the
+        last sequence the batch used on each partition, and a query given the
+        token waits until its local partitions have applied up to them.
+
+        {origin}:{partition}.{sequence},{partition}.{sequence}[;{origin}:...]
+
+        Tokens from different inserts can be joined with `;`.
+    */
+    struct ConsistencyToken_s
+    {
+        // <origin, positions>
+        std::unordered_map<int64_t, SequenceMap> origins;
+
+        void merge(const int64_t origin, const SequenceMap& positions)
+        {
+            auto& current = origins[origin];
+            for (const auto& position : positions)
+            {
+                auto& sequence = current[position.first];
+                sequence = std::max(sequence, position.second);
+            }
+        }
+
+        bool empty() const
+        {
+            return origins.empty();
+        }
+
+        std::string toString() const
+        {
+            std::string result;
+
+            for (const auto& origin : origins)
+            {
+                if (result.length())
+                    result += ';';
+
+                result += to_string(origin.first) + ':';
+
+                auto first = true;
+                for (const auto& position : origin.second)
+                {
+                    if (!first)
+                        result += ',';
+                    first = false;
+                    result += to_string(position.first) + '.' + to_string(position.second);
+                }
+            }
+
+            return result;
+        }
+
+        // malformed parts are skipped
+        static ConsistencyToken_s parse(const std::string& token)
+        {
+            ConsistencyToken_s result;
+
+            for (const auto& part : split(token, ';'))
+            {
+                const auto colon = part.find(':');
+                if (colon == std::string::npos)
+                    continue;
+
+                const auto origin = std::strtoll(part.c_str(), nullptr, 10);
+                if (!origin)
+                    continue;
+
+                SequenceMap positions;
+
+                for (const auto& position : split(part.substr(colon + 1), ','))
+                {
+                    const auto dot = position.find('.');
+                    if (dot == std::string::npos)
+                        continue;
+
+                    positions[static_cast<int32_t>(std::strtol(position.c_str(), nullptr, 10))] =
+                        std::strtoll(position.c_str() + dot + 1, nullptr, 10);
+                }
+
+                result.merge(origin, positions);
+            }
+
+            return result;
+        }
+    };
+
+    /*
+        Watermark_s - the contiguous run of sequences seen from one origin on one
+        table/partition, with any ranges seen past a gap held in `ahead`.
+
+        Sequences below the first one a node sees may never arrive (they were
+        numbered before the node joined, or before the partition moved here), so
+        `contiguous` is unknown (-1) until it is given a baseline with seed(). The
+        origin sends the baseline with each forwarded batch, rather than the
+        receiver guessing it from whichever batch happens to arrive first.
+    */
+    struct Watermark_s
+    {
+        int64_t contiguous{ -1 };         // -1 until seeded
+        std::map<int64_t, int64_t> ahead; // <first, last> seen past a gap, or before seeding
+
+        // every sequence up to `base` is accounted for, only acts the first time
+        void seed(const int64_t base)
+        {
+            if (contiguous != -1)
+                return;
+
+            contiguous = base;
+            absorb();
+        }
+
+        void mark(const int64_t sequence)
+        {
+            mark(sequence, sequence);
+        }
+
+        void mark(int64_t first, int64_t last)
+        {
+            if (contiguous != -1)
+            {
+                if (last <= contiguous)
+                    return;
+                first = std::max(first, contiguous + 1);
+            }
+
+            // join any ranges this overlaps or touches
+            auto next = ahead.upper_bound(first);
+
+            if (next != ahead.begin())
+            {
+                const auto prev = std::prev(next);
+                if (prev->second + 1 >= first)
+                {
+                    first = prev->first;
+                    last = std::max(last, prev->second);
+                    ahead.erase(prev);
+                }
+            }
+
+            while (next != ahead.end() && next->first <= last + 1)
+            {
+                last = std::max(last, next->second);
+                next = ahead.erase(next);
+            }
+
+            ahead.emplace(first, last);
+            absorb();
+        }
+
+    private:
+        void absorb()
+        {
+            if (contiguous == -1)
+                return;
+
+            while (!ahead.empty() && ahead.begin()->first <= contiguous + 1)
+            {
+                contiguous = std::max(contiguous, ahead.begin()->second);
+                ahead.erase(ahead.begin());
+            }
+        }
+    };
+
     struct SideLogCursor_s
     {
         int64_t stamp{ Now() };
         int64_t tableHash{ 0 };
         int32_t partition{ -1 };
-        char* jsonData { nullptr };
+        int64_t origin{ 0 };   // node instance that accepted the row, 0 if untracked
+        int64_t sequence{ 0 }; // per table/partition number given by the origin
+        char* data { nullptr };  // staged insert row (see staging.h)
+        int32_t length{ 0 };
         SideLogCursor_s* next { nullptr };
 
         SideLogCursor_s() = default;
 
-        SideLogCursor_s(const int64_t tableHash, const int32_t partition, char* data) :
+        SideLogCursor_s(const int64_t tableHash, const int32_t partition, char* data, const int32_t length, const int64_t origin, const int64_t sequence) :
             tableHash(tableHash),
             partition(partition),
-            jsonData(data)
+            origin(origin),
+            sequence(sequence),
+            data(data),
+            length(length)
         { }
 
         ~SideLogCursor_s() = default;
@@ -41,11 +223,17 @@ namespace openset::db
             const auto serializedPartition = recast<int32_t*>(mem->newPtr(sizeof(int32_t)));
             *serializedPartition = partition;
 
-            const auto serializedJsonLength = recast<int32_t*>(mem->newPtr(sizeof(int32_t)));
-            *serializedJsonLength = strlen(jsonData);
+            const auto serializedOrigin = recast<int64_t*>(mem->newPtr(sizeof(int64_t)));
+            *serializedOrigin = origin;
+
+            const auto serializedSequence = recast<int64_t*>(mem->newPtr(sizeof(int64_t)));
+            *serializedSequence = sequence;
+
+            const auto serializedLength = recast<int32_t*>(mem->newPtr(sizeof(int32_t)));
+            *serializedLength = length;
 
-            const auto serializedJson = mem->newPtr(*serializedJsonLength);
-            memcpy(serializedJson, jsonData, *serializedJsonLength);
+            const auto serializedData = mem->newPtr(length);
+            memcpy(serializedData, data, length);
         }
 
         void deserialize(char* &mem)
@@ -59,14 +247,18 @@ namespace openset::db
             partition = *recast<int32_t*>(mem);
             mem += sizeof(int32_t);
 
-            const auto jsonLength = *recast<int32_t*>(mem);
+            origin = *recast<int64_t*>(mem);
+            mem += sizeof(int64_t);
+
+            sequence = *recast<int64_t*>(mem);
+            mem += sizeof(int64_t);
+
+            length = *recast<int32_t*>(mem);
             mem += sizeof(int32_t);
 
-            // buffer for the json text and +1 for the null terminator
-            jsonData = static_cast<char*>(PoolMem::getPool().getPtr(jsonLength + 1));
-            memcpy(jsonData, mem, jsonLength);
-            jsonData[jsonLength] = 0x00;
-            mem += jsonLength;
+            data = static_cast<char*>(PoolMem::getPool().getPtr(length));
+            memcpy(data, mem, length);
+            mem += length;
         }
     };
 
@@ -83,7 +275,7 @@ namespace openset::db
 
         CriticalSection cs;
 
-        using JsonList = std::vector<char*>;
+        using EntryList = std::vector<char*>;
 
         // pair is <tableHash, parition>
         using ReadMap = std::unordered_map<std::pair<int64_t, int32_t>, SideLogCursor_s*>;
@@ -91,6 +283,43 @@ namespace openset::db
         //LastMap writeHeads;
         ReadMap readHeads;
 
+        struct PendingRead_s
+        {
+            int64_t handle{ 0 };
+            int64_t count{ 0 };
+            std::vector<std::pair<int64_t, int64_t>> sequences; // <origin, sequence> of tracked rows
+        };
+
+        // unread entries per partition (all tables), kept as entries are added, read and trimmed
+        std::unordered_map<int32_t, int64_t> unread;
+        // reads returned by read() and not yet passed to updateReadHead
+        std::unordered_map<std::pair<int64_t, int32_t>, PendingRead_s> pendingReads;
+
+        // identifies this process in tokens, a restarted node starts new sequences
+        const int64_t origin{
+            static_cast<int64_t>((static_cast<uint64_t>(std::random_device{}()) << 31) ^ static_cast<uint64_t>(Now())) &
+            std::numeric_limits<int64_t>::max() };
+        // last sequence given per <table, partition> by this node
+        std::unordered_map<std::pair<int64_t, int32_t>, int64_t> sequences;
+        // <table, partition> -> <origin, watermark>
+        std::unordered_map<std::pair<int64_t, int32_t>, std::unordered_map<int64_t, Watermark_s>> applied;
+        // sequences from this node handed to forwarding per <table, partition>
+        std::unordered_map<std::pair<int64_t, int32_t>, Watermark_s> released;
+
+        // bumped whenever `applied` moves, so token waits sleep instead of polling
+        std::mutex appliedLock;
+        std::condition_variable appliedChanged;
+        int64_t appliedVersion{ 0 };
+
+        void notifyApplied()
+        {
+            {
+                std::lock_guard<std::mutex> guard(appliedLock);
+                ++appliedVersion;
+            }
+            appliedChanged.notify_all();
+        }
+
         int64_t lastTrim{ Now() };
 
         SideLog() = default;
@@ -154,8 +383,12 @@ namespace openset::db
             {
                 const auto nextEntry = cursor->next;
 
-                // free json data
-                PoolMem::getPool().freePtr(cursor->jsonData);
+                // nobody here reads this table/partition, so it leaves the backlog unread
+                if (!readHeads.count(std::make_pair(cursor->tableHash, cursor->partition)))
+                    --unread[cursor->partition];
+
+                // free row data
+                PoolMem::getPool().freePtr(cursor->data);
                 // free struct - was created with placement new, destructor need not be called
                 PoolMem::getPool().freePtr(cursor);
 
@@ -178,6 +411,37 @@ namespace openset::db
                 head.second = nullptr;
         }
 
+        // rebuild the unread counts after read heads move backwards or go away. An
+        // entry is unread until the read head for its table/partition has passed it
+        void recountUnread()
+        {
+            unread.clear();
+            pendingReads.clear();
+
+            std::unordered_multimap<SideLogCursor_s*, std::pair<int64_t, int32_t>> headsAt;
+            std::unordered_set<std::pair<int64_t, int32_t>> pending;
+
+            for (const auto& readHead : readHeads)
+            {
+                if (!readHead.second)
+                    continue;
+                headsAt.emplace(readHead.second, readHead.first);
+                pending.insert(readHead.first);
+            }
+
+            for (auto cursor = head; cursor; cursor = cursor->next)
+            {
+                const auto key = std::make_pair(cursor->tableHash, cursor->partition);
+
+                if (!pending.count(key))
+                    ++unread[cursor->partition];
+
+                const auto passed = headsAt.equal_range(cursor);
+                for (auto iter = passed.first; iter != passed.second; ++iter)
+                    pending.erase(iter->second);
+            }
+        }
+
 
     public:
 
@@ -198,17 +462,69 @@ namespace openset::db
             cs.unlock();
         }
 
+        // origin of the sequences this node gives out
+        int64_t getOrigin() const
+        {
+            return origin;
+        }
+
+        // numbers a row accepted by this node, lock from the caller using lock() and unlock()
+        int64_t nextSequence(const Table* table, const int32_t partition)
+        {
+            return ++sequences[std::make_pair(table->getTableHash(), partition)];
+        }
+
+        // the rows numbered before this batch that a node will never be sent, for
+        // each partition the batch numbered rows on from `firsts` to `lasts`. The
+        // caller forwards batches in the order they are released
+        SequenceMap release(const Table* table, const SequenceMap& firsts, const SequenceMap& lasts)
+        {
+            csLock lock(cs);
+
+            SequenceMap bases;
+
+            for (const auto& first : firsts)
+            {
+                const auto last = lasts.find(first.first);
+                if (last == lasts.end())
+                    continue;
+
+                auto& watermark = released[std::make_pair(table->getTableHash(), first.first)];
+                watermark.seed(0);
+
+                // sequences not yet released were numbered by batches that will be sent after this one
+                bases[first.first] = watermark.contiguous;
+                watermark.mark(first.second, last->second);
+            }
+
+            return bases;
+        }
+
+        // the baseline sent by `rowOrigin` for a partition, only the first one counts.
+        // Lock from the caller using lock() and unlock()
+        void seed(const Table* table, const int32_t partition, const int64_t rowOrigin, const int64_t base)
+        {
+            auto& watermark = applied[std::make_pair(table->getTableHash(), partition)][rowOrigin];
+
+            if (watermark.contiguous != -1)
+                return;
+
+            watermark.seed(base);
+            notifyApplied();
+        }
+
         // lock/unlock from caller using lock() and unlock() to accelerate inserts
-        void add(const Table* table, const int32_t partition, char* json)
+        void add(const Table* table, const int32_t partition, char* data, const int32_t length, const int64_t rowOrigin = 0, const int64_t sequence = 0)
         {
             const auto tableHash = table->getTableHash();
 
             // create with placement new
             const auto newEntry =
                 new (PoolMem::getPool().getPtr(sizeof(SideLogCursor_s)))
-                    SideLogCursor_s(tableHash, partition, json);
+                    SideLogCursor_s(tableHash, partition, data, length, rowOrigin, sequence);
 
             ++logSize;
+            ++unread[partition];
 
             // link it onto the end of the list
             if (!head)
@@ -220,11 +536,20 @@ namespace openset::db
             tail = newEntry;
         }
 
-        JsonList read(const Table* table, const int32_t partition, const int limit, int64_t& readPosition)
+        // entries waiting for a partition's insert cell (all tables). Lock from the
+        // caller using lock() and unlock() (i.e. while checking capacity before add)
+        int64_t getUnread(const int32_t partition) const
+        {
+            const auto iter = unread.find(partition);
+            return iter == unread.end() ? 0 : iter->second;
+        }
+
+        // entries stay valid until the read head is moved past them with updateReadHead
+        EntryList read(const Table* table, const int32_t partition, const int limit, int64_t& readPosition)
         {
             readPosition = 0;
 
-            JsonList resultList;
+            EntryList resultList;
             resultList.reserve(limit);
 
             const auto tableHash = table->getTableHash();
@@ -239,9 +564,14 @@ namespace openset::db
             else
                 cursor = cursor->next;
 
+            auto& pendingRead = pendingReads[std::make_pair(tableHash, partition)];
+            pendingRead.sequences.clear();
+
             if (!cursor)
             {
                 readPosition = reinterpret_cast<int64_t>(lastCursor);
+                pendingRead.handle = readPosition;
+                pendingRead.count = 0;
                 trimSideLog();
                 return resultList;
             }
@@ -252,7 +582,10 @@ namespace openset::db
 
                 if (cursor->tableHash == tableHash && cursor->partition == partition)
                 {
-                    resultList.push_back(cursor->jsonData);
+                    resultList.push_back(cursor->data);
+
+                    if (cursor->origin)
+                        pendingRead.sequences.emplace_back(cursor->origin, cursor->sequence);
 
                     if (static_cast<int>(resultList.size()) == limit)
                         break;
@@ -263,6 +596,10 @@ namespace openset::db
 
             readPosition = reinterpret_cast<int64_t>(lastCursor);
 
+            // these only leave the backlog when the caller moves the read head past them
+            pendingRead.handle = readPosition;
+            pendingRead.count = static_cast<int64_t>(resultList.size());
+
             trimSideLog();
 
             return resultList;
@@ -271,14 +608,81 @@ namespace openset::db
         void updateReadHead(const Table* table, const int32_t partition, const int64_t handle)
         {
             csLock lock(cs);
+
+            const auto key = std::make_pair(table->getTableHash(), partition);
+
+            if (const auto pendingRead = pendingReads.find(key);
+                pendingRead != pendingReads.end() && pendingRead->second.handle == handle)
+            {
+                unread[partition] -= pendingRead->second.count;
+
+                // the insert cell moves the read head once the rows are applied
+                if (!pendingRead->second.sequences.empty())
+                {
+                    auto& watermarks = applied[key];
+                    for (const auto& sequence : pendingRead->second.sequences)
+                        watermarks[sequence.first].mark(sequence.second);
+
+                    notifyApplied();
+                }
+
+                pendingReads.erase(pendingRead);
+            }
+
             setLastRead(table->getTableHash(), partition, reinterpret_cast<SideLogCursor_s*>(handle));
         }
 
+        // true once `partition` has applied every row from `rowOrigin` up to `sequence`
+        bool isApplied(const Table* table, const int32_t partition, const int64_t rowOrigin, const int64_t sequence)
+        {
+            csLock lock(cs);
+
+            const auto watermarks = applied.find(std::make_pair(table->getTableHash(), partition));
+            if (watermarks == applied.end())
+                return false;
+
+            const auto watermark = watermarks->second.find(rowOrigin);
+            return watermark != watermarks->second.end() && watermark->second.contiguous >= sequence;
+        }
+
+        // pass to waitApplied, read before checking isApplied so no change is missed
+        int64_t getAppliedVersion()
+        {
+            std::lock_guard<std::mutex> guard(appliedLock);
+            return appliedVersion;
+        }
+
+        // sleeps until rows are applied after `version` was read, or until `deadline` (ms)
+        void waitApplied(const int64_t version, const int64_t deadline)
+        {
+            std::unique_lock<std::mutex> guard(appliedLock);
+            appliedChanged.wait_for(
+                guard,
+                std::chrono::milliseconds(std::max<int64_t>(0, deadline - Now())),
+                [&]() { return appliedVersion != version; });
+        }
+
         void resetReadHead(const Table* table, const int32_t partition)
         {
             csLock lock(cs);
             const auto tableHash = table->getTableHash();
             setLastRead(tableHash, partition, nullptr);
+            recountUnread();
+        }
+
+        // unread entries per partition (all tables). Read heads point at the last
+        // entry consumed, so an entry is backlog once its read head has been passed
+        std::unordered_map<int32_t, int64_t> getBacklog()
+        {
+            csLock lock(cs);
+
+            std::unordered_map<int32_t, int64_t> backlog;
+
+            for (const auto& count : unread)
+                if (count.second)
+                    backlog.emplace(count.first, count.second);
+
+            return backlog;
         }
 
         void removeReadHeadsByPartition(const int32_t partition)
@@ -292,6 +696,8 @@ namespace openset::db
                 else
                     ++iter;
             }
+
+            recountUnread();
         }
 
         void serialize(HeapStack* mem)
@@ -386,6 +792,7 @@ namespace openset::db
             // reset the read-head so this entire new transaction log
             // will get replayed through the insert mechanism
             resetReadHeads();
+            recountUnread();
         }
     };
 }
@@ -0,0 +1,153 @@
+#include "sketch.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace openset::result;
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+
+    // t-digest k1 scale function, a centroid may span at most 1 unit of k
+    double scale(const double q)
+    {
+        return (SKETCH_COMPRESSION / (2.0 * PI)) * std::asin(2.0 * q - 1.0);
+    }
+}
+
+void QuantileSketch_s::init()
+{
+    min = 0;
+    max = 0;
+    count = 0;
+    size = 0;
+    reserved = 0;
+}
+
+void QuantileSketch_s::add(const double value, const int64_t weight)
+{
+    if (weight <= 0)
+        return;
+
+    if (size == SKETCH_CAPACITY)
+        compress();
+
+    if (!count)
+    {
+        min = value;
+        max = value;
+    }
+    else
+    {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    centroids[size++] = Centroid_s{ value, weight };
+    count += weight;
+}
+
+void QuantileSketch_s::merge(const QuantileSketch_s* other)
+{
+    if (!other || !other->count)
+        return;
+
+    const auto otherMin = other->min;
+    const auto otherMax = other->max;
+
+    for (auto i = 0; i < other->size; ++i)
+        add(other->centroids[i].mean, other->centroids[i].weight);
+
+    // the centroids carry means, keep the real extremes
+    min = std::min(min, otherMin);
+    max = std::max(max, otherMax);
+}
+
+void QuantileSketch_s::compress()
+{
+    if (size <= 1)
+        return;
+
+    std::sort(
+        centroids,
+        centroids + size,
+        [](const Centroid_s& left, const Centroid_s& right) -> bool
+        {
+            return left.mean < right.mean;
+        });
+
+    const auto total = static_cast<double>(count);
+
+    auto out = 0;
+    double before = 0;                  // weight ahead of the centroid being built
+    auto limit = scale(0.0) + 1.0;
+
+    for (auto i = 1; i < size; ++i)
+    {
+        auto& current = centroids[out];
+        const auto& next = centroids[i];
+
+        const auto proposed = before + current.weight + next.weight;
+
+        if (scale(proposed / total) <= limit)
+        {
+            const auto weight = current.weight + next.weight;
+            current.mean += (next.mean - current.mean) * (static_cast<double>(next.weight) / weight);
+            current.weight = weight;
+        }
+        else
+        {
+            before += current.weight;
+            limit = scale(before / total) + 1.0;
+            centroids[++out] = next;
+        }
+    }
+
+    size = out + 1;
+}
+
+double QuantileSketch_s::quantile(const double q)
+{
+    if (!count)
+        return 0;
+
+    compress();
+
+    if (q <= 0)
+        return min;
+    if (q >= 1)
+        return max;
+
+    const auto target = q * count;
+
+    // each centroid is centered on the middle of its weight, values are
+    // interpolated between neighbouring centers (or the extremes at the ends)
+    double before = 0;
+    for (auto i = 0; i < size; ++i)
+    {
+        const auto weight = static_cast<double>(centroids[i].weight);
+        const auto center = before + weight / 2.0;
+
+        if (target < center)
+        {
+            const auto leftMean = i ? centroids[i - 1].mean : min;
+            const auto leftCenter = i ? before - centroids[i - 1].weight / 2.0 : 0.0;
+
+            if (center == leftCenter)
+                return centroids[i].mean;
+
+            return leftMean + (centroids[i].mean - leftMean) * ((target - leftCenter) / (center - leftCenter));
+        }
+
+        before += weight;
+    }
+
+    const auto lastCenter = count - centroids[size - 1].weight / 2.0;
+    const auto span = count - lastCenter;
+
+    if (span <= 0)
+        return max;
+
+    return centroids[size - 1].mean + (max - centroids[size - 1].mean) * ((target - lastCenter) / span);
+}
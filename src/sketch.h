@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+    Quantile sketch
+
+    A merging t-digest with a fixed footprint, used by the percentile aggregates
+    (`median`, `p75`, `p90`, `p95` and `p99`). Values are collected as weighted
+    centroids, when the buffer fills the centroids are sorted and neighbours are
+    combined as long as they stay under the size the t-digest scale function
+    allows for their quantile. Centroids near the ends stay small, so the tails
+    (p95, p99) keep their accuracy while the middle is summarized coarsely.
+
+    Compression leaves at most SKETCH_COMPRESSION + 1 centroids (usually about
+    60), so a sketch is the same size no matter how many distinct values were
+    added. Only the centroids in use are sent between nodes. Two sketches
+    merge by adding the centroids of one to the other, which is how partitions
+    and nodes combine their results.
+
+    Values are what the accumulator would hold (doubles scaled by 10000).
+*/
+
+namespace openset::result
+{
+    const int SKETCH_COMPRESSION = 100;
+    const int SKETCH_CAPACITY = 128; // must be over SKETCH_COMPRESSION + 1
+
+    struct Centroid_s
+    {
+        double mean;
+        int64_t weight;
+    };
+
+    struct QuantileSketch_s
+    {
+        double min;
+        double max;
+        int64_t count;
+        int32_t size;     // centroids in use
+        int32_t reserved;
+        Centroid_s centroids[SKETCH_CAPACITY];
+
+        void init();
+        void add(double value, int64_t weight = 1);
+        void merge(const QuantileSketch_s* other);
+        void compress();
+
+        // estimated value at quantile `q` (0 to 1)
+        double quantile(double q);
+
+        // bytes used by a compressed sketch when serialized, centroids past `size` are not sent
+        int64_t packedBytes() const
+        {
+            return static_cast<int64_t>(sizeof(QuantileSketch_s) - sizeof(centroids) + sizeof(Centroid_s) * size);
+        }
+    };
+}
@@ -0,0 +1,343 @@
+#include "staging.h"
+
+#include <vector>
+#include <cstring>
+
+#include "table.h"
+#include "properties.h"
+#include "time/epoch.h"
+#include "str/strtools.h"
+#include "sba/sba.h"
+
+using namespace openset::db;
+
+namespace
+{
+    // scratch space reused by every row staged on the calling thread
+    struct Scratch_s
+    {
+        std::vector<StagedValue_s> values;
+        std::string text;
+
+        void clear()
+        {
+            values.clear();
+            text.clear();
+        }
+
+        void push(const StagedKind_e kind, const int32_t property, const int64_t value = NONE, const bool member = false)
+        {
+            StagedValue_s staged;
+            staged.kind = kind;
+            staged.property = property;
+            staged.value = value;
+            staged.member = member;
+            values.push_back(staged);
+        }
+
+        void push(const StagedKind_e kind, const int32_t property, const int64_t value, const std::string& valueText, const bool member = false)
+        {
+            push(kind, property, value, member);
+            values.back().textOffset = static_cast<int32_t>(text.length());
+            values.back().textLength = static_cast<int32_t>(valueText.length());
+            text += valueText;
+        }
+    };
+
+    thread_local Scratch_s scratch;
+
+    // converts a scalar to the value an event property stores, same rules as Grid::insertParse
+    bool toEventValue(cjson* node, const PropertyTypes_e type, int64_t& value, std::string& text)
+    {
+        switch (node->type())
+        {
+        case cjson::Types_e::INT:
+            switch (type)
+            {
+            case PropertyTypes_e::intProp:
+                value = node->getInt();
+                return true;
+            case PropertyTypes_e::doubleProp:
+                value = cast<int64_t>(node->getInt() * 10000LL);
+                return true;
+            case PropertyTypes_e::boolProp:
+                value = node->getInt() ? 1 : 0;
+                return true;
+            case PropertyTypes_e::textProp:
+                text = to_string(node->getInt());
+                value = MakeHash(text);
+                return true;
+            default:
+                return false;
+            }
+        case cjson::Types_e::DBL:
+            switch (type)
+            {
+            case PropertyTypes_e::intProp:
+                value = cast<int64_t>(node->getDouble());
+                return true;
+            case PropertyTypes_e::doubleProp:
+                value = cast<int64_t>(node->getDouble() * 10000LL);
+                return true;
+            case PropertyTypes_e::boolProp:
+                value = node->getDouble() != 0;
+                return true;
+            case PropertyTypes_e::textProp:
+                text = to_string(node->getDouble());
+                value = MakeHash(text);
+                return true;
+            default:
+                return false;
+            }
+        case cjson::Types_e::STR:
+            switch (type)
+            {
+            case PropertyTypes_e::boolProp:
+                value = node->getString() != "0";
+                return true;
+            case PropertyTypes_e::textProp:
+                text = node->getString();
+                value = MakeHash(text);
+                return true;
+            default:
+                return false;
+            }
+        case cjson::Types_e::BOOL:
+            switch (type)
+            {
+            case PropertyTypes_e::intProp:
+                value = node->getBool() ? 1 : 0;
+                return true;
+            case PropertyTypes_e::doubleProp:
+                value = node->getBool() ? 10000 : 0;
+                return true;
+            case PropertyTypes_e::boolProp:
+                value = node->getBool();
+                return true;
+            case PropertyTypes_e::textProp:
+                text = node->getBool() ? "true" : "false";
+                value = MakeHash(text);
+                return true;
+            default:
+                return false;
+            }
+        default:
+            return false;
+        }
+    }
+
+    void stageEventProperty(const Properties::Property_s* propInfo, cjson* node)
+    {
+        scratch.push(StagedKind_e::property, propInfo->idx);
+
+        int64_t value = NONE;
+        std::string text;
+
+        if (node->type() == cjson::Types_e::ARRAY)
+        {
+            if (!propInfo->isSet)
+                return;
+
+            scratch.push(StagedKind_e::set, propInfo->idx);
+
+            for (auto member : node->getNodes())
+                if (toEventValue(member, propInfo->type, value, text))
+                {
+                    if (propInfo->type == PropertyTypes_e::textProp)
+                        scratch.push(StagedKind_e::member, propInfo->idx, value, text);
+                    else
+                        scratch.push(StagedKind_e::member, propInfo->idx, value);
+                }
+
+            return;
+        }
+
+        if (!toEventValue(node, propInfo->type, value, text))
+            return;
+
+        if (propInfo->type == PropertyTypes_e::textProp)
+            scratch.push(StagedKind_e::value, propInfo->idx, value, text);
+        else
+            scratch.push(StagedKind_e::value, propInfo->idx, value);
+    }
+
+    // customer properties go through cvar, so values are staged typed rather than
+    // converted. Set members follow the (slightly different) set rules of insertParse
+    void stageCustomerValue(const Properties::Property_s* propInfo, cjson* node, const bool member)
+    {
+        const auto idx = propInfo->idx;
+
+        switch (node->type())
+        {
+        case cjson::Types_e::INT:
+            switch (propInfo->type)
+            {
+            case PropertyTypes_e::intProp:
+            case PropertyTypes_e::doubleProp:
+                scratch.push(StagedKind_e::customerInt, idx, node->getInt(), member);
+                break;
+            case PropertyTypes_e::boolProp:
+                scratch.push(StagedKind_e::customerBool, idx, node->getInt() ? 1 : 0, member);
+                break;
+            case PropertyTypes_e::textProp:
+                scratch.push(StagedKind_e::customerText, idx, 0, to_string(node->getInt()), member);
+                break;
+            default:
+                break;
+            }
+            break;
+        case cjson::Types_e::DBL:
+            switch (propInfo->type)
+            {
+            case PropertyTypes_e::intProp:
+            case PropertyTypes_e::doubleProp:
+                if (member)
+                    scratch.push(StagedKind_e::customerInt, idx, cast<int64_t>(node->getDouble()), member);
+                else
+                {
+                    auto number = node->getDouble();
+                    scratch.push(StagedKind_e::customerReal, idx, *reinterpret_cast<int64_t*>(&number), member);
+                }
+                break;
+            case PropertyTypes_e::boolProp:
+                scratch.push(StagedKind_e::customerBool, idx, node->getDouble() != 0 ? 1 : 0, member);
+                break;
+            case PropertyTypes_e::textProp:
+                scratch.push(StagedKind_e::customerText, idx, 0, to_string(node->getDouble()), member);
+                break;
+            default:
+                break;
+            }
+            break;
+        case cjson::Types_e::STR:
+            switch (propInfo->type)
+            {
+            case PropertyTypes_e::boolProp:
+                scratch.push(StagedKind_e::customerBool, idx, node->getString() != "0" ? 1 : 0, member);
+                break;
+            case PropertyTypes_e::textProp:
+                scratch.push(StagedKind_e::customerText, idx, 0, node->getString(), member);
+                break;
+            default:
+                break;
+            }
+            break;
+        case cjson::Types_e::BOOL:
+            switch (propInfo->type)
+            {
+            case PropertyTypes_e::intProp:
+            case PropertyTypes_e::doubleProp:
+                scratch.push(StagedKind_e::customerInt, idx, node->getBool() ? 1 : 0, member);
+                break;
+            case PropertyTypes_e::boolProp:
+                scratch.push(StagedKind_e::customerBool, idx, node->getBool() ? 1 : 0, member);
+                break;
+            case PropertyTypes_e::textProp:
+                scratch.push(StagedKind_e::customerText, idx, 0, std::string(node->getBool() ? "true" : "false"), member);
+                break;
+            default:
+                break;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void stageCustomerProperty(const Properties::Property_s* propInfo, cjson* node)
+    {
+        // present even when the value is dropped, the row still updates customer properties
+        scratch.push(StagedKind_e::customer, propInfo->idx);
+
+        if (node->type() == cjson::Types_e::ARRAY)
+        {
+            if (!propInfo->isSet)
+                return;
+
+            scratch.push(StagedKind_e::customerSet, propInfo->idx);
+
+            for (auto member : node->getNodes())
+                stageCustomerValue(propInfo, member, true);
+
+            return;
+        }
+
+        stageCustomerValue(propInfo, node, false);
+    }
+}
+
+StagedRow_s* InsertStaging::stage(Table* table, cjson* row)
+{
+    const auto properties = table->getProperties();
+
+    scratch.clear();
+
+    StagedRow_s header;
+
+    std::string idText;
+    if (table->numericCustomerIds)
+    {
+        header.customerId = row->xPathInt("/id", 0);
+    }
+    else
+    {
+        idText = row->xPathString("/id", "");
+        toLower(idText);
+
+        // Customers::createCustomer keeps the first 64 characters
+        if (idText.length() > 64)
+            idText.erase(64);
+
+        header.customerId = MakeHash(idText);
+    }
+
+    const auto stampNode = row->xPath("/stamp");
+
+    if (stampNode && stampNode->type() == cjson::Types_e::STR)
+        header.stamp = Epoch::fixMilli(Epoch::ISO8601ToEpoch(stampNode->getString()));
+    else if (stampNode)
+        header.stamp = Epoch::fixMilli(stampNode->getInt());
+
+    header.eventHash = MakeHash(row->xPathString("/event", ""));
+
+    for (auto node : row->getNodes())
+    {
+        const auto propInfo = properties->getProperty(node->name());
+
+        // unknown properties are dropped, like the grid does when they aren't mapped
+        if (!propInfo || propInfo->deleted)
+            continue;
+
+        if (propInfo->isCustomerProperty)
+            stageCustomerProperty(propInfo, node);
+        else
+            stageEventProperty(propInfo, node);
+    }
+
+    header.valueCount = static_cast<int32_t>(scratch.values.size());
+    header.idLength = static_cast<int32_t>(idText.length());
+    header.textLength = static_cast<int32_t>(scratch.text.length());
+    header.length = static_cast<int32_t>(
+        sizeof(StagedRow_s) +
+        sizeof(StagedValue_s) * scratch.values.size() +
+        idText.length() +
+        scratch.text.length());
+
+    const auto staged = recast<StagedRow_s*>(PoolMem::getPool().getPtr(header.length));
+    *staged = header;
+
+    auto write = recast<char*>(staged + 1);
+
+    if (!scratch.values.empty())
+        memcpy(write, scratch.values.data(), sizeof(StagedValue_s) * scratch.values.size());
+    write += sizeof(StagedValue_s) * scratch.values.size();
+
+    if (!idText.empty())
+        memcpy(write, idText.data(), idText.length());
+    write += idText.length();
+
+    if (!scratch.text.empty())
+        memcpy(write, scratch.text.data(), scratch.text.length());
+
+    return staged;
+}
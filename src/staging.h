@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+
+#include "common.h"
+#include "cjson/cjson.h"
+
+/*
+    Staged insert rows
+
+    Inserts are converted once, on the node that receives them, into flat rows
+    the insert cells can apply without touching JSON. Property names are resolved
+    to schema indexes, values are converted to what the grid stores (text hashed,
+    doubles scaled), the stamp is parsed and the event name hashed. Text is kept
+    alongside the values so attributes can be created the first time a value is
+    seen.
+
+    A staged row is a single PoolMem buffer:
+
+        [StagedRow_s][StagedValue_s x valueCount][id text][value text]
+
+    Values are in document order. An event property is a `property` entry followed
+    by its `value`, or by a `set` and its `member`s. A customer property is a
+    `customer` entry followed by its typed value, or by `customerSet` and typed
+    values flagged as members.
+*/
+
+namespace openset::db
+{
+    class Table;
+
+    enum class StagedKind_e : uint8_t
+    {
+        property,     // an event property is present (even if its value can't be converted)
+        value,        // event property value
+        set,          // event property set, its members follow
+        member,       // event property set member
+        customer,     // a customer property is present
+        customerInt,
+        customerReal, // value holds the bits of a double
+        customerBool,
+        customerText,
+        customerSet,  // customer property set, its members follow
+    };
+
+    struct StagedValue_s
+    {
+        int64_t value{ NONE };  // stored value
+        int32_t property{ -1 }; // schema index
+        int32_t textOffset{ 0 };
+        int32_t textLength{ -1 }; // -1 if the value has no text
+        StagedKind_e kind{ StagedKind_e::value };
+        bool member{ false };     // customer set member
+
+        double getDouble() const
+        {
+            return *reinterpret_cast<const double*>(&value);
+        }
+    };
+
+    struct StagedRow_s
+    {
+        int64_t customerId{ 0 }; // numeric id, or the hash of the (lower case) text id
+        int64_t stamp{ 0 };      // -1 if the stamp could not be parsed
+        int64_t eventHash{ 0 };
+        int32_t length{ 0 };     // bytes in the buffer, header included
+        int32_t valueCount{ 0 };
+        int32_t idLength{ 0 };   // 0 for numeric ids
+        int32_t textLength{ 0 };
+
+        const StagedValue_s* values() const
+        {
+            return reinterpret_cast<const StagedValue_s*>(this + 1);
+        }
+
+        const char* idText() const
+        {
+            return reinterpret_cast<const char*>(values() + valueCount);
+        }
+
+        const char* text(const StagedValue_s& value) const
+        {
+            return idText() + idLength + value.textOffset;
+        }
+
+        std::string getId() const
+        {
+            return std::string(idText(), idLength);
+        }
+    };
+
+    class InsertStaging
+    {
+    public:
+        // stages a validated insert row (it has an id of the type the table expects).
+        // Returns a PoolMem buffer, the length is in the row header
+        static StagedRow_s* stage(Table* table, cjson* row);
+    };
+}
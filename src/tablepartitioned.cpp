@@ -15,6 +15,9 @@ SegmentPartitioned_s::~SegmentPartitioned_s()
 
     if (interpreter)
         delete interpreter;
+
+    if (insertInterpreter)
+        delete insertInterpreter;
 }
 
 openset::db::IndexBits* openset::db::SegmentPartitioned_s::prepare(Attributes& attributes)
@@ -70,6 +73,37 @@ openset::query::Interpreter * openset::db::SegmentPartitioned_s::getInterpreter(
     return interpreter;
 }
 
+openset::query::Interpreter * openset::db::SegmentPartitioned_s::getInsertInterpreter(int64_t maxLinearId)
+{
+    if (!insertInterpreter)
+        insertInterpreter = new openset::query::Interpreter(insertMacros, openset::query::InterpretMode_e::count);
+
+    if (!bits)
+        throw std::runtime_error("call prepare before calling getInsertInterpreter");
+
+    insertInterpreter->setBits(bits, maxLinearId);
+
+    return insertInterpreter;
+}
+
+bool openset::db::SegmentPartitioned_s::isTouched(const std::bitset<MAX_PROPERTIES>& touched) const
+{
+    auto referenced = false;
+
+    for (const auto& var : macros.vars.tableVars)
+    {
+        if (var.schemaColumn < 0 || var.schemaColumn >= MAX_PROPERTIES)
+            continue;
+
+        referenced = true;
+
+        if (touched[var.schemaColumn])
+            return true;
+    }
+
+    return !referenced;
+}
+
 TablePartitioned::TablePartitioned(
     Table* table,
     const int partition,
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <bitset>
 #include <queue>
 
 #include "threads/locks.h"
@@ -40,11 +41,14 @@ namespace openset
             int64_t segmentHash { 0 };
             int64_t refreshTime{ 86400 };
             query::Macro_s macros;
+            // the insert interpreter configures its own copy for the full schema grid
+            query::Macro_s insertMacros;
 
             int zIndex {100};
             int64_t lastModified {0};
             bool    onInsert {false};
             query::Interpreter* interpreter { nullptr };
+            query::Interpreter* insertInterpreter { nullptr };
             IndexBits* bits { nullptr };
 
             int changeCount {0};
@@ -59,6 +63,7 @@ namespace openset
                 segmentHash(MakeHash(segmentName)),
                 refreshTime(refreshTime),
                 macros(macros),
+                insertMacros(macros),
                 zIndex(zIndex),
                 onInsert(onInsert)
             {}
@@ -82,6 +87,14 @@ namespace openset
             // returns a new or cached interpreter. Call prepare before calling get Interpreter
             query::Interpreter* getInterpreter(int64_t maxLinearId);
 
+            // interpreter for the insert cell. It runs on the insert grid (every property mapped)
+            // so it is configured differently from the one above, which runs on grids mapped to
+            // just this script's properties. Call prepare first.
+            query::Interpreter* getInsertInterpreter(int64_t maxLinearId);
+
+            // true if the script references one of the `touched` schema properties (or none at all)
+            bool isTouched(const std::bitset<MAX_PROPERTIES>& touched) const;
+
         };
 
 
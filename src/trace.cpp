@@ -0,0 +1,214 @@
+#include "trace.h"
+
+#include <mutex>
+#include <random>
+
+#include "common.h"
+#include "threads/locks.h"
+
+namespace openset::trace
+{
+    std::atomic<bool> enabled{ true };
+    std::atomic<bool> verbose{ false };
+}
+
+using namespace openset::trace;
+
+namespace
+{
+    // single writer (the owning thread), readers use the slot sequence
+    // numbers to skip slots that are being written while they copy.
+    // Fields are relaxed atomics so a reader racing the writer is defined,
+    // the sequence check throws away any torn copy
+    struct Ring_s
+    {
+        struct Slot_s
+        {
+            std::atomic<uint64_t> sequence{ 0 }; // odd while writing
+            std::atomic<const char*> name{ nullptr };
+            std::atomic<int64_t> traceId{ 0 };
+            std::atomic<int64_t> start{ 0 };
+            std::atomic<int64_t> duration{ 0 };
+            std::atomic<int64_t> arg{ -1 };
+
+            void store(const Span_s& span)
+            {
+                name.store(span.name, std::memory_order_relaxed);
+                traceId.store(span.traceId, std::memory_order_relaxed);
+                start.store(span.start, std::memory_order_relaxed);
+                duration.store(span.duration, std::memory_order_relaxed);
+                arg.store(span.arg, std::memory_order_relaxed);
+            }
+
+            Span_s load() const
+            {
+                Span_s span;
+                span.name = name.load(std::memory_order_relaxed);
+                span.traceId = traceId.load(std::memory_order_relaxed);
+                span.start = start.load(std::memory_order_relaxed);
+                span.duration = duration.load(std::memory_order_relaxed);
+                span.arg = arg.load(std::memory_order_relaxed);
+                return span;
+            }
+        };
+
+        int32_t threadId;
+        uint64_t head{ 0 };
+        Slot_s slots[TRACE_RING_SIZE];
+
+        explicit Ring_s(const int32_t threadId) :
+            threadId(threadId)
+        {}
+
+        void push(const Span_s& span)
+        {
+            auto& slot = slots[head % TRACE_RING_SIZE];
+            const auto sequence = head * 2 + 1;
+
+            slot.sequence.store(sequence, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.store(span);
+            slot.sequence.store(sequence + 1, std::memory_order_release);
+
+            ++head;
+        }
+    };
+
+    CriticalSection ringsLock;
+    std::vector<Ring_s*> rings;    // every ring ever made, never freed
+    std::vector<Ring_s*> idleRings; // rings from threads that have exited
+    int32_t nextThreadId{ 0 };
+
+    // returns the ring to the idle list when the thread exits, so
+    // short lived threads don't grow the ring list
+    struct RingOwner_s
+    {
+        Ring_s* ring{ nullptr };
+
+        ~RingOwner_s()
+        {
+            if (!ring)
+                return;
+            csLock lock(ringsLock);
+            idleRings.push_back(ring);
+        }
+    };
+
+    thread_local RingOwner_s ringOwner;
+    thread_local int64_t traceContext{ 0 };
+
+    Ring_s* getRing()
+    {
+        if (!ringOwner.ring)
+        {
+            csLock lock(ringsLock);
+
+            if (!idleRings.empty())
+            {
+                ringOwner.ring = idleRings.back();
+                idleRings.pop_back();
+            }
+            else
+            {
+                ringOwner.ring = new Ring_s(nextThreadId++);
+                rings.push_back(ringOwner.ring);
+            }
+        }
+
+        return ringOwner.ring;
+    }
+}
+
+int64_t openset::trace::getContext()
+{
+    return traceContext;
+}
+
+void openset::trace::setContext(const int64_t traceId)
+{
+    traceContext = traceId;
+}
+
+int64_t openset::trace::newTraceId()
+{
+    static thread_local std::mt19937_64 generator(std::random_device{}() ^ (nowMicros() << 8));
+    // positive so it survives a round trip through getParamInt
+    return static_cast<int64_t>(generator() >> 1);
+}
+
+void openset::trace::record(const char* name, const int64_t start, const int64_t end, const int64_t arg)
+{
+    if (!enabled)
+        return;
+
+    Span_s span;
+    span.name = name;
+    span.traceId = traceContext;
+    span.start = start;
+    span.duration = end - start;
+    span.arg = arg;
+
+    getRing()->push(span);
+}
+
+std::vector<std::pair<int32_t, Span_s>> openset::trace::collect(const int64_t from, const int64_t to, const int64_t traceId)
+{
+    std::vector<Ring_s*> ringList;
+
+    {
+        csLock lock(ringsLock);
+        ringList = rings;
+    }
+
+    std::vector<std::pair<int32_t, Span_s>> result;
+
+    for (auto ring : ringList)
+    {
+        for (auto& slot : ring->slots)
+        {
+            const auto before = slot.sequence.load(std::memory_order_acquire);
+
+            if (!before || (before & 1))
+                continue;
+
+            const auto span = slot.load();
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != before)
+                continue; // overwritten while we copied it
+
+            if (span.start + span.duration < from || span.start > to)
+                continue;
+
+            if (traceId && span.traceId != traceId)
+                continue;
+
+            result.emplace_back(ring->threadId, span);
+        }
+    }
+
+    return result;
+}
+
+void openset::trace::toChromeTrace(cjson* events, const int64_t pid, const int64_t from, const int64_t to, const int64_t traceId)
+{
+    for (const auto& item : collect(from, to, traceId))
+    {
+        const auto& span = item.second;
+
+        auto event = events->pushObject();
+        event->set("name", span.name);
+        event->set("cat", "openset");
+        event->set("ph", "X");
+        event->set("ts", span.start);
+        event->set("dur", span.duration);
+        event->set("pid", pid);
+        event->set("tid", static_cast<int64_t>(item.first));
+
+        auto args = event->setObject("args");
+        if (span.traceId)
+            args->set("trace_id", to_string(span.traceId));
+        if (span.arg != -1)
+            args->set("arg", span.arg);
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "cjson/cjson.h"
+
+/*
+    Span tracing
+
+    Every thread records completed spans into its own fixed size ring buffer,
+    so recording is a clock read on entry and exit plus a write into memory no
+    other thread writes. Old spans are overwritten, the rings always hold the
+    most recent history and are only read when a trace is dumped.
+
+    Spans carry a trace id. An id is assigned when a request arrives (or taken
+    from the `trace_id` param when a node forwards one), cells inherit the id
+    of the request that created them, and forkQuery passes it on to every node
+    it dispatches to, so a query can be followed across the cluster.
+
+    GET /v1/trace gathers spans from every node in Chrome trace event format,
+    it loads directly in chrome://tracing or ui.perfetto.dev.
+
+    Verbose spans (i.e. per customer decode) are off by default as they would
+    flush everything else out of the rings in a few milliseconds.
+*/
+
+namespace openset::trace
+{
+    const int TRACE_RING_SIZE = 4096; // spans per thread
+
+    struct Span_s
+    {
+        const char* name { nullptr }; // static strings only
+        int64_t traceId { 0 };
+        int64_t start { 0 };    // epoch microseconds, comparable across nodes
+        int64_t duration { 0 }; // microseconds
+        int64_t arg { -1 };     // i.e. partition
+    };
+
+    extern std::atomic<bool> enabled;
+    extern std::atomic<bool> verbose;
+
+    // microseconds since epoch
+    inline int64_t nowMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // trace id of the work the calling thread is doing
+    int64_t getContext();
+    void setContext(int64_t traceId);
+    int64_t newTraceId();
+
+    // record a span that has already completed
+    void record(const char* name, int64_t start, int64_t end, int64_t arg = -1);
+
+    // spans in [from, to] (epoch microseconds), all threads, optionally one trace id (0 = all)
+    std::vector<std::pair<int32_t, Span_s>> collect(int64_t from, int64_t to, int64_t traceId);
+
+    // appends Chrome trace events for this node to `events` (an array), `pid` identifies the node
+    void toChromeTrace(cjson* events, int64_t pid, int64_t from, int64_t to, int64_t traceId);
+
+    // records the lifetime of the object as a span
+    class Span
+    {
+        const char* name;
+        int64_t start;
+        int64_t arg;
+
+    public:
+        explicit Span(const char* name, const int64_t arg = -1) :
+            name(name),
+            start(enabled ? nowMicros() : 0),
+            arg(arg)
+        {}
+
+        ~Span()
+        {
+            if (start)
+                record(name, start, nowMicros(), arg);
+        }
+    };
+
+    // sets the thread trace context for a scope, restoring the previous one
+    class Context
+    {
+        int64_t previous;
+
+    public:
+        explicit Context(const int64_t traceId) :
+            previous(getContext())
+        {
+            setContext(traceId);
+        }
+
+        ~Context()
+        {
+            setContext(previous);
+        }
+    };
+}
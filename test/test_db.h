@@ -3,6 +3,7 @@
 #include "testing.h"
 
 #include "../lib/cjson/cjson.h"
+#include "../lib/heapstack/heapstack.h"
 #include "../src/database.h"
 #include "../src/table.h"
 #include "../src/properties.h"
@@ -10,6 +11,15 @@
 #include "../src/tablepartitioned.h"
 #include "../src/queryinterpreter.h"
 #include "../src/internoderouter.h"
+#include "../src/sidelog.h"
+#include "../src/oloop_load.h"
+#include "../src/ingest.h"
+#include "../src/sentinel.h"
+#include "../src/rpc_insert.h"
+#include "../src/oloop_insert.h"
+#include "../src/oloop_seg_refresh.h"
+#include "../src/oloop_seg_export.h"
+#include "../src/staging.h"
 
 #include "test_helper.h"
 
@@ -866,5 +876,769 @@ inline Tests test_db()
             }
         },
 
+        {
+            "db: attribute clearDirty applies the last change per customer",
+            []
+            {
+                auto table = openset::globals::database->newTable("__testdirty__", false);
+                table->getProperties()->setProperty(2000, "some_int", PropertyTypes_e::intProp, false);
+
+                auto& attributes = table->getPartitionObjects(0, true)->attributes;
+
+                const auto population = [&attributes](const int64_t value) -> int64_t
+                {
+                    const auto attr = attributes.get(2000, value);
+                    if (!attr)
+                        return -1;
+                    const auto bits = attr->getBits();
+                    const auto count = bits->population(bits->ints * 64);
+                    delete bits;
+                    return count;
+                };
+
+                const auto isSet = [&attributes](const int64_t value, const int32_t linId) -> bool
+                {
+                    const auto bits = attributes.get(2000, value)->getBits();
+                    const auto state = bits->bitState(linId);
+                    delete bits;
+                    return state;
+                };
+
+                // the same customer set and cleared several times in one slice
+                attributes.getMake(2000, 5);
+                attributes.setDirty(3, 2000, 5, true);
+                attributes.setDirty(7, 2000, 5, true);
+                attributes.setDirty(3, 2000, 5, false);
+                attributes.setDirty(7, 2000, 5, false);
+                attributes.setDirty(3, 2000, 5, true);
+                attributes.setDirty(9, 2000, 5, true);
+                attributes.setDirty(9, 2000, 5, false);
+                attributes.clearDirty();
+
+                ASSERT(attributes.changeIndex.empty());
+                ASSERT(population(5) == 1);
+                ASSERT(isSet(5, 3));
+                ASSERT(!isSet(5, 7));
+                ASSERT(!isSet(5, 9));
+
+                // grow past the sparse layout, then shrink back in place
+                for (auto linId = 0; linId < 500; ++linId)
+                    attributes.setDirty(linId, 2000, 5, true);
+                attributes.clearDirty();
+
+                ASSERT(population(5) == 500);
+
+                for (auto linId = 1; linId < 500; ++linId)
+                    attributes.setDirty(linId, 2000, 5, false);
+                attributes.clearDirty();
+
+                ASSERT(population(5) == 1);
+                ASSERT(isSet(5, 0));
+                ASSERT(!isSet(5, 3));
+                ASSERT(!isSet(5, 499));
+
+                // a change that moves nothing leaves the stored copy alone
+                const auto unchanged = attributes.get(2000, 5);
+                attributes.setDirty(0, 2000, 5, true);
+                attributes.setDirty(3, 2000, 5, false);
+                attributes.clearDirty();
+
+                ASSERT(attributes.get(2000, 5) == unchanged);
+                ASSERT(population(5) == 1);
+
+                // shrinking to nothing drops the attribute
+                attributes.setDirty(0, 2000, 5, false);
+                attributes.clearDirty();
+
+                ASSERT(population(5) == -1);
+
+                // a new attribute that ends up empty is dropped
+                attributes.getMake(2000, 6);
+                attributes.setDirty(4, 2000, 6, true);
+                attributes.setDirty(4, 2000, 6, false);
+                attributes.clearDirty();
+
+                ASSERT(population(6) == -1);
+
+                // a new attribute that was never set is dropped too
+                attributes.getMake(2000, 8);
+                attributes.setDirty(2, 2000, 8, false);
+                attributes.clearDirty();
+
+                ASSERT(population(8) == -1);
+            }
+        },
+
+        {
+            "db: sidelog watermark with out of order first contact",
+            []
+            {
+                // the origin numbers batch A (1-3) then batch B (4-6), but releases B first
+                const auto table = openset::globals::database->getTable("__test001__");
+                auto& sideLog = openset::db::SideLog::getSideLog();
+
+                auto baseB = sideLog.release(table.get(), { { 7, 4 } }, { { 7, 6 } });
+                auto baseA = sideLog.release(table.get(), { { 7, 1 } }, { { 7, 3 } });
+                auto baseC = sideLog.release(table.get(), { { 7, 7 } }, { { 7, 8 } });
+
+                // nothing was released before B, and A still can't be assumed sent
+                ASSERT(baseB[7] == 0);
+                ASSERT(baseA[7] == 0);
+                // A and B are both out by the time C is released
+                ASSERT(baseC[7] == 6);
+
+                // a node that hears B first
+                openset::db::Watermark_s watermark;
+                watermark.mark(4, 6);
+                ASSERT(watermark.contiguous == -1); // unknown until seeded
+
+                watermark.seed(baseB[7]);
+                ASSERT(watermark.contiguous == 0); // 1-3 are still owed
+                ASSERT(watermark.ahead.size() == 1);
+
+                watermark.seed(baseA[7]); // only the first baseline counts
+                watermark.mark(2);
+                ASSERT(watermark.contiguous == 0);
+                watermark.mark(1);
+                ASSERT(watermark.contiguous == 2);
+                watermark.mark(3);
+                ASSERT(watermark.contiguous == 6);
+                ASSERT(watermark.ahead.empty());
+
+                // repeats and overlaps don't move it
+                watermark.mark(5);
+                watermark.mark(2, 6);
+                ASSERT(watermark.contiguous == 6);
+
+                // a node that joined after A and B were released only ever hears C
+                openset::db::Watermark_s joined;
+                joined.mark(7, 8);
+                ASSERT(joined.contiguous == -1);
+                joined.seed(baseC[7]);
+                ASSERT(joined.contiguous == 8);
+            }
+        },
+
+        {
+            "db: bulk load applies unsorted customers in stamp order",
+            []
+            {
+                auto table = openset::globals::database->newTable("__testload__", false);
+                table->getProperties()->setProperty(2000, "page", PropertyTypes_e::textProp, false);
+
+                const auto parts = table->getPartitionObjects(0, true);
+
+                // customers interleaved and each customer's stamps out of order, as a file might be
+                const std::vector<std::string> lines = {
+                    R"({"id":"c@test.com","stamp":1458820903000,"event":"visit","page":"c3"})",
+                    R"({"id":"a@test.com","stamp":1458820902000,"event":"visit","page":"a2"})",
+                    R"({"id":"b@test.com","stamp":1458820901000,"event":"visit","page":"b1"})",
+                    R"({"id":"a@test.com","stamp":1458820900000,"event":"visit","page":"a1"})",
+                    R"({"id":"c@test.com","stamp":1458820901000,"event":"visit","page":"c1"})",
+                    R"({"id":"c@test.com","stamp":1458820902000,"event":"visit","page":"c2"})",
+                    R"({"id":"a@test.com","stamp":1458820903000,"event":"visit","page":"a3"})",
+                };
+
+                auto load = std::make_shared<openset::async::BulkLoad_s>();
+
+                // rows are read the way the bulk loader reads them
+                for (const auto& line : lines)
+                {
+                    auto row = std::make_unique<cjson>();
+                    cjson::parse(line, row.get(), true);
+
+                    load->keys.push_back(openset::async::BulkLoad_s::Key_s{
+                        row->xPathString("/id", ""),
+                        row->xPathInt("/stamp", 0),
+                        static_cast<int32_t>(load->rows.size())
+                    });
+                    load->rows.push_back(std::move(row));
+                }
+
+                load->sort();
+                RunCell(new openset::async::OpenLoopLoad(table, load), 0);
+
+                ASSERT(parts->people.customerCount() == 3);
+
+                const auto pages = [&](const std::string& customerId) -> std::string
+                {
+                    const auto personRaw = parts->people.getCustomerByID(customerId);
+                    ASSERT(personRaw != nullptr);
+
+                    Customer person;
+                    person.mapTable(table.get(), 0);
+                    person.mount(personRaw);
+                    person.prepare();
+
+                    auto json = person.getGrid()->toJSON();
+
+                    std::string result;
+                    int64_t lastStamp = 0;
+
+                    for (auto r : json.xPath("events")->getNodes())
+                    {
+                        const auto stamp = r->xPath("stamp")->getInt();
+                        ASSERT(stamp > lastStamp);
+                        lastStamp = stamp;
+
+                        result += (result.length() ? "," : "") + r->xPath("_")->xPathString("page", "");
+                    }
+
+                    return result;
+                };
+
+                ASSERT(pages("a@test.com") == "a1,a2,a3");
+                ASSERT(pages("b@test.com") == "b1");
+                ASSERT(pages("c@test.com") == "c1,c2,c3");
+
+                // index bitmaps were written back after the load
+                const auto attr = parts->attributes.get(2000, "c2");
+                ASSERT(attr != nullptr);
+                const auto bits = attr->getBits();
+                ASSERT(bits->population(parts->people.customerCount()) == 1);
+                delete bits;
+            }
+        },
+
+        {
+            "db: ingest frame is queued, acknowledged and released for forwarding",
+            []
+            {
+                // frames wait out partition map changes, which needs a sentinel
+                if (!openset::globals::sentinel)
+                    new openset::mapping::Sentinel(openset::globals::mapper, openset::globals::database);
+
+                auto table = openset::globals::database->newTable("__testingest__", false);
+                table->getProperties()->setProperty(2000, "page", PropertyTypes_e::textProp, false);
+                table->getPartitionObjects(0, true);
+
+                // [uint16 name length][name][JSON events], the length prefix is read by the session
+                const auto makeFrame = [](const std::string& tableName, const std::string& events) -> std::vector<char>
+                {
+                    const auto nameLength = static_cast<uint16_t>(tableName.length());
+                    std::vector<char> frame(sizeof(nameLength));
+                    memcpy(frame.data(), &nameLength, sizeof(nameLength));
+                    frame.insert(frame.end(), tableName.begin(), tableName.end());
+                    frame.insert(frame.end(), events.begin(), events.end());
+                    return frame;
+                };
+
+                auto& sideLog = openset::db::SideLog::getSideLog();
+                const auto unread = sideLog.getUnread(0);
+
+                const auto frame = makeFrame("__testingest__", R"([
+                    {"id":"ingest1@test.com","stamp":1458820830000,"event":"visit","page":"home"},
+                    {"id":"ingest2@test.com","stamp":1458820831000,"event":"visit","page":"about"},
+                    {"id":"ingest1@test.com","stamp":1458820832000,"event":"visit","page":"blog"}
+                ])");
+
+                int64_t backlog = 0;
+                std::string error;
+
+                ASSERT(openset::web::IngestServer::queueFrame(frame.data(), frame.size(), backlog, error));
+                ASSERT(error.empty());
+
+                // one partition in the test, so every row is queued on partition 0 numbered 1 to 3
+                ASSERT(sideLog.getUnread(0) == unread + 3);
+
+                // the batch was released for forwarding, so a batch numbered after it is owed nothing
+                const auto bases = sideLog.release(table.get(), { { 0, 4 } }, { { 0, 4 } });
+                ASSERT(bases.at(0) == 3);
+
+                // rejected frames queue nothing and say why
+                const auto unknown = makeFrame("__nosuchtable__", "[]");
+                ASSERT(!openset::web::IngestServer::queueFrame(unknown.data(), unknown.size(), backlog, error));
+                ASSERT(error == "missing or invalid table name");
+
+                const auto notArray = makeFrame("__testingest__", R"({"id":"ingest1@test.com"})");
+                ASSERT(!openset::web::IngestServer::queueFrame(notArray.data(), notArray.size(), backlog, error));
+                ASSERT(error == "events must be a JSON array");
+
+                auto truncated = makeFrame("__testingest__", "");
+                truncated.resize(6);
+                ASSERT(!openset::web::IngestServer::queueFrame(truncated.data(), truncated.size(), backlog, error));
+                ASSERT(error == "invalid table name length");
+
+                ASSERT(sideLog.getUnread(0) == unread + 3);
+
+                // [uint64 frames][int64 backlog][uint8 status][uint16 error length][error]
+                const auto ack = openset::web::IngestServer::makeAck(7, 42, 1, error);
+                ASSERT(ack.size() == 8 + 8 + 1 + 2 + error.length());
+
+                uint64_t ackFrames;
+                int64_t ackBacklog;
+                uint8_t ackStatus;
+                uint16_t ackErrorLength;
+                auto read = ack.data();
+
+                memcpy(&ackFrames, read, sizeof(ackFrames));
+                read += sizeof(ackFrames);
+                memcpy(&ackBacklog, read, sizeof(ackBacklog));
+                read += sizeof(ackBacklog);
+                memcpy(&ackStatus, read, sizeof(ackStatus));
+                read += sizeof(ackStatus);
+                memcpy(&ackErrorLength, read, sizeof(ackErrorLength));
+                read += sizeof(ackErrorLength);
+
+                ASSERT(ackFrames == 7);
+                ASSERT(ackBacklog == 42);
+                ASSERT(ackStatus == 1);
+                ASSERT(std::string(read, ackErrorLength) == "invalid table name length");
+
+                // a clean ack has no error
+                ASSERT(openset::web::IngestServer::makeAck(64, 0, 0, "").size() == 8 + 8 + 1 + 2);
+            }
+        },
+
+        {
+            "db: on_insert segment refresh matches the insert result",
+            []
+            {
+                auto table = openset::globals::database->newTable("__testoninsert__", false);
+                auto columns = table->getProperties();
+                // `fruit` sits at a different column on the full insert grid than on the refresh grid
+                columns->setProperty(2000, "page", PropertyTypes_e::textProp, false);
+                columns->setProperty(2001, "fruit", PropertyTypes_e::textProp, false);
+
+                const auto parts = table->getPartitionObjects(0, true);
+
+                const auto segmentScript =
+                R"osl(
+                    each_row where fruit.is(== "banana")
+                        return(true)
+                    end
+                )osl"s;
+
+                openset::query::Macro_s segmentMacros;
+                openset::query::QueryParser parser;
+                parser.compileQuery(segmentScript, columns, segmentMacros, nullptr);
+                ASSERT(parser.error.inError() == false);
+
+                table->setSegmentRefresh("bananas", segmentMacros, 86'400'000, 100, true);
+
+                cjson events(R"([
+                    {"id":"fruit1@test.com","stamp":1458820830000,"event":"visit","page":"home","fruit":"banana"},
+                    {"id":"fruit2@test.com","stamp":1458820831000,"event":"visit","page":"home","fruit":"apple"},
+                    {"id":"fruit3@test.com","stamp":1458820832000,"event":"visit","page":"about"},
+                    {"id":"fruit3@test.com","stamp":1458820833000,"event":"visit","page":"blog","fruit":"banana"}
+                ])", cjson::Mode_e::string);
+
+                const auto queued = openset::comms::RpcInsert::queueRows(table.get(), events.getNodes(), false);
+                ASSERT(queued.status == openset::comms::InsertStatus_e::accepted);
+
+                const auto members = [&]() -> std::string
+                {
+                    std::string segmentName = "bananas";
+                    const auto bits = parts->getBits(segmentName);
+                    const auto maxLinearId = parts->people.customerCount();
+
+                    std::vector<std::string> ids;
+                    int64_t linId = -1;
+                    while (bits->linearIter(linId, maxLinearId))
+                        ids.push_back(parts->people.getCustomerByLIN(linId)->getIdStr());
+
+                    std::sort(ids.begin(), ids.end());
+
+                    std::string result;
+                    for (const auto& id : ids)
+                        result += (result.length() ? "," : "") + id;
+                    return result;
+                };
+
+                // the insert cell evaluates the segment for each customer it writes
+                RunCell(new openset::async::OpenLoopInsert(table), 0);
+
+                ASSERT(parts->people.customerCount() == 3);
+                ASSERT(members() == "fruit1@test.com,fruit3@test.com");
+
+                // a full refresh runs the same script on grids mapped to just `fruit`
+                parts->setSegmentRefresh("bananas", 0);
+                RunCell(new openset::async::OpenLoopSegmentRefresh(table), 0);
+
+                ASSERT(members() == "fruit1@test.com,fruit3@test.com");
+
+                // and inserting again after the refresh still evaluates correctly
+                cjson more(R"([
+                    {"id":"fruit2@test.com","stamp":1458820834000,"event":"visit","fruit":"banana"}
+                ])", cjson::Mode_e::string);
+
+                ASSERT(openset::comms::RpcInsert::queueRows(table.get(), more.getNodes(), false).status ==
+                    openset::comms::InsertStatus_e::accepted);
+
+                RunCell(new openset::async::OpenLoopInsert(table), 0);
+
+                ASSERT(members() == "fruit1@test.com,fruit2@test.com,fruit3@test.com");
+            }
+        },
+
+        {
+            "db: staged and JSON inserts build identical customers",
+            []
+            {
+                const auto makeTable = [](const std::string& name)
+                {
+                    auto table = openset::globals::database->newTable(name, false);
+                    auto columns = table->getProperties();
+                    columns->setProperty(2000, "page", PropertyTypes_e::textProp, false);
+                    columns->setProperty(2001, "amount", PropertyTypes_e::doubleProp, false);
+                    columns->setProperty(2002, "tags", PropertyTypes_e::textProp, true);
+                    columns->setProperty(2003, "visits", PropertyTypes_e::intProp, false);
+                    // customer properties
+                    columns->setProperty(3000, "tier", PropertyTypes_e::textProp, false, true);
+                    columns->setProperty(3001, "score", PropertyTypes_e::intProp, false, true);
+                    columns->setProperty(3002, "vip", PropertyTypes_e::boolProp, false, true);
+                    columns->setProperty(3003, "colors", PropertyTypes_e::textProp, true, true);
+                    return table;
+                };
+
+                auto jsonTable = makeTable("__testjsonpath__");
+                auto stagedTable = makeTable("__teststagedpath__");
+
+                // stamps out of order, a shared stamp, an ISO stamp, a props only row and a junk row,
+                // in two batches so the second lands between rows already committed
+                const std::vector<std::string> batches = {
+                    R"([
+                        {"id":"mixed@test.com","stamp":1458820840000,"event":"visit","page":"home","amount":12.5,"tags":["a","b"],"tier":"gold"},
+                        {"id":"mixed@test.com","stamp":1458820830000,"event":"visit","page":"about","visits":3,"score":10},
+                        {"id":"mixed@test.com","stamp":1458820835000,"event":"purchase","amount":7,"vip":true,"colors":["red","blue"]}
+                    ])",
+                    R"([
+                        {"id":"mixed@test.com","stamp":1458820835000,"event":"visit","page":"home","tags":["c"]},
+                        {"id":"mixed@test.com","stamp":"2016-03-24T12:00:25Z","event":"visit","page":"blog","visits":1},
+                        {"id":"mixed@test.com","stamp":1458820820000,"event":"visit","tier":"silver","score":12},
+                        {"id":"mixed@test.com","stamp":1458820845000,"page":"no event"},
+                        {"id":"mixed@test.com","stamp":1458820850000,"event":"visit","page":"last","amount":0.25}
+                    ])"
+                };
+
+                const auto insert = [&](const openset::db::Database::TablePtr& table, const bool staged)
+                {
+                    const auto parts = table->getPartitionObjects(0, true);
+
+                    Customer person;
+                    person.mapTable(table.get(), 0);
+
+                    for (const auto& batch : batches)
+                    {
+                        person.mount(parts->people.createCustomer("mixed@test.com"));
+                        person.prepare();
+
+                        cjson events(batch, cjson::Mode_e::string);
+
+                        for (auto e : events.getNodes())
+                        {
+                            if (staged)
+                            {
+                                const auto row = openset::db::InsertStaging::stage(table.get(), e);
+                                person.insert(row);
+                                PoolMem::getPool().freePtr(row);
+                            }
+                            else
+                            {
+                                person.insert(e);
+                            }
+                        }
+
+                        person.commit();
+                        parts->attributes.clearDirty();
+                    }
+
+                    // re-read the committed customer
+                    person.mount(parts->people.getCustomerByID("mixed@test.com"));
+                    person.prepare();
+
+                    auto json = person.getGrid()->toJSON();
+                    return cjson::stringify(&json);
+                };
+
+                // value, text and population of every index for a property
+                const auto indexes = [](const openset::db::Database::TablePtr& table, const int32_t propIndex)
+                {
+                    auto& attributes = table->getPartitionObjects(0, true)->attributes;
+
+                    std::vector<std::string> entries;
+
+                    for (const auto& attr : attributes.getPropertyValues(propIndex))
+                    {
+                        const auto bits = attr.second->getBits();
+                        entries.push_back(
+                            to_string(attr.first) + ":" +
+                            (attr.second->text ? std::string(attr.second->text) : "") + ":" +
+                            to_string(bits->population(64)));
+                        delete bits;
+                    }
+
+                    std::sort(entries.begin(), entries.end());
+
+                    std::string result;
+                    for (const auto& entry : entries)
+                        result += entry + ",";
+                    return result;
+                };
+
+                const auto jsonGrid = insert(jsonTable, false);
+                const auto stagedGrid = insert(stagedTable, true);
+
+                ASSERT(jsonGrid == stagedGrid);
+
+                // make sure the comparison covers what we inserted, the props only and junk rows add no events
+                cjson grid(jsonGrid, cjson::Mode_e::string);
+                const auto rows = grid.xPath("/events")->getNodes();
+                ASSERT(rows.size() == 6);
+
+                int64_t lastStamp = 0;
+                for (auto r : rows)
+                {
+                    ASSERT(r->xPathInt("/stamp", 0) >= lastStamp);
+                    lastStamp = r->xPathInt("/stamp", 0);
+                }
+
+                ASSERT(grid.xPathString("/properties/tier", "") == "silver");
+                ASSERT(grid.xPathInt("/properties/score", 0) == 12);
+                ASSERT(grid.xPathBool("/properties/vip", false) == true);
+
+                for (const auto propIndex : { openset::db::PROP_EVENT, 2000, 2001, 2002, 2003, 3000, 3001, 3002, 3003 })
+                {
+                    const auto jsonIndexes = indexes(jsonTable, propIndex);
+                    ASSERT(jsonIndexes == indexes(stagedTable, propIndex));
+                }
+
+                ASSERT(indexes(jsonTable, 2002).length() > 0);
+                ASSERT(indexes(jsonTable, 3000).length() > 0);
+            }
+        },
+
+        {
+            "db: segment export lists exactly the segment members",
+            []
+            {
+                auto table = openset::globals::database->newTable("__testexport__", false);
+                auto columns = table->getProperties();
+                columns->setProperty(2000, "fruit", PropertyTypes_e::textProp, false);
+
+                const auto parts = table->getPartitionObjects(0, true);
+
+                const auto segmentScript =
+                R"osl(
+                    each_row where fruit.is(== "banana")
+                        return(true)
+                    end
+                )osl"s;
+
+                openset::query::Macro_s segmentMacros;
+                openset::query::QueryParser parser;
+                parser.compileQuery(segmentScript, columns, segmentMacros, nullptr);
+                ASSERT(parser.error.inError() == false);
+
+                table->setSegmentRefresh("bananas", segmentMacros, 86'400'000, 100, true);
+
+                // every third customer buys a banana, more members than the cell lists
+                // in one go so it resumes between slices. One id needs escaping
+                std::vector<std::string> expected;
+                std::string inserts = "[";
+
+                for (auto i = 0; i < 3000; ++i)
+                {
+                    const auto id = i == 300 ? "quote\\\"d@test.com"s : "export" + std::to_string(i) + "@test.com";
+                    const auto banana = i % 3 == 0;
+
+                    if (banana)
+                        expected.push_back(i == 300 ? "quote\"d@test.com" : id);
+
+                    inserts += (i ? "," : "") + "{\"id\":\""s + id + "\",\"stamp\":" + std::to_string(1458820830000 + i) +
+                        ",\"event\":\"visit\",\"fruit\":\"" + (banana ? "banana" : "apple") + "\"}";
+                }
+                inserts += "]";
+
+                cjson events(inserts, cjson::Mode_e::string);
+                ASSERT(events.getNodes().size() == 3000);
+
+                ASSERT(openset::comms::RpcInsert::queueRows(table.get(), events.getNodes(), false).status ==
+                    openset::comms::InsertStatus_e::accepted);
+
+                RunCell(new openset::async::OpenLoopInsert(table), 0);
+                ASSERT(parts->people.customerCount() == 3000);
+
+                std::sort(expected.begin(), expected.end());
+
+                // keeps what the cell replies with, there is no connection to answer
+                class ExportReply : public openset::async::Shuttle<int>
+                {
+                    openset::http::StatusCode& status;
+                    std::string& data;
+
+                public:
+                    ExportReply(openset::http::StatusCode& status, std::string& data) :
+                        Shuttle<int>(nullptr),
+                        status(status),
+                        data(data)
+                    {}
+
+                    void reply(const openset::http::StatusCode replyStatus, const string messageString) override
+                    {
+                        status = replyStatus;
+                        data = messageString;
+                        release();
+                    }
+
+                    void reply(const openset::http::StatusCode replyStatus, const char* replyData, const int64_t length) override
+                    {
+                        status = replyStatus;
+                        data = std::string(replyData, length);
+                        release();
+                    }
+                };
+
+                const auto exportSegment = [&](const std::string& segmentName, const openset::async::ExportFormat_e format)
+                {
+                    auto status = openset::http::StatusCode::unknown;
+                    std::string data;
+
+                    RunCell(
+                        new openset::async::OpenLoopSegmentExport(new ExportReply(status, data), table, segmentName, format),
+                        0);
+
+                    ASSERT(status == openset::http::StatusCode::success_ok);
+                    ASSERT(parts->segmentUsageCount == 0);
+                    return data;
+                };
+
+                // ndjson, one quoted id per line
+                const auto ndjson = exportSegment("bananas", openset::async::ExportFormat_e::ndjson);
+                ASSERT(ndjson.find("\"quote\\\"d@test.com\"\n") != std::string::npos);
+
+                std::vector<std::string> listed;
+                for (size_t start = 0, end; (end = ndjson.find('\n', start)) != std::string::npos; start = end + 1)
+                {
+                    auto line = ndjson.substr(start, end - start);
+                    ASSERT(line.length() > 2 && line.front() == '"' && line.back() == '"');
+                    line = line.substr(1, line.length() - 2);
+                    if (const auto escape = line.find("\\\""); escape != std::string::npos)
+                        line.erase(escape, 1);
+                    listed.push_back(line);
+                }
+
+                std::sort(listed.begin(), listed.end());
+                ASSERT(listed.size() == 1000);
+                ASSERT(listed == expected);
+
+                // binary, a length and the bytes per id
+                const auto binary = exportSegment("bananas", openset::async::ExportFormat_e::binary);
+
+                listed.clear();
+                for (size_t offset = 0; offset < binary.length();)
+                {
+                    ASSERT(offset + sizeof(int32_t) <= binary.length());
+                    int32_t length;
+                    memcpy(&length, binary.data() + offset, sizeof(int32_t));
+                    offset += sizeof(int32_t);
+
+                    ASSERT(length > 0 && offset + length <= binary.length());
+                    listed.emplace_back(binary.data() + offset, length);
+                    offset += length;
+                }
+
+                std::sort(listed.begin(), listed.end());
+                ASSERT(listed == expected);
+
+                // a segment the partition doesn't have has no members here
+                ASSERT(exportSegment("nothing", openset::async::ExportFormat_e::ndjson).empty());
+            }
+        },
+
+        {
+            "db: partition people transfer in the current and older formats",
+            []
+            {
+                using namespace openset::db;
+
+                const auto source = &openset::globals::database->getTable("__testexport__")->getPartitionObjects(0, false)->people;
+                ASSERT(source->customerCount() == 3000);
+
+                const auto sameCustomers = [&](Customers& copy, const bool stamps)
+                {
+                    ASSERT(copy.customerCount() == source->customerCount());
+
+                    for (auto linId = 0; linId < source->customerCount(); ++linId)
+                    {
+                        const auto original = source->getCustomerByLIN(linId);
+                        const auto person = copy.getCustomerByID(original->getIdStr());
+
+                        ASSERT(person != nullptr);
+                        ASSERT(person->linId == original->linId);
+                        ASSERT(person->bytes == original->bytes);
+                        ASSERT(person->comp == original->comp);
+                        ASSERT(memcmp(person->events, original->events, original->idBytes + original->comp) == 0);
+
+                        if (stamps)
+                        {
+                            ASSERT(person->firstStamp == original->firstStamp);
+                            ASSERT(person->lastStamp == original->lastStamp);
+                        }
+                        else
+                        {
+                            // unknown stamps never skip the customer
+                            ASSERT(person->overlaps(LLONG_MIN, LLONG_MIN));
+                            ASSERT(person->overlaps(LLONG_MAX, LLONG_MAX));
+                        }
+                    }
+                };
+
+                // current format
+                {
+                    HeapStack mem;
+                    source->serialize(&mem);
+
+                    const auto block = mem.flatten();
+                    ASSERT(*recast<serializedBlockType_e*>(block) == serializedBlockType_e::people_v2);
+
+                    Customers copy(0);
+                    ASSERT(copy.deserialize(block) == mem.getBytes());
+                    sameCustomers(copy, true);
+
+                    // a block type this node doesn't know is refused
+                    *recast<int64_t*>(block) = 99;
+                    Customers refused(0);
+                    ASSERT(refused.deserialize(block) == 0);
+                    ASSERT(refused.customerCount() == 0);
+
+                    HeapStack::releaseFlatPtr(block);
+                }
+
+                // the layout older nodes send, without stamps
+                {
+                    HeapStack mem;
+                    *recast<serializedBlockType_e*>(mem.newPtr(sizeof(int64_t))) = serializedBlockType_e::people;
+                    const auto sectionLength = recast<int64_t*>(mem.newPtr(sizeof(int64_t)));
+                    *sectionLength = 0;
+
+                    for (auto linId = 0; linId < source->customerCount(); ++linId)
+                    {
+                        const auto original = source->getCustomerByLIN(linId);
+                        const auto size = (sizeof(PersonDataV1_s) - 1LL) + original->comp + original->idBytes;
+
+                        const auto person = recast<PersonDataV1_s*>(mem.newPtr(size));
+                        person->id = original->id;
+                        person->linId = original->linId;
+                        person->bytes = original->bytes;
+                        person->comp = original->comp;
+                        person->idBytes = original->idBytes;
+                        person->props = nullptr;
+                        memcpy(person->events, original->events, original->idBytes + original->comp);
+
+                        *sectionLength += size;
+                    }
+
+                    const auto block = mem.flatten();
+
+                    Customers copy(0);
+                    ASSERT(copy.deserialize(block) == mem.getBytes());
+                    sameCustomers(copy, false);
+
+                    HeapStack::releaseFlatPtr(block);
+                }
+            }
+        },
+
     };
 }
@@ -5,6 +5,9 @@
 #include "../src/database.h"
 #include "../src/table.h"
 #include "../src/asyncpool.h"
+#include "../src/asyncloop.h"
+#include "../src/config.h"
+#include "../src/internoderouter.h"
 #include "../src/tablepartitioned.h"
 #include "../src/queryparserosl.h"
 #include "../src/queryinterpreter.h"
@@ -79,4 +82,31 @@ cjson ResultToJson(TestEngineContainer_s* engine)
     merger.resultSetToJson(engine->interpreter->macros.vars.columnVars.size(), 1, resultSets, &resultJson);
 
     return resultJson;
-}
\ No newline at end of file
+}
+void RunCell(openset::async::OpenLoop* cell, const int32_t partition)
+{
+    openset::async::AsyncLoop loop(openset::globals::async, partition, 0);
+
+    // cells that touch data wait until this node owns the partition
+    openset::globals::mapper->partitionMap.setState(
+        partition,
+        openset::globals::running->nodeId,
+        openset::mapping::NodeState_e::active_owner);
+
+    cell->assignLoop(&loop);
+    cell->prepare();
+    cell->prepared = true;
+
+    // a cell that reschedules itself is run again, until it is done or waiting on
+    // future work (like an insert cell with an empty SideLog)
+    while (cell->state == openset::async::oloopState_e::running)
+    {
+        const auto now = Now();
+        cell->runStart = now;
+
+        if (!cell->run() && cell->runAt > now)
+            break;
+    }
+
+    delete cell;
+}
@@ -2,6 +2,7 @@
 
 #include "../src/queryinterpreter.h"
 #include "../src/queryparserosl.h"
+#include "../src/oloop.h"
 
 struct TestEngineContainer_s
 {
@@ -29,3 +30,7 @@ struct TestEngineContainer_s
 
 TestEngineContainer_s* TestScriptRunner(const std::string& tableName, const std::string& script, openset::query::Macro_s& queryMacros, const bool debug = false);
 cjson ResultToJson(TestEngineContainer_s* engine);
+
+// runs a cell on `partition` the way AsyncLoop does, until it is done or idle, then deletes
+// it. The async workers are suspended while testing, so cells are run on the test thread
+void RunCell(openset::async::OpenLoop* cell, int32_t partition);
@@ -9,8 +9,129 @@
 #include "../src/tablepartitioned.h"
 #include "../src/internoderouter.h"
 #include "../src/result.h"
+#include "../src/cursors.h"
+#include "../src/oloop_merge.h"
+#include "../src/asyncloop.h"
+#include "../src/queryindexing.h"
 #include "test_helper.h"
 #include <unordered_set>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+// runs `script` for one customer the way OpenLoopQuery does, the stamp window the parser
+// found is only applied when `windowed` is set. Skipped customers report -1 rows and the
+// empty result
+struct WindowedRun_s
+{
+    std::string json;
+    int64_t rows;
+};
+
+inline WindowedRun_s WindowedRun(
+    const std::string& tableName,
+    const std::string& customerId,
+    const std::string& script,
+    openset::query::Macro_s& queryMacros,
+    const bool windowed)
+{
+    const auto table = openset::globals::database->getTable(tableName);
+    const auto parts = table->getPartitionObjects(0, true); // partition zero for test
+
+    openset::query::QueryParser p;
+    p.compileQuery(script, table->getProperties(), queryMacros, nullptr);
+    ASSERT(p.error.inError() == false);
+
+    TestEngineContainer_s engine(queryMacros);
+    engine.resultSet.setAccTypesFromMacros(queryMacros);
+
+    const auto personData = parts->people.getCustomerByID(customerId);
+    ASSERT(personData != nullptr);
+
+    int64_t rows = -1;
+
+    if (!windowed || personData->overlaps(queryMacros.stampFrom, queryMacros.stampTo))
+    {
+        auto mappedColumns = engine.interpreter->getReferencedColumns();
+
+        Customer person;
+        person.mapTable(table.get(), 0, mappedColumns);
+        person.setSessionTime(queryMacros.sessionTime);
+        if (windowed)
+            person.setStampWindow(queryMacros.stampFrom, queryMacros.stampTo);
+        person.mount(personData);
+        person.prepare();
+
+        rows = static_cast<int64_t>(person.getGrid()->getRows()->size());
+
+        engine.interpreter->mount(&person);
+        engine.interpreter->exec();
+    }
+
+    engine.resultSet.makeSortedList();
+
+    std::vector<openset::result::ResultSet*> resultSets { &engine.resultSet };
+    cjson resultJson;
+    openset::result::ResultMuxDemux::resultSetToJson(
+        static_cast<int>(queryMacros.vars.columnVars.size()), 1, resultSets, &resultJson);
+
+    return { cjson::stringify(&resultJson), rows };
+}
+
+// one result set per entry in `partitions`, each filled by running `script` over that
+// partition's customers the way OpenLoopQuery does. They stand in for the partition
+// results a query merges, an empty entry is a partition without customers
+using PartitionRuns_t = std::vector<std::unique_ptr<TestEngineContainer_s>>;
+
+inline PartitionRuns_t PartitionRuns(
+    const std::string& tableName,
+    const std::vector<std::vector<std::string>>& partitions,
+    const std::string& script,
+    openset::query::Macro_s& queryMacros)
+{
+    const auto table = openset::globals::database->getTable(tableName);
+    const auto parts = table->getPartitionObjects(0, true); // partition zero for test
+
+    openset::query::QueryParser p;
+    p.compileQuery(script, table->getProperties(), queryMacros, nullptr);
+    ASSERT(p.error.inError() == false);
+
+    PartitionRuns_t runs;
+
+    for (const auto& customerIds : partitions)
+    {
+        runs.emplace_back(new TestEngineContainer_s(queryMacros));
+        const auto& engine = runs.back();
+        engine->resultSet.setAccTypesFromMacros(queryMacros);
+
+        auto mappedColumns = engine->interpreter->getReferencedColumns();
+
+        Customer person;
+        person.mapTable(table.get(), 0, mappedColumns);
+
+        for (const auto& customerId : customerIds)
+        {
+            const auto personData = parts->people.getCustomerByID(customerId);
+            ASSERT(personData != nullptr);
+
+            person.mount(personData);
+            person.prepare();
+
+            engine->interpreter->mount(&person);
+            engine->interpreter->exec();
+        }
+    }
+
+    return runs;
+}
+
+inline std::vector<openset::result::ResultSet*> PartitionResults(const PartitionRuns_t& runs)
+{
+    std::vector<openset::result::ResultSet*> resultSets;
+    for (const auto& engine : runs)
+        resultSets.push_back(&engine->resultSet);
+    return resultSets;
+}
 
 // Our tests
 inline Tests test_osl_language()
@@ -718,6 +839,1272 @@ inline Tests test_osl_language()
 
                 delete interpreter;            }
         },
+
+        {
+            "test OSL percentiles: insert test data",
+            []
+            {
+                auto database = openset::globals::database;
+                auto table    = database->newTable("__testpct__", false);
+                auto columns  = table->getProperties();
+
+                ASSERT(columns != nullptr);
+
+                columns->setProperty(1001, "score", PropertyTypes_e::intProp, false, false);
+                columns->setProperty(1002, "amount", PropertyTypes_e::doubleProp, false, false);
+
+                auto parts     = table->getPartitionObjects(0, true); // partition zero for test
+                auto personRaw = parts->people.createCustomer("user1@test.com");
+                Customer person;
+
+                person.mapTable(table.get(), 0);
+                person.mount(personRaw);
+
+                // scores are 1 to 200, amounts are a quarter of the score. This is more
+                // values than a sketch holds, so it compresses while values are added
+                std::string inserts = "[";
+                for (auto i = 1; i <= 200; ++i)
+                {
+                    if (i > 1)
+                        inserts += ",";
+                    inserts +=
+                        "{\"id\": \"user1@test.com\", \"stamp\": " + std::to_string(1458820830 + i) +
+                        ", \"event\": \"score\", \"score\": " + std::to_string(i) +
+                        ", \"amount\": " + std::to_string(i * 0.25) + "}";
+                }
+                inserts += "]";
+
+                cjson insertJSON(inserts, cjson::Mode_e::string);
+
+                auto events = insertJSON.getNodes();
+                ASSERT(events.size() == 200);
+
+                for (auto e : events)
+                    person.insert(e);
+
+                person.commit();
+            }
+        },
+
+        {
+            "test OSL percentiles on int and double properties",
+            []
+            {
+                const auto testScript =
+                R"osl(
+                    select
+                        count id
+                        median score as score_median
+                        p95 score as score_p95
+                        median amount as amount_median
+                        p95 amount as amount_p95
+                    end
+
+                    each_row where event == "score"
+                        << "scores"
+                    end
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__testpct__", testScript, queryMacros, true);
+
+                // the query loop does this before running a query, the sketches
+                // are only read as percentiles when the modifiers are known
+                interpreter->interpreter->result->setAccTypesFromMacros(queryMacros);
+
+                auto json = ResultToJson(interpreter);
+
+                auto dataNodes = json.xPath("/_")->getNodes();
+                ASSERT(dataNodes.size() == 1);
+
+                auto values = dataNodes[0]->xPath("/c")->getNodes();
+                ASSERT(values.size() == 5);
+                ASSERT(values[0]->getInt() == 1);
+
+                // exact values are 100.5, 190.5, 25.125 and 47.625, the sketch is an estimate
+                ASSERT(std::abs(values[1]->getDouble() - 100.5) <= 2.0);
+                ASSERT(std::abs(values[2]->getDouble() - 190.5) <= 2.0);
+                ASSERT(std::abs(values[3]->getDouble() - 25.125) <= 0.5);
+                ASSERT(std::abs(values[4]->getDouble() - 47.625) <= 0.5);
+
+                delete interpreter;
+
+                // text has no order to rank by
+                openset::query::Macro_s textMacros;
+                openset::query::QueryParser p;
+                p.compileQuery(
+                    "select\n  median fruit\nend\n",
+                    openset::globals::database->getTable("__test003__")->getProperties(),
+                    textMacros,
+                    nullptr);
+                ASSERT(p.error.inError());
+            }
+        },
+
+        {
+            "test OSL percentiles merge through internode blocks",
+            []
+            {
+                // each half of the scores runs as its own partition
+                const auto lowScript =
+                R"osl(
+                    select
+                        count id
+                        median score as score_median
+                        p95 amount as amount_p95
+                    end
+
+                    each_row where score <= 100
+                        << "scores"
+                    end
+                )osl"s;
+
+                const auto highScript =
+                R"osl(
+                    select
+                        count id
+                        median score as score_median
+                        p95 amount as amount_p95
+                    end
+
+                    each_row where score > 100
+                        << "scores"
+                    end
+                )osl"s;
+
+                openset::query::Macro_s lowMacros;
+                const auto low = TestScriptRunner("__testpct__", lowScript, lowMacros, false);
+                low->interpreter->result->setAccTypesFromMacros(lowMacros);
+
+                openset::query::Macro_s highMacros;
+                const auto high = TestScriptRunner("__testpct__", highScript, highMacros, false);
+                high->interpreter->result->setAccTypesFromMacros(highMacros);
+
+                const auto columnCount = static_cast<int>(lowMacros.vars.columnVars.size());
+
+                // a partition with no customers never runs the query, its set reports
+                // `sum` for every column. It goes first so it leads the merge
+                openset::result::ResultSet empty(columnCount);
+
+                // node one has the empty partition and the low half, node two the high half
+                std::vector<openset::result::ResultSet*> nodeOneSets { &empty, low->interpreter->result };
+                std::vector<openset::result::ResultSet*> nodeTwoSets { high->interpreter->result };
+
+                int64_t nodeOneLength = 0;
+                const auto nodeOneBuffer = openset::result::ResultMuxDemux::multiSetToInternode(
+                    columnCount, 1, nodeOneSets, nodeOneLength);
+
+                int64_t nodeTwoLength = 0;
+                const auto nodeTwoBuffer = openset::result::ResultMuxDemux::multiSetToInternode(
+                    columnCount, 1, nodeTwoSets, nodeTwoLength);
+
+                ASSERT(openset::result::ResultMuxDemux::isInternode(nodeOneBuffer, nodeOneLength));
+                ASSERT(openset::result::ResultMuxDemux::isInternode(nodeTwoBuffer, nodeTwoLength));
+
+                // the coordinator decodes each node and merges them
+                std::vector<openset::result::ResultSet*> resultSets {
+                    openset::result::ResultMuxDemux::internodeToResultSet(nodeOneBuffer, nodeOneLength),
+                    openset::result::ResultMuxDemux::internodeToResultSet(nodeTwoBuffer, nodeTwoLength)
+                };
+
+                ASSERT(resultSets[0]->sortedResult.size() == 1);
+                ASSERT(resultSets[0]->accModifiers[0] == openset::query::Modifiers_e::count);
+                ASSERT(resultSets[0]->accModifiers[1] == openset::query::Modifiers_e::median);
+                ASSERT(resultSets[0]->accModifiers[2] == openset::query::Modifiers_e::p95);
+
+                cjson json;
+                openset::result::ResultMuxDemux::resultSetToJson(columnCount, 1, resultSets, &json);
+
+                auto dataNodes = json.xPath("/_")->getNodes();
+                ASSERT(dataNodes.size() == 1);
+
+                auto values = dataNodes[0]->xPath("/c")->getNodes();
+                ASSERT(values.size() == 3);
+
+                // counts add, the sketches merge to cover both halves
+                ASSERT(values[0]->getInt() == 2);
+                ASSERT(std::abs(values[1]->getDouble() - 100.5) <= 2.0);
+                ASSERT(std::abs(values[2]->getDouble() - 47.625) <= 0.5);
+
+                for (auto r : resultSets)
+                    delete r;
+
+                PoolMem::getPool().freePtr(nodeOneBuffer);
+                PoolMem::getPool().freePtr(nodeTwoBuffer);
+
+                delete low;
+                delete high;
+            }
+        },
+
+        {
+            "test OSL string functions: insert test data",
+            []
+            {
+                auto database = openset::globals::database;
+                auto table    = database->newTable("__teststr__", false);
+                auto columns  = table->getProperties();
+
+                ASSERT(columns != nullptr);
+
+                columns->setProperty(1001, "page", PropertyTypes_e::textProp, false, false);
+                columns->setProperty(1002, "referrer", PropertyTypes_e::textProp, false, false);
+
+                auto parts = table->getPartitionObjects(0, true); // partition zero for test
+
+                // user1 sees the same page twice and has a row without a page,
+                // user2 has no checkout page
+                const std::vector<std::pair<std::string, std::string>> customers {
+                    {
+                        "user1@test.com",
+                        R"([
+                            {"stamp": 1458820830, "event": "a", "page": " /shop/checkout/cart "},
+                            {"stamp": 1458820831, "event": "b", "page": "/shop/item/42"},
+                            {"stamp": 1458820832, "event": "c", "referrer": "search"},
+                            {"stamp": 1458820833, "event": "d", "page": " /shop/checkout/cart "},
+                            {"stamp": 1458820834, "event": "e", "page": "/blog/post"}
+                        ])"
+                    },
+                    {
+                        "user2@test.com",
+                        R"([
+                            {"stamp": 1458820835, "event": "a", "page": "/blog/post"}
+                        ])"
+                    }
+                };
+
+                for (const auto& customer : customers)
+                {
+                    auto personRaw = parts->people.createCustomer(customer.first);
+                    Customer person;
+
+                    person.mapTable(table.get(), 0);
+                    person.mount(personRaw);
+
+                    cjson insertJSON(customer.second, cjson::Mode_e::string);
+
+                    for (auto e : insertJSON.getNodes())
+                        person.insert(e);
+
+                    person.commit();
+                }
+
+                // write back any dirty change bits from the insert
+                parts->attributes.clearDirty();
+            }
+        },
+
+        {
+            "test OSL find on a text property",
+            []
+            {
+                // rows are " /shop/checkout/cart ", "/shop/item/42", nil, " /shop/checkout/cart " and "/blog/post"
+                const auto testScript =
+                R"osl(
+                    found = ""
+                    each_row where event.is(!= nil)
+                        found = found + "," + str(find(page, "/checkout/"))
+                    end
+
+                    debug(found == ",6,-1,-1,6,-1")
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__teststr__", testScript, queryMacros, true);
+
+                auto& debug = interpreter->debugLog();
+                ASSERT(debug.size() == 1);
+                ASSERTDEBUGLOG(debug);
+
+                // one call, cached for the three distinct values (nil is never cached)
+                const auto& calls = interpreter->interpreter->dictionaryCalls;
+                ASSERT(calls.size() == 1);
+                ASSERT(calls.begin()->second.size() == 3);
+
+                delete interpreter;
+            }
+        },
+
+        {
+            "test OSL rfind on a text property",
+            []
+            {
+                // rows are " /shop/checkout/cart ", "/shop/item/42", nil, " /shop/checkout/cart " and "/blog/post"
+                const auto testScript =
+                R"osl(
+                    found = ""
+                    each_row where event.is(!= nil)
+                        found = found + "," + str(rfind(page, "/"))
+                    end
+
+                    debug(found == ",15,10,-1,15,5")
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__teststr__", testScript, queryMacros, true);
+
+                auto& debug = interpreter->debugLog();
+                ASSERT(debug.size() == 1);
+                ASSERTDEBUGLOG(debug);
+
+                // one call, cached for the three distinct values (nil is never cached)
+                const auto& calls = interpreter->interpreter->dictionaryCalls;
+                ASSERT(calls.size() == 1);
+                ASSERT(calls.begin()->second.size() == 3);
+
+                delete interpreter;
+            }
+        },
+
+        {
+            "test OSL split on a text property",
+            []
+            {
+                // rows are " /shop/checkout/cart ", "/shop/item/42", nil, " /shop/checkout/cart " and "/blog/post"
+                const auto testScript =
+                R"osl(
+                    found = ""
+                    each_row where event.is(!= nil)
+                        parts = split(page, "/")
+                        found = found + "," + str(len(parts))
+                        if len(parts) > 2
+                            found = found + ":" + parts[2]
+                        end
+                    end
+
+                    debug(found == ",4:checkout,4:item,0,4:checkout,3:post")
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__teststr__", testScript, queryMacros, true);
+
+                auto& debug = interpreter->debugLog();
+                ASSERT(debug.size() == 1);
+                ASSERTDEBUGLOG(debug);
+
+                // one call, cached for the three distinct values (nil is never cached)
+                const auto& calls = interpreter->interpreter->dictionaryCalls;
+                ASSERT(calls.size() == 1);
+                ASSERT(calls.begin()->second.size() == 3);
+
+                delete interpreter;
+            }
+        },
+
+        {
+            "test OSL replace on a text property",
+            []
+            {
+                // rows are " /shop/checkout/cart ", "/shop/item/42", nil, " /shop/checkout/cart " and "/blog/post"
+                const auto testScript =
+                R"osl(
+                    found = ""
+                    each_row where event.is(!= nil)
+                        replaced = replace(page, "/", "|")
+                        if replaced == nil
+                            replaced = "~"
+                        end
+                        found = found + "," + replaced
+                    end
+
+                    debug(found == ", |shop|checkout|cart ,|shop|item|42,~, |shop|checkout|cart ,|blog|post")
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__teststr__", testScript, queryMacros, true);
+
+                auto& debug = interpreter->debugLog();
+                ASSERT(debug.size() == 1);
+                ASSERTDEBUGLOG(debug);
+
+                // one call, cached for the three distinct values (nil is never cached)
+                const auto& calls = interpreter->interpreter->dictionaryCalls;
+                ASSERT(calls.size() == 1);
+                ASSERT(calls.begin()->second.size() == 3);
+
+                delete interpreter;
+            }
+        },
+
+        {
+            "test OSL slice on a text property",
+            []
+            {
+                // rows are " /shop/checkout/cart ", "/shop/item/42", nil, " /shop/checkout/cart " and "/blog/post"
+                const auto testScript =
+                R"osl(
+                    found = ""
+                    each_row where event.is(!= nil)
+                        sliced = slice(page, 1, 5)
+                        if sliced == nil
+                            sliced = "~"
+                        end
+                        found = found + "," + sliced
+                    end
+
+                    debug(found == ",/sho,shop,~,/sho,blog")
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__teststr__", testScript, queryMacros, true);
+
+                auto& debug = interpreter->debugLog();
+                ASSERT(debug.size() == 1);
+                ASSERTDEBUGLOG(debug);
+
+                // one call, cached for the three distinct values (nil is never cached)
+                const auto& calls = interpreter->interpreter->dictionaryCalls;
+                ASSERT(calls.size() == 1);
+                ASSERT(calls.begin()->second.size() == 3);
+
+                delete interpreter;
+            }
+        },
+
+        {
+            "test OSL strip on a text property",
+            []
+            {
+                // rows are " /shop/checkout/cart ", "/shop/item/42", nil, " /shop/checkout/cart " and "/blog/post"
+                const auto testScript =
+                R"osl(
+                    found = ""
+                    each_row where event.is(!= nil)
+                        stripped = strip(page)
+                        if stripped == nil
+                            stripped = "~"
+                        end
+                        found = found + "," + stripped
+                    end
+
+                    debug(found == ",/shop/checkout/cart,/shop/item/42,~,/shop/checkout/cart,/blog/post")
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__teststr__", testScript, queryMacros, true);
+
+                auto& debug = interpreter->debugLog();
+                ASSERT(debug.size() == 1);
+                ASSERTDEBUGLOG(debug);
+
+                // one call, cached for the three distinct values (nil is never cached)
+                const auto& calls = interpreter->interpreter->dictionaryCalls;
+                ASSERT(calls.size() == 1);
+                ASSERT(calls.begin()->second.size() == 3);
+
+                delete interpreter;
+            }
+        },
+
+        {
+            "test OSL find index hint matches the unhinted script",
+            []
+            {
+                // becomes a [find] index hint
+                const auto hintedScript =
+                R"osl(
+                    select
+                        count id
+                    end
+
+                    each_row where find(page, "/checkout/") != -1
+                        << "matched", page
+                    end
+                )osl"s;
+
+                // the same test as a statement (`!=` after `)` stays on the `if` line), the
+                // index ORs it with `event != nil` so every customer is read
+                const auto unhintedScript =
+                R"osl(
+                    select
+                        count id
+                    end
+
+                    each_row where event.is(!= nil)
+                        if find(page, "/checkout/") != -1
+                            << "matched", page
+                        end
+                    end
+                )osl"s;
+
+                openset::query::Macro_s hintedMacros;
+                const auto hinted = TestScriptRunner("__teststr__", hintedScript, hintedMacros, true);
+
+                ASSERT(hintedMacros.index.size() == 3);
+                ASSERT(hintedMacros.index[0].op == openset::query::HintOp_e::PUSH_TBL);
+                ASSERT(hintedMacros.index[0].value == "page"s);
+                ASSERT(hintedMacros.index[1].op == openset::query::HintOp_e::PUSH_VAL);
+                ASSERT(hintedMacros.index[1].value == "/checkout/"s);
+                ASSERT(hintedMacros.index[2].op == openset::query::HintOp_e::FIND);
+
+                openset::query::Macro_s unhintedMacros;
+                const auto unhinted = TestScriptRunner("__teststr__", unhintedScript, unhintedMacros, true);
+
+                auto hintedJson = ResultToJson(hinted);
+                auto unhintedJson = ResultToJson(unhinted);
+
+                ASSERT(cjson::stringify(&hintedJson) == cjson::stringify(&unhintedJson));
+
+                auto groups = hintedJson.xPath("/_")->getNodes();
+                ASSERT(groups.size() == 1);
+                auto pages = groups[0]->xPath("/_")->getNodes();
+                ASSERT(pages.size() == 1);
+                ASSERT(pages[0]->xPathString("/g", "") == " /shop/checkout/cart ");
+
+                // the hint only selects the customer with a checkout page
+                const auto table = openset::globals::database->getTable("__teststr__");
+                const auto parts = table->getPartitionObjects(0, true);
+                const auto maxLinearId = parts->people.customerCount();
+
+                openset::query::Indexing hintedIndexing;
+                hintedIndexing.mount(table.get(), hintedMacros, 0, maxLinearId);
+
+                bool countable;
+                const auto hintedIndex = hintedIndexing.getIndex("_", countable);
+                ASSERT(hintedIndex != nullptr);
+                ASSERT(hintedIndex->population(maxLinearId) == 1);
+                ASSERT(hintedIndex->bitState(parts->people.getCustomerByID("user1@test.com"s)->linId));
+
+                openset::query::Indexing unhintedIndexing;
+                unhintedIndexing.mount(table.get(), unhintedMacros, 0, maxLinearId);
+
+                const auto unhintedIndex = unhintedIndexing.getIndex("_", countable);
+                ASSERT(unhintedIndex != nullptr);
+                ASSERT(unhintedIndex->population(maxLinearId) == 2);
+
+                delete hinted;
+                delete unhinted;
+            }
+        },
+
+        {
+            "test OSL stamp window from a constant .range",
+            []
+            {
+                // rows are at 12:00:30 to 12:00:34, one per second
+                const auto testScript =
+                R"osl(
+                    select
+                        count id
+                        sum price
+                    end
+
+                    each_row.range("2016-03-24T12:00:31+00:00", "2016-03-24T12:00:33+00:00") where event == "purchase"
+                        << "fruit", fruit
+                    end
+                )osl"s;
+
+                openset::query::Macro_s windowedMacros;
+                const auto windowed = WindowedRun("__test003__", "user1@test.com", testScript, windowedMacros, true);
+
+                ASSERT(windowedMacros.stampFrom == 1458820831000);
+                ASSERT(windowedMacros.stampTo == 1458820833000);
+                ASSERT(windowed.rows == 3);
+
+                openset::query::Macro_s unwindowedMacros;
+                const auto unwindowed = WindowedRun("__test003__", "user1@test.com", testScript, unwindowedMacros, false);
+
+                ASSERT(unwindowed.rows == 5);
+                ASSERT(windowed.json == unwindowed.json);
+                ASSERT(windowed.json.find("pear") != std::string::npos);
+            }
+        },
+
+        {
+            "test OSL stamp window with nested iterators",
+            []
+            {
+                // the window is the union of both ranges, 12:00:31 to 12:00:33
+                const auto testScript =
+                R"osl(
+                    select
+                        count id
+                    end
+
+                    each_row.range("2016-03-24T12:00:31+00:00", "2016-03-24T12:00:32+00:00") where event == "purchase"
+                        outer_fruit = fruit
+                        each_row.continue().next().range("2016-03-24T12:00:32+00:00", "2016-03-24T12:00:33+00:00") where event == "purchase"
+                            << outer_fruit, fruit
+                        end
+                    end
+                )osl"s;
+
+                openset::query::Macro_s windowedMacros;
+                const auto windowed = WindowedRun("__test003__", "user1@test.com", testScript, windowedMacros, true);
+
+                ASSERT(windowedMacros.stampFrom == 1458820831000);
+                ASSERT(windowedMacros.stampTo == 1458820833000);
+                ASSERT(windowed.rows == 3);
+
+                openset::query::Macro_s unwindowedMacros;
+                const auto unwindowed = WindowedRun("__test003__", "user1@test.com", testScript, unwindowedMacros, false);
+
+                ASSERT(windowed.json == unwindowed.json);
+                ASSERT(windowed.json.find("banana") != std::string::npos);
+            }
+        },
+
+        {
+            "test OSL stamp window left open",
+            []
+            {
+                // each of these can read rows outside the ranges
+                const std::vector<std::string> scripts {
+                    // property read outside the ranged iterator
+                    R"osl(
+                        each_row.range("2016-03-24T12:00:31+00:00", "2016-03-24T12:00:33+00:00") where event == "purchase"
+                            << "fruit", fruit
+                        end
+                        << "last", fruit
+                    )osl",
+                    // unranged inner iterator
+                    R"osl(
+                        each_row.range("2016-03-24T12:00:31+00:00", "2016-03-24T12:00:33+00:00") where event == "purchase"
+                            each_row.continue().next() where event == "purchase"
+                                << "after", fruit
+                            end
+                        end
+                    )osl",
+                    // whole history function
+                    R"osl(
+                        each_row.range("2016-03-24T12:00:31+00:00", "2016-03-24T12:00:33+00:00") where event == "purchase"
+                            << "fruit", fruit, first_stamp
+                        end
+                    )osl",
+                    // range bound from a variable
+                    R"osl(
+                        start_at = "2016-03-24T12:00:31+00:00"
+                        each_row.range(start_at, "2016-03-24T12:00:33+00:00") where event == "purchase"
+                            << "fruit", fruit
+                        end
+                    )osl",
+                };
+
+                for (const auto& script : scripts)
+                {
+                    openset::query::Macro_s windowedMacros;
+                    const auto windowed = WindowedRun("__test003__", "user1@test.com", script, windowedMacros, true);
+
+                    ASSERT(windowedMacros.stampFrom == LLONG_MIN);
+                    ASSERT(windowedMacros.stampTo == LLONG_MAX);
+                    ASSERT(windowed.rows == 5);
+
+                    openset::query::Macro_s unwindowedMacros;
+                    const auto unwindowed = WindowedRun("__test003__", "user1@test.com", script, unwindowedMacros, false);
+
+                    ASSERT(windowed.json == unwindowed.json);
+                }
+            }
+        },
+
+        {
+            "test OSL stamp window skips a customer outside it",
+            []
+            {
+                // user1 has rows at 12:00:30 to 12:00:34, user2 only at 12:00:35
+                const auto testScript =
+                R"osl(
+                    select
+                        count id
+                    end
+
+                    each_row.range("2016-03-24T12:00:30+00:00", "2016-03-24T12:00:31+00:00") where event.is(!= nil)
+                        << "page", page
+                    end
+                )osl"s;
+
+                openset::query::Macro_s windowedMacros;
+                const auto skipped = WindowedRun("__teststr__", "user2@test.com", testScript, windowedMacros, true);
+
+                ASSERT(skipped.rows == -1);
+
+                openset::query::Macro_s unwindowedMacros;
+                const auto unskipped = WindowedRun("__teststr__", "user2@test.com", testScript, unwindowedMacros, false);
+
+                ASSERT(unskipped.rows == 1);
+                ASSERT(skipped.json == unskipped.json);
+
+                // user1 is in the window and gets the same result either way
+                openset::query::Macro_s userOneWindowedMacros;
+                const auto windowed = WindowedRun("__teststr__", "user1@test.com", testScript, userOneWindowedMacros, true);
+
+                openset::query::Macro_s userOneMacros;
+                const auto unwindowed = WindowedRun("__teststr__", "user1@test.com", testScript, userOneMacros, false);
+
+                ASSERT(windowed.rows == 2);
+                ASSERT(windowed.json == unwindowed.json);
+                ASSERT(windowed.json.find("/shop/item/42") != std::string::npos);
+            }
+        },
+
+        {
+            "test OSL merged results: insert test data",
+            []
+            {
+                auto database = openset::globals::database;
+                auto table    = database->newTable("__testmerge__", false);
+                auto columns  = table->getProperties();
+
+                ASSERT(columns != nullptr);
+
+                columns->setProperty(1001, "fruit", PropertyTypes_e::textProp, false, false);
+                columns->setProperty(1002, "price", PropertyTypes_e::doubleProp, false, false);
+                columns->setProperty(1003, "size", PropertyTypes_e::intProp, false, false);
+
+                auto parts = table->getPartitionObjects(0, true); // partition zero for test
+
+                // customers m00 to m11 buy three fruits each, every fruit is bought by
+                // several customers so merged partitions share keys
+                const std::vector<std::string> fruits { "apple", "banana", "cherry", "grape", "pear" };
+
+                for (auto i = 0; i < 12; ++i)
+                {
+                    const auto customerId = "m" + std::string(i < 10 ? "0" : "") + std::to_string(i);
+
+                    auto personRaw = parts->people.createCustomer(customerId);
+                    Customer person;
+
+                    person.mapTable(table.get(), 0);
+                    person.mount(personRaw);
+
+                    std::string inserts = "[";
+                    for (auto j = 0; j < 3; ++j)
+                    {
+                        if (j)
+                            inserts += ",";
+                        inserts +=
+                            "{\"id\": \"" + customerId + "\", \"stamp\": " + std::to_string(1458820900 + i * 10 + j) +
+                            ", \"event\": \"purchase\", \"fruit\": \"" + fruits[(i + j) % 5] +
+                            "\", \"price\": " + std::to_string(i + 1 + j * 0.5) +
+                            ", \"size\": " + std::to_string((i + j) % 3) + "}";
+                    }
+                    inserts += "]";
+
+                    cjson insertJSON(inserts, cjson::Mode_e::string);
+
+                    for (auto e : insertJSON.getNodes())
+                        person.insert(e);
+
+                    person.commit();
+                }
+            }
+        },
+
+        {
+            "test OSL sampled totals are scaled and report margins",
+            []
+            {
+                const auto testScript =
+                R"osl(
+                    select
+                        count id
+                        sum price
+                        max size
+                    end
+
+                    each_row where event == "purchase"
+                        << fruit
+                    end
+                )osl"s;
+
+                const std::vector<std::string> fruits { "apple", "banana", "cherry", "grape", "pear" };
+
+                std::vector<std::string> everyone;
+                for (auto i = 0; i < 12; ++i)
+                    everyone.push_back("m" + std::string(i < 10 ? "0" : "") + std::to_string(i));
+
+                // a merge updates the sets it merges, so each document gets its own run
+                openset::query::Macro_s fullMacros;
+                const auto fullRuns = PartitionRuns("__testmerge__", { everyone }, testScript, fullMacros);
+                auto fullSets = PartitionResults(fullRuns);
+                cjson full;
+                openset::result::ResultMuxDemux::resultSetToJson(3, 1, fullSets, &full);
+
+                openset::query::Macro_s sampledMacros;
+                const auto sampledRuns = PartitionRuns("__testmerge__", { everyone }, testScript, sampledMacros);
+                auto sampledSets = PartitionResults(sampledRuns);
+                cjson sampled;
+                openset::result::ResultMuxDemux::resultSetToJson(3, 1, sampledSets, &sampled, 0.25);
+
+                const auto fullGroups = full.xPath("/_")->getNodes();
+                const auto sampledGroups = sampled.xPath("/_")->getNodes();
+
+                ASSERT(fullGroups.size() == 5);
+                ASSERT(sampledGroups.size() == 5);
+
+                for (auto g = 0; g < 5; ++g)
+                {
+                    const auto fruit = fullGroups[g]->xPathString("/g", "");
+                    ASSERT(sampledGroups[g]->xPathString("/g", "") == fruit);
+
+                    // customers and rows with this fruit, as inserted
+                    const auto fruitIndex = std::find(fruits.begin(), fruits.end(), fruit) - fruits.begin();
+                    ASSERT(fruitIndex < 5);
+
+                    int64_t customers = 0;
+                    int64_t rows = 0;
+                    for (auto i = 0; i < 12; ++i)
+                    {
+                        auto bought = false;
+                        for (auto j = 0; j < 3; ++j)
+                            if ((i + j) % 5 == fruitIndex)
+                            {
+                                bought = true;
+                                ++rows;
+                            }
+                        if (bought)
+                            ++customers;
+                    }
+
+                    const auto fullValues = fullGroups[g]->xPath("/c")->getNodes();
+                    ASSERT(fullValues[0]->getInt() == customers);
+                    ASSERT(fullGroups[g]->xPath("/e") == nullptr);
+
+                    // sums and counts are scaled up, max is not
+                    const auto values = sampledGroups[g]->xPath("/c")->getNodes();
+                    ASSERT(values[0]->getInt() == customers * 4);
+                    ASSERT(std::abs(values[1]->getDouble() - fullValues[1]->getDouble() * 4) < 0.0001);
+                    ASSERT(values[2]->getInt() == fullValues[2]->getInt());
+
+                    const auto margins = sampledGroups[g]->xPath("/e")->getNodes();
+                    ASSERT(margins.size() == 3);
+                    ASSERT(std::abs(margins[0]->getDouble() - 1.96 * std::sqrt(customers * 0.75) / 0.25) < 0.0001);
+                    ASSERT(std::abs(
+                        margins[1]->getDouble() - 1.96 * values[1]->getDouble() * std::sqrt(0.75 / rows)) < 0.0001);
+                    ASSERT(margins[1]->getDouble() > 0);
+                    ASSERT(margins[2]->isNull());
+                }
+            }
+        },
+
+        {
+            "test OSL streamed result matches the buffered result",
+            []
+            {
+                const auto testScript =
+                R"osl(
+                    select
+                        count id
+                        sum price
+                        max size
+                    end
+
+                    each_row where event == "purchase"
+                        << fruit, size
+                    end
+                )osl"s;
+
+                // customers spread over four partitions, one of them empty
+                const std::vector<std::vector<std::string>> partitions {
+                    { "m00", "m01", "m02", "m03", "m04" },
+                    { "m05", "m06", "m07" },
+                    {},
+                    { "m08", "m09", "m10", "m11" }
+                };
+
+                using namespace openset::result;
+
+                const auto buffered = [&](
+                    const ResultSortMode_e sortMode,
+                    const ResultSortOrder_e sortOrder,
+                    const int sortColumn,
+                    const int trim,
+                    const double sample) -> std::string
+                {
+                    openset::query::Macro_s queryMacros;
+                    const auto runs = PartitionRuns("__testmerge__", partitions, testScript, queryMacros);
+                    auto resultSets = PartitionResults(runs);
+
+                    cjson doc;
+                    ResultMuxDemux::resultSetToJson(3, 1, resultSets, &doc, sample);
+
+                    if (sortMode == ResultSortMode_e::key)
+                        ResultMuxDemux::jsonResultSortByGroup(&doc, sortOrder);
+                    else
+                        ResultMuxDemux::jsonResultSortByColumn(&doc, sortOrder, sortColumn);
+                    ResultMuxDemux::jsonResultTrim(&doc, trim);
+
+                    return cjson::stringify(&doc);
+                };
+
+                // the body a streamed reply sends, and the groups it was sent in
+                const auto streamed = [&](
+                    const ResultSortMode_e sortMode,
+                    const ResultSortOrder_e sortOrder,
+                    const int sortColumn,
+                    const int trim,
+                    const bool trimTop,
+                    const double sample,
+                    std::vector<std::string>& groups) -> std::string
+                {
+                    openset::query::Macro_s queryMacros;
+                    const auto runs = PartitionRuns("__testmerge__", partitions, testScript, queryMacros);
+                    auto resultSets = PartitionResults(runs);
+
+                    std::string body = "{\"_\":[";
+                    const auto done = ResultMuxDemux::resultSetToJsonStream(
+                        3, 1, resultSets, sortMode, sortOrder, sortColumn, trim, trimTop, sample,
+                        [&](const std::string& group) -> bool
+                        {
+                            body += (groups.empty() ? "" : ",") + group;
+                            groups.push_back(group);
+                            return true;
+                        });
+                    ASSERT(done);
+
+                    return body + "]}";
+                };
+
+                struct Case_s
+                {
+                    ResultSortMode_e sortMode;
+                    ResultSortOrder_e sortOrder;
+                    int sortColumn;
+                    int trim;
+                    double sample;
+                };
+
+                const std::vector<Case_s> cases {
+                    { ResultSortMode_e::key, ResultSortOrder_e::Asc, 0, -1, 1.0 },
+                    { ResultSortMode_e::key, ResultSortOrder_e::Desc, 0, 2, 1.0 },
+                    { ResultSortMode_e::column, ResultSortOrder_e::Desc, 0, -1, 1.0 },
+                    { ResultSortMode_e::column, ResultSortOrder_e::Asc, 1, 3, 1.0 },
+                    { ResultSortMode_e::column, ResultSortOrder_e::Desc, 1, 2, 0.5 },
+                };
+
+                for (const auto& c : cases)
+                {
+                    const auto expected = buffered(c.sortMode, c.sortOrder, c.sortColumn, c.trim, c.sample);
+
+                    std::vector<std::string> groups;
+                    const auto body = streamed(c.sortMode, c.sortOrder, c.sortColumn, c.trim, true, c.sample, groups);
+
+                    ASSERT(body == expected);
+                    ASSERT(groups.size() == static_cast<size_t>(c.trim > 0 ? c.trim : 5));
+                }
+
+                // a cursor takes every top level group, each trimmed like the buffered ones
+                const auto trimmed = buffered(ResultSortMode_e::key, ResultSortOrder_e::Asc, 0, 2, 1.0);
+
+                std::vector<std::string> groups;
+                streamed(ResultSortMode_e::key, ResultSortOrder_e::Asc, 0, 2, false, 1.0, groups);
+
+                ASSERT(groups.size() == 5);
+                ASSERT(trimmed == "{\"_\":[" + groups[0] + "," + groups[1] + "]}");
+
+                // nested groups are trimmed as well
+                cjson trimmedJson(trimmed, cjson::Mode_e::string);
+                for (auto group : trimmedJson.xPath("/_")->getNodes())
+                    ASSERT(group->xPath("/_")->getNodes().size() <= 2);
+            }
+        },
+
+        {
+            "test OSL cursor pages, expires and drops",
+            []
+            {
+                const auto testScript =
+                R"osl(
+                    select
+                        count id
+                        sum price
+                    end
+
+                    each_row where event == "purchase"
+                        << fruit, size
+                    end
+                )osl"s;
+
+                using namespace openset::result;
+
+                // a paged query keeps every top level group, the way RpcQuery fills a cursor
+                const auto makeCursor = [&]() -> CursorPtr
+                {
+                    openset::query::Macro_s queryMacros;
+                    const auto runs = PartitionRuns(
+                        "__testmerge__", { { "m00", "m01", "m02", "m03", "m04", "m05" }, { "m06", "m07", "m08" } },
+                        testScript,
+                        queryMacros);
+                    auto resultSets = PartitionResults(runs);
+
+                    auto cursor = std::make_shared<Cursor_s>();
+                    cursor->table = "__testmerge__";
+                    cursor->tail = ",\"sample\":{\"rate\":1}";
+
+                    ResultMuxDemux::resultSetToJsonStream(
+                        2, 1, resultSets, ResultSortMode_e::key, ResultSortOrder_e::Asc, 0, -1, false, 1.0,
+                        [&](const std::string& group) -> bool
+                        {
+                            cursor->bytes += static_cast<int64_t>(group.length());
+                            cursor->groups.push_back(group);
+                            return true;
+                        });
+
+                    cursor->bytes += static_cast<int64_t>(cursor->tail.length());
+                    return cursor;
+                };
+
+                auto& cursors = ResultCursors::get();
+
+                const auto cursor = makeCursor();
+                ASSERT(cursor->groups.size() == 5);
+
+                const auto id = cursors.add(cursor);
+                ASSERT(id.length() == 16);
+                ASSERT(cursors.find(id) == cursor);
+
+                // pages of two, in result order, until `next` is null
+                std::vector<std::string> paged;
+                int64_t offset = 0;
+                auto pages = 0;
+
+                while (true)
+                {
+                    const auto found = cursors.find(id);
+                    ASSERT(found != nullptr);
+
+                    cjson page(ResultCursors::page(id, *found, offset, 2), cjson::Mode_e::string);
+
+                    ASSERT(page.xPathString("/cursor/id", "") == id);
+                    ASSERT(page.xPathInt("/cursor/offset", -1) == offset);
+                    ASSERT(page.xPathInt("/cursor/total", -1) == 5);
+                    ASSERT(page.xPathInt("/sample/rate", 0) == 1);
+
+                    const auto groups = page.xPath("/_")->getNodes();
+                    ASSERT(groups.size() == (offset < 4 ? 2 : 1));
+                    for (auto group : groups)
+                        paged.push_back(cjson::stringify(group));
+
+                    ++pages;
+
+                    const auto next = page.xPath("/cursor/next");
+                    if (next->isNull())
+                        break;
+
+                    offset = next->getInt();
+                }
+
+                ASSERT(pages == 3);
+                ASSERT(paged == cursor->groups);
+
+                // offsets past either end are clamped
+                cjson past(ResultCursors::page(id, *cursor, 50, 2), cjson::Mode_e::string);
+                ASSERT(past.xPath("/_")->getNodes().empty());
+                ASSERT(past.xPathInt("/cursor/offset", -1) == 5);
+                ASSERT(past.xPath("/cursor/next")->isNull());
+
+                cjson before(ResultCursors::page(id, *cursor, -3, 2), cjson::Mode_e::string);
+                ASSERT(before.xPathInt("/cursor/offset", -1) == 0);
+                ASSERT(before.xPathInt("/cursor/next", -1) == 2);
+
+                // dropped cursors are gone
+                ASSERT(cursors.drop(id));
+                ASSERT(!cursors.drop(id));
+                ASSERT(cursors.find(id) == nullptr);
+
+                // a cursor that hasn't been read for CURSOR_TTL expires
+                const auto stale = makeCursor();
+                const auto staleId = cursors.add(stale);
+                ASSERT(cursors.find(staleId) != nullptr);
+
+                stale->lastUsed = Now() - CURSOR_TTL - 1;
+                ASSERT(cursors.find(staleId) == nullptr);
+                ASSERT(!cursors.drop(staleId));
+
+                // a result larger than the cursor memory is refused
+                const auto huge = makeCursor();
+                huge->bytes = CURSOR_MEMORY_MAX + 1;
+                ASSERT(cursors.add(huge).empty());
+
+                // when memory runs out the least recently read cursor goes first
+                const auto older = makeCursor();
+                older->bytes = CURSOR_MEMORY_MAX / 2;
+                const auto olderId = cursors.add(older);
+
+                const auto newer = makeCursor();
+                newer->bytes = CURSOR_MEMORY_MAX / 2;
+                const auto newerId = cursors.add(newer);
+
+                older->lastUsed = Now() - 1000;
+
+                const auto last = makeCursor();
+                last->bytes = CURSOR_MEMORY_MAX / 2;
+                const auto lastId = cursors.add(last);
+
+                ASSERT(cursors.find(olderId) == nullptr);
+                ASSERT(cursors.find(newerId) == newer);
+                ASSERT(cursors.find(lastId) == last);
+
+                ASSERT(cursors.drop(newerId));
+                ASSERT(cursors.drop(lastId));
+            }
+        },
+
+        {
+            "test OSL range merge matches the serial merge",
+            []
+            {
+                const auto nestedScript =
+                R"osl(
+                    select
+                        count id
+                        sum price
+                        max size
+                    end
+
+                    each_row where event == "purchase"
+                        << fruit, size
+                    end
+                )osl"s;
+
+                // every partition has the same one key
+                const auto equalScript =
+                R"osl(
+                    select
+                        count id
+                        sum price
+                        max size
+                    end
+
+                    each_row where event == "purchase"
+                        << "all"
+                    end
+                )osl"s;
+
+                // the first partition is the largest, its keys become the splitters
+                const std::vector<std::vector<std::string>> partitions {
+                    { "m00", "m01", "m02", "m03", "m04", "m05" },
+                    { "m06" },
+                    {},
+                    { "m07", "m08", "m09", "m10", "m11" }
+                };
+
+                using namespace openset::result;
+                using namespace openset::async;
+
+                const auto serial = [&](const std::string& script, const bool parallelMerge) -> std::string
+                {
+                    openset::query::Macro_s queryMacros;
+                    const auto runs = PartitionRuns("__testmerge__", partitions, script, queryMacros);
+                    auto resultSets = PartitionResults(runs);
+
+                    cjson doc;
+                    ResultMuxDemux::resultSetToJson(3, 1, resultSets, &doc, 1.0, parallelMerge);
+                    return cjson::stringify(&doc);
+                };
+
+                // merges the key ranges in OpenLoopMerge cells the way OpenLoopMerge::merge
+                // does on the async workers. The `removed` cell is deleted before it runs
+                const auto ranged = [&](
+                    const std::string& script,
+                    const int shards,
+                    const int removed,
+                    int& rangeCount,
+                    int& emptyCount) -> std::string
+                {
+                    openset::query::Macro_s queryMacros;
+                    const auto runs = PartitionRuns("__testmerge__", partitions, script, queryMacros);
+                    auto resultSets = PartitionResults(runs);
+
+                    ResultMuxDemux::prepareMerge(resultSets);
+
+                    const auto job = std::make_shared<MergeJob_s>();
+                    job->resultColumnCount = 3;
+                    job->resultSetCount = 1;
+                    job->resultSets = &resultSets;
+                    job->splitters = ResultMuxDemux::mergeSplitters(resultSets, shards);
+
+                    rangeCount = static_cast<int>(job->splitters.size()) + 1;
+                    job->shards.resize(rangeCount);
+                    job->merged.assign(rangeCount, 0);
+                    job->outstanding = rangeCount - 1;
+
+                    for (auto shard = 1; shard < rangeCount; ++shard)
+                    {
+                        if (shard != removed)
+                        {
+                            RunCell(new OpenLoopMerge(job, shard), 0);
+                            continue;
+                        }
+
+                        AsyncLoop loop(openset::globals::async, 0, 0);
+                        const auto cell = new OpenLoopMerge(job, shard);
+                        cell->assignLoop(&loop);
+                        cell->partitionRemoved();
+                        delete cell;
+                    }
+
+                    job->mergeShard(0);
+                    ASSERT(job->outstanding == 0);
+
+                    for (auto shard = 0; shard < rangeCount; ++shard)
+                    {
+                        if (job->merged[shard])
+                            continue;
+                        ASSERT(shard == removed);
+                        job->mergeShard(shard);
+                    }
+
+                    ResultSet::RowVector rows;
+                    emptyCount = 0;
+
+                    for (auto& shardRows : job->shards)
+                    {
+                        if (shardRows.empty())
+                            ++emptyCount;
+                        rows.insert(rows.end(), shardRows.begin(), shardRows.end());
+                    }
+
+                    cjson doc;
+                    ResultMuxDemux::resultRowsToJson(3, 1, resultSets, rows, &doc);
+                    return cjson::stringify(&doc);
+                };
+
+                const auto expected = serial(nestedScript, false);
+                ASSERT(expected.find("banana") != std::string::npos);
+
+                // small results are merged on the calling thread
+                ASSERT(serial(nestedScript, true) == expected);
+
+                for (const auto shards : { 2, 3, 5, 8 })
+                {
+                    auto rangeCount = 0;
+                    auto emptyCount = 0;
+
+                    ASSERT(ranged(nestedScript, shards, 0, rangeCount, emptyCount) == expected);
+                    ASSERT(rangeCount > 1);
+                    ASSERT(emptyCount == 0);
+
+                    // the range of a removed cell is merged by the caller
+                    ASSERT(ranged(nestedScript, shards, rangeCount - 1, rangeCount, emptyCount) == expected);
+                }
+
+                // with one key the splitters collapse to it, the range below it is empty
+                const auto equalExpected = serial(equalScript, false);
+
+                auto rangeCount = 0;
+                auto emptyCount = 0;
+
+                ASSERT(ranged(equalScript, 4, 0, rangeCount, emptyCount) == equalExpected);
+                ASSERT(rangeCount == 2);
+                ASSERT(emptyCount == 1);
+
+                cjson equalJson(equalExpected, cjson::Mode_e::string);
+                ASSERT(equalJson.xPath("/_")->getNodes().size() == 1);
+                ASSERT(equalJson.xPath("/_")->getNodes()[0]->xPath("/c")->getNodes()[0]->getInt() == 12);
+
+                // a range with the same bound at both ends holds nothing
+                openset::query::Macro_s queryMacros;
+                const auto runs = PartitionRuns("__testmerge__", partitions, nestedScript, queryMacros);
+                auto resultSets = PartitionResults(runs);
+
+                ResultMuxDemux::prepareMerge(resultSets);
+                const auto splitters = ResultMuxDemux::mergeSplitters(resultSets, 3);
+                ASSERT(splitters.size() == 2);
+                ASSERT(ResultMuxDemux::mergeResultRange(3, 1, resultSets, &splitters[0], &splitters[0]).empty());
+                ASSERT(!ResultMuxDemux::mergeResultRange(3, 1, resultSets, &splitters[0], &splitters[1]).empty());
+            }
+        },
     };
 }
 
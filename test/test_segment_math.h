@@ -0,0 +1,323 @@
+#pragma once
+
+#include "testing.h"
+
+#include "../lib/cjson/cjson.h"
+#include "../src/database.h"
+#include "../src/table.h"
+#include "../src/properties.h"
+#include "../src/asyncpool.h"
+#include "../src/tablepartitioned.h"
+#include "../src/queryparserosl.h"
+#include "../src/queryinterpreter.h"
+#include "../src/segmentmath.h"
+#include "../src/internoderouter.h"
+
+#include <unordered_map>
+
+// compiles a segment script against the segment math test table
+inline openset::query::Macro_s SegmentMathCompile(const std::string& script)
+{
+    const auto table = openset::globals::database->getTable("__testsegmath__");
+
+    openset::query::Macro_s macros;
+    openset::query::QueryParser parser;
+    parser.compileQuery(script, table->getProperties(), macros, nullptr);
+
+    ASSERT(parser.error.inError() == false);
+    return macros;
+}
+
+// runs a segment script through the interpreter (the path used before segment math), into `bits`
+inline void SegmentMathInterpret(
+    openset::query::Macro_s& macros,
+    const openset::query::SegmentMathEval::GetSegmentCB& getSegment,
+    openset::db::IndexBits* bits,
+    const int64_t maxLinearId)
+{
+    const auto table = openset::globals::database->getTable("__testsegmath__");
+    const auto parts = table->getPartitionObjects(0, true);
+
+    openset::query::Interpreter interpreter(macros, openset::query::InterpretMode_e::count);
+    interpreter.setBits(bits, static_cast<int>(maxLinearId));
+    interpreter.setGetSegmentCB(getSegment);
+
+    auto mappedColumns = interpreter.getReferencedColumns();
+
+    Customer person;
+    person.mapTable(table.get(), 0, mappedColumns);
+    person.mount(parts->people.createCustomer("user1@test.com"));
+    person.prepare();
+
+    interpreter.mount(&person);
+    interpreter.exec();
+}
+
+inline openset::db::IndexBits SegmentMathBits(const std::vector<int64_t>& linIds)
+{
+    openset::db::IndexBits bits;
+    for (const auto linId : linIds)
+        bits.bitSet(linId);
+    return bits;
+}
+
+inline std::vector<int64_t> SegmentMathMembers(const openset::db::IndexBits& bits, const int64_t maxLinearId)
+{
+    std::vector<int64_t> members;
+    int64_t linId = -1;
+    while (bits.linearIter(linId, maxLinearId))
+        members.push_back(linId);
+    return members;
+}
+
+// Our tests
+inline Tests test_segment_math()
+{
+    // need config objects to run this
+    openset::config::CommandlineArgs args;
+    openset::globals::running = new openset::config::Config(args);
+
+    // stop load/save objects from doing anything
+    openset::globals::running->testMode = true;
+
+    // we need an async engine, although we won't really be using it,
+    // it's wired into the into features such as tablePartitioned (shared locks mostly)
+    openset::async::AsyncPool* async = new openset::async::AsyncPool(1, 1); // 1 worker
+
+    // this must be on heap to keep it in scope
+    openset::mapping::Mapper* mapper = new openset::mapping::Mapper();
+    mapper->startRouter();
+
+    // put engine in a wait state otherwise we will throw an exception
+    async->suspendAsync();
+
+    return {
+        {
+            "segment math: create a table",
+            []
+            {
+                auto table = openset::globals::database->newTable("__testsegmath__", false);
+                ASSERT(table->getProperties() != nullptr);
+                table->getProperties()->setProperty(2000, "some_val", openset::db::PropertyTypes_e::intProp, false);
+            }
+        },
+        {
+            "segment math: difference keeps its parameter order",
+            []
+            {
+                const int64_t maxLinearId = 200;
+
+                std::unordered_map<std::string, openset::db::IndexBits> segments;
+                segments["a"] = SegmentMathBits({ 1, 2, 3, 70, 150 });
+                segments["b"] = SegmentMathBits({ 2, 70, 199 });
+
+                const auto getSegment = [&segments](const std::string& name, bool& loaded) -> openset::db::IndexBits*
+                {
+                    loaded = false;
+                    const auto iter = segments.find(name);
+                    return iter == segments.end() ? nullptr : &iter->second;
+                };
+
+                auto forward = SegmentMathCompile(R"osl(difference("a", "b"))osl");
+                auto backward = SegmentMathCompile(R"osl(difference("b", "a"))osl");
+
+                ASSERT(forward.isSegmentMath);
+                ASSERT(forward.segmentMath.op == openset::query::Marshals_e::marshal_difference);
+                ASSERT(forward.segmentMath.params.size() == 2);
+                ASSERT(forward.segmentMath.params[0].segment == "a");
+                ASSERT(forward.segmentMath.params[1].segment == "b");
+                // unlike intersection and union, the order is part of the key
+                ASSERT(forward.segmentMath.key != backward.segmentMath.key);
+
+                openset::query::SegmentMathEval eval(getSegment, maxLinearId);
+
+                openset::db::IndexBits aNotB;
+                ASSERT(eval.evaluate(forward.segmentMath, &aNotB));
+                ASSERT(SegmentMathMembers(aNotB, maxLinearId) == std::vector<int64_t>({ 1, 3, 150 }));
+
+                openset::db::IndexBits bNotA;
+                ASSERT(eval.evaluate(backward.segmentMath, &bNotA));
+                ASSERT(SegmentMathMembers(bNotA, maxLinearId) == std::vector<int64_t>({ 199 }));
+
+                // the interpreter agrees
+                openset::db::IndexBits interpreted;
+                SegmentMathInterpret(forward, getSegment, &interpreted, maxLinearId);
+                ASSERT(SegmentMathMembers(interpreted, maxLinearId) == std::vector<int64_t>({ 1, 3, 150 }));
+
+                // a missing segment fails the whole expression
+                auto missing = SegmentMathCompile(R"osl(difference("a", "nope"))osl");
+                openset::db::IndexBits none;
+                ASSERT(!eval.evaluate(missing.segmentMath, &none));
+            }
+        },
+        {
+            "segment math: compliment covers customers past the source's last word",
+            []
+            {
+                const int64_t maxLinearId = 200;
+
+                std::unordered_map<std::string, openset::db::IndexBits> segments;
+                // one word of bits, the table has four words of customers
+                segments["a"] = SegmentMathBits({ 1, 5 });
+
+                const auto getSegment = [&segments](const std::string& name, bool& loaded) -> openset::db::IndexBits*
+                {
+                    loaded = false;
+                    const auto iter = segments.find(name);
+                    return iter == segments.end() ? nullptr : &iter->second;
+                };
+
+                auto macros = SegmentMathCompile(R"osl(compliment("a"))osl");
+                ASSERT(macros.isSegmentMath);
+
+                openset::query::SegmentMathEval eval(getSegment, maxLinearId);
+
+                openset::db::IndexBits result;
+                ASSERT(eval.evaluate(macros.segmentMath, &result));
+
+                ASSERT(!result.bitState(1));
+                ASSERT(!result.bitState(5));
+                ASSERT(result.bitState(0));
+                ASSERT(result.bitState(64));
+                ASSERT(result.bitState(199));
+                ASSERT(result.population(maxLinearId) == maxLinearId - 2);
+
+                // the source is left alone
+                ASSERT(SegmentMathMembers(segments["a"], maxLinearId) == std::vector<int64_t>({ 1, 5 }));
+            }
+        },
+        {
+            "segment math: shared nodes are memoized until invalidated",
+            []
+            {
+                const int64_t maxLinearId = 200;
+
+                std::unordered_map<std::string, openset::db::IndexBits> segments;
+                segments["a"] = SegmentMathBits({ 1, 2 });
+                segments["ab"] = SegmentMathBits({ 3 });
+                segments["c"] = SegmentMathBits({ 4 });
+
+                std::unordered_map<std::string, int> loads;
+
+                // "c" comes from the index, so it is a copy that the evaluator owns
+                const auto getSegment = [&segments, &loads](const std::string& name, bool& loaded) -> openset::db::IndexBits*
+                {
+                    ++loads[name];
+                    const auto iter = segments.find(name);
+                    if (iter == segments.end())
+                        return nullptr;
+                    loaded = name == "c";
+                    return loaded ? new openset::db::IndexBits(iter->second) : &iter->second;
+                };
+
+                auto first = SegmentMathCompile(R"osl(union(union("a", "c"), "ab"))osl");
+                auto second = SegmentMathCompile(R"osl(intersection(union("c", "a"), "a"))osl");
+                auto third = SegmentMathCompile(R"osl(union("ab", "c"))osl");
+                ASSERT(first.isSegmentMath);
+                ASSERT(second.isSegmentMath);
+                ASSERT(third.isSegmentMath);
+                // union("a", "c") and union("c", "a") are the same node
+                ASSERT(first.segmentMath.params[0].key == second.segmentMath.params[0].key);
+
+                openset::query::SegmentMathEval eval(getSegment, maxLinearId);
+
+                openset::db::IndexBits result;
+                ASSERT(eval.evaluate(first.segmentMath, &result));
+                ASSERT(SegmentMathMembers(result, maxLinearId) == std::vector<int64_t>({ 1, 2, 3, 4 }));
+
+                ASSERT(eval.evaluate(second.segmentMath, &result));
+                ASSERT(SegmentMathMembers(result, maxLinearId) == std::vector<int64_t>({ 1, 2 }));
+
+                ASSERT(eval.evaluate(third.segmentMath, &result));
+                ASSERT(SegmentMathMembers(result, maxLinearId) == std::vector<int64_t>({ 3, 4 }));
+
+                // the shared node and the loaded segment were only calculated once
+                ASSERT(loads["c"] == 1);
+
+                // "a" is refreshed, calculated nodes still hold the old members
+                segments["a"] = SegmentMathBits({ 10 });
+                segments["ab"] = SegmentMathBits({ 11 });
+
+                ASSERT(eval.evaluate(first.segmentMath, &result));
+                ASSERT(SegmentMathMembers(result, maxLinearId) == std::vector<int64_t>({ 1, 2, 3, 4 }));
+
+                // the refresh drops every node that reads "a", but not the ones that only read "ab"
+                eval.invalidate("a");
+
+                ASSERT(eval.evaluate(third.segmentMath, &result));
+                ASSERT(SegmentMathMembers(result, maxLinearId) == std::vector<int64_t>({ 3, 4 }));
+
+                ASSERT(eval.evaluate(second.segmentMath, &result));
+                ASSERT(SegmentMathMembers(result, maxLinearId) == std::vector<int64_t>({ 10 }));
+
+                ASSERT(eval.evaluate(first.segmentMath, &result));
+                ASSERT(SegmentMathMembers(result, maxLinearId) == std::vector<int64_t>({ 4, 10, 11 }));
+
+                // "c" was not invalidated, so it is still the loaded copy
+                ASSERT(loads["c"] == 1);
+
+                eval.invalidate("c");
+                ASSERT(eval.evaluate(first.segmentMath, &result));
+                ASSERT(loads["c"] == 2);
+            }
+        },
+        {
+            "segment math: segments are ordered after the segments they read",
+            []
+            {
+                std::unordered_map<std::string, openset::query::Macro_s> scripts;
+                std::unordered_map<std::string, int> zIndex;
+
+                // "both" reads "red" and "big", "red_only" reads "both", "loop_a" and "loop_b" read each other
+                scripts["red_only"] = SegmentMathCompile(R"osl(difference("red", "both"))osl");
+                scripts["both"] = SegmentMathCompile(R"osl(intersection("big", "red"))osl");
+                scripts["outside"] = SegmentMathCompile(R"osl(union("big", "not_a_segment"))osl");
+                scripts["loop_a"] = SegmentMathCompile(R"osl(population("loop_b"))osl");
+                scripts["loop_b"] = SegmentMathCompile(R"osl(population("loop_a"))osl");
+
+                zIndex["red_only"] = 1;
+                zIndex["both"] = 2;
+                zIndex["outside"] = 3;
+                zIndex["red"] = 50;
+                zIndex["big"] = 10;
+                zIndex["loop_a"] = 4;
+                zIndex["loop_b"] = 5;
+
+                std::vector<std::string> names { "loop_b", "red", "outside", "both", "red_only", "big", "loop_a" };
+
+                openset::query::SegmentMath::order(
+                    names,
+                    [&scripts](const std::string& name) -> const openset::query::Macro_s*
+                    {
+                        const auto iter = scripts.find(name);
+                        return iter == scripts.end() ? nullptr : &iter->second;
+                    },
+                    [&zIndex](const std::string& name) -> int
+                    {
+                        return zIndex[name];
+                    });
+
+                const auto position = [&names](const std::string& name) -> int64_t
+                {
+                    return std::find(names.begin(), names.end(), name) - names.begin();
+                };
+
+                ASSERT(names.size() == 7);
+
+                ASSERT(position("red") < position("both"));
+                ASSERT(position("big") < position("both"));
+                ASSERT(position("both") < position("red_only"));
+                ASSERT(position("red") < position("red_only"));
+                ASSERT(position("big") < position("outside"));
+
+                // a cycle is cut, both members are still refreshed once
+                ASSERT(position("loop_a") < 7);
+                ASSERT(position("loop_b") < 7);
+
+                // with no dependencies between them, z_index decides
+                ASSERT(position("outside") < position("loop_a"));
+                ASSERT(position("outside") < position("loop_b"));
+            }
+        },
+    };
+}
@@ -232,6 +232,130 @@ inline Tests test_sessions()
 
                 ASSERT(values == "[1,3,9]");
 
+                delete interpreter;
+            }
+        },
+        {
+            "test OSL session functions",
+            []
+            {
+                // sessions are 100-102, 103-105 and 106-108 (some_val)
+                const auto testScript =
+                R"osl(
+
+                    each_row where some_val == 104
+                      debug(session_start == 1545220000000)
+                      debug(session_end == 1545220900000)
+                      debug(session_duration == 900000)
+                      debug(session_length == 3)
+                    end
+
+                    each_row where some_val == 100
+                      debug(session_start == stamp)
+                      debug(session_duration == 200000)
+                    end
+
+                    each_row where some_val == 108
+                      debug(session_end == stamp)
+                      debug(session_duration == 1200000)
+                      debug(session_length == 3)
+                    end
+
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__testsessions__", testScript, queryMacros, true);
+
+                ASSERT(queryMacros.useSessions);
+
+                auto& debug = interpreter->debugLog();
+                ASSERT(debug.size() == 9);
+                ASSERTDEBUGLOG(debug);
+
+                delete interpreter;
+            }
+        },
+        {
+            "test OSL each_row .sessions forward, reverse and continue",
+            []
+            {
+                // visits are recorded as some_val digits, so 100103106 is 100 then 103 then 106
+                const auto testScript =
+                R"osl(
+
+                    forward = 0
+                    lengths = 0
+                    each_row.sessions() where event.is(== "some event")
+                      forward = (forward * 1000) + some_val
+                      lengths = lengths + session_length
+                      debug(session_start == stamp)
+                    end
+
+                    debug(forward == 100103106)
+                    debug(lengths == 9)
+
+                    backward = 0
+                    each_row.reverse().sessions() where event.is(== "some event")
+                      backward = (backward * 1000) + some_val
+                    end
+
+                    debug(backward == 106103100)
+
+                    # from the middle of a session
+                    each_row where some_val == 104
+
+                      after = 0
+                      each_row.continue().sessions() where event.is(== "some event")
+                        after = (after * 1000) + some_val
+                      end
+                      debug(after == 106)
+
+                      after_next = 0
+                      each_row.continue().next().sessions() where event.is(== "some event")
+                        after_next = (after_next * 1000) + some_val
+                      end
+                      debug(after_next == 106)
+
+                      before = 0
+                      each_row.continue().reverse().sessions() where event.is(== "some event")
+                        before = (before * 1000) + some_val
+                      end
+                      debug(before == 103100)
+
+                    end
+
+                    # from the first row of a session
+                    each_row where some_val == 103
+
+                      from_start = 0
+                      each_row.continue().sessions() where event.is(== "some event")
+                        from_start = (from_start * 1000) + some_val
+                      end
+                      debug(from_start == 103106)
+
+                      past_start = 0
+                      each_row.continue().next().sessions() where event.is(== "some event")
+                        past_start = (past_start * 1000) + some_val
+                      end
+                      debug(past_start == 106)
+
+                      before_start = 0
+                      each_row.continue().next().reverse().sessions() where event.is(== "some event")
+                        before_start = (before_start * 1000) + some_val
+                      end
+                      debug(before_start == 100)
+
+                    end
+
+                )osl"s;
+
+                openset::query::Macro_s queryMacros;
+                const auto interpreter = TestScriptRunner("__testsessions__", testScript, queryMacros, true);
+
+                auto& debug = interpreter->debugLog();
+                ASSERT(debug.size() == 12);
+                ASSERTDEBUGLOG(debug);
+
                 delete interpreter;
             }
         },
@@ -6,6 +6,7 @@
 #include "test_osl_language.h"
 #include "test_zorder.h"
 #include "test_sessions.h"
+#include "test_segment_math.h"
 #include "test_count_methods.h"
 #include "../src/logger.h"
 
@@ -26,6 +27,7 @@ bool unitTest()
     add(test_osl_language());
     add(test_zorder());
     add(test_sessions());
+    add(test_segment_math());
     //add(test_count_methods());
 
     return runTests(allTests).size() == 0; // true if zero